@@ -0,0 +1,494 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_addr.c
+ * @author agent
+ * @brief Station address book
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+
+#include "ale_addr.h"
+
+#define ADDR_MIN_SLOTS 16
+
+struct addr_slot {
+    uint64_t key;
+    uint32_t entry;             // + 1, 0: free
+    uint16_t mask_no;
+    uint8_t kind;
+};
+
+struct ale_addr_index {
+    struct addr_slot *slots;
+    unsigned int slots_mask;
+    uint64_t *masks;            // per kind, most specific first
+    unsigned int mask_first[_NUM_ALE_ADDR_KINDS];
+    unsigned int mask_count[_NUM_ALE_ADDR_KINDS];
+    struct ale_addr_entry *entries;
+    unsigned int count;
+};
+
+static const char *kind_names[_NUM_ALE_ADDR_KINDS] = {
+    [ALE_ADDR_STATION] = "station",
+    [ALE_ADDR_NET] = "net",
+    [ALE_ADDR_DENY] = "deny",
+};
+
+// Private functions
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// Packs up to ALE_ADDR_LEN characters, upper case, NUL padded
+/// Returns the length, or -1 if longer
+static int addr_pack(const char *addr, uint64_t *value)
+{
+    uint8_t bytes[ALE_ADDR_LEN] = { 0 };
+    int len = 0;
+
+    for (; addr[len]; len++)
+    {
+        if (len == ALE_ADDR_LEN)
+            return -1;
+        bytes[len] = toupper((unsigned char) addr[len]);
+    }
+    memcpy(value, bytes, sizeof(*value));
+    return len;
+}
+
+static int pattern_parse(struct ale_addr_entry *e, const char *pattern)
+{
+    uint8_t bytes[ALE_ADDR_LEN] = { 0 }, mask[ALE_ADDR_LEN];
+    size_t len = strlen(pattern);
+    bool prefix = len && pattern[len - 1] == '*';
+
+    if (prefix)
+        len--;
+    if (len > ALE_ADDR_LEN || strcspn(pattern, "*") != len)
+        return -1;
+
+    // exact length: the padding must match too
+    memset(mask, 0xff, sizeof(mask));
+    if (prefix)
+        memset(mask + len, 0, sizeof(mask) - len);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (pattern[i] == '?')
+            mask[i] = 0;
+        else if (isgraph((unsigned char) pattern[i]))
+            bytes[i] = toupper((unsigned char) pattern[i]);
+        else
+            return -1;
+    }
+
+    memcpy(&e->value, bytes, sizeof(e->value));
+    memcpy(&e->mask, mask, sizeof(e->mask));
+    e->value &= e->mask;
+    e->min_len = len;
+    snprintf(e->pattern, sizeof(e->pattern), "%s", pattern);
+    for (char *c = e->pattern; *c; c++)
+        *c = toupper((unsigned char) *c);
+
+    return 0;
+}
+
+static unsigned int slot_hash(uint64_t key, unsigned int mask_no, unsigned int kind)
+{
+    uint64_t h = key ^ ((uint64_t) mask_no << 48) ^ ((uint64_t) kind << 56);
+
+    h *= 0x9e3779b97f4a7c15ULL;
+    return h >> 32;
+}
+
+static int entry_find(struct ale_addr_book *book, const char *pattern, enum ale_addr_kind kind)
+{
+    for (unsigned int i = 0; i < book->count; i++)
+    {
+        if (book->entries[i].kind == kind && !strcasecmp(book->entries[i].pattern, pattern))
+            return i;
+    }
+    return -1;
+}
+
+static void index_free(struct ale_addr_index *idx)
+{
+    if (!idx)
+        return;
+    free(idx->slots);
+    free(idx->masks);
+    free(idx->entries);
+    free(idx);
+}
+
+static int mask_cmp(const void *a, const void *b)
+{
+    int pa = __builtin_popcountll(*(const uint64_t *) a), pb = __builtin_popcountll(*(const uint64_t *) b);
+
+    return pb - pa;
+}
+
+static struct ale_addr_index *index_build(const struct ale_addr_entry *entries, unsigned int count)
+{
+    struct ale_addr_index *idx = calloc(1, sizeof(*idx));
+    unsigned int slots = ADDR_MIN_SLOTS, masks = 0;
+
+    if (!idx)
+        return NULL;
+    while (slots < 2 * count)
+        slots <<= 1;
+    idx->slots = calloc(slots, sizeof(*idx->slots));
+    idx->slots_mask = slots - 1;
+    idx->masks = malloc((count ? count : 1) * sizeof(*idx->masks));
+    idx->entries = malloc((count ? count : 1) * sizeof(*idx->entries));
+    if (!idx->slots || !idx->masks || !idx->entries)
+    {
+        index_free(idx);
+        return NULL;
+    }
+    memcpy(idx->entries, entries, count * sizeof(*entries));
+    idx->count = count;
+
+    // the distinct masks of each kind, there are few
+    for (int k = 0; k < _NUM_ALE_ADDR_KINDS; k++)
+    {
+        idx->mask_first[k] = masks;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            unsigned int m;
+
+            if (entries[i].kind != k)
+                continue;
+            for (m = idx->mask_first[k]; m < masks; m++)
+                if (idx->masks[m] == entries[i].mask)
+                    break;
+            if (m == masks)
+                idx->masks[masks++] = entries[i].mask;
+        }
+        idx->mask_count[k] = masks - idx->mask_first[k];
+        qsort(idx->masks + idx->mask_first[k], idx->mask_count[k], sizeof(*idx->masks), mask_cmp);
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const struct ale_addr_entry *e = &entries[i];
+        unsigned int m = idx->mask_first[e->kind], h;
+
+        while (idx->masks[m] != e->mask)
+            m++;
+        m -= idx->mask_first[e->kind];
+
+        for (h = slot_hash(e->value, m, e->kind) & idx->slots_mask; idx->slots[h].entry;
+             h = (h + 1) & idx->slots_mask)
+            ;
+        idx->slots[h].key = e->value;
+        idx->slots[h].entry = i + 1;
+        idx->slots[h].mask_no = m;
+        idx->slots[h].kind = e->kind;
+    }
+
+    return idx;
+}
+
+/// One line of the ale node: "address PATTERN KIND [NAME]" is staged,
+/// "no address PATTERN KIND" unstaged, anything else skipped
+/// Returns 0 on success, -1 with errno EINVAL on a bad address line
+static int config_line(struct ale_addr_book *book, char *line)
+{
+    char *tok[5], *save = NULL;
+    int n = 0, kind;
+    bool no;
+
+    for (char *t = strtok_r(line, " \t\r\n", &save); t && n < 5; t = strtok_r(NULL, " \t\r\n", &save))
+        tok[n++] = t;
+
+    no = n && !strcmp(tok[0], "no");
+    if (n < 1 + no || strcmp(tok[no], "address"))
+        return 0;
+    if (no ? n != 4 : n < 3 || n > 4)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    // the VTY takes any abbreviation of the kind, the initials differ
+    for (kind = 0; kind < _NUM_ALE_ADDR_KINDS; kind++)
+    {
+        if (!strncmp(kind_names[kind], tok[2 + no], strlen(tok[2 + no])))
+            break;
+    }
+    if (kind == _NUM_ALE_ADDR_KINDS)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (no)
+        return ale_addr_del(book, tok[2], kind) < 0 && errno != ENOENT ? -1 : 0;
+    return ale_addr_add(book, tok[1], kind, n == 4 ? tok[3] : NULL);
+}
+
+// User APIs
+
+struct ale_addr_book *ale_addr_alloc(void)
+{
+    return calloc(1, sizeof(struct ale_addr_book));
+}
+
+void ale_addr_free(struct ale_addr_book *book)
+{
+    index_free(atomic_load(&book->index));
+    free(book->entries);
+    free(book);
+}
+
+int ale_addr_add(struct ale_addr_book *book, const char *pattern, enum ale_addr_kind kind,
+                 const char *name)
+{
+    struct ale_addr_entry e = { .kind = kind };
+    int i;
+
+    if (kind >= _NUM_ALE_ADDR_KINDS || pattern_parse(&e, pattern) < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (name)
+        snprintf(e.name, sizeof(e.name), "%s", name);
+
+    i = entry_find(book, e.pattern, kind);
+    if (i < 0)
+    {
+        if (book->count == book->alloc)
+        {
+            unsigned int alloc = book->alloc ? 2 * book->alloc : 64;
+            struct ale_addr_entry *entries = realloc(book->entries, alloc * sizeof(*entries));
+
+            if (!entries)
+                return -1;
+            book->entries = entries;
+            book->alloc = alloc;
+        }
+        i = book->count++;
+    }
+    book->entries[i] = e;
+
+    return book->loading ? 0 : ale_addr_commit(book);
+}
+
+int ale_addr_del(struct ale_addr_book *book, const char *pattern, enum ale_addr_kind kind)
+{
+    int i = entry_find(book, pattern, kind);
+
+    if (i < 0)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    memmove(&book->entries[i], &book->entries[i + 1], (book->count - i - 1) * sizeof(*book->entries));
+    book->count--;
+
+    return book->loading ? 0 : ale_addr_commit(book);
+}
+
+void ale_addr_clear(struct ale_addr_book *book)
+{
+    book->count = 0;
+}
+
+int ale_addr_commit(struct ale_addr_book *book)
+{
+    uint64_t start = monotonic_ns();
+    struct ale_addr_index *idx = index_build(book->entries, book->count);
+
+    if (!idx)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // lookups are on this thread, nobody holds the old one
+    index_free(atomic_exchange(&book->index, idx));
+    book->stats.commits++;
+    book->stats.commit_ns = monotonic_ns() - start;
+
+    return 0;
+}
+
+const struct ale_addr_entry *ale_addr_lookup(struct ale_addr_book *book, enum ale_addr_kind kind,
+                                             const char *addr)
+{
+    struct ale_addr_index *idx = atomic_load_explicit(&book->index, memory_order_acquire);
+    uint64_t value;
+    int len;
+
+    book->stats.lookups++;
+    if (!idx || kind >= _NUM_ALE_ADDR_KINDS)
+        return NULL;
+    len = addr_pack(addr, &value);
+    if (len < 0)
+        return NULL;
+
+    for (unsigned int m = 0; m < idx->mask_count[kind]; m++)
+    {
+        uint64_t key = value & idx->masks[idx->mask_first[kind] + m];
+        unsigned int h = slot_hash(key, m, kind) & idx->slots_mask;
+
+        for (; idx->slots[h].entry; h = (h + 1) & idx->slots_mask)
+        {
+            const struct addr_slot *s = &idx->slots[h];
+            const struct ale_addr_entry *e;
+
+            book->stats.probes++;
+            if (s->key != key || s->mask_no != m || s->kind != kind)
+                continue;
+            e = &idx->entries[s->entry - 1];
+            if (len >= e->min_len)
+            {
+                book->stats.hits++;
+                return e;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void ale_addr_index_size(struct ale_addr_book *book, unsigned int *entries, unsigned int *masks)
+{
+    struct ale_addr_index *idx = atomic_load(&book->index);
+
+    *entries = idx ? idx->count : 0;
+    *masks = 0;
+    for (int k = 0; idx && k < _NUM_ALE_ADDR_KINDS; k++)
+        *masks += idx->mask_count[k];
+}
+
+struct ale_addr_book *ale_addr_read(const char *path, unsigned int *line)
+{
+    struct ale_addr_book *book;
+    bool in_ale = false;
+    char buf[256];
+    FILE *f;
+
+    *line = 0;
+    f = fopen(path, "r");
+    if (!f)
+        return NULL;
+    book = ale_addr_alloc();
+    if (!book)
+    {
+        fclose(f);
+        errno = ENOMEM;
+        return NULL;
+    }
+    book->loading = true;
+
+    while (fgets(buf, sizeof(buf), f))
+    {
+        const char *c = buf + strspn(buf, " \t");
+
+        (*line)++;
+        if (*c == '!' || *c == '#' || *c == '\n' || !*c)
+            continue;
+        // a node starts in the first column, its commands are indented
+        if (c == buf)
+        {
+            in_ale = !strncmp(buf, "ale", 3) && strchr(" \t\r\n", buf[3]);
+            continue;
+        }
+        if (in_ale && config_line(book, buf) < 0)
+        {
+            int err = errno;
+
+            fclose(f);
+            ale_addr_free(book);
+            errno = err;
+            return NULL;
+        }
+    }
+    if (ferror(f))
+    {
+        fclose(f);
+        ale_addr_free(book);
+        errno = EIO;
+        return NULL;
+    }
+
+    fclose(f);
+    book->loading = false;
+    return book;
+}
+
+int ale_addr_replace(struct ale_addr_book *book, struct ale_addr_book *from)
+{
+    uint64_t start = monotonic_ns();
+    struct ale_addr_index *idx = index_build(from->entries, from->count);
+    struct ale_addr_entry *entries = book->entries;
+    unsigned int count = book->count, alloc = book->alloc;
+
+    if (!idx)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    book->entries = from->entries;
+    book->count = from->count;
+    book->alloc = from->alloc;
+    from->entries = entries;
+    from->count = count;
+    from->alloc = alloc;
+
+    index_free(atomic_exchange(&book->index, idx));
+    book->stats.commits++;
+    book->stats.commit_ns = monotonic_ns() - start;
+
+    return 0;
+}
+
+const char *ale_addr_kind_name(enum ale_addr_kind kind)
+{
+    return kind < _NUM_ALE_ADDR_KINDS ? kind_names[kind] : "?";
+}
+
+int ale_addr_kind_by_name(const char *name)
+{
+    for (int k = 0; k < _NUM_ALE_ADDR_KINDS; k++)
+    {
+        if (!strcmp(kind_names[k], name))
+            return k;
+    }
+    return -1;
+}
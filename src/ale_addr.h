@@ -0,0 +1,142 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_addr.h
+ * @author agent
+ * @brief Station address book
+ *
+ * Address patterns from the config file ("address" in the ale node), of
+ * up to ALE_ADDR_LEN characters:
+ *
+ *  PY2ABC    exactly this address
+ *  PY2*      any address starting with PY2
+ *  PY?ABC    '?' stands for any one character, also before a '*'
+ *
+ * Each pattern is an address value and a byte mask over the address packed
+ * into 64 bits. The index is an open addressing hash table of (value, mask)
+ * pairs and, per kind, the distinct masks, most specific first. A lookup
+ * probes once per distinct mask: the exact match first, then the wildcard
+ * and prefix shapes. The cost depends on the shapes in use, not on the
+ * number of entries.
+ *
+ * Entries are staged in the book; ale_addr_commit() builds a new index
+ * aside and swaps it in with one pointer store. Lookups keep using the
+ * old index until then, so reloading thousands of entries never holds up
+ * a call. Lookups and commits happen on the main thread.
+ *
+ * A reload reads the address lines of the config file alone into a
+ * scratch book (ale_addr_read()) and swaps its entries and index in with
+ * ale_addr_replace() once all of them parsed: a bad file leaves the book
+ * in use and its staged entries as they were.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define ALE_ADDR_LEN 8          // ARQ_CALLSIGN_LEN
+#define ALE_ADDR_NAME_LEN 32
+
+enum ale_addr_kind {
+    ALE_ADDR_STATION,           // a known station
+    ALE_ADDR_NET,               // our own net or group address, calls to it are answered
+    ALE_ADDR_DENY,              // calls from it are ignored
+    _NUM_ALE_ADDR_KINDS
+};
+
+struct ale_addr_entry {
+    char pattern[ALE_ADDR_LEN + 2];
+    char name[ALE_ADDR_NAME_LEN];
+    uint8_t kind;
+    uint8_t min_len;            // '?' stands for a character that must be there
+    uint64_t value;             // packed, masked
+    uint64_t mask;
+};
+
+struct ale_addr_index;
+
+struct ale_addr_stats {
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long probes;
+    unsigned long commits;
+    uint64_t commit_ns;         // the last one
+};
+
+struct ale_addr_book {
+    // staged entries, in config order
+    struct ale_addr_entry *entries;
+    unsigned int count;
+    unsigned int alloc;
+    bool loading;               // no commit per change while reading the config
+
+    _Atomic(struct ale_addr_index *) index;
+
+    struct ale_addr_stats stats;
+};
+
+struct ale_addr_book *ale_addr_alloc(void);
+
+void ale_addr_free(struct ale_addr_book *book);
+
+/// Stages an entry, replacing one of the same pattern and kind. Commits
+/// right away unless book->loading
+/// Returns 0 on success, -1 with errno set on error (EINVAL: bad pattern)
+int ale_addr_add(struct ale_addr_book *book, const char *pattern, enum ale_addr_kind kind,
+                 const char *name);
+
+/// Returns 0 on success, -1 with errno ENOENT if there is no such entry
+int ale_addr_del(struct ale_addr_book *book, const char *pattern, enum ale_addr_kind kind);
+
+/// Removes all staged entries, the index stays until the next commit
+void ale_addr_clear(struct ale_addr_book *book);
+
+/// Builds the index of the staged entries and swaps it in
+/// Returns 0 on success, -1 with errno set on error (the old index stays)
+int ale_addr_commit(struct ale_addr_book *book);
+
+/// Reads the "address" and "no address" lines of the ale node of a config
+/// file into a new book, staged and not indexed; other lines are skipped
+/// Returns the book, or NULL with errno set (EINVAL: bad address line,
+/// *line is its number)
+struct ale_addr_book *ale_addr_read(const char *path, unsigned int *line);
+
+/// Indexes the staged entries of from and swaps both the entries and the
+/// index into book. from gets the old entries, for the caller to free
+/// Returns 0 on success, -1 with errno set on error (both books unchanged)
+int ale_addr_replace(struct ale_addr_book *book, struct ale_addr_book *from);
+
+/// Most specific entry of a kind matching an address, or NULL
+const struct ale_addr_entry *ale_addr_lookup(struct ale_addr_book *book, enum ale_addr_kind kind,
+                                             const char *addr);
+
+/// Entries and distinct masks in the index
+void ale_addr_index_size(struct ale_addr_book *book, unsigned int *entries, unsigned int *masks);
+
+const char *ale_addr_kind_name(enum ale_addr_kind kind);
+
+/// The kind of a name, or -1
+int ale_addr_kind_by_name(const char *name);
@@ -0,0 +1,432 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * @file ale_ardop.c
+ * @author agent
+ * @brief ARDOP compatible TNC interface
+ *
+ * Command port (8515 by default) and data port (command port + 1) pair of
+ * the ARDOP TNC host interface (doc/ARDOP Specification.pdf), ARQ mode
+ * only. Commands and the BUFFER reports go through the command port layer
+ * shared with the VARA interface. On the data port every block is
+ * prefixed with its length (2 bytes, big endian); host blocks are read
+ * straight into the TX ring, blocks to the host are tagged "ARQ". The data
+ * port is one of the RX readers and TX writers of the host layer.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/netif/stream.h>
+
+#include "internal.h"
+#include "ale_pool.h"
+
+#define ARDOP_BW 2300
+#define ARDOP_RX_BLOCK 2048	// data bytes per block to the host
+#define ARDOP_RX_POOL (ALE_DATA_RING_SIZE / ARDOP_RX_BLOCK)	// blocks of a full RX ring
+#define ARDOP_RX_RETRY_USECS 100000
+
+struct ardop_tnc {
+	struct ale_station *st;
+	struct osmo_stream_srv_link *cmd_link;
+	struct osmo_stream_srv_link *data_link;
+	struct ale_host_cmd cmd;
+	struct osmo_stream_srv *data;
+	struct ale_host_rx rx;
+	struct ale_host_tx tx;
+
+	// host block being read
+	uint8_t hdr[2];
+	size_t hdr_len;
+	size_t remain;
+
+	bool listen;
+	const char *state;	// last NEWSTATE
+
+	struct osmo_timer_list rx_timer;
+	struct ale_pool *rx_pool;
+	struct ale_host_if hif;
+};
+
+static const char *ardop_state(struct ale_station *st)
+{
+	if (ale_station_idle(st))
+		return "DISC";
+	return ale_station_has_turn(st) ? "ISS" : "IRS";
+}
+
+static void ardop_newstate(struct ardop_tnc *ardop)
+{
+	const char *state = ardop_state(ardop->st);
+
+	if (state == ardop->state)
+		return;
+	ardop->state = state;
+	ale_host_cmd_reply(&ardop->cmd, "NEWSTATE %s", state);
+}
+
+/* Reads the data port again, it owns its TX stream and the ring has room */
+static void ardop_data_resume(struct ale_host_tx *tx)
+{
+	struct ardop_tnc *ardop = tx->priv;
+
+	if (ardop->data)
+		osmo_fd_read_enable(osmo_stream_srv_get_ofd(ardop->data));
+}
+
+static void ardop_rx_flush(struct ardop_tnc *ardop)
+{
+	struct ale_station *st = ardop->st;
+	size_t len;
+
+	if (!ardop->data)
+		return;
+
+	while ((len = ale_host_rx_pending(st, &ardop->rx))) {
+		struct msgb *msg;
+
+		if (len > ARDOP_RX_BLOCK)
+			len = ARDOP_RX_BLOCK;
+		/* the rest stays in the RX ring until the socket drained some
+		 * blocks, where a slow client is handled like any lagging reader */
+		msg = ale_msgb_take(ardop->rx_pool, "ardop-rx");
+		if (!msg) {
+			osmo_timer_schedule(&ardop->rx_timer, 0, ARDOP_RX_RETRY_USECS);
+			return;
+		}
+		msgb_put_u16(msg, len + 3);
+		memcpy(msgb_put(msg, 3), "ARQ", 3);
+		ale_host_rx_read(st, &ardop->rx, msgb_put(msg, len), len);
+		osmo_stream_srv_send(ardop->data, msg);
+	}
+}
+
+static void ardop_rx_timer_cb(void *data)
+{
+	ardop_rx_flush(data);
+}
+
+/* Settings of the ARDOP modem itself, accepted and ignored */
+static const char *ardop_noop_cmds[] = {
+	"ARQBW", "ARQTIMEOUT", "AUTOBREAK", "BUSYBLOCK", "BUSYDET", "CWID",
+	"DRIVELEVEL", "ENABLEPINGACK", "FECID", "FECMODE", "FECREPEATS",
+	"GRIDSQUARE", "LEADER", "MONITOR", "SQUELCH", "TRAILER", "TUNINGRANGE",
+};
+
+static void ardop_command(struct ale_host_cmd *cmd, int argc, char **argv)
+{
+	struct ardop_tnc *ardop = cmd->priv;
+	struct ale_station *st = ardop->st;
+
+	if (!strcasecmp(argv[0], "INITIALIZE")) {
+		ardop->state = NULL;
+		ale_host_cmd_reply(cmd, "INITIALIZE");
+		ardop_newstate(ardop);
+	} else if (!strcasecmp(argv[0], "MYCALL")) {
+		if (argc < 2) {
+			ale_host_cmd_reply(cmd, "MYCALL %s", st->callsign);
+			return;
+		}
+		if (strlen(argv[1]) > ARQ_CALLSIGN_LEN)
+			goto fault;
+		OSMO_STRLCPY_ARRAY(st->callsign, argv[1]);
+		ale_host_cmd_reply(cmd, "MYCALL now %s", st->callsign);
+	} else if (!strcasecmp(argv[0], "LISTEN")) {
+		if (argc >= 2) {
+			ardop->listen = !strcasecmp(argv[1], "TRUE");
+			ale_station_listen(st, ardop->listen);
+			ale_host_cmd_reply(cmd, "LISTEN now %s", ardop->listen ? "TRUE" : "FALSE");
+		} else {
+			ale_host_cmd_reply(cmd, "LISTEN %s", ardop->listen ? "TRUE" : "FALSE");
+		}
+	} else if (!strcasecmp(argv[0], "ARQCALL") && argc >= 2) {
+		if (strlen(argv[1]) > ARQ_CALLSIGN_LEN || ale_station_call(st, argv[1]) < 0)
+			goto fault;
+		ale_host_cmd_reply(cmd, "ARQCALL %s %s", argv[1], argc > 2 ? argv[2] : "5");
+		ardop_newstate(ardop);
+	} else if (!strcasecmp(argv[0], "DISCONNECT")) {
+		ale_station_disconnect(st, false);
+		ale_host_cmd_reply(cmd, "DISCONNECT");
+	} else if (!strcasecmp(argv[0], "ABORT") || !strcasecmp(argv[0], "DD")) {
+		ale_station_disconnect(st, true);
+		ale_host_cmd_reply(cmd, "ABORT");
+	} else if (!strcasecmp(argv[0], "STATE")) {
+		ale_host_cmd_reply(cmd, "STATE %s", ardop_state(st));
+	} else if (!strcasecmp(argv[0], "BUFFER")) {
+		ale_host_cmd_buffer(cmd, st, true);
+	} else if (!strcasecmp(argv[0], "PURGEBUFFER")) {
+		circular_buf_reset(ale_host_tx_ring(st, &ardop->tx));
+		ardop->remain = ardop->hdr_len = 0;
+		ale_host_cmd_reply(cmd, "PURGEBUFFER");
+		ale_host_cmd_buffer(cmd, st, false);
+		ale_host_tx_schedule(st);
+	} else if (!strcasecmp(argv[0], "VERSION")) {
+		ale_host_cmd_reply(cmd, "VERSION rhizo-ale %s", PACKAGE_VERSION);
+	} else if (!strcasecmp(argv[0], "PROTOCOLMODE")) {
+		if (argc >= 2 && strcasecmp(argv[1], "ARQ"))
+			goto fault;
+		ale_host_cmd_reply(cmd, argc >= 2 ? "PROTOCOLMODE now ARQ" : "PROTOCOLMODE ARQ");
+	} else {
+		for (int i = 0; i < ARRAY_SIZE(ardop_noop_cmds); i++) {
+			if (!strcasecmp(argv[0], ardop_noop_cmds[i])) {
+				if (argc >= 2)
+					ale_host_cmd_reply(cmd, "%s now %s", ardop_noop_cmds[i], argv[1]);
+				else
+					ale_host_cmd_reply(cmd, "%s", ardop_noop_cmds[i]);
+				return;
+			}
+		}
+		ale_host_cmd_reply(cmd, "FAULT %s command not supported", argv[0]);
+	}
+	return;
+
+fault:
+	ale_host_cmd_reply(cmd, "FAULT %s", argv[0]);
+}
+
+static int ardop_cmd_read_cb(struct osmo_stream_srv *conn)
+{
+	struct ardop_tnc *ardop = osmo_stream_srv_get_data(conn);
+
+	return ale_host_cmd_read(&ardop->cmd);
+}
+
+static int ardop_cmd_closed_cb(struct osmo_stream_srv *conn)
+{
+	struct ardop_tnc *ardop = osmo_stream_srv_get_data(conn);
+
+	LOGP(ALE, LOGL_NOTICE, "ARDOP command client disconnected\n");
+	ale_host_cmd_attach(&ardop->cmd, NULL);
+	return 0;
+}
+
+static int ardop_data_read_cb(struct osmo_stream_srv *conn)
+{
+	struct ardop_tnc *ardop = osmo_stream_srv_get_data(conn);
+	struct osmo_fd *ofd = osmo_stream_srv_get_ofd(conn);
+	cbuf_handle_t ring;
+	size_t quota;
+	ssize_t rc;
+
+	if (!ardop->remain) {
+		rc = recv(ofd->fd, ardop->hdr + ardop->hdr_len, sizeof(ardop->hdr) - ardop->hdr_len, 0);
+		if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+			return 0;
+		if (rc <= 0)
+			goto closed;
+		ardop->hdr_len += rc;
+		if (ardop->hdr_len < sizeof(ardop->hdr))
+			return 0;
+		ardop->remain = osmo_load16be(ardop->hdr);
+		ardop->hdr_len = 0;
+		return 0;
+	}
+
+	ring = ale_host_tx_ring(ardop->st, &ardop->tx);
+	quota = ale_host_tx_quota(ardop->st, &ardop->tx);
+	rc = ale_host_sock_to_ring(ofd->fd, ring, OSMO_MIN(ardop->remain, quota));
+	if (rc == -EAGAIN) {
+		if (!circular_buf_free_size(ring) || !quota) {
+			osmo_fd_read_disable(ofd);
+			ale_host_tx_wait(ardop->st, &ardop->tx);
+		}
+		return 0;
+	}
+	if (rc <= 0)
+		goto closed;
+
+	ardop->remain -= rc;
+	ale_host_tx_wrote(ardop->st, &ardop->tx, rc);
+	ale_host_cmd_buffer(&ardop->cmd, ardop->st, false);
+	return 0;
+
+closed:
+	osmo_stream_srv_destroy(conn);
+	return -EBADF;
+}
+
+static int ardop_data_closed_cb(struct osmo_stream_srv *conn)
+{
+	struct ardop_tnc *ardop = osmo_stream_srv_get_data(conn);
+
+	LOGP(ALE, LOGL_NOTICE, "ARDOP data client disconnected\n");
+	ardop->data = NULL;
+	ardop->remain = ardop->hdr_len = 0;
+	ale_host_rx_detach(ardop->st, &ardop->rx);
+	ale_host_tx_detach(ardop->st, &ardop->tx);
+	osmo_timer_del(&ardop->rx_timer);
+	return 0;
+}
+
+static int ardop_cmd_accept_cb(struct osmo_stream_srv_link *link, int fd)
+{
+	struct ardop_tnc *ardop = osmo_stream_srv_link_get_data(link);
+	struct osmo_stream_srv *conn;
+
+	if (ardop->cmd.conn) {
+		LOGP(ALE, LOGL_NOTICE, "ARDOP command port busy, rejecting client\n");
+		close(fd);
+		return -EBUSY;
+	}
+
+	conn = osmo_stream_srv_create(ardop, link, fd, ardop_cmd_read_cb, ardop_cmd_closed_cb, ardop);
+	if (!conn) {
+		close(fd);
+		return -ENOMEM;
+	}
+	ale_host_cmd_attach(&ardop->cmd, conn);
+	ardop->state = NULL;
+
+	LOGP(ALE, LOGL_NOTICE, "ARDOP command client connected\n");
+	return 0;
+}
+
+static int ardop_data_accept_cb(struct osmo_stream_srv_link *link, int fd)
+{
+	struct ardop_tnc *ardop = osmo_stream_srv_link_get_data(link);
+
+	if (ardop->data) {
+		LOGP(ALE, LOGL_NOTICE, "ARDOP data port busy, rejecting client\n");
+		close(fd);
+		return -EBUSY;
+	}
+
+	ardop->data = osmo_stream_srv_create(ardop, link, fd, ardop_data_read_cb, ardop_data_closed_cb, ardop);
+	if (!ardop->data) {
+		close(fd);
+		return -ENOMEM;
+	}
+
+	ardop->rx.cls = ardop->st->ardop_class;
+	ale_host_rx_attach(ardop->st, &ardop->rx);
+	ardop->tx.prio = ardop->st->ardop_prio;
+	ardop->tx.cls = ardop->st->ardop_class;
+	ale_host_tx_attach(ardop->st, &ardop->tx);
+
+	LOGP(ALE, LOGL_NOTICE, "ARDOP data client connected\n");
+	ardop_rx_flush(ardop);
+	return 0;
+}
+
+static void ardop_event(struct ale_host_if *hif, struct ale_station *st, enum ale_host_event ev)
+{
+	struct ardop_tnc *ardop = hif->priv;
+	struct ale_host_cmd *cmd = &ardop->cmd;
+
+	switch (ev) {
+	case ALE_HOST_PENDING:
+		ale_host_cmd_reply(cmd, "PENDING");
+		ale_host_cmd_reply(cmd, "TARGET %s", st->callsign);
+		break;
+	case ALE_HOST_CANCELPENDING:
+		ale_host_cmd_reply(cmd, "CANCELPENDING");
+		break;
+	case ALE_HOST_CONNECTED:
+		ale_host_cmd_reply(cmd, "CONNECTED %s %d", st->remote, ARDOP_BW);
+		break;
+	case ALE_HOST_DISCONNECTED:
+		ale_host_cmd_reply(cmd, "DISCONNECTED");
+		break;
+	case ALE_HOST_PTT_ON:
+		ale_host_cmd_reply(cmd, "PTT TRUE");
+		break;
+	case ALE_HOST_PTT_OFF:
+		ale_host_cmd_reply(cmd, "PTT FALSE");
+		break;
+	case ALE_HOST_BUFFER:
+		ale_host_cmd_buffer(cmd, st, false);
+		break;
+	case ALE_HOST_RX_DATA:
+		ardop_rx_flush(ardop);
+		break;
+	case ALE_HOST_TURN:
+		break;
+	}
+
+	ardop_newstate(ardop);
+}
+
+int ale_ardop_init(void *ctx, struct ale_station *st)
+{
+	struct ardop_tnc *ardop;
+
+	if (!st->ardop_port)
+		return 0;
+
+	ardop = talloc_zero(ctx, struct ardop_tnc);
+	OSMO_ASSERT(ardop);
+	ardop->st = st;
+	ardop->listen = true;
+	osmo_timer_setup(&ardop->rx_timer, ardop_rx_timer_cb, ardop);
+	ardop->rx_pool = ale_msgb_pool_alloc(ardop, "ardop-rx", ARDOP_RX_BLOCK + 5, ARDOP_RX_POOL);
+	ardop->rx = (struct ale_host_rx) {
+		.name = "ARDOP",
+		.priv = ardop,
+	};
+	ardop->tx = (struct ale_host_tx) {
+		.name = "ARDOP",
+		.resume = ardop_data_resume,
+		.priv = ardop,
+	};
+
+	ardop->cmd = (struct ale_host_cmd) {
+		.name = "ARDOP",
+		.command = ardop_command,
+		.priv = ardop,
+	};
+	ardop->cmd_link = ale_host_listen(ardop, st, st->ardop_port, ardop_cmd_accept_cb, ardop);
+	ardop->data_link = ale_host_listen(ardop, st, st->ardop_port + 1, ardop_data_accept_cb, ardop);
+	if (!ardop->cmd_link || !ardop->data_link) {
+		if (ardop->cmd_link)
+			osmo_stream_srv_link_destroy(ardop->cmd_link);
+		if (ardop->data_link)
+			osmo_stream_srv_link_destroy(ardop->data_link);
+		talloc_free(ardop);
+		return -1;
+	}
+
+	ardop->hif = (struct ale_host_if) {
+		.name = "ardop",
+		.event = ardop_event,
+		.priv = ardop,
+	};
+	ale_host_register(&ardop->hif);
+
+	LOGP(ALE, LOGL_NOTICE, "ARDOP TNC on port %u (data %u)\n", st->ardop_port, st->ardop_port + 1);
+	return 0;
+}
@@ -0,0 +1,685 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_arq.c
+ * @author agent
+ * @brief Selective repeat ARQ
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ale_arq.h"
+#include "ale_lat.h"
+
+// Private functions
+
+#define SLOT(seq) ((seq) % ARQ_MAX_WINDOW)
+
+static unsigned int window_for_mode(const struct ale_mode *mode)
+{
+    unsigned int window = ARQ_WINDOW_BYTES / mode->payload_bytes;
+
+    if (window < 1)
+        window = 1;
+    if (window > ARQ_MAX_WINDOW)
+        window = ARQ_MAX_WINDOW;
+
+    return window;
+}
+
+static uint8_t tx_outstanding(struct ale_arq *arq)
+{
+    return (uint8_t) (arq->tx_next - arq->tx_base);
+}
+
+// data bytes a frame of the given mode can carry
+static size_t frame_capacity(const struct ale_mode *mode, bool with_ack)
+{
+    size_t cap = mode->payload_bytes - ARQ_DATA_HDR_LEN - (with_ack ? ARQ_ACK_LEN : 0);
+
+    return cap > ARQ_MAX_PAYLOAD ? ARQ_MAX_PAYLOAD : cap;
+}
+
+static size_t frag_capacity(const struct ale_mode *mode)
+{
+    return mode->payload_bytes - ARQ_FRAG_HDR_LEN;
+}
+
+static uint64_t rx_bitmap(struct ale_arq *arq)
+{
+    uint64_t bitmap = 0;
+
+    for (unsigned int i = 0; i < ARQ_MAX_WINDOW - 1; i++)
+    {
+        struct ale_arq_slot *slot = &arq->rx[SLOT(arq->rx_base + 1 + i)];
+
+        if (slot->used && slot->seq == (uint8_t) (arq->rx_base + 1 + i))
+            bitmap |= (uint64_t) 1 << i;
+    }
+
+    return bitmap;
+}
+
+static size_t ring_read(void *priv, uint8_t *buf, size_t len)
+{
+    struct ale_arq *arq = priv;
+    size_t size = circular_buf_size(arq->tx_data);
+
+    if (len > size)
+        len = size;
+    if (!len || circular_buf_get_range(arq->tx_data, buf, len))
+        return 0;
+
+    return len;
+}
+
+static bool ring_write(void *priv, const uint8_t *buf, size_t len)
+{
+    struct ale_arq *arq = priv;
+
+    if (circular_buf_free_size(arq->rx_data) < len)
+        return false;
+    circular_buf_put_range(arq->rx_data, (uint8_t *) buf, len);
+
+    return true;
+}
+
+static bool ring_pending(void *priv)
+{
+    struct ale_arq *arq = priv;
+
+    return !circular_buf_empty(arq->tx_data);
+}
+
+static size_t ring_avail(void *priv)
+{
+    struct ale_arq *arq = priv;
+
+    return circular_buf_size(arq->tx_data);
+}
+
+// hands in-order frames to the RX side while it has room for them
+static void rx_deliver(struct ale_arq *arq)
+{
+    struct ale_arq_slot *slot = &arq->rx[SLOT(arq->rx_base)];
+
+    uint64_t now = ale_lat_now();
+
+    while (slot->used && slot->seq == arq->rx_base)
+    {
+        if (slot->len && !arq->io->write(arq->io->priv, slot->data, slot->len))
+            break;
+
+        ale_lat_since(ALE_LAT_RX_ARQ, slot->born_us, now);
+        arq->stats.rx_bytes += slot->len;
+        slot->used = false;
+        arq->rx_base++;
+        slot = &arq->rx[SLOT(arq->rx_base)];
+    }
+}
+
+static void rx_ack(struct ale_arq *arq, uint8_t base, uint64_t bitmap)
+{
+    uint8_t out = tx_outstanding(arq);
+    uint8_t cum = (uint8_t) (base - arq->tx_base);
+
+    arq->stats.rx_acks++;
+
+    // stale or bogus acknowledgement
+    if (cum > out)
+        return;
+
+    for (uint8_t seq = arq->tx_base; seq != base; seq++)
+        arq->tx[SLOT(seq)].acked = true;
+
+    for (unsigned int i = 0; i < ARQ_MAX_WINDOW - 1; i++)
+    {
+        uint8_t seq = base + 1 + i;
+
+        if ((uint8_t) (seq - arq->tx_base) >= out)
+            break;
+        if (bitmap & ((uint64_t) 1 << i))
+            arq->tx[SLOT(seq)].acked = true;
+    }
+
+    while (arq->tx_base != arq->tx_next && arq->tx[SLOT(arq->tx_base)].acked)
+    {
+        arq->tx[SLOT(arq->tx_base)].used = false;
+        arq->tx_base++;
+    }
+}
+
+static void rx_data(struct ale_arq *arq, uint8_t seq, const uint8_t *data, uint16_t len,
+                    uint16_t unit, uint8_t index, uint16_t total)
+{
+    uint8_t offset = seq - arq->rx_base;
+    struct ale_arq_slot *slot = &arq->rx[SLOT(seq)];
+
+    arq->ack_pending = true;
+    arq->stats.rx_frames++;
+
+    if (offset >= ARQ_MAX_WINDOW)
+    {
+        // already delivered: the peer missed our acknowledgement
+        if (offset >= 256 - ARQ_MAX_WINDOW)
+            arq->stats.rx_duplicates++;
+        else
+            arq->stats.rx_out_of_window++;
+        return;
+    }
+
+    if (slot->used && slot->seq == seq)
+    {
+        arq->stats.rx_duplicates++;
+        return;
+    }
+
+    if (unit)
+    {
+        unsigned int count = (total + unit - 1) / unit;
+
+        arq->stats.rx_fragments++;
+        if (slot->seq != seq || slot->frag_unit != unit || slot->frag_total != total)
+        {
+            slot->seq = seq;
+            slot->frag_unit = unit;
+            slot->frag_total = total;
+            slot->frag_mask = 0;
+        }
+
+        memcpy(slot->data + index * unit, data, len);
+        slot->frag_mask |= (uint64_t) 1 << index;
+        if (slot->frag_mask != (count == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << count) - 1))
+            return;
+        len = total;
+    }
+    else
+    {
+        memcpy(slot->data, data, len);
+    }
+
+    slot->used = true;
+    slot->seq = seq;
+    slot->len = len;
+    slot->frag_unit = 0;
+    slot->frag_mask = 0;
+    slot->born_us = ale_lat_now();
+
+    rx_deliver(arq);
+}
+
+// fills a new slot from the TX side
+static bool tx_new_frame(struct ale_arq *arq, bool with_ack)
+{
+    struct ale_arq_slot *slot = &arq->tx[SLOT(arq->tx_next)];
+    size_t len = arq->io->read(arq->io->priv, slot->data, frame_capacity(arq->mode, with_ack));
+
+    if (!len)
+        return false;
+
+    slot->used = true;
+    slot->acked = false;
+    slot->seq = arq->tx_next;
+    slot->len = len;
+    slot->tx_count = 0;
+    slot->mode = arq->mode;
+    slot->born_us = ale_lat_now();
+    arq->tx_next++;
+
+    return true;
+}
+
+static const char callsign_chars[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ/-";
+
+// 8 characters, 6 bits each
+static void callsign_pack(uint8_t *out, const char *callsign)
+{
+    uint64_t v = 0;
+
+    for (int i = 0; i < ARQ_CALLSIGN_LEN; i++)
+    {
+        const char *p = NULL;
+        char c = *callsign;
+
+        if (c)
+        {
+            callsign++;
+            if (c >= 'a' && c <= 'z')
+                c -= 'a' - 'A';
+            p = strchr(callsign_chars, c);
+        }
+        v = (v << 6) | (p ? (uint64_t) (p - callsign_chars) : 0);
+    }
+
+    for (int i = 5; i >= 0; i--)
+    {
+        out[i] = v & 0xff;
+        v >>= 8;
+    }
+}
+
+static void callsign_unpack(char *out, const uint8_t *in)
+{
+    uint64_t v = 0;
+    int len = 0;
+
+    for (int i = 0; i < 6; i++)
+        v = (v << 8) | in[i];
+
+    for (int i = ARQ_CALLSIGN_LEN - 1; i >= 0; i--)
+    {
+        unsigned int idx = (v >> (6 * i)) & 0x3f;
+
+        out[len++] = idx < sizeof(callsign_chars) - 1 ? callsign_chars[idx] : ' ';
+    }
+
+    while (len && out[len - 1] == ' ')
+        len--;
+    out[len] = 0;
+}
+
+// User APIs
+
+struct ale_arq *ale_arq_alloc(cbuf_handle_t tx_data, cbuf_handle_t rx_data, const struct ale_mode *mode)
+{
+    assert(tx_data && rx_data && mode);
+
+    struct ale_arq *arq = calloc(1, sizeof(struct ale_arq));
+    assert(arq);
+
+    arq->tx_data = tx_data;
+    arq->rx_data = rx_data;
+    arq->ring_io = (struct ale_arq_io) {
+        .read = ring_read,
+        .write = ring_write,
+        .pending = ring_pending,
+        .avail = ring_avail,
+        .priv = arq,
+    };
+    arq->io = &arq->ring_io;
+    arq->ack_snr = ARQ_SNR_UNKNOWN;
+    ale_arq_set_mode(arq, mode);
+
+    return arq;
+}
+
+void ale_arq_free(struct ale_arq *arq)
+{
+    free(arq);
+}
+
+void ale_arq_reset(struct ale_arq *arq)
+{
+    for (int i = 0; i < ARQ_MAX_WINDOW; i++)
+    {
+        arq->tx[i].used = false;
+        arq->rx[i].used = false;
+        arq->rx[i].frag_mask = 0;
+        arq->rx[i].frag_unit = 0;
+    }
+
+    arq->tx_base = arq->tx_next = 0;
+    arq->rx_base = 0;
+    arq->burst_len = arq->burst_pos = 0;
+    arq->ack_pending = false;
+    arq->ack_snr = ARQ_SNR_UNKNOWN;
+    memset(&arq->stats, 0, sizeof(arq->stats));
+}
+
+void ale_arq_set_io(struct ale_arq *arq, const struct ale_arq_io *io)
+{
+    arq->io = io ? io : &arq->ring_io;
+}
+
+void ale_arq_set_mode(struct ale_arq *arq, const struct ale_mode *mode)
+{
+    arq->mode = mode;
+    arq->window = window_for_mode(mode);
+}
+
+const struct ale_mode *ale_arq_ack_mode(const struct ale_mode *mode)
+{
+    const struct ale_mode *datac0 = ale_mode_get(ALE_MODE_DATAC0);
+
+    if (mode->min_snr_db < datac0->min_snr_db || !ale_mode_usable(datac0))
+        return ale_mode_get(ALE_MODE_DATAC13);
+
+    return datac0;
+}
+
+void ale_arq_set_rx_snr(struct ale_arq *arq, bool valid, float snr_db)
+{
+    float half_db = snr_db * 2;
+
+    if (!valid)
+        arq->ack_snr = ARQ_SNR_UNKNOWN;
+    else if (half_db <= ARQ_SNR_UNKNOWN + 1)
+        arq->ack_snr = ARQ_SNR_UNKNOWN + 1;
+    else if (half_db >= 127)
+        arq->ack_snr = 127;
+    else
+        arq->ack_snr = (int8_t) (half_db + (half_db < 0 ? -0.5f : 0.5f));
+}
+
+bool ale_arq_tx_pending(struct ale_arq *arq)
+{
+    return arq->tx_base != arq->tx_next || arq->io->pending(arq->io->priv);
+}
+
+size_t ale_arq_tx_inflight(struct ale_arq *arq)
+{
+    size_t bytes = 0;
+
+    for (uint8_t seq = arq->tx_base; seq != arq->tx_next; seq++)
+    {
+        if (!arq->tx[SLOT(seq)].acked)
+            bytes += arq->tx[SLOT(seq)].len;
+    }
+
+    return bytes;
+}
+
+unsigned int ale_arq_turn_begin(struct ale_arq *arq)
+{
+    unsigned int airtime = 0;
+    bool ack = arq->ack_pending;
+
+    arq->burst_len = arq->burst_pos = 0;
+    arq->stats.turns++;
+
+    // the RX ring may have been drained by the host since last turn
+    rx_deliver(arq);
+
+    // retransmissions first, in sequence order
+    for (uint8_t seq = arq->tx_base; seq != arq->tx_next; seq++)
+    {
+        struct ale_arq_slot *slot = &arq->tx[SLOT(seq)];
+
+        unsigned int frags = 1;
+        uint16_t unit = 0;
+
+        if (slot->acked)
+            continue;
+
+        // retransmissions go out in the current mode, in pieces if needed
+        slot->mode = arq->mode;
+        if (slot->len > frame_capacity(arq->mode, false))
+        {
+            unit = frag_capacity(arq->mode);
+            frags = (slot->len + unit - 1) / unit;
+        }
+
+        if (arq->burst_len + frags + 1 > ARQ_MAX_BURST ||
+            (arq->burst_len && airtime + frags * arq->mode->frame_ms > ARQ_BURST_MS))
+            break;
+
+        // no room to piggyback the acknowledgement on the first frame
+        if (ack && !arq->burst_len &&
+            (unit || slot->len > frame_capacity(arq->mode, true)))
+        {
+            arq->burst[arq->burst_len++] = (struct ale_arq_burst) { ARQ_BURST_ACK, 0, 0, 0 };
+            airtime += ale_arq_ack_mode(arq->mode)->frame_ms;
+        }
+
+        for (unsigned int i = 0; i < frags; i++)
+        {
+            arq->burst[arq->burst_len++] = (struct ale_arq_burst) { ARQ_BURST_DATA, seq, i, unit };
+            airtime += arq->mode->frame_ms;
+        }
+    }
+
+    // then new data, as far as the window and the turn airtime allow
+    while (tx_outstanding(arq) < arq->window &&
+           arq->burst_len < ARQ_MAX_BURST &&
+           (!arq->burst_len || airtime + arq->mode->frame_ms <= ARQ_BURST_MS))
+    {
+        uint8_t seq = arq->tx_next;
+
+        if (!tx_new_frame(arq, ack && !arq->burst_len))
+            break;
+
+        arq->burst[arq->burst_len++] = (struct ale_arq_burst) { ARQ_BURST_DATA, seq, 0, 0 };
+        airtime += arq->mode->frame_ms;
+    }
+
+    // nothing to send: acknowledgement (or keep-alive) only
+    if (!arq->burst_len)
+        arq->burst[arq->burst_len++] = (struct ale_arq_burst) { ARQ_BURST_ACK, 0, 0, 0 };
+
+    return arq->burst_len;
+}
+
+int ale_arq_tx_frame(struct ale_arq *arq, uint8_t *buf, size_t size, const struct ale_mode **mode)
+{
+    struct ale_arq_burst *b;
+    size_t pos = 1;
+
+    if (arq->burst_pos >= arq->burst_len)
+        return 0;
+
+    b = &arq->burst[arq->burst_pos];
+    *mode = b->kind == ARQ_BURST_DATA ? arq->tx[SLOT(b->seq)].mode : ale_arq_ack_mode(arq->mode);
+
+    if (size < (*mode)->payload_bytes)
+        return -1;
+
+    memset(buf, 0, (*mode)->payload_bytes);
+
+    if (arq->burst_pos == arq->burst_len - 1)
+        buf[0] |= ARQ_HDR_EOT;
+
+    if (arq->burst_pos == 0 && arq->ack_pending)
+    {
+        uint64_t bitmap = rx_bitmap(arq);
+
+        buf[0] |= ARQ_HDR_ACK;
+        buf[pos++] = arq->rx_base;
+        for (int i = 0; i < 8; i++)
+            buf[pos++] = (bitmap >> (8 * i)) & 0xff;
+        buf[pos++] = (uint8_t) arq->ack_snr;
+
+        arq->ack_pending = false;
+        arq->stats.tx_acks++;
+    }
+
+    arq->tx_frame_born_us = 0;
+    if (b->kind == ARQ_BURST_DATA)
+    {
+        struct ale_arq_slot *slot = &arq->tx[SLOT(b->seq)];
+        const uint8_t *data = slot->data;
+        uint16_t len = slot->len;
+
+        arq->tx_frame_born_us = slot->born_us;
+
+        buf[0] |= ARQ_HDR_DATA;
+        if (b->frag_unit)
+        {
+            data += b->frag_index * b->frag_unit;
+            len = slot->len - b->frag_index * b->frag_unit;
+            if (len > b->frag_unit)
+                len = b->frag_unit;
+            buf[0] |= ARQ_HDR_FRAG;
+        }
+
+        buf[pos++] = slot->seq;
+        buf[pos++] = len >> 8;
+        buf[pos++] = len & 0xff;
+        if (b->frag_unit)
+        {
+            buf[pos++] = b->frag_unit >> 8;
+            buf[pos++] = b->frag_unit & 0xff;
+            buf[pos++] = b->frag_index;
+            buf[pos++] = slot->len >> 8;
+            buf[pos++] = slot->len & 0xff;
+            arq->stats.tx_fragments++;
+        }
+        assert(pos + len <= (*mode)->payload_bytes);
+        memcpy(buf + pos, data, len);
+
+        // one retransmission per frame, not per fragment
+        if (!b->frag_unit || !b->frag_index)
+        {
+            if (slot->tx_count++)
+                arq->stats.tx_retransmissions++;
+            else
+                arq->stats.tx_bytes += slot->len;
+        }
+    }
+
+    arq->stats.tx_frames++;
+    arq->burst_pos++;
+
+    return (*mode)->payload_bytes;
+}
+
+int ale_arq_rx_frame(struct ale_arq *arq, const uint8_t *buf, size_t len, struct ale_arq_ctrl *ctrl)
+{
+    size_t pos = 1;
+    uint8_t flags;
+
+    if (len < 1)
+        return -1;
+
+    flags = buf[0];
+
+    if (flags & ARQ_HDR_CTRL)
+    {
+        if (len < 14)
+            return -1;
+        if (ctrl)
+        {
+            memset(ctrl, 0, sizeof(*ctrl));
+            ctrl->type = buf[0] & 0x0f;
+            if (ctrl->type == ARQ_CTRL_DICT)
+            {
+                ctrl->dict_id = ((uint32_t) buf[1] << 24) | (buf[2] << 16) | (buf[3] << 8) | buf[4];
+                callsign_unpack(ctrl->src, buf + 5);
+                return flags & 0xf0;
+            }
+            callsign_unpack(ctrl->dst, buf + 1);
+            callsign_unpack(ctrl->src, buf + 7);
+            ctrl->caps = buf[13];
+        }
+        return flags & 0xf0;
+    }
+
+    if (flags & ARQ_HDR_ACK)
+    {
+        uint64_t bitmap = 0;
+
+        if (len < pos + ARQ_ACK_LEN)
+            return -1;
+        for (int i = 0; i < 8; i++)
+            bitmap |= (uint64_t) buf[pos + 1 + i] << (8 * i);
+        rx_ack(arq, buf[pos], bitmap);
+        if ((int8_t) buf[pos + 9] != ARQ_SNR_UNKNOWN)
+        {
+            arq->stats.peer_snr_db = (int8_t) buf[pos + 9] / 2.0f;
+            arq->stats.rx_snr_reports++;
+        }
+        pos += ARQ_ACK_LEN;
+    }
+
+    if (flags & ARQ_HDR_DATA)
+    {
+        size_t hdr = (flags & ARQ_HDR_FRAG) ? ARQ_FRAG_HDR_LEN - 1 : ARQ_DATA_HDR_LEN - 1;
+        uint16_t data_len, unit = 0, total = 0;
+        uint8_t index = 0;
+
+        if (len < pos + hdr)
+            return -1;
+        data_len = (buf[pos + 1] << 8) | buf[pos + 2];
+        if (flags & ARQ_HDR_FRAG)
+        {
+            unit = (buf[pos + 3] << 8) | buf[pos + 4];
+            index = buf[pos + 5];
+            total = (buf[pos + 6] << 8) | buf[pos + 7];
+            // the index must name one of the fragments, not the end of the payload
+            if (!unit || !data_len || data_len > unit || total > ARQ_MAX_PAYLOAD ||
+                (total + unit - 1) / unit > 64 || index >= (total + unit - 1) / unit ||
+                index * unit + data_len > total)
+                return -1;
+        }
+        if (data_len > ARQ_MAX_PAYLOAD || len < pos + hdr + data_len)
+            return -1;
+        rx_data(arq, buf[pos], buf + pos + hdr, data_len, unit, index, total);
+    }
+
+    return flags;
+}
+
+int ale_arq_ctrl_encode(uint8_t *buf, size_t size, const struct ale_arq_ctrl *ctrl)
+{
+    if (size < 14)
+        return -1;
+
+    memset(buf, 0, size);
+    buf[0] = ARQ_HDR_CTRL | ARQ_HDR_EOT | (ctrl->type & 0x0f);
+    if (ctrl->type == ARQ_CTRL_DICT)
+    {
+        buf[1] = ctrl->dict_id >> 24;
+        buf[2] = ctrl->dict_id >> 16;
+        buf[3] = ctrl->dict_id >> 8;
+        buf[4] = ctrl->dict_id;
+        callsign_pack(buf + 5, ctrl->src);
+        return 14;
+    }
+    callsign_pack(buf + 1, ctrl->dst);
+    callsign_pack(buf + 7, ctrl->src);
+    buf[13] = ctrl->caps;
+
+    return 14;
+}
+
+int ale_arq_ui_encode(uint8_t *buf, size_t size, const uint8_t *data, size_t len)
+{
+    if (len > ARQ_MAX_PAYLOAD || size < ARQ_UI_HDR_LEN + len)
+        return -1;
+
+    memset(buf, 0, size);
+    buf[0] = ARQ_HDR_UI;
+    buf[1] = len >> 8;
+    buf[2] = len & 0xff;
+    memcpy(buf + ARQ_UI_HDR_LEN, data, len);
+
+    return ARQ_UI_HDR_LEN + len;
+}
+
+int ale_arq_ui_decode(const uint8_t *buf, size_t len, const uint8_t **data)
+{
+    size_t data_len;
+
+    if (len < ARQ_UI_HDR_LEN || buf[0] != ARQ_HDR_UI)
+        return -1;
+
+    data_len = (buf[1] << 8) | buf[2];
+    if (!data_len || data_len > ARQ_MAX_PAYLOAD || len < ARQ_UI_HDR_LEN + data_len)
+        return -1;
+
+    *data = buf + ARQ_UI_HDR_LEN;
+    return data_len;
+}
@@ -0,0 +1,236 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_arq.h
+ * @author agent
+ * @brief Selective repeat ARQ
+ *
+ * Data link layer carrying the TX data ring of one station to the RX data
+ * ring of the other one. Traffic is organized in turns (ROLE_TX/ROLE_RX
+ * of the FSM): in each turn a station sends a burst of data frames, the
+ * first one carrying the acknowledgement (cumulative sequence number plus
+ * a 64 frame bitmap) of everything received in the previous turn of the
+ * peer, and the last one flagged with end-of-turn. The acknowledgement
+ * also reports the SNR the peer frames arrive with, the sender picks its
+ * speed level on that and not on the SNR of the reverse path.
+ *
+ * Frame layout (padded with zeros to the mode payload size):
+ *
+ *   flags | [ack base | ack bitmap (8, LE) | snr] | [seq | len (2, BE) | data]
+ *   flags | [ack ...] | seq | len | unit (2) | index | total (2) | data
+ *   flags | CTRL type | dst (6) | src (6) | caps       (call control)
+ *   flags | CTRL type | dict id (4, BE) | src (6)     (ARQ_CTRL_DICT)
+ *   flags | len (2, BE) | data                        (UI, unconnected)
+ *
+ * The second form is a fragment: when the level goes down, frames built
+ * for a faster mode are retransmitted in pieces of "unit" bytes in the new
+ * mode. Acknowledgements stay per sequence number.
+ *
+ * UI frames carry KISS frames outside of a session, sent once in the
+ * smallest data mode that fits them, without acknowledgement.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+#include "ale_mode.h"
+
+#define ARQ_MAX_WINDOW 64
+#define ARQ_MAX_PAYLOAD 512
+#define ARQ_WINDOW_BYTES 8192   // bytes in flight, sets the window of each mode
+#define ARQ_BURST_MS 20000      // maximum airtime of one turn
+
+#define ARQ_HDR_DATA 0x80
+#define ARQ_HDR_ACK  0x40
+#define ARQ_HDR_EOT  0x20
+#define ARQ_HDR_CTRL 0x10
+#define ARQ_HDR_FRAG 0x08
+#define ARQ_HDR_UI   0x04       // alone in the flags byte
+
+#define ARQ_DATA_HDR_LEN 4      // flags, seq, len
+#define ARQ_FRAG_HDR_LEN 9      // flags, seq, len, unit, index, total
+#define ARQ_MAX_BURST 128
+#define ARQ_ACK_LEN 10          // base, bitmap, snr
+#define ARQ_SNR_UNKNOWN -128    // snr byte (0.5 dB steps) when nothing was measured
+#define ARQ_UI_HDR_LEN 3        // flags, len
+
+#define ARQ_CALLSIGN_LEN 8
+
+enum ale_arq_ctrl_type {
+    ARQ_CTRL_CALL = 1,
+    ARQ_CTRL_CALL_ACK,
+    ARQ_CTRL_DISC,
+    ARQ_CTRL_SOUND,             // to no one, for the LQA of who hears it
+    ARQ_CTRL_DICT,              // full compression dictionary id, ahead of a CALL
+};
+
+struct ale_arq_ctrl {
+    enum ale_arq_ctrl_type type;
+    char dst[ARQ_CALLSIGN_LEN + 1];
+    char src[ARQ_CALLSIGN_LEN + 1];
+    uint8_t caps;
+    uint32_t dict_id;           // ARQ_CTRL_DICT only, dst is empty then
+};
+
+struct ale_arq_slot {
+    bool used;
+    bool acked;
+    uint8_t seq;
+    uint16_t len;
+    unsigned int tx_count;
+    const struct ale_mode *mode;
+    // fragments received so far (receiver side)
+    uint16_t frag_unit;
+    uint16_t frag_total;
+    uint64_t frag_mask;
+    // taken from the TX queue / complete (us), for the latency accounting
+    uint64_t born_us;
+    uint8_t data[ARQ_MAX_PAYLOAD];
+};
+
+struct ale_arq_stats {
+    unsigned long tx_frames;
+    unsigned long tx_retransmissions;
+    unsigned long tx_bytes;
+    unsigned long tx_acks;
+    unsigned long rx_frames;
+    unsigned long rx_duplicates;
+    unsigned long rx_out_of_window;
+    unsigned long rx_bytes;
+    unsigned long rx_acks;
+    unsigned long rx_snr_reports;   // acknowledgements with the peer SNR
+    float peer_snr_db;              // SNR of our frames at the peer, last report
+    unsigned long tx_fragments;
+    unsigned long rx_fragments;
+    unsigned long turns;
+};
+
+enum ale_arq_burst_kind {
+    ARQ_BURST_ACK,
+    ARQ_BURST_DATA,
+};
+
+struct ale_arq_burst {
+    enum ale_arq_burst_kind kind;
+    uint8_t seq;
+    uint8_t frag_index;     // fragments only, frag_unit != 0
+    uint16_t frag_unit;
+};
+
+/// Where the ARQ takes the data to send and puts the data received. By
+/// default the TX and RX rings, a compression stage replaces it
+struct ale_arq_io {
+    /// Fills buf with up to len bytes, returns the count
+    size_t (*read)(void *priv, uint8_t *buf, size_t len);
+    /// Takes all the len bytes or none (returns false)
+    bool (*write)(void *priv, const uint8_t *buf, size_t len);
+    /// True if read() has data
+    bool (*pending)(void *priv);
+    /// Bytes read() would return right now (an estimate if compressed)
+    size_t (*avail)(void *priv);
+    void *priv;
+};
+
+struct ale_arq {
+    cbuf_handle_t tx_data;
+    cbuf_handle_t rx_data;
+    struct ale_arq_io ring_io;
+    const struct ale_arq_io *io;
+    const struct ale_mode *mode;
+    unsigned int window;
+
+    // sender
+    uint8_t tx_base;    // oldest unacknowledged
+    uint8_t tx_next;
+    struct ale_arq_slot tx[ARQ_MAX_WINDOW];
+
+    // frames of the current turn
+    struct ale_arq_burst burst[ARQ_MAX_BURST];
+    unsigned int burst_len;
+    unsigned int burst_pos;
+    uint64_t tx_frame_born_us;  // of the data in the last frame, 0 if none
+
+    // receiver
+    uint8_t rx_base;    // next in-order sequence number
+    bool ack_pending;
+    int8_t ack_snr;     // ARQ_SNR_UNKNOWN or SNR of the peer frames, 0.5 dB
+    struct ale_arq_slot rx[ARQ_MAX_WINDOW];
+
+    struct ale_arq_stats stats;
+};
+
+/// Creates an ARQ engine between the TX and RX data rings
+struct ale_arq *ale_arq_alloc(cbuf_handle_t tx_data, cbuf_handle_t rx_data, const struct ale_mode *mode);
+
+void ale_arq_free(struct ale_arq *arq);
+
+/// Clears both windows, for a new session. Data in the rings is kept
+void ale_arq_reset(struct ale_arq *arq);
+
+/// Replaces the data source and sink of the ARQ, NULL restores the rings
+void ale_arq_set_io(struct ale_arq *arq, const struct ale_arq_io *io);
+
+/// Mode for the next data frames, retransmissions included
+void ale_arq_set_mode(struct ale_arq *arq, const struct ale_mode *mode);
+
+/// SNR the peer frames were received with, reported to the peer in our
+/// next acknowledgement
+void ale_arq_set_rx_snr(struct ale_arq *arq, bool valid, float snr_db);
+
+/// True if there is data waiting to be sent or in flight
+bool ale_arq_tx_pending(struct ale_arq *arq);
+
+/// Bytes sent and not acknowledged yet
+size_t ale_arq_tx_inflight(struct ale_arq *arq);
+
+/// Plans the frames of our turn: acknowledgement, retransmissions, then new
+/// data. Returns the number of frames of the turn (at least one)
+unsigned int ale_arq_turn_begin(struct ale_arq *arq);
+
+/// Writes the next frame of the turn into buf, returns its length (the
+/// payload size of *mode) or 0 once the turn is over
+int ale_arq_tx_frame(struct ale_arq *arq, uint8_t *buf, size_t size, const struct ale_mode **mode);
+
+/// Processes a frame received from the peer. Returns the frame flags
+/// (ARQ_HDR_*) or -1 if the frame is malformed. ctrl is filled for CTRL
+/// frames and may be NULL
+int ale_arq_rx_frame(struct ale_arq *arq, const uint8_t *buf, size_t len, struct ale_arq_ctrl *ctrl);
+
+/// Encodes a call control frame, returns its length or -1
+int ale_arq_ctrl_encode(uint8_t *buf, size_t size, const struct ale_arq_ctrl *ctrl);
+
+/// Mode used for acknowledgement-only frames for a given data mode
+const struct ale_mode *ale_arq_ack_mode(const struct ale_mode *mode);
+
+/// Encodes a UI frame, returns its length or -1 if size is not enough
+int ale_arq_ui_encode(uint8_t *buf, size_t size, const uint8_t *data, size_t len);
+
+/// Data of a UI frame, returns its length or -1 if the frame is malformed
+int ale_arq_ui_decode(const uint8_t *buf, size_t len, const uint8_t **data);
@@ -0,0 +1,175 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_batch.c
+ * @author agent
+ * @brief TX frame aggregation
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "ale_batch.h"
+
+const char *ale_batch_reason_names[_NUM_BATCH_REASONS] = {
+    [BATCH_FULL] = "full",
+    [BATCH_DEADLINE] = "deadline",
+    [BATCH_TURNOVER] = "turnover",
+    [BATCH_DISABLED] = "disabled",
+};
+
+// Private functions
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static void frame_out(struct ale_batch *batch, size_t len, size_t cap, enum ale_batch_reason reason)
+{
+    batch->stats.frames++;
+    batch->stats.bytes += len;
+    batch->stats.capacity += cap;
+    batch->stats.flushes[reason]++;
+}
+
+static size_t io_read(void *priv, uint8_t *buf, size_t len)
+{
+    struct ale_batch *batch = priv;
+    const struct ale_arq_io *src = batch->src;
+    enum ale_batch_reason reason;
+    uint64_t age;
+    size_t n;
+
+    ale_batch_poll(batch);
+    if (!batch->waiting)
+        return 0;
+
+    age = now_ms() - batch->since_ms;
+
+    if (src->avail(src->priv) >= len)
+        reason = BATCH_FULL;
+    else if (!batch->deadline_ms)
+        reason = BATCH_DISABLED;
+    else if (age >= batch->deadline_ms)
+        reason = BATCH_DEADLINE;
+    else if (age + batch->next_turn_ms >= batch->deadline_ms)
+        reason = BATCH_TURNOVER;
+    else
+    {
+        batch->stats.holds++;
+        return 0;
+    }
+
+    n = src->read(src->priv, buf, len);
+    if (n)
+        frame_out(batch, n, len, reason);
+
+    // the rest keeps the age of what just went out, it may be as old
+    ale_batch_poll(batch);
+
+    return n;
+}
+
+static bool io_write(void *priv, const uint8_t *buf, size_t len)
+{
+    struct ale_batch *batch = priv;
+
+    return batch->src->write(batch->src->priv, buf, len);
+}
+
+static bool io_pending(void *priv)
+{
+    struct ale_batch *batch = priv;
+
+    return batch->src->pending(batch->src->priv);
+}
+
+static size_t io_avail(void *priv)
+{
+    struct ale_batch *batch = priv;
+
+    return batch->src->avail(batch->src->priv);
+}
+
+// User APIs
+
+struct ale_batch *ale_batch_alloc(const struct ale_arq_io *src, unsigned int deadline_ms)
+{
+    struct ale_batch *batch = calloc(1, sizeof(struct ale_batch));
+    assert(batch);
+
+    batch->deadline_ms = deadline_ms;
+    batch->io = (struct ale_arq_io) {
+        .read = io_read,
+        .write = io_write,
+        .pending = io_pending,
+        .avail = io_avail,
+        .priv = batch,
+    };
+    ale_batch_set_source(batch, src);
+
+    return batch;
+}
+
+void ale_batch_free(struct ale_batch *batch)
+{
+    free(batch);
+}
+
+void ale_batch_set_source(struct ale_batch *batch, const struct ale_arq_io *src)
+{
+    assert(src && src->avail);
+
+    batch->src = src;
+    batch->waiting = false;
+}
+
+void ale_batch_poll(struct ale_batch *batch)
+{
+    bool pending = batch->src->pending(batch->src->priv);
+
+    if (pending && !batch->waiting)
+        batch->since_ms = now_ms();
+    batch->waiting = pending;
+}
+
+void ale_batch_turn(struct ale_batch *batch, unsigned int next_turn_ms)
+{
+    batch->next_turn_ms = next_turn_ms;
+}
+
+double ale_batch_fill(const struct ale_batch_stats *stats)
+{
+    if (!stats->capacity)
+        return 0.0;
+
+    return (double) stats->bytes / stats->capacity;
+}
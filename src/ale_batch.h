@@ -0,0 +1,94 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_batch.h
+ * @author agent
+ * @brief TX frame aggregation
+ *
+ * Sits in front of the ARQ data source and only lets full frames through.
+ * A partly filled frame costs the same airtime as a full one, so the tail
+ * of small host writes is held back until more data fills it, or until
+ * the oldest held byte would miss its deadline: either the deadline has
+ * already expired, or it expires before our next turn and the turnover
+ * is about to happen. A deadline of 0 disables the stage.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include "ale_arq.h"
+
+enum ale_batch_reason {
+    BATCH_FULL,         // enough data for a full frame
+    BATCH_DEADLINE,     // oldest byte reached the deadline
+    BATCH_TURNOVER,     // deadline would expire before our next turn
+    BATCH_DISABLED,     // no deadline configured
+    _NUM_BATCH_REASONS
+};
+
+extern const char *ale_batch_reason_names[_NUM_BATCH_REASONS];
+
+struct ale_batch_stats {
+    unsigned long frames;
+    unsigned long bytes;        // data bytes in those frames
+    unsigned long capacity;     // and the bytes they could carry
+    unsigned long flushes[_NUM_BATCH_REASONS];
+    unsigned long holds;        // partial frames kept for the next turn
+};
+
+struct ale_batch {
+    const struct ale_arq_io *src;
+    struct ale_arq_io io;
+    unsigned int deadline_ms;
+
+    // when the source was first seen with data (oldest byte, roughly)
+    bool waiting;
+    uint64_t since_ms;
+    // expected time until our next turn, set before each turn
+    unsigned int next_turn_ms;
+
+    struct ale_batch_stats stats;
+};
+
+/// Creates the stage in front of src, with a deadline in ms (0: disabled)
+struct ale_batch *ale_batch_alloc(const struct ale_arq_io *src, unsigned int deadline_ms);
+
+void ale_batch_free(struct ale_batch *batch);
+
+/// Changes the data source (ring or compression stage)
+void ale_batch_set_source(struct ale_batch *batch, const struct ale_arq_io *src);
+
+/// Notes when data shows up in the source, called periodically
+void ale_batch_poll(struct ale_batch *batch);
+
+/// Before the turn: expected milliseconds until the following one
+void ale_batch_turn(struct ale_batch *batch, unsigned int next_turn_ms);
+
+/// Average fill of the data frames, 0 to 1
+double ale_batch_fill(const struct ale_batch_stats *stats);
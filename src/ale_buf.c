@@ -36,6 +36,9 @@
 
 #include "ale_buf.h"
 #include "ale_shm.h"
+#include "ale_probe.h"
+
+void (*circular_buf_trace)(cbuf_handle_t cbuf, int op, size_t len);
 
 // Private functions
 
@@ -43,11 +46,10 @@ static void advance_pointer_n(cbuf_handle_t cbuf, size_t len)
 {
     assert(cbuf);
 
-    fprintf(stderr, "head = %ld\n", cbuf->internal->head);
-
     if(cbuf->internal->full)
     {
         cbuf->internal->tail = (cbuf->internal->tail + len) % cbuf->internal->max;
+        cbuf->internal->consumed += len;
     }
 
     cbuf->internal->head = (cbuf->internal->head + len) % cbuf->internal->max;
@@ -63,6 +65,7 @@ static void advance_pointer(cbuf_handle_t cbuf)
     if(cbuf->internal->full)
     {
         cbuf->internal->tail = (cbuf->internal->tail + 1) % cbuf->internal->max;
+        cbuf->internal->consumed++;
     }
 
     cbuf->internal->head = (cbuf->internal->head + 1) % cbuf->internal->max;
@@ -77,6 +80,7 @@ static void retreat_pointer_n(cbuf_handle_t cbuf, size_t len)
 
     cbuf->internal->full = false;
     cbuf->internal->tail = (cbuf->internal->tail + len) % cbuf->internal->max;
+    cbuf->internal->consumed += len;
 }
 
 static void retreat_pointer(cbuf_handle_t cbuf)
@@ -85,6 +89,43 @@ static void retreat_pointer(cbuf_handle_t cbuf)
 
     cbuf->internal->full = false;
     cbuf->internal->tail = (cbuf->internal->tail + 1) % cbuf->internal->max;
+    cbuf->internal->consumed++;
+}
+
+// copies len bytes in or out of the regions of an iovec pair, from offset
+static void iov_copy(struct iovec *iov, int n, size_t offset, uint8_t *data, size_t len, bool in)
+{
+    for (int i = 0; i < n && len; i++)
+    {
+        if (offset >= iov[i].iov_len)
+        {
+            offset -= iov[i].iov_len;
+            continue;
+        }
+
+        size_t chunk = iov[i].iov_len - offset;
+        if (chunk > len)
+            chunk = len;
+
+        if (in)
+            memcpy((uint8_t *) iov[i].iov_base + offset, data, chunk);
+        else
+            memcpy(data, (uint8_t *) iov[i].iov_base + offset, chunk);
+
+        data += chunk;
+        len -= chunk;
+        offset = 0;
+    }
+}
+
+static size_t iov_size(struct iovec *iov, int n)
+{
+    size_t size = 0;
+
+    for (int i = 0; i < n; i++)
+        size += iov[i].iov_len;
+
+    return size;
 }
 
 // User APIs
@@ -101,8 +142,11 @@ cbuf_handle_t circular_buf_init(uint8_t* buffer, size_t size)
 
     cbuf->buffer = buffer;
     cbuf->internal->max = size;
-    circular_buf_reset(cbuf);
+    cbuf->internal->head = cbuf->internal->tail = 0;
+    cbuf->internal->full = false;
+    cbuf->internal->consumed = 0;
     atomic_flag_clear(&cbuf->internal->acquire);
+    circular_buf_reset(cbuf);
 
     assert(circular_buf_empty(cbuf));
 
@@ -138,6 +182,9 @@ cbuf_handle_t circular_buf_init_shm(size_t size, key_t key)
     assert(cbuf->internal);
 
     cbuf->internal->max = size;
+    cbuf->internal->head = cbuf->internal->tail = 0;
+    cbuf->internal->full = false;
+    cbuf->internal->consumed = 0;
     atomic_flag_clear(&cbuf->internal->acquire);
     circular_buf_reset(cbuf);
 
@@ -182,17 +229,35 @@ void circular_buf_free_shm(cbuf_handle_t cbuf, size_t size, key_t key)
     free(cbuf);
 }
 
+void circular_buf_disconnect_shm(cbuf_handle_t cbuf, size_t size, key_t key)
+{
+    assert(cbuf && cbuf->internal && cbuf->buffer);
+    shm_dettach(key, size, cbuf->buffer);
+    shm_dettach(key+1, sizeof(struct circular_buf_t_aux), cbuf->internal);
+    free(cbuf);
+}
+
 void circular_buf_reset(cbuf_handle_t cbuf)
 {
     assert(cbuf && cbuf->internal);
 
     while (atomic_flag_test_and_set(&cbuf->internal->acquire));
 
+    // discarded data counts as consumed, readers positions stay valid
+    if (cbuf->internal->full)
+        cbuf->internal->consumed += cbuf->internal->max;
+    else
+        cbuf->internal->consumed += (cbuf->internal->max + cbuf->internal->head -
+                                     cbuf->internal->tail) % cbuf->internal->max;
+
     cbuf->internal->head = 0;
     cbuf->internal->tail = 0;
     cbuf->internal->full = false;
 
     atomic_flag_clear(&cbuf->internal->acquire);
+
+    if (circular_buf_trace)
+        circular_buf_trace(cbuf, CBUF_OP_RESET, 0);
 }
 
 size_t circular_buf_size(cbuf_handle_t cbuf)
@@ -218,7 +283,6 @@ size_t circular_buf_size(cbuf_handle_t cbuf)
 
     atomic_flag_clear(&cbuf->internal->acquire);
 
-    fprintf(stderr, "size = %ld\n", size);
     return size;
 }
 
@@ -350,9 +414,14 @@ int circular_buf_get_range(cbuf_handle_t cbuf, uint8_t *data, size_t len)
         }
 
         retreat_pointer_n(cbuf, len);
+        ALE_PROBE6(ring__get, cbuf, len, cbuf->internal->head, cbuf->internal->tail,
+                   cbuf->internal->max, cbuf->internal->full);
 
         atomic_flag_clear(&cbuf->internal->acquire);
 
+        if (circular_buf_trace)
+            circular_buf_trace(cbuf, CBUF_OP_GET, len);
+
         r = 0;
     }
 
@@ -381,11 +450,236 @@ int circular_buf_put_range(cbuf_handle_t cbuf, uint8_t * data, size_t len)
         }
 
         advance_pointer_n(cbuf, len);
+        ALE_PROBE6(ring__put, cbuf, len, cbuf->internal->head, cbuf->internal->tail,
+                   cbuf->internal->max, cbuf->internal->full);
 
         atomic_flag_clear(&cbuf->internal->acquire);
 
+        if (circular_buf_trace)
+            circular_buf_trace(cbuf, CBUF_OP_PUT, len);
+
         r = 0;
     }
 
     return r;
 }
+
+int circular_buf_free_iov(cbuf_handle_t cbuf, struct iovec iov[2])
+{
+    assert(cbuf && cbuf->internal && cbuf->buffer && iov);
+
+    int n = 0;
+
+    while (atomic_flag_test_and_set(&cbuf->internal->acquire));
+
+    size_t head = cbuf->internal->head;
+    size_t tail = cbuf->internal->tail;
+    size_t max = cbuf->internal->max;
+
+    if (!cbuf->internal->full)
+    {
+        if (head >= tail)
+        {
+            iov[n].iov_base = cbuf->buffer + head;
+            iov[n++].iov_len = max - head;
+            if (tail)
+            {
+                iov[n].iov_base = cbuf->buffer;
+                iov[n++].iov_len = tail;
+            }
+        }
+        else
+        {
+            iov[n].iov_base = cbuf->buffer + head;
+            iov[n++].iov_len = tail - head;
+        }
+    }
+
+    atomic_flag_clear(&cbuf->internal->acquire);
+
+    return n;
+}
+
+void circular_buf_commit(cbuf_handle_t cbuf, size_t len)
+{
+    assert(cbuf && cbuf->internal);
+
+    if (!len)
+        return;
+
+    while (atomic_flag_test_and_set(&cbuf->internal->acquire));
+
+    advance_pointer_n(cbuf, len);
+    ALE_PROBE6(ring__put, cbuf, len, cbuf->internal->head, cbuf->internal->tail,
+               cbuf->internal->max, cbuf->internal->full);
+
+    atomic_flag_clear(&cbuf->internal->acquire);
+
+    if (circular_buf_trace)
+        circular_buf_trace(cbuf, CBUF_OP_PUT, len);
+}
+
+int circular_buf_data_iov(cbuf_handle_t cbuf, struct iovec iov[2])
+{
+    assert(cbuf && cbuf->internal && cbuf->buffer && iov);
+
+    int n = 0;
+
+    while (atomic_flag_test_and_set(&cbuf->internal->acquire));
+
+    size_t head = cbuf->internal->head;
+    size_t tail = cbuf->internal->tail;
+    size_t max = cbuf->internal->max;
+
+    if (cbuf->internal->full || head != tail)
+    {
+        if (head > tail)
+        {
+            iov[n].iov_base = cbuf->buffer + tail;
+            iov[n++].iov_len = head - tail;
+        }
+        else
+        {
+            iov[n].iov_base = cbuf->buffer + tail;
+            iov[n++].iov_len = max - tail;
+            if (head)
+            {
+                iov[n].iov_base = cbuf->buffer;
+                iov[n++].iov_len = head;
+            }
+        }
+    }
+
+    atomic_flag_clear(&cbuf->internal->acquire);
+
+    return n;
+}
+
+void circular_buf_consume(cbuf_handle_t cbuf, size_t len)
+{
+    assert(cbuf && cbuf->internal);
+
+    if (!len)
+        return;
+
+    while (atomic_flag_test_and_set(&cbuf->internal->acquire));
+
+    retreat_pointer_n(cbuf, len);
+    ALE_PROBE6(ring__get, cbuf, len, cbuf->internal->head, cbuf->internal->tail,
+               cbuf->internal->max, cbuf->internal->full);
+
+    atomic_flag_clear(&cbuf->internal->acquire);
+
+    if (circular_buf_trace)
+        circular_buf_trace(cbuf, CBUF_OP_GET, len);
+}
+
+uint64_t circular_buf_read_pos(cbuf_handle_t cbuf)
+{
+    assert(cbuf && cbuf->internal);
+
+    while (atomic_flag_test_and_set(&cbuf->internal->acquire));
+
+    uint64_t pos = cbuf->internal->consumed;
+
+    atomic_flag_clear(&cbuf->internal->acquire);
+
+    return pos;
+}
+
+int circular_buf_peek_iov(cbuf_handle_t cbuf, uint64_t pos, struct iovec iov[2])
+{
+    assert(cbuf && cbuf->internal && cbuf->buffer && iov);
+
+    int n = 0;
+
+    while (atomic_flag_test_and_set(&cbuf->internal->acquire));
+
+    size_t head = cbuf->internal->head;
+    size_t tail = cbuf->internal->tail;
+    size_t max = cbuf->internal->max;
+    size_t size = cbuf->internal->full ? max : (max + head - tail) % max;
+    uint64_t consumed = cbuf->internal->consumed;
+
+    atomic_flag_clear(&cbuf->internal->acquire);
+
+    if (pos < consumed)
+        return -1;
+    if (pos - consumed >= size)
+        return 0;
+
+    size_t start = (tail + (pos - consumed)) % max;
+    size_t len = size - (pos - consumed);
+
+    if (start + len <= max)
+    {
+        iov[n].iov_base = cbuf->buffer + start;
+        iov[n++].iov_len = len;
+    }
+    else
+    {
+        iov[n].iov_base = cbuf->buffer + start;
+        iov[n++].iov_len = max - start;
+        iov[n].iov_base = cbuf->buffer;
+        iov[n++].iov_len = len - (max - start);
+    }
+
+    return n;
+}
+
+int circular_buf_put_record(cbuf_handle_t cbuf, const uint8_t *data, size_t len)
+{
+    assert(cbuf && (data || !len) && len <= 0xffff);
+
+    struct iovec iov[2];
+    int n = circular_buf_free_iov(cbuf, iov);
+    uint8_t hdr[2] = { len & 0xff, len >> 8 };
+
+    if (iov_size(iov, n) < len + sizeof(hdr))
+        return -1;
+
+    iov_copy(iov, n, 0, hdr, sizeof(hdr), true);
+    iov_copy(iov, n, sizeof(hdr), (uint8_t *) data, len, true);
+    circular_buf_commit(cbuf, len + sizeof(hdr));
+
+    return 0;
+}
+
+int circular_buf_record_len(cbuf_handle_t cbuf)
+{
+    assert(cbuf);
+
+    struct iovec iov[2];
+    int n = circular_buf_data_iov(cbuf, iov);
+    uint8_t hdr[2];
+
+    if (iov_size(iov, n) < sizeof(hdr))
+        return -1;
+
+    iov_copy(iov, n, 0, hdr, sizeof(hdr), false);
+
+    return hdr[0] | (hdr[1] << 8);
+}
+
+int circular_buf_get_record(cbuf_handle_t cbuf, uint8_t *data, size_t size)
+{
+    assert(cbuf && data);
+
+    struct iovec iov[2];
+    int n = circular_buf_data_iov(cbuf, iov);
+    uint8_t hdr[2];
+    size_t len;
+
+    if (iov_size(iov, n) < sizeof(hdr))
+        return -1;
+
+    iov_copy(iov, n, 0, hdr, sizeof(hdr), false);
+    len = hdr[0] | (hdr[1] << 8);
+    if (len > size)
+        return -1;
+
+    iov_copy(iov, n, sizeof(hdr), data, len, false);
+    circular_buf_consume(cbuf, len + sizeof(hdr));
+
+    return len;
+}
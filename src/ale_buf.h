@@ -22,7 +22,9 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <stdbool.h>
+#include <sys/uio.h>
 
 struct circular_buf_t_aux {
     size_t head;
@@ -30,6 +32,7 @@ struct circular_buf_t_aux {
     size_t max; //of the buffer
     bool full;
     atomic_flag acquire;
+    uint64_t consumed; // stream position of tail
 };
 
 struct circular_buf_t {
@@ -43,6 +46,16 @@ struct circular_buf_t {
 /// Handle type, the way users interact with the API
 typedef struct circular_buf_t* cbuf_handle_t;
 
+enum circular_buf_op {
+    CBUF_OP_PUT,
+    CBUF_OP_GET,
+    CBUF_OP_RESET
+};
+
+/// Called after every put_range / commit (CBUF_OP_PUT), get_range / consume
+/// (CBUF_OP_GET) and reset with the bytes moved, if set. NULL by default
+extern void (*circular_buf_trace)(cbuf_handle_t cbuf, int op, size_t len);
+
 /// Pass in a storage buffer and size, returns a circular buffer handle
 /// Requires: buffer is not NULL, size > 0
 /// Ensures: cbuf has been created and is returned in an empty state
@@ -59,6 +72,9 @@ void circular_buf_free(cbuf_handle_t cbuf);
 
 void circular_buf_free_shm(cbuf_handle_t cbuf, size_t size, key_t key);
 
+/// Detaches from the segments of circular_buf_connect_shm, which stay
+void circular_buf_disconnect_shm(cbuf_handle_t cbuf, size_t size, key_t key);
+
 /// Reset the circular buffer to empty, head == tail. Data not cleared
 /// Requires: cbuf is valid and created by circular_buf_init
 void circular_buf_reset(cbuf_handle_t cbuf);
@@ -103,3 +119,47 @@ size_t circular_buf_free_size(cbuf_handle_t cbuf);
 int circular_buf_get_range(cbuf_handle_t cbuf, uint8_t *data, size_t len);
 
 int circular_buf_put_range(cbuf_handle_t cbuf, uint8_t * data, size_t len);
+
+/// Free space of the buffer as up to two contiguous regions, to be filled
+/// in place (e.g. by readv()) and then made visible with circular_buf_commit
+/// Requires: a single writer
+/// Returns the number of regions (0 if the buffer is full)
+int circular_buf_free_iov(cbuf_handle_t cbuf, struct iovec iov[2]);
+
+/// Marks len bytes written in the circular_buf_free_iov regions as stored
+void circular_buf_commit(cbuf_handle_t cbuf, size_t len);
+
+/// Stored data as up to two contiguous regions, to be read in place (e.g.
+/// by writev()) and then released with circular_buf_consume
+/// Requires: a single reader
+/// Returns the number of regions (0 if the buffer is empty)
+int circular_buf_data_iov(cbuf_handle_t cbuf, struct iovec iov[2]);
+
+/// Releases len bytes read in the circular_buf_data_iov regions
+void circular_buf_consume(cbuf_handle_t cbuf, size_t len);
+
+/// Stream position of the oldest stored byte, i.e. the bytes consumed
+/// (or discarded by circular_buf_reset) since the buffer was created
+uint64_t circular_buf_read_pos(cbuf_handle_t cbuf);
+
+/// Stored data from stream position pos on as up to two contiguous
+/// regions, without consuming it. For several readers each keeping its own
+/// position, the buffer being consumed up to the slowest of them
+/// Returns the number of regions (0 if there is nothing after pos), -1 if
+/// pos was consumed already
+int circular_buf_peek_iov(cbuf_handle_t cbuf, uint64_t pos, struct iovec iov[2]);
+
+/// Stores a whole record (2 byte length followed by the data), readers
+/// never see part of it
+/// Requires: a single writer, len <= 65535
+/// Returns 0 on success, -1 if there is no room for it
+int circular_buf_put_record(cbuf_handle_t cbuf, const uint8_t *data, size_t len);
+
+/// Length of the next record, -1 if the buffer is empty
+int circular_buf_record_len(cbuf_handle_t cbuf);
+
+/// Retrieves the next record into data, of size bytes
+/// Requires: a single reader
+/// Returns the record length, -1 if the buffer is empty or the record does
+/// not fit (it is left in the buffer)
+int circular_buf_get_record(cbuf_handle_t cbuf, uint8_t *data, size_t size);
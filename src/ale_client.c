@@ -0,0 +1,480 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_client.c
+ * @author agent
+ * @brief libale-client, local fast path to the controller
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ale_buf.h"
+#include "ale_shm.h"
+#include "ale_client.h"
+
+#define MAX_EVENTS 32
+
+struct ale_client {
+    int fd;
+    cbuf_handle_t tx_data[ALE_TX_NUM_CLASSES];     // ours, the daemon drains them
+    cbuf_handle_t rx_data[ALE_TX_NUM_CLASSES];
+
+    char line[ALE_CLIENT_LINE_MAX];     // partial line from the socket
+    size_t line_len;
+
+    char events[MAX_EVENTS][ALE_CLIENT_LINE_MAX];
+    unsigned int ev_head;
+    unsigned int ev_count;
+
+    int reply;                          // 1: waiting, 0: OK, -1: WRONG
+    size_t backlog;
+    bool connected;
+
+    uint64_t rx_pos[ALE_TX_NUM_CLASSES];    // RX stream position of the next read
+    uint64_t rx_acked[ALE_TX_NUM_CLASSES];  // last reported to the daemon
+    uint64_t rx_lost;
+};
+
+// Private functions
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static int time_left(int64_t deadline)
+{
+    int64_t left;
+
+    if (deadline < 0)
+        return -1;
+
+    left = deadline - now_ms();
+    return left > 0 ? left : 0;
+}
+
+static void client_line(struct ale_client *cl, const char *line)
+{
+    if (!strcmp(line, "OK"))
+    {
+        cl->reply = 0;
+        return;
+    }
+    if (!strcmp(line, "WRONG"))
+    {
+        cl->reply = -1;
+        return;
+    }
+    // wake-ups only
+    if (!strncmp(line, "BUFFER ", 7))
+    {
+        cl->backlog = strtoul(line + 7, NULL, 10);
+        return;
+    }
+    if (!strcmp(line, "RX"))
+        return;
+
+    if (!strncmp(line, "CONNECTED", 9))
+        cl->connected = true;
+    else if (!strcmp(line, "DISCONNECTED"))
+        cl->connected = false;
+
+    // the oldest event goes if nobody reads them
+    if (cl->ev_count == MAX_EVENTS)
+    {
+        cl->ev_head = (cl->ev_head + 1) % MAX_EVENTS;
+        cl->ev_count--;
+    }
+    snprintf(cl->events[(cl->ev_head + cl->ev_count) % MAX_EVENTS], ALE_CLIENT_LINE_MAX, "%s", line);
+    cl->ev_count++;
+}
+
+// tells the daemon how far the RX stream of a class was read, it releases
+// the ring
+static void client_rx_ack(struct ale_client *cl, enum ale_tx_class cls)
+{
+    char line[40];
+    int len;
+
+    if (cl->rx_pos[cls] == cl->rx_acked[cls])
+        return;
+
+    len = snprintf(line, sizeof(line), "RXACK %" PRIu64 " %d\r", cl->rx_pos[cls], cls);
+    if (send(cl->fd, line, len, MSG_NOSIGNAL) == len)
+        cl->rx_acked[cls] = cl->rx_pos[cls];
+}
+
+// tells the daemon there is new data in the TX ring of a class, and with
+// wait that it is full: BUFFER comes once it has room
+static int client_tx_notify(struct ale_client *cl, enum ale_tx_class cls, bool wait)
+{
+    char line[24];
+    int len;
+
+    len = snprintf(line, sizeof(line), "TX %d%s\r", cls, wait ? " WAIT" : "");
+    return send(cl->fd, line, len, MSG_NOSIGNAL) == len ? 0 : -1;
+}
+
+static bool client_ring_exists(key_t key)
+{
+    return shm_is_created(key, ALE_DATA_RING_SIZE) && shm_is_created(key + 1, 0);
+}
+
+static void client_rings_close(struct ale_client *cl)
+{
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        if (cl->tx_data[i])
+            circular_buf_disconnect_shm(cl->tx_data[i], ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(i));
+        if (cl->rx_data[i])
+            circular_buf_disconnect_shm(cl->rx_data[i], ALE_DATA_RING_SIZE, ALE_SHM_RX_KEY(i));
+    }
+}
+
+// waits up to timeout_ms for control socket lines and processes them.
+// Returns 1 if lines came, 0 on timeout, -1 on error or daemon gone
+static int client_recv(struct ale_client *cl, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = cl->fd, .events = POLLIN };
+    char buf[1024];
+    ssize_t rc;
+
+    rc = poll(&pfd, 1, timeout_ms);
+    if (rc <= 0)
+        return (rc < 0 && errno != EINTR) ? -1 : 0;
+
+    rc = recv(cl->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (rc < 0)
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    if (rc == 0)
+    {
+        errno = ECONNRESET;
+        return -1;
+    }
+
+    for (ssize_t i = 0; i < rc; i++)
+    {
+        if (buf[i] == '\r' || buf[i] == '\n')
+        {
+            if (!cl->line_len)
+                continue;
+            cl->line[cl->line_len] = 0;
+            client_line(cl, cl->line);
+            cl->line_len = 0;
+            continue;
+        }
+        if (cl->line_len < ALE_CLIENT_LINE_MAX - 1)
+            cl->line[cl->line_len++] = buf[i];
+    }
+
+    return 1;
+}
+
+// User APIs
+
+struct ale_client *ale_client_open(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct ale_client *cl;
+
+    if (!path)
+        path = ALE_CLIENT_DEFAULT_PATH;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+
+    cl = calloc(1, sizeof(*cl));
+    if (!cl)
+        return NULL;
+
+    cl->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (cl->fd < 0 || connect(cl->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    {
+        int err = errno;
+
+        if (cl->fd >= 0)
+            close(cl->fd);
+        free(cl);
+        errno = err;
+        return NULL;
+    }
+
+    // the daemon created the rings before opening the socket, unless it
+    // is some other program listening there
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        if (!client_ring_exists(ALE_SHM_CLIENT_TX_KEY(i)) || !client_ring_exists(ALE_SHM_RX_KEY(i)))
+        {
+            client_rings_close(cl);
+            close(cl->fd);
+            free(cl);
+            errno = ENOENT;
+            return NULL;
+        }
+        cl->tx_data[i] = circular_buf_connect_shm(ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(i));
+        cl->rx_data[i] = circular_buf_connect_shm(ALE_DATA_RING_SIZE, ALE_SHM_RX_KEY(i));
+        cl->rx_pos[i] = cl->rx_acked[i] = circular_buf_read_pos(cl->rx_data[i]);
+    }
+
+    return cl;
+}
+
+void ale_client_close(struct ale_client *cl)
+{
+    if (!cl)
+        return;
+
+    close(cl->fd);
+    client_rings_close(cl);
+    free(cl);
+}
+
+int ale_client_fd(struct ale_client *cl)
+{
+    return cl->fd;
+}
+
+int ale_client_command(struct ale_client *cl, const char *fmt, ...)
+{
+    char line[ALE_CLIENT_LINE_MAX];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    va_end(ap);
+    if (len < 0 || len >= (int) sizeof(line) - 1)
+        return -1;
+    line[len++] = '\r';
+
+    if (send(cl->fd, line, len, MSG_NOSIGNAL) != len)
+        return -1;
+
+    // the events that come before the answer are queued
+    cl->reply = 1;
+    while (cl->reply == 1)
+    {
+        if (client_recv(cl, -1) < 0)
+            return -1;
+    }
+
+    return cl->reply;
+}
+
+int ale_client_set_callsign(struct ale_client *cl, const char *callsign)
+{
+    return ale_client_command(cl, "MYCALL %s", callsign);
+}
+
+int ale_client_listen(struct ale_client *cl, bool on)
+{
+    return ale_client_command(cl, "LISTEN %s", on ? "ON" : "OFF");
+}
+
+int ale_client_call(struct ale_client *cl, const char *remote)
+{
+    return ale_client_command(cl, "CONNECT %s", remote);
+}
+
+int ale_client_disconnect(struct ale_client *cl, bool abort)
+{
+    return ale_client_command(cl, abort ? "ABORT" : "DISCONNECT");
+}
+
+ssize_t ale_client_write(struct ale_client *cl, const void *data, size_t len, int timeout_ms)
+{
+    return ale_client_write_class(cl, ALE_TX_BULK, data, len, timeout_ms);
+}
+
+ssize_t ale_client_write_class(struct ale_client *cl, enum ale_tx_class cls,
+                               const void *data, size_t len, int timeout_ms)
+{
+    cbuf_handle_t ring = cl->tx_data[cls];
+    int64_t deadline = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+    const uint8_t *p = data;
+    size_t done = 0, notified = 0;
+
+    while (done < len)
+    {
+        struct iovec iov[2];
+        int n = circular_buf_free_iov(ring, iov);
+        size_t chunk = 0;
+
+        for (int i = 0; i < n && done + chunk < len; i++)
+        {
+            size_t part = iov[i].iov_len;
+
+            if (part > len - done - chunk)
+                part = len - done - chunk;
+            memcpy(iov[i].iov_base, p + done + chunk, part);
+            chunk += part;
+        }
+        if (chunk)
+        {
+            circular_buf_commit(ring, chunk);
+            done += chunk;
+            continue;
+        }
+
+        // full: the daemon reports BUFFER once it took some
+        if (client_tx_notify(cl, cls, true) < 0)
+            return done ? (ssize_t) done : -1;
+        notified = done;
+
+        int rc = client_recv(cl, time_left(deadline));
+
+        if (rc < 0)
+            return done ? (ssize_t) done : -1;
+        if (!rc && !time_left(deadline))
+            break;
+    }
+    // a daemon gone shows up at the next call
+    if (done > notified)
+        client_tx_notify(cl, cls, false);
+
+    return done;
+}
+
+ssize_t ale_client_read(struct ale_client *cl, void *data, size_t size, int timeout_ms)
+{
+    return ale_client_read_class(cl, ALE_TX_BULK, data, size, timeout_ms);
+}
+
+ssize_t ale_client_read_class(struct ale_client *cl, enum ale_tx_class cls,
+                              void *data, size_t size, int timeout_ms)
+{
+    cbuf_handle_t ring = cl->rx_data[cls];
+    int64_t deadline = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+
+    if (!size)
+        return 0;
+
+    for (;;)
+    {
+        struct iovec iov[2];
+        int n = circular_buf_peek_iov(ring, cl->rx_pos[cls], iov);
+        size_t done = 0;
+
+        if (n < 0)
+        {
+            // the daemon moved on without us
+            uint64_t pos = circular_buf_read_pos(ring);
+
+            cl->rx_lost += pos - cl->rx_pos[cls];
+            cl->rx_pos[cls] = cl->rx_acked[cls] = pos;
+            continue;
+        }
+
+        for (int i = 0; i < n && done < size; i++)
+        {
+            size_t part = iov[i].iov_len;
+
+            if (part > size - done)
+                part = size - done;
+            memcpy((uint8_t *) data + done, iov[i].iov_base, part);
+            done += part;
+        }
+        // overwritten while copying if the daemon moved on meanwhile
+        if (done && circular_buf_read_pos(ring) > cl->rx_pos[cls])
+            continue;
+        if (done)
+        {
+            cl->rx_pos[cls] += done;
+            if (cl->rx_pos[cls] - cl->rx_acked[cls] >= ALE_DATA_RING_SIZE / 4)
+                client_rx_ack(cl, cls);
+            return done;
+        }
+
+        // all read, let the daemon release it before sleeping
+        client_rx_ack(cl, cls);
+
+        // RX comes after each write to the ring, so none is missed
+        int rc = client_recv(cl, time_left(deadline));
+
+        if (rc < 0)
+            return -1;
+        if (!rc && !time_left(deadline))
+            return 0;
+    }
+}
+
+int ale_client_event(struct ale_client *cl, char *line, size_t size, int timeout_ms)
+{
+    int64_t deadline = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+
+    while (!cl->ev_count)
+    {
+        int rc = client_recv(cl, time_left(deadline));
+
+        if (rc < 0)
+            return -1;
+        if (!rc && !time_left(deadline))
+            return 0;
+    }
+
+    snprintf(line, size, "%s", cl->events[cl->ev_head]);
+    cl->ev_head = (cl->ev_head + 1) % MAX_EVENTS;
+    cl->ev_count--;
+
+    return strlen(line);
+}
+
+size_t ale_client_backlog(struct ale_client *cl)
+{
+    size_t backlog = cl->backlog;
+
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+        backlog += circular_buf_size(cl->tx_data[i]);
+
+    return backlog;
+}
+
+bool ale_client_connected(struct ale_client *cl)
+{
+    return cl->connected;
+}
+
+uint64_t ale_client_rx_lost(struct ale_client *cl)
+{
+    return cl->rx_lost;
+}
@@ -0,0 +1,136 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_client.h
+ * @author agent
+ * @brief libale-client, local fast path to the controller
+ *
+ * For applications running on the same host as rhizo-ale. The payload
+ * moves through shared memory rings, with no socket copies; the Unix
+ * control socket carries the commands and the link events, which also
+ * wake up the blocking reads and writes.
+ *
+ * Each TX priority class is a stream of its own, received by the peer in
+ * the RX ring of that class. The client writes to TX rings of its own, one
+ * per class, which the daemon moves to its TX rings as a host client like
+ * the others (VARA, ARDOP...): it waits for its turn at a class another
+ * one is sending, and the ring of the class fills up meanwhile. The RX
+ * rings are the daemon ones, shared with the other host clients: the
+ * client reads each one at its own stream position and reports how far it
+ * got, the daemon releases a ring up to its slowest client.
+ * A client lagging far behind the others loses data rather than stalling
+ * the link (see ale_client_rx_lost()).
+ *
+ * Control protocol (CR terminated lines): the commands MYCALL <call>,
+ * LISTEN ON|OFF, CONNECT <call>, DISCONNECT, ABORT and BUFFER are
+ * answered with OK or WRONG. These get no answer: RXACK <stream position>
+ * [<class>] (RX data of the class, enum ale_tx_class, bulk if left out,
+ * read up to there) and TX <class> [WAIT] (new data in the client TX ring
+ * of the class; WAIT: the ring is full, send BUFFER once it has room).
+ * Events: PENDING, CANCELPENDING, CONNECTED <call>, DISCONNECTED,
+ * BUFFER <bytes>, RX (new data in an RX ring) and TURN.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define ALE_SHM_TX_DATA_KEY 66660
+#define ALE_SHM_RX_DATA_KEY 66662
+#define ALE_DATA_RING_SIZE (64 * 1024)
+
+/// TX priority classes, one ring each: express data goes out first, the
+/// other two share the rest of the frames by weight. Each class is its own
+/// stream, the peer receives it in the RX ring of the same class
+enum ale_tx_class {
+    ALE_TX_EXPRESS,
+    ALE_TX_INTERACTIVE,
+    ALE_TX_BULK,                // the default, ALE_SHM_TX_DATA_KEY
+    ALE_TX_NUM_CLASSES
+};
+
+#define ALE_SHM_TX_KEY(cls) ((cls) == ALE_TX_BULK ? ALE_SHM_TX_DATA_KEY : 66668 + 2 * (cls))
+#define ALE_SHM_RX_KEY(cls) ((cls) == ALE_TX_BULK ? ALE_SHM_RX_DATA_KEY : 66676 + 2 * (cls))
+/// TX rings of the libale-client client, drained by the daemon
+#define ALE_SHM_CLIENT_TX_KEY(cls) (66680 + 2 * (cls))
+
+#define ALE_CLIENT_DEFAULT_PATH "/tmp/rhizo-ale.sock"
+#define ALE_CLIENT_LINE_MAX 256
+
+struct ale_client;
+
+/// Connects to the daemon control socket (path NULL: the default one) and
+/// attaches to the data rings. Returns NULL on error (errno set, ENOENT if
+/// the daemon has no rings)
+struct ale_client *ale_client_open(const char *path);
+
+void ale_client_close(struct ale_client *cl);
+
+/// Control socket, to be polled for readability by event loops that then
+/// call the functions below with timeout 0
+int ale_client_fd(struct ale_client *cl);
+
+/// Sends a command, returns 0 when the daemon answers OK, -1 otherwise
+int ale_client_command(struct ale_client *cl, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+int ale_client_set_callsign(struct ale_client *cl, const char *callsign);
+int ale_client_listen(struct ale_client *cl, bool on);
+int ale_client_call(struct ale_client *cl, const char *remote);
+int ale_client_disconnect(struct ale_client *cl, bool abort);
+
+/// Writes to the TX ring, waiting for room up to timeout_ms (-1: forever).
+/// Returns the bytes written (less than len on timeout), -1 on error
+ssize_t ale_client_write(struct ale_client *cl, const void *data, size_t len, int timeout_ms);
+
+/// Same as ale_client_write(), to the ring of a TX priority class (the
+/// one above writes bulk data)
+ssize_t ale_client_write_class(struct ale_client *cl, enum ale_tx_class cls,
+                               const void *data, size_t len, int timeout_ms);
+
+/// Reads from the RX ring, waiting up to timeout_ms (-1: forever) for data.
+/// Returns the bytes read (0 on timeout), -1 on error
+ssize_t ale_client_read(struct ale_client *cl, void *data, size_t size, int timeout_ms);
+
+/// Same as ale_client_read(), from the RX ring of a class (the one above
+/// reads the bulk stream)
+ssize_t ale_client_read_class(struct ale_client *cl, enum ale_tx_class cls,
+                              void *data, size_t size, int timeout_ms);
+
+/// Next link event line (CONNECTED ..., DISCONNECTED, PENDING...), waiting
+/// up to timeout_ms. Returns its length, 0 on timeout, -1 on error
+int ale_client_event(struct ale_client *cl, char *line, size_t size, int timeout_ms);
+
+/// Bytes written and not acknowledged by the peer, as last reported plus
+/// what the daemon didn't take from the client TX rings yet
+size_t ale_client_backlog(struct ale_client *cl);
+
+/// True between CONNECTED and DISCONNECTED
+bool ale_client_connected(struct ale_client *cl);
+
+/// RX bytes skipped because the client fell too far behind the others
+uint64_t ale_client_rx_lost(struct ale_client *cl);
@@ -0,0 +1,381 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_comp.c
+ * @author agent
+ * @brief Payload compression
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include <osmocom/core/logging.h>
+
+#include "internal.h"
+#include "ale_comp.h"
+
+// most frequent header lines of the HERMES/Winlink email traffic, the
+// most likely strings go last (closer to the data)
+static const char default_dict[] =
+    "X-Mailer: X-Spam-Status: X-Priority: 3 Reply-To: In-Reply-To: References: "
+    "Content-Disposition: attachment; filename=\"Content-Disposition: inline"
+    "Content-Transfer-Encoding: quoted-printable"
+    "Content-Transfer-Encoding: base64Content-Transfer-Encoding: 8bit"
+    "Content-Type: multipart/mixed; boundary=\"Content-Type: text/html; charset=\"UTF-8\""
+    "Content-Type: text/plain; charset=UTF-8; format=flowed"
+    "Content-Type: text/plain; charset=\"UTF-8\"MIME-Version: 1.0"
+    "Received: from by with ESMTP id for <>; Return-Path: <"
+    "Message-ID: <@hermes.radio>Date: Mon, Tue, Wed, Thu, Fri, Sat, Sun, "
+    "Jan 2025 Feb Mar Apr May Jun Jul Aug Sep Oct Nov Dec 00:00:00 +0000 -0300"
+    "Subject: Re: Fwd: To: Cc: From: @hermes.radio>\r\n\r\n";
+
+// Private functions
+
+static double thread_cpu_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// deflates more input from the TX source into tx_buf
+static void tx_fill(struct ale_comp *comp, size_t want)
+{
+    double start = thread_cpu_ms();
+
+    if (comp->tx_pos)
+    {
+        memmove(comp->tx_buf, comp->tx_buf + comp->tx_pos, comp->tx_len - comp->tx_pos);
+        comp->tx_len -= comp->tx_pos;
+        comp->tx_pos = 0;
+    }
+
+    while (comp->tx_len < want && comp->tx_len < COMP_BUF_SIZE / 2)
+    {
+        int flush = Z_NO_FLUSH;
+
+        if (!comp->tx.avail_in)
+        {
+            // the source picks what to send next, a read at a time
+            size_t len = comp->tx_src->read(comp->tx_src->priv, comp->tx_stage, sizeof(comp->tx_stage));
+
+            if (len)
+            {
+                comp->tx.next_in = comp->tx_stage;
+                comp->tx.avail_in = len;
+                comp->tx_unflushed = true;
+                comp->stats.tx_in += len;
+            }
+        }
+
+        if (!comp->tx.avail_in)
+        {
+            // the ring ran dry: push out what deflate holds back
+            if (!comp->tx_unflushed)
+                break;
+            flush = Z_SYNC_FLUSH;
+        }
+
+        comp->tx.next_out = comp->tx_buf + comp->tx_len;
+        comp->tx.avail_out = COMP_BUF_SIZE - comp->tx_len;
+
+        deflate(&comp->tx, flush);
+
+        comp->tx_len = COMP_BUF_SIZE - comp->tx.avail_out;
+        if (flush == Z_SYNC_FLUSH && comp->tx.avail_out)
+        {
+            comp->tx_unflushed = false;
+            comp->stats.tx_flushes++;
+        }
+    }
+
+    comp->stats.cpu_ms += thread_cpu_ms() - start;
+}
+
+static size_t io_read(void *priv, uint8_t *buf, size_t len)
+{
+    struct ale_comp *comp = priv;
+
+    tx_fill(comp, len);
+
+    if (len > comp->tx_len - comp->tx_pos)
+        len = comp->tx_len - comp->tx_pos;
+
+    memcpy(buf, comp->tx_buf + comp->tx_pos, len);
+    comp->tx_pos += len;
+    comp->stats.tx_out += len;
+
+    return len;
+}
+
+static bool io_pending(void *priv)
+{
+    struct ale_comp *comp = priv;
+
+    return comp->tx_pos != comp->tx_len || comp->tx_unflushed ||
+        comp->tx_src->pending(comp->tx_src->priv);
+}
+
+static size_t io_avail(void *priv)
+{
+    struct ale_comp *comp = priv;
+    size_t raw = comp->tx_src->avail(comp->tx_src->priv) + comp->tx.avail_in;
+    double ratio = comp->stats.tx_in >= 1024 ? ale_comp_ratio(&comp->stats) : 0.5;
+
+    // what deflate still holds back is not known, the ratio so far stands for it
+    return comp->tx_len - comp->tx_pos + (size_t) (raw * ratio);
+}
+
+// hands the inflated bytes to the source, all of them or none
+static bool rx_flush(struct ale_comp *comp)
+{
+    if (!comp->rx_out_len)
+        return true;
+    if (!comp->tx_src->write(comp->tx_src->priv, comp->rx_out, comp->rx_out_len))
+        return false;
+
+    comp->stats.rx_out += comp->rx_out_len;
+    comp->rx_out_len = 0;
+    return true;
+}
+
+// inflates rx_buf as far as the source takes the output
+static void rx_drain(struct ale_comp *comp)
+{
+    double start = thread_cpu_ms();
+    bool full = false;
+
+    // a full rx_out may leave more output inside inflate
+    while (rx_flush(comp) && (comp->rx_pos < comp->rx_len || full) && !comp->rx_error)
+    {
+        size_t room = sizeof(comp->rx_out);
+        size_t len;
+        int rc;
+
+        comp->rx.next_in = comp->rx_buf + comp->rx_pos;
+        comp->rx.avail_in = comp->rx_len - comp->rx_pos;
+        comp->rx.next_out = comp->rx_out;
+        comp->rx.avail_out = room;
+
+        rc = inflate(&comp->rx, Z_SYNC_FLUSH);
+        if (rc == Z_NEED_DICT)
+        {
+            if (!comp->use_dict || comp->rx.adler != comp->dict_id)
+            {
+                // undecodable, but no fault of the stream: don't offer ours again
+                LOGP(ALE, LOGL_NOTICE, "compression: peer dictionary %08lx is not ours, "
+                     "no dictionary from now on\n", comp->rx.adler);
+                comp->rx_error = true;
+                comp->dict_refused = true;
+                comp->stats.dict_mismatches++;
+                break;
+            }
+            inflateSetDictionary(&comp->rx, comp->dict, comp->dict_len);
+            rc = inflate(&comp->rx, Z_SYNC_FLUSH);
+        }
+        if (rc != Z_OK && rc != Z_BUF_ERROR && rc != Z_STREAM_END)
+        {
+            LOGP(ALE, LOGL_ERROR, "compression: inflate error %d\n", rc);
+            comp->rx_error = true;
+            comp->stats.rx_errors++;
+            break;
+        }
+
+        len = room - comp->rx.avail_out;
+        if (!len && comp->rx_pos == comp->rx_len - comp->rx.avail_in)
+            break;
+        comp->rx_pos = comp->rx_len - comp->rx.avail_in;
+        comp->rx_out_len = len;
+        full = len == room;
+    }
+    rx_flush(comp);
+
+    if (comp->rx_pos == comp->rx_len)
+        comp->rx_pos = comp->rx_len = 0;
+
+    comp->stats.cpu_ms += thread_cpu_ms() - start;
+}
+
+static bool io_write(void *priv, const uint8_t *buf, size_t len)
+{
+    struct ale_comp *comp = priv;
+
+    // nothing after a broken stream can be inflated, the ARQ must not ack it
+    if (comp->rx_error)
+        return false;
+
+    if (COMP_BUF_SIZE - comp->rx_len < len && comp->rx_pos)
+    {
+        memmove(comp->rx_buf, comp->rx_buf + comp->rx_pos, comp->rx_len - comp->rx_pos);
+        comp->rx_len -= comp->rx_pos;
+        comp->rx_pos = 0;
+    }
+    if (COMP_BUF_SIZE - comp->rx_len < len)
+        return false;
+
+    memcpy(comp->rx_buf + comp->rx_len, buf, len);
+    comp->rx_len += len;
+    comp->stats.rx_in += len;
+
+    rx_drain(comp);
+
+    return true;
+}
+
+// User APIs
+
+struct ale_comp *ale_comp_alloc(const struct ale_arq_io *tx_src)
+{
+    assert(tx_src && tx_src->write);
+
+    struct ale_comp *comp = calloc(1, sizeof(struct ale_comp));
+    assert(comp);
+
+    comp->tx_src = tx_src;
+    comp->io = (struct ale_arq_io) {
+        .read = io_read,
+        .write = io_write,
+        .pending = io_pending,
+        .avail = io_avail,
+        .priv = comp,
+    };
+    ale_comp_set_dict(comp, NULL, 0);
+
+    return comp;
+}
+
+void ale_comp_free(struct ale_comp *comp)
+{
+    ale_comp_stop(comp);
+    free(comp->dict);
+    free(comp);
+}
+
+int ale_comp_set_dict(struct ale_comp *comp, const uint8_t *dict, size_t len)
+{
+    if (!dict)
+    {
+        dict = (const uint8_t *) default_dict;
+        len = sizeof(default_dict) - 1;
+    }
+    if (len > COMP_MAX_DICT)
+        return -1;
+
+    free(comp->dict);
+    comp->dict = malloc(len);
+    assert(comp->dict);
+    memcpy(comp->dict, dict, len);
+    comp->dict_len = len;
+    comp->dict_id = adler32(adler32(0, NULL, 0), comp->dict, len);
+    comp->dict_refused = false;
+
+    return 0;
+}
+
+uint8_t ale_comp_caps(struct ale_comp *comp)
+{
+    // a zero nibble means no dictionary, avoid it
+    uint8_t dict = (comp->dict_id & 0x0f) ? (comp->dict_id & 0x0f) : 1;
+
+    if (comp->dict_refused)
+        return ALE_CAP_COMP;
+    return ALE_CAP_COMP | (dict << 4);
+}
+
+uint8_t ale_comp_negotiate(struct ale_comp *comp, uint8_t peer_caps, uint32_t peer_dict_id)
+{
+    uint8_t caps = ale_comp_caps(comp);
+
+    if (!(peer_caps & ALE_CAP_COMP))
+        return 0;
+
+    // the nibble is only a hint, 1 in 16 different dictionaries share it
+    if (!(caps & ALE_CAP_DICT_MASK) || (peer_caps & ALE_CAP_DICT_MASK) != (caps & ALE_CAP_DICT_MASK) ||
+        peer_dict_id != comp->dict_id)
+        return ALE_CAP_COMP;
+
+    return caps;
+}
+
+const struct ale_arq_io *ale_comp_start(struct ale_comp *comp, uint8_t caps)
+{
+    ale_comp_stop(comp);
+    memset(&comp->stats, 0, sizeof(comp->stats));
+    comp->rx_error = false;
+
+    if (!(caps & ALE_CAP_COMP))
+        return NULL;
+
+    memset(&comp->tx, 0, sizeof(comp->tx));
+    memset(&comp->rx, 0, sizeof(comp->rx));
+    if (deflateInit(&comp->tx, COMP_LEVEL) != Z_OK)
+        return NULL;
+    if (inflateInit(&comp->rx) != Z_OK)
+    {
+        deflateEnd(&comp->tx);
+        return NULL;
+    }
+
+    // both sides must have the same dictionary
+    comp->use_dict = (caps & ALE_CAP_DICT_MASK) &&
+                     (caps & ALE_CAP_DICT_MASK) == (ale_comp_caps(comp) & ALE_CAP_DICT_MASK);
+    if (comp->use_dict)
+        deflateSetDictionary(&comp->tx, comp->dict, comp->dict_len);
+
+    comp->tx_pos = comp->tx_len = 0;
+    comp->tx.avail_in = 0;
+    comp->rx_pos = comp->rx_len = 0;
+    comp->rx_out_len = 0;
+    comp->tx_unflushed = false;
+    comp->active = true;
+
+    return &comp->io;
+}
+
+void ale_comp_stop(struct ale_comp *comp)
+{
+    if (!comp->active)
+        return;
+
+    deflateEnd(&comp->tx);
+    inflateEnd(&comp->rx);
+    comp->active = false;
+}
+
+void ale_comp_pump(struct ale_comp *comp)
+{
+    if (comp->active)
+        rx_drain(comp);
+}
+
+double ale_comp_ratio(const struct ale_comp_stats *stats)
+{
+    if (!stats->tx_in)
+        return 1.0;
+
+    return (double) stats->tx_out / stats->tx_in;
+}
@@ -0,0 +1,138 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_comp.h
+ * @author agent
+ * @brief Payload compression
+ *
+ * Streaming zlib compression between the priority queue and the ARQ: the
+ * records of all the classes are deflated as one stream, what is inflated
+ * goes back to the queue to be split into the RX rings. One
+ * deflate and one inflate stream live for the whole session, so the
+ * history window is shared by all the frames, and both are primed with a
+ * preset dictionary (email headers by default). The compressor only
+ * flushes (Z_SYNC_FLUSH) when the TX ring runs dry, so full frames carry
+ * no flush overhead.
+ *
+ * The caller sends the full adler32 of its dictionary ahead of the call
+ * (ARQ_CTRL_DICT), the callee compares it with its own and answers with
+ * the agreed capabilities, which both sides then use. A peer stream that
+ * still turns out to need another dictionary withdraws ours: the session
+ * can't be decoded and ends, the next ones go without a dictionary until
+ * it is configured again.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+#include "ale_buf.h"
+#include "ale_arq.h"
+
+// call setup capabilities (ale_arq_ctrl.caps)
+#define ALE_CAP_COMP 0x01
+#define ALE_CAP_DICT_MASK 0xf0  // low bits of the dictionary adler32
+
+#define COMP_LEVEL 6
+#define COMP_BUF_SIZE 4096
+#define COMP_MAX_DICT 32768
+
+struct ale_comp_stats {
+    unsigned long tx_in;        // bytes from the TX source
+    unsigned long tx_out;       // compressed bytes handed to the ARQ
+    unsigned long tx_flushes;
+    unsigned long rx_in;        // compressed bytes from the ARQ
+    unsigned long rx_out;       // bytes handed back to the source
+    unsigned long rx_errors;    // broken streams, the session is ended
+    unsigned long dict_mismatches;  // peer streams primed with another dictionary
+    double cpu_ms;              // deflate + inflate
+};
+
+struct ale_comp {
+    const struct ale_arq_io *tx_src;   // priority queue, takes the inflated bytes too
+    uint8_t *dict;
+    size_t dict_len;
+    uint32_t dict_id;
+
+    bool active;
+    bool use_dict;
+    bool dict_refused;          // a peer used another one, not offered any more
+    z_stream tx;
+    z_stream rx;
+    bool tx_unflushed;
+    bool rx_error;
+
+    // input being deflated
+    uint8_t tx_stage[1024];
+
+    // compressed bytes not taken by the ARQ yet
+    uint8_t tx_buf[COMP_BUF_SIZE];
+    size_t tx_pos;
+    size_t tx_len;
+
+    // received compressed bytes not inflated yet (RX rings full)
+    uint8_t rx_buf[COMP_BUF_SIZE];
+    size_t rx_pos;
+    size_t rx_len;
+
+    // inflated bytes the source did not take yet
+    uint8_t rx_out[1024];
+    size_t rx_out_len;
+
+    struct ale_arq_io io;
+    struct ale_comp_stats stats;
+};
+
+/// Compression over tx_src, which gets what is inflated through its write
+struct ale_comp *ale_comp_alloc(const struct ale_arq_io *tx_src);
+
+void ale_comp_free(struct ale_comp *comp);
+
+/// Replaces the preset dictionary (NULL: built-in email header one)
+int ale_comp_set_dict(struct ale_comp *comp, const uint8_t *dict, size_t len);
+
+/// Capabilities we announce in the call setup
+uint8_t ale_comp_caps(struct ale_comp *comp);
+
+/// Capabilities of the session for the ones announced by the caller and
+/// its full dictionary id (0 if it sent none)
+uint8_t ale_comp_negotiate(struct ale_comp *comp, uint8_t peer_caps, uint32_t peer_dict_id);
+
+/// New session with the capabilities agreed in the call setup. Returns the
+/// ARQ io to use, or NULL if the session is not compressed
+const struct ale_arq_io *ale_comp_start(struct ale_comp *comp, uint8_t caps);
+
+/// End of session, stats are kept until the next start
+void ale_comp_stop(struct ale_comp *comp);
+
+/// Inflates what is left once the host made room in the RX ring
+void ale_comp_pump(struct ale_comp *comp);
+
+/// Compressed/uncompressed ratio of the TX direction (1.0 when unused)
+double ale_comp_ratio(const struct ale_comp_stats *stats);
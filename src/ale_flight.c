@@ -0,0 +1,290 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_flight.c
+ * @author agent
+ * @brief Flight recorder of the data path
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "ale_flight.h"
+
+static _Atomic(struct ale_flight_buf *) bufs;
+static __thread struct ale_flight_buf *tls_buf;
+static atomic_uint thread_count;
+
+static char labels[_NUM_FLIGHT_TABLES][ALE_FLIGHT_LABELS][ALE_FLIGHT_LABEL_LEN];
+
+// ring ids are the indexes, written before ring_count is raised
+static cbuf_handle_t rings[ALE_FLIGHT_LABELS];
+static atomic_uint ring_count;
+
+static char dump_file[256] = ALE_FLIGHT_DEFAULT_FILE;
+
+// Private functions
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void ring_trace(cbuf_handle_t cbuf, int op, size_t len)
+{
+    static const uint16_t types[] = {
+        [CBUF_OP_PUT] = FLIGHT_RING_PUT,
+        [CBUF_OP_GET] = FLIGHT_RING_GET,
+        [CBUF_OP_RESET] = FLIGHT_RING_RESET,
+    };
+    unsigned int n = atomic_load_explicit(&ring_count, memory_order_acquire);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (rings[i] == cbuf)
+        {
+            ale_flight_rec(types[op], i, len);
+            return;
+        }
+    }
+}
+
+static int write_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    while (len)
+    {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/// Writes the events of one buffer straight from it, the owner may keep
+/// overwriting the oldest meanwhile: valid_from tells the decoder which
+static int dump_buf(int fd, struct ale_flight_buf *buf)
+{
+    struct ale_flight_thread th;
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    uint64_t first, end, seq;
+
+    memset(&th, 0, sizeof(th));
+    memcpy(th.name, buf->name, sizeof(th.name));
+    end = atomic_load_explicit(&buf->seq, memory_order_acquire);
+    first = end > ALE_FLIGHT_EVENTS ? end - ALE_FLIGHT_EVENTS : 0;
+    th.seq_first = first;
+    th.seq_end = end;
+    th.valid_from = first;
+    if (write_all(fd, &th, sizeof(th)) < 0)
+        return -1;
+
+    for (seq = first; seq < end; )
+    {
+        size_t idx = seq % ALE_FLIGHT_EVENTS;
+        size_t n = ALE_FLIGHT_EVENTS - idx;
+
+        if (n > end - seq)
+            n = end - seq;
+        if (write_all(fd, &buf->evt[idx], n * sizeof(buf->evt[0])) < 0)
+            return -1;
+        seq += n;
+    }
+
+    /* everything the owner wrote during the copy went over the oldest, and
+     * the event it may be writing now (seq) goes over one more */
+    seq = atomic_load_explicit(&buf->seq, memory_order_acquire);
+    if (seq >= first + ALE_FLIGHT_EVENTS)
+    {
+        th.valid_from = seq + 1 - ALE_FLIGHT_EVENTS;
+        if (th.valid_from > end)
+            th.valid_from = end;
+        if (pwrite(fd, &th, sizeof(th), pos) != sizeof(th))
+            return -1;
+    }
+    return 0;
+}
+
+static void abort_handler(int sig)
+{
+    ale_flight_dump(dump_file);
+    // SA_RESETHAND restored the default action
+    raise(sig);
+}
+
+// User APIs
+
+int ale_flight_thread_init(const char *name)
+{
+    struct ale_flight_buf *buf;
+
+    if (tls_buf)
+        return 0;
+
+    buf = malloc(sizeof(*buf));
+    if (!buf)
+        return -1;
+
+    memset(buf->name, 0, sizeof(buf->name));
+    if (name)
+        snprintf(buf->name, sizeof(buf->name), "%s", name);
+    else
+        snprintf(buf->name, sizeof(buf->name), "thread%u", atomic_fetch_add(&thread_count, 1));
+    atomic_init(&buf->seq, 0);
+
+    buf->next = atomic_load(&bufs);
+    while (!atomic_compare_exchange_weak(&bufs, &buf->next, buf));
+
+    tls_buf = buf;
+    return 0;
+}
+
+void ale_flight_rec(enum ale_flight_type type, uint16_t a, uint32_t b)
+{
+    struct ale_flight_buf *buf = tls_buf;
+    struct ale_flight_evt *evt;
+    uint64_t seq;
+
+    if (!buf)
+    {
+        if (ale_flight_thread_init(NULL) < 0)
+            return;
+        buf = tls_buf;
+    }
+
+    seq = atomic_load_explicit(&buf->seq, memory_order_relaxed);
+    evt = &buf->evt[seq % ALE_FLIGHT_EVENTS];
+    evt->ts_ns = now_ns();
+    evt->type = type;
+    evt->a = a;
+    evt->b = b;
+    atomic_store_explicit(&buf->seq, seq + 1, memory_order_release);
+}
+
+void ale_flight_label(enum ale_flight_table table, unsigned int id, const char *name)
+{
+    if (table >= _NUM_FLIGHT_TABLES || id >= ALE_FLIGHT_LABELS)
+        return;
+
+    snprintf(labels[table][id], ALE_FLIGHT_LABEL_LEN, "%s", name);
+}
+
+int ale_flight_ring(cbuf_handle_t cbuf, const char *name)
+{
+    unsigned int id = atomic_load(&ring_count);
+
+    if (id >= ALE_FLIGHT_LABELS)
+        return -1;
+
+    rings[id] = cbuf;
+    ale_flight_label(FLIGHT_T_RING, id, name);
+    atomic_store_explicit(&ring_count, id + 1, memory_order_release);
+    circular_buf_trace = ring_trace;
+
+    return 0;
+}
+
+int ale_flight_dump(const char *path)
+{
+    struct ale_flight_hdr hdr;
+    struct timespec mono, real;
+    struct ale_flight_buf *head, *buf;
+    int fd, saved;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, ALE_FLIGHT_MAGIC, sizeof(ALE_FLIGHT_MAGIC));
+    hdr.version = ALE_FLIGHT_VERSION;
+    // threads registering meanwhile are put in front of head, not dumped
+    head = atomic_load(&bufs);
+    for (buf = head; buf; buf = buf->next)
+        hdr.threads++;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    hdr.realtime_ns = (int64_t) (real.tv_sec - mono.tv_sec) * 1000000000 +
+        (real.tv_nsec - mono.tv_nsec);
+    memcpy(hdr.labels, labels, sizeof(hdr.labels));
+
+    if (write_all(fd, &hdr, sizeof(hdr)) < 0)
+        goto error;
+
+    for (buf = head; buf; buf = buf->next)
+    {
+        if (dump_buf(fd, buf) < 0)
+            goto error;
+    }
+
+    close(fd);
+    return 0;
+
+error:
+    saved = errno;
+    close(fd);
+    errno = saved;
+    return -1;
+}
+
+void ale_flight_set_file(const char *path)
+{
+    snprintf(dump_file, sizeof(dump_file), "%s", path);
+}
+
+const char *ale_flight_file(void)
+{
+    return dump_file;
+}
+
+void ale_flight_catch_abort(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = abort_handler;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGABRT, &sa, NULL);
+}
+
+struct ale_flight_buf *ale_flight_bufs(void)
+{
+    return atomic_load(&bufs);
+}
@@ -0,0 +1,138 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_flight.h
+ * @author agent
+ * @brief Flight recorder of the data path
+ *
+ * Every thread that records gets a circular buffer of fixed size binary
+ * events (a CLOCK_MONOTONIC timestamp, a type and two arguments) it alone
+ * writes, overwriting the oldest: no locks, no syscalls besides the vDSO
+ * clock, a few tens of nanoseconds per event. Recorded are the put / get
+ * sizes of the named rings (through circular_buf_trace), the state changes
+ * of the FSM and the sync, decode and transmit events of the modem.
+ *
+ * ale_flight_dump() writes all buffers to a file with open() / write()
+ * only, so it can run from a signal handler: on SIGUSR1, on SIGABRT (a
+ * failed assert() or OSMO_ASSERT()) and from the VTY. rhizo-ale-flight
+ * turns a dump into a timeline.
+ *
+ * Dump layout: struct ale_flight_hdr, then per thread a struct
+ * ale_flight_thread followed by the events from seq_first to seq_end,
+ * oldest first. Events before valid_from may have been overwritten while
+ * the dump was written and are to be skipped.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "ale_buf.h"
+
+#define ALE_FLIGHT_EVENTS 8192          // per thread, power of 2
+#define ALE_FLIGHT_MAGIC "ALEFLGT"
+#define ALE_FLIGHT_VERSION 1
+#define ALE_FLIGHT_LABELS 32
+#define ALE_FLIGHT_LABEL_LEN 24
+#define ALE_FLIGHT_DEFAULT_FILE "/tmp/rhizo-ale-flight.bin"
+
+enum ale_flight_type {
+    FLIGHT_RING_PUT,            // a: ring, b: bytes
+    FLIGHT_RING_GET,            // a: ring, b: bytes
+    FLIGHT_RING_RESET,          // a: ring
+    FLIGHT_FSM_STATE,           // a: old state, b: new state
+    FLIGHT_MODEM_SYNC,          // a: mode, b: 1 in sync, 0 lost
+    FLIGHT_MODEM_RX,            // a: mode, b: SNR in 0.1 dB
+    FLIGHT_MODEM_CRC,           // a: mode, b: SNR in 0.1 dB
+    FLIGHT_MODEM_TX,            // a: mode, b: bytes
+    FLIGHT_MODEM_TX_DONE,
+    _NUM_FLIGHT_TYPES
+};
+
+enum ale_flight_table {
+    FLIGHT_T_RING,
+    FLIGHT_T_STATE,
+    _NUM_FLIGHT_TABLES
+};
+
+struct ale_flight_evt {
+    uint64_t ts_ns;
+    uint16_t type;
+    uint16_t a;
+    uint32_t b;
+};
+
+struct ale_flight_buf {
+    struct ale_flight_buf *next;
+    char name[16];
+    _Atomic uint64_t seq;       // events ever recorded, owner writes
+    struct ale_flight_evt evt[ALE_FLIGHT_EVENTS];
+};
+
+struct ale_flight_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t threads;
+    int64_t realtime_ns;        // CLOCK_REALTIME - CLOCK_MONOTONIC
+    char labels[_NUM_FLIGHT_TABLES][ALE_FLIGHT_LABELS][ALE_FLIGHT_LABEL_LEN];
+};
+
+struct ale_flight_thread {
+    char name[16];
+    uint64_t seq_first;
+    uint64_t seq_end;
+    uint64_t valid_from;
+};
+
+/// Gives the calling thread its buffer; a thread without one gets it (and
+/// a malloc) on its first event
+/// Returns 0 on success, -1 if out of memory
+int ale_flight_thread_init(const char *name);
+
+/// Records an event in the buffer of the calling thread
+void ale_flight_rec(enum ale_flight_type type, uint16_t a, uint32_t b);
+
+/// Names entry id of a label table, for the decoder
+void ale_flight_label(enum ale_flight_table table, unsigned int id, const char *name);
+
+/// Records the puts and gets of cbuf under name; the first call installs
+/// circular_buf_trace
+/// Returns 0 on success, -1 if all ALE_FLIGHT_LABELS ids are in use
+int ale_flight_ring(cbuf_handle_t cbuf, const char *name);
+
+/// Writes all buffers to path (async-signal-safe)
+/// Returns 0 on success, -1 with errno set on error
+int ale_flight_dump(const char *path);
+
+/// File of the SIGUSR1 and crash dumps
+void ale_flight_set_file(const char *path);
+const char *ale_flight_file(void);
+
+/// Dumps to ale_flight_file() when the process aborts
+void ale_flight_catch_abort(void);
+
+/// Registered buffers, a lock-free list (see next)
+struct ale_flight_buf *ale_flight_bufs(void);
@@ -0,0 +1,244 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_flight_decode.c
+ * @author agent
+ * @brief rhizo-ale-flight, turns a flight recorder dump into a timeline
+ *
+ * The events of all threads are merged by timestamp and printed one per
+ * line: wall clock time, time since the previous line, thread, event.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "ale_flight.h"
+#include "ale_mode.h"
+
+struct timeline_evt {
+    struct ale_flight_evt evt;
+    unsigned int thread;
+    uint64_t seq;
+};
+
+static const char *type_names[_NUM_FLIGHT_TYPES] = {
+    [FLIGHT_RING_PUT] = "ring-put",
+    [FLIGHT_RING_GET] = "ring-get",
+    [FLIGHT_RING_RESET] = "ring-reset",
+    [FLIGHT_FSM_STATE] = "fsm-state",
+    [FLIGHT_MODEM_SYNC] = "modem-sync",
+    [FLIGHT_MODEM_RX] = "modem-rx",
+    [FLIGHT_MODEM_CRC] = "modem-crc",
+    [FLIGHT_MODEM_TX] = "modem-tx",
+    [FLIGHT_MODEM_TX_DONE] = "modem-tx-done",
+};
+
+static struct ale_flight_hdr hdr;
+static char (*thread_names)[16];
+
+static int evt_cmp(const void *a, const void *b)
+{
+    const struct timeline_evt *x = a, *y = b;
+
+    if (x->evt.ts_ns != y->evt.ts_ns)
+        return x->evt.ts_ns < y->evt.ts_ns ? -1 : 1;
+    if (x->thread != y->thread)
+        return x->thread < y->thread ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static const char *label(enum ale_flight_table table, unsigned int id)
+{
+    static char unknown[ALE_FLIGHT_LABEL_LEN + 1];
+
+    if (id < ALE_FLIGHT_LABELS && hdr.labels[table][id][0])
+        return hdr.labels[table][id];
+
+    snprintf(unknown, sizeof(unknown), "#%u", id);
+    return unknown;
+}
+
+static const char *mode_name(unsigned int id)
+{
+    const struct ale_mode *mode = ale_mode_get(id);
+
+    return mode ? mode->name : "?";
+}
+
+static void print_evt(const struct timeline_evt *te, uint64_t prev_ns)
+{
+    const struct ale_flight_evt *e = &te->evt;
+    int64_t wall_ns = (int64_t) e->ts_ns + hdr.realtime_ns;
+    time_t secs = wall_ns / 1000000000;
+    struct tm tm;
+    char when[32];
+
+    localtime_r(&secs, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("%s.%06u %+11.3f ms  %-10s %-14s ", when, (unsigned int) (wall_ns % 1000000000 / 1000),
+           prev_ns ? (e->ts_ns - prev_ns) / 1e6 : 0.0, thread_names[te->thread],
+           e->type < _NUM_FLIGHT_TYPES ? type_names[e->type] : "?");
+
+    switch (e->type)
+    {
+    case FLIGHT_RING_PUT:
+    case FLIGHT_RING_GET:
+        printf("%s %" PRIu32 " bytes\n", label(FLIGHT_T_RING, e->a), e->b);
+        break;
+    case FLIGHT_RING_RESET:
+        printf("%s\n", label(FLIGHT_T_RING, e->a));
+        break;
+    case FLIGHT_FSM_STATE:
+        printf("%s", label(FLIGHT_T_STATE, e->a));
+        printf(" -> %s\n", label(FLIGHT_T_STATE, e->b));
+        break;
+    case FLIGHT_MODEM_SYNC:
+        printf("%s %s\n", mode_name(e->a), e->b ? "in sync" : "lost sync");
+        break;
+    case FLIGHT_MODEM_RX:
+    case FLIGHT_MODEM_CRC:
+        printf("%s SNR %.1f dB\n", mode_name(e->a), (int32_t) e->b / 10.0);
+        break;
+    case FLIGHT_MODEM_TX:
+        printf("%s %" PRIu32 " bytes\n", mode_name(e->a), e->b);
+        break;
+    case FLIGHT_MODEM_TX_DONE:
+        printf("%s\n", mode_name(e->a));
+        break;
+    default:
+        printf("%u %" PRIu32 "\n", e->a, e->b);
+        break;
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-t thread] [-l last events] dump\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    struct timeline_evt *events = NULL;
+    const char *only = NULL;
+    size_t count = 0, last = 0, overwritten = 0;
+    uint64_t prev_ns = 0;
+    FILE *f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:l:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            only = optarg;
+            break;
+        case 'l':
+            last = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    f = fopen(argv[optind], "rb");
+    if (!f)
+    {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, ALE_FLIGHT_MAGIC, sizeof(ALE_FLIGHT_MAGIC)))
+    {
+        fprintf(stderr, "%s: not a flight recorder dump\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+    if (hdr.version != ALE_FLIGHT_VERSION)
+    {
+        fprintf(stderr, "%s: dump version %u, this decoder reads %u\n", argv[optind],
+                hdr.version, ALE_FLIGHT_VERSION);
+        return EXIT_FAILURE;
+    }
+
+    thread_names = calloc(hdr.threads, sizeof(*thread_names));
+    for (unsigned int t = 0; t < hdr.threads; t++)
+    {
+        struct ale_flight_thread th;
+        size_t n;
+
+        if (fread(&th, sizeof(th), 1, f) != 1 || th.seq_end < th.seq_first ||
+            th.seq_end - th.seq_first > ALE_FLIGHT_EVENTS)
+        {
+            fprintf(stderr, "%s: truncated or corrupt dump\n", argv[optind]);
+            return EXIT_FAILURE;
+        }
+        memcpy(thread_names[t], th.name, sizeof(th.name));
+        thread_names[t][sizeof(th.name) - 1] = '\0';
+
+        n = th.seq_end - th.seq_first;
+        events = realloc(events, (count + n) * sizeof(*events));
+        for (uint64_t seq = th.seq_first; seq < th.seq_end; seq++)
+        {
+            struct timeline_evt *te = &events[count];
+
+            if (fread(&te->evt, sizeof(te->evt), 1, f) != 1)
+            {
+                fprintf(stderr, "%s: truncated dump\n", argv[optind]);
+                return EXIT_FAILURE;
+            }
+            if (seq < th.valid_from || (only && strcmp(only, thread_names[t])))
+                continue;
+            te->thread = t;
+            te->seq = seq;
+            count++;
+        }
+        overwritten += th.valid_from - th.seq_first;
+        printf("# thread %-10s %" PRIu64 " events recorded, %" PRIu64 " in the dump\n",
+               thread_names[t], th.seq_end, th.seq_end - th.valid_from);
+    }
+    fclose(f);
+
+    if (overwritten)
+        printf("# %zu events overwritten while dumping, skipped\n", overwritten);
+
+    qsort(events, count, sizeof(*events), evt_cmp);
+    for (size_t i = last && last < count ? count - last : 0; i < count; i++)
+    {
+        print_evt(&events[i], prev_ns);
+        prev_ns = events[i].evt.ts_ns;
+    }
+
+    free(events);
+    free(thread_names);
+    return EXIT_SUCCESS;
+}
@@ -20,78 +20,934 @@
  *
  */
 
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
 #include <osmocom/core/fsm.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
 
 #include "internal.h"
+#include "ale_flight.h"
+#include "ale_probe.h"
 
 #define S(x)	(1 << (x))
 
+/* every requested state change goes to the flight recorder and the
+ * fsm__state probe first */
+#define ale_state_chg(fi, new_state, secs, T) \
+	do { \
+		ale_flight_rec(FLIGHT_FSM_STATE, (fi)->state, new_state); \
+		ALE_PROBE4(fsm__state, (fi)->state, new_state, \
+			   (fi)->fsm->states[(fi)->state].name, \
+			   (fi)->fsm->states[new_state].name); \
+		osmo_fsm_inst_state_chg(fi, new_state, secs, T); \
+	} while (0)
+
 // timer definitions here...
-#define T_KEEPALIVE			1
-#define T_KEEPALIVE_SECS		30
+#define T_CALL				1
+#define T_CALL_SECS			5
+#define T_TURN				2
+#define T_TURN_SECS			(ARQ_BURST_MS / 1000 + 10)
+
+#define BATCH_POLL_USECS		250000
+#define SOUND_IDLE_SECS			1	// first look at the soundings once idle
+#define SOUND_TUNE_USECS		200000	// for the rig to get to a channel
+
+#define CALL_MAX_TRIES			5
+#define IDLE_MAX_TURNS			20
 
 enum ale_state {
 	ALE_S_INIT,
-	ALE_S_CONN_PENDING,
-	ALE_S_KEEPALIVE_PENDING,
-	ALE_S_IDLE,
+	ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS,
+	ALE_S_READY_IDLE_REJECTING_CONNECTIONS,
+	ALE_S_CALLING_TO_HOST,
+	ALE_S_RECEIVING_FROM_HOST,
+	ALE_S_ROLE_TX,
+	ALE_S_ROLE_RX,
 };
 
+struct ale_station *g_ale;
 
 static const struct value_string ale_event_names[] = {
 	{ ALE_E_INIT, "ALE init" },
-	{ ALE_E_CONN_PENDING, "ALE Conn Pending" },
-	{ ALE_E_KEEPALIVE_PENDING, "ALE Keep-Alive Pending" },
-	{ ALE_E_IDLE, "ALE Idle" },
+	{ ALE_E_REJECT_CONNECTIONS, "Reject connections" },
+	{ ALE_E_ACCEPT_CONNECTIONS, "Accept connections" },
+	{ ALE_E_MAKE_CALL, "Make call" },
+	{ ALE_E_RECEIVE_CALL, "Receive call" },
+	{ ALE_E_MAKE_CALL_CONNECTED, "Make call connected" },
+	{ ALE_E_RECEIVE_CALL_CONNECTED, "Receive call connected" },
+	{ ALE_E_CHG_ROLE_TO_RX, "Change role to RX" },
+	{ ALE_E_CHG_ROLE_TO_TX, "Change role to TX" },
+	{ ALE_E_DISCONNECTED, "Disconnected" },
 	{ 0, NULL }
 };
 
+static void ale_ptt_on(struct ale_station *st)
+{
+	if (!st->ptt) {
+		st->ptt = true;
+		ale_host_event(st, ALE_HOST_PTT_ON);
+	}
+}
+
+static void ale_send_frame(struct ale_station *st, const struct ale_mode *mode,
+			   const uint8_t *buf, size_t len, uint64_t born_us)
+{
+	if (!st->tx_frame) {
+		LOGPFSML(st->fi, LOGL_ERROR, "No modem, dropping %zu byte frame\n", len);
+		return;
+	}
+	ale_ptt_on(st);
+	st->tx_frame(st, mode, buf, len, born_us);
+}
+
+/* The burst is complete: the modem calls ale_station_tx_done() once its
+ * last frame is on the air, not when its queue happens to run dry */
+static void ale_send_end(struct ale_station *st)
+{
+	if (st->tx_end)
+		st->tx_end(st);
+}
+
+static void ale_send_ctrl(struct ale_station *st, enum ale_arq_ctrl_type type)
+{
+	const struct ale_mode *sig = ale_mode_get(ALE_MODE_DATAC13);
+	struct ale_arq_ctrl ctrl = { .type = type };
+	uint8_t frame[sig->payload_bytes];
+
+	OSMO_STRLCPY_ARRAY(ctrl.dst, st->remote);
+	OSMO_STRLCPY_ARRAY(ctrl.src, st->callsign);
+	if (type == ARQ_CTRL_CALL)
+		ctrl.caps = st->compression ? ale_comp_caps(st->comp) : 0;
+	else if (type == ARQ_CTRL_CALL_ACK)
+		ctrl.caps = st->caps;
+
+	/* the caps only hold 4 bits of the dictionary id, the whole one goes
+	 * just ahead of the call and the callee decides */
+	if (type == ARQ_CTRL_CALL && (ctrl.caps & ALE_CAP_DICT_MASK)) {
+		struct ale_arq_ctrl dict = { .type = ARQ_CTRL_DICT, .dict_id = st->comp->dict_id };
+
+		OSMO_STRLCPY_ARRAY(dict.src, st->callsign);
+		ale_arq_ctrl_encode(frame, sizeof(frame), &dict);
+		ale_send_frame(st, sig, frame, sizeof(frame), 0);
+	}
+
+	ale_arq_ctrl_encode(frame, sizeof(frame), &ctrl);
+	ale_send_frame(st, sig, frame, sizeof(frame), 0);
+	ale_send_end(st);
+}
+
+static uint64_t monotonic_ms(void)
+{
+	struct timespec ts;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+/* A call holds the scan on its channel, idle lets it go on */
+static void scan_hold_call(struct ale_station *st, bool hold)
+{
+	ale_scan_hold(st->scan, hold, monotonic_ms());
+	ale_rig_kick(st);
+}
+
+/* Calls go out on the channel of the scan list with the best LQA to the
+ * station, or on the one the scan is on if there is no history */
+static void scan_call_channel(struct ale_station *st, const char *remote)
+{
+	struct ale_scan_list *list = st->scan->list;
+	uint32_t freqs[ALE_SCAN_MAX_CHANNELS];
+	float score;
+	int best;
+
+	if (!list)
+		return;
+	for (unsigned int i = 0; i < list->count; i++)
+		freqs[i] = list->ch[i].freq_hz;
+	best = ale_lqa_best(st->lqa, remote, freqs, list->count, time(NULL), &score);
+	if (best < 0)
+		return;
+	LOGPFSML(st->fi, LOGL_INFO, "Calling %s on %u Hz, LQA score %.1f\n", remote, freqs[best], score);
+	ale_scan_goto(st->scan, best, monotonic_ms());
+}
+
+/* Our sounding: the same frame every time, the modem sends it from its
+ * waveform cache */
+static void ale_send_sounding(struct ale_station *st, bool send)
+{
+	const struct ale_mode *sig = ale_mode_get(ALE_MODE_DATAC13);
+	struct ale_arq_ctrl ctrl = { .type = ARQ_CTRL_SOUND };
+	uint8_t frame[sig->payload_bytes];
+
+	OSMO_STRLCPY_ARRAY(ctrl.src, st->callsign);
+	ale_arq_ctrl_encode(frame, sizeof(frame), &ctrl);
+	if (send)
+		ale_ptt_on(st);
+	st->tx_cached(st, sig, frame, sizeof(frame), send);
+	if (send)
+		ale_send_end(st);
+}
+
+/* Soundings go out while idle only, on the channel of the scan list the
+ * scheduler picks, or on the one we are on when not scanning. A sounding
+ * holds the scan until it is on the air, ale_station_tx_done() asks for
+ * the next one */
+static void ale_sound_timer_cb(void *data)
+{
+	struct ale_station *st = data;
+	struct ale_scan_list *list = st->scan->list;
+	uint32_t freqs[ALE_SCAN_MAX_CHANNELS];
+	time_t now = time(NULL), next;
+	unsigned int n = 0;
+	int idx;
+
+	if (!ale_station_idle(st) || !st->tx_cached || !st->callsign[0])
+		return;
+	if (st->ptt) {
+		osmo_timer_schedule(&st->sound_timer, 1, 0);
+		return;
+	}
+
+	if (list) {
+		for (unsigned int i = 0; i < list->count; i++)
+			freqs[n++] = list->ch[i].freq_hz;
+	} else if (st->freq_hz) {
+		freqs[n++] = st->freq_hz;
+	}
+
+	idx = ale_sound_pick(st->sound, st->lqa, freqs, n, now, &next);
+	if (idx >= 0 && list) {
+		st->sound_hold = true;
+		scan_hold_call(st, true);
+		if (freqs[idx] != st->freq_hz) {
+			// the rig needs a moment to get there
+			ale_scan_goto(st->scan, idx, monotonic_ms());
+			osmo_timer_schedule(&st->sound_timer, 0, SOUND_TUNE_USECS);
+			return;
+		}
+	}
+	if (idx >= 0) {
+		LOGPFSML(st->fi, LOGL_DEBUG, "Sounding on %u Hz, priority %.2f\n", freqs[idx],
+			 ale_sound_channel(st->sound, freqs[idx])->priority);
+		ale_sound_sent(st->sound, freqs[idx], now);
+		ale_send_sounding(st, true);
+		return;
+	}
+
+	if (st->sound_hold) {
+		st->sound_hold = false;
+		scan_hold_call(st, false);
+	}
+	if (next)
+		osmo_timer_schedule(&st->sound_timer, next - now, 0);
+}
+
+/* Host writes to the shm ring are not seen, the batching stage learns the
+ * age of the data it holds from this poll */
+static void ale_batch_timer_cb(void *data)
+{
+	struct ale_station *st = data;
+
+	ale_batch_poll(st->batch);
+	osmo_timer_schedule(&st->batch_timer, 0, BATCH_POLL_USECS);
+}
+
+/* Both ends agreed on the capabilities, the first turn is next */
+static void ale_session_start(struct ale_station *st)
+{
+	const struct ale_arq_io *io = ale_comp_start(st->comp, st->caps);
+
+	ale_txq_reset(st->txq);
+	ale_batch_set_source(st->batch, io ? io : &st->txq->io);
+	if (st->batch->deadline_ms)
+		ale_batch_timer_cb(st);
+	st->tx_turn_ms = st->rx_turn_ms = 0;
+	st->turn_start_ms = monotonic_ms();
+	st->disc_pending = false;
+	rate_ctr_inc(&st->ctrs->ctr[ALE_CTR_CALL_CONNECTED]);
+	osmo_stat_item_set(st->stats->items[ALE_STAT_CALL_SETUP], st->turn_start_ms - st->call_start_ms);
+	ale_host_event(st, ALE_HOST_CONNECTED);
+	LOGPFSML(st->fi, LOGL_INFO, "Session with %s, compression %s\n", st->remote,
+		 !(st->caps & ALE_CAP_COMP) ? "off" :
+		 (st->caps & ALE_CAP_DICT_MASK) ? "on" : "on (no dictionary)");
+}
+
+static void ale_session_end(struct ale_station *st)
+{
+	struct ale_comp_stats *cs = &st->comp->stats;
+
+	if (st->comp->active)
+		LOGPFSML(st->fi, LOGL_INFO, "Compression: tx %lu -> %lu bytes (%.2f), "
+			 "rx %lu -> %lu bytes, %lu flushes, %lu errors, cpu %.1f ms\n",
+			 cs->tx_in, cs->tx_out, ale_comp_ratio(cs), cs->rx_in, cs->rx_out,
+			 cs->tx_flushes, cs->rx_errors, cs->cpu_ms);
+	ale_comp_stop(st->comp);
+	ale_batch_set_source(st->batch, &st->txq->io);
+	osmo_timer_del(&st->batch_timer);
+	st->caps = 0;
+}
 
 static void ale_init(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 {
-    osmo_fsm_inst_state_chg(fi, ALE_S_IDLE, 0, 0);
+	struct ale_station *st = fi->priv;
+
+	// the sounding waveform is ready before the first one is due
+	if (st->tx_cached && st->callsign[0])
+		ale_send_sounding(st, false);
+	ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+}
+
+static void ale_idle_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+{
+	struct ale_station *st = fi->priv;
+
+	ale_session_end(st);
+	ale_stats_arq_flush(st);
+	ale_arq_reset(st->arq);
+	ale_rate_reset(&st->rate);
+
+	switch (prev_state) {
+	case ALE_S_ROLE_TX:
+	case ALE_S_ROLE_RX:
+		rate_ctr_inc(&st->ctrs->ctr[ALE_CTR_CALL_ENDED]);
+		/* fall through */
+	case ALE_S_CALLING_TO_HOST:
+		ale_host_event(st, ALE_HOST_DISCONNECTED);
+		ale_host_event(st, ALE_HOST_BUFFER);
+		break;
+	case ALE_S_RECEIVING_FROM_HOST:
+		ale_host_event(st, ALE_HOST_CANCELPENDING);
+		break;
+	}
+
+	st->remote[0] = 0;
+	st->call_tries = 0;
+	st->idle_turns = 0;
+	st->disc_pending = false;
+	st->sound_hold = false;
+	scan_hold_call(st, false);
+	osmo_timer_schedule(&st->sound_timer, SOUND_IDLE_SECS, 0);
+
+	ale_station_send_ui(st);
+}
+
+static void ale_idle_accepting(struct osmo_fsm_inst *fi, uint32_t event, void *data)
+{
+	struct ale_station *st = fi->priv;
+	const struct ale_addr_entry *entry;
+	struct ale_arq_ctrl *ctrl;
+
+	switch (event) {
+	case ALE_E_REJECT_CONNECTIONS:
+		ale_state_chg(fi, ALE_S_READY_IDLE_REJECTING_CONNECTIONS, 0, 0);
+		break;
+	case ALE_E_MAKE_CALL:
+		OSMO_STRLCPY_ARRAY(st->remote, (const char *) data);
+		st->call_start_ms = monotonic_ms();
+		rate_ctr_inc(&st->ctrs->ctr[ALE_CTR_CALL_OUT]);
+		scan_call_channel(st, st->remote);
+		scan_hold_call(st, true);
+		ale_state_chg(fi, ALE_S_CALLING_TO_HOST, T_CALL_SECS, T_CALL);
+		break;
+	case ALE_E_RECEIVE_CALL:
+		ctrl = data;
+		entry = ale_addr_lookup(st->addr, ALE_ADDR_STATION, ctrl->src);
+		LOGPFSML(fi, LOGL_INFO, "Call from %s to %s (%s)\n", ctrl->src, ctrl->dst,
+			 !entry ? "not in the address book" : entry->name[0] ? entry->name : entry->pattern);
+		OSMO_STRLCPY_ARRAY(st->remote, ctrl->src);
+		st->call_start_ms = monotonic_ms();
+		rate_ctr_inc(&st->ctrs->ctr[ALE_CTR_CALL_IN]);
+		st->caps = st->compression ? ale_comp_negotiate(st->comp, ctrl->caps,
+				strcmp(st->dict_from, ctrl->src) ? 0 : st->dict_id) : 0;
+		st->dict_from[0] = 0;
+		scan_hold_call(st, true);
+		ale_host_event(st, ALE_HOST_PENDING);
+		ale_state_chg(fi, ALE_S_RECEIVING_FROM_HOST, T_CALL_SECS * CALL_MAX_TRIES, T_CALL);
+		break;
+	default:
+		OSMO_ASSERT(0);
+	}
+}
+
+static void ale_idle_rejecting(struct osmo_fsm_inst *fi, uint32_t event, void *data)
+{
+	switch (event) {
+	case ALE_E_ACCEPT_CONNECTIONS:
+		ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+		break;
+	default:
+		OSMO_ASSERT(0);
+	}
+}
+
+static void ale_calling_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+{
+	struct ale_station *st = fi->priv;
+
+	st->call_tries++;
+	ale_send_ctrl(st, ARQ_CTRL_CALL);
+}
+
+static void ale_calling(struct osmo_fsm_inst *fi, uint32_t event, void *data)
+{
+	struct ale_station *st = fi->priv;
+	struct ale_arq_ctrl *ctrl;
+
+	switch (event) {
+	case ALE_E_MAKE_CALL_CONNECTED:
+		ctrl = data;
+		st->caps = st->compression ? ctrl->caps : 0;
+		ale_session_start(st);
+		ale_state_chg(fi, ALE_S_ROLE_TX, 0, 0);
+		break;
+	case ALE_E_DISCONNECTED:
+		ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+		break;
+	default:
+		OSMO_ASSERT(0);
+	}
+}
+
+static void ale_receiving_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+{
+	ale_send_ctrl(fi->priv, ARQ_CTRL_CALL_ACK);
+}
+
+static void ale_receiving(struct osmo_fsm_inst *fi, uint32_t event, void *data)
+{
+	switch (event) {
+	case ALE_E_RECEIVE_CALL:
+		// our acknowledgement was lost, the caller is retrying
+		ale_send_ctrl(fi->priv, ARQ_CTRL_CALL_ACK);
+		break;
+	case ALE_E_RECEIVE_CALL_CONNECTED:
+		ale_session_start(fi->priv);
+		ale_state_chg(fi, ALE_S_ROLE_RX, T_TURN_SECS, T_TURN);
+		break;
+	case ALE_E_DISCONNECTED:
+		ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+		break;
+	default:
+		OSMO_ASSERT(0);
+	}
+}
+
+/* Our turn: acknowledgement of the last peer turn, retransmissions and
+ * new data all go out in one burst before the turnover. The speed level
+ * is only changed here, between two bursts. */
+static void ale_role_tx_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+{
+	struct ale_station *st = fi->priv;
+	uint8_t frame[ARQ_MAX_PAYLOAD];
+	const struct ale_mode *mode;
+	uint64_t now = monotonic_ms();
+	int len;
+
+	if (prev_state == ALE_S_ROLE_RX)
+		st->rx_turn_ms = now - st->turn_start_ms;
+	st->turn_start_ms = now;
+
+	mode = ale_rate_turn(&st->rate, &st->arq->stats);
+	if (mode != st->arq->mode) {
+		LOGPFSML(fi, LOGL_INFO, "Speed level %s -> %s (%s, snr %.1f dB)\n",
+			 st->arq->mode->name, mode->name,
+			 ale_rate_reason_names[st->rate.last], st->rate.snr_db);
+		ale_arq_set_mode(st->arq, mode);
+	}
+
+	if (!ale_arq_tx_pending(st->arq))
+		st->idle_turns++;
+	else
+		st->idle_turns = 0;
+
+	// the host may have drained the RX ring since last turn
+	ale_comp_pump(st->comp);
+
+	// a partial frame held now goes out in one turn cycle
+	ale_batch_turn(st->batch, st->tx_turn_ms + st->rx_turn_ms);
+
+	// the peer picks its level on how we hear it
+	ale_arq_set_rx_snr(st->arq, st->rate.rx_snr_valid, st->rate.rx_snr_db);
+	ale_arq_turn_begin(st->arq);
+	while ((len = ale_arq_tx_frame(st->arq, frame, sizeof(frame), &mode)) > 0)
+		ale_send_frame(st, mode, frame, len, st->arq->tx_frame_born_us);
+	ale_send_end(st);
+
+	if (!st->tx_frame)
+		ale_station_tx_done(st);
 }
 
+/* The peer stream can't be inflated or split into its classes: the ARQ no
+ * longer acks what can't be delivered and the peer would retry it for ever,
+ * end the session */
+static bool ale_comp_failed(struct osmo_fsm_inst *fi, struct ale_station *st)
+{
+	if (!st->comp->rx_error && !st->txq->rx_error)
+		return false;
 
+	if (st->txq->rx_error)
+		LOGPFSML(fi, LOGL_ERROR, "RX record stream broken, disconnecting\n");
+	else if (st->comp->dict_refused)
+		LOGPFSML(fi, LOGL_NOTICE, "Peer compresses with another dictionary, disconnecting, "
+			 "the next calls go without one\n");
+	else
+		LOGPFSML(fi, LOGL_ERROR, "Compressed stream broken, disconnecting\n");
+	ale_send_ctrl(st, ARQ_CTRL_DISC);
+	ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+	return true;
+}
+
+static void ale_role_tx(struct osmo_fsm_inst *fi, uint32_t event, void *data)
+{
+	struct ale_station *st = fi->priv;
+
+	switch (event) {
+	case ALE_E_CHG_ROLE_TO_RX:
+		if (ale_comp_failed(fi, st))
+			break;
+		if (st->idle_turns > IDLE_MAX_TURNS) {
+			LOGPFSML(fi, LOGL_NOTICE, "Link idle, disconnecting\n");
+			ale_send_ctrl(st, ARQ_CTRL_DISC);
+			ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+			break;
+		}
+		ale_state_chg(fi, ALE_S_ROLE_RX, T_TURN_SECS, T_TURN);
+		break;
+	case ALE_E_DISCONNECTED:
+		ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+		break;
+	default:
+		OSMO_ASSERT(0);
+	}
+}
+
+static void ale_role_rx_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+{
+	struct ale_station *st = fi->priv;
+	uint64_t now = monotonic_ms();
+
+	if (prev_state == ALE_S_ROLE_TX)
+		st->tx_turn_ms = now - st->turn_start_ms;
+	st->turn_start_ms = now;
+}
 
- // example code from osmo-cbc
-static void ale_event_handler(struct osmo_fsm_inst *fi, uint32_t event, void *data)
+static void ale_role_rx(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 {
+	struct ale_station *st = fi->priv;
+
 	switch (event) {
-            // TODO
-	case ALE_E_INIT:
-		osmo_fsm_inst_state_chg(fi, ALE_S_IDLE, 0, 0);
+	case ALE_E_CHG_ROLE_TO_TX:
+		if (ale_comp_failed(fi, st))
+			break;
+		if (st->disc_pending && !ale_arq_tx_pending(st->arq)) {
+			LOGPFSML(fi, LOGL_INFO, "TX backlog sent, disconnecting\n");
+			ale_send_ctrl(st, ARQ_CTRL_DISC);
+			ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+			break;
+		}
+		ale_state_chg(fi, ALE_S_ROLE_TX, 0, 0);
+		break;
+	case ALE_E_DISCONNECTED:
+		ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
 		break;
 	default:
 		OSMO_ASSERT(0);
 	}
 }
 
-static int ale_conn_cb(struct osmo_fsm_inst *fi)
+static int ale_fsm_timer_cb(struct osmo_fsm_inst *fi)
 {
-    return 1;
+	struct ale_station *st = fi->priv;
+
+	switch (fi->T) {
+	case T_CALL:
+		if (fi->state == ALE_S_CALLING_TO_HOST && st->call_tries < CALL_MAX_TRIES) {
+			/* re-entering the state sends the call again */
+			ale_state_chg(fi, ALE_S_CALLING_TO_HOST, T_CALL_SECS, T_CALL);
+			return 0;
+		}
+		LOGPFSML(fi, LOGL_NOTICE, "Call to %s failed\n", st->remote);
+		rate_ctr_inc(&st->ctrs->ctr[ALE_CTR_CALL_FAILED]);
+		ale_state_chg(fi, ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS, 0, 0);
+		return 0;
+	case T_TURN:
+		// end of turn frame lost, take the turn back
+		ale_state_chg(fi, ALE_S_ROLE_TX, 0, 0);
+		return 0;
+	default:
+		OSMO_ASSERT(0);
+	}
+	return 0;
 }
 
 static const struct osmo_fsm_state ale_fsm_states[] = {
 	[ALE_S_INIT] = {
 		.name = "INIT",
-		.in_event_mask = 0,
-		.out_state_mask = S(ALE_S_IDLE),
+		.in_event_mask = S(ALE_E_INIT),
+		.out_state_mask = S(ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS),
 		.action = ale_init,
 	},
+	[ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS] = {
+		.name = "READY_IDLE_ACCEPTING_CONNECTIONS",
+		.in_event_mask = S(ALE_E_REJECT_CONNECTIONS) |
+				 S(ALE_E_MAKE_CALL) |
+				 S(ALE_E_RECEIVE_CALL),
+		.out_state_mask = S(ALE_S_READY_IDLE_REJECTING_CONNECTIONS) |
+				  S(ALE_S_CALLING_TO_HOST) |
+				  S(ALE_S_RECEIVING_FROM_HOST),
+		.onenter = ale_idle_onenter,
+		.action = ale_idle_accepting,
+	},
+	[ALE_S_READY_IDLE_REJECTING_CONNECTIONS] = {
+		.name = "READY_IDLE_REJECTING_CONNECTIONS",
+		.in_event_mask = S(ALE_E_ACCEPT_CONNECTIONS),
+		.out_state_mask = S(ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS),
+		.action = ale_idle_rejecting,
+	},
+	[ALE_S_CALLING_TO_HOST] = {
+		.name = "CALLING_TO_HOST",
+		.in_event_mask = S(ALE_E_MAKE_CALL_CONNECTED) |
+				 S(ALE_E_DISCONNECTED),
+		.out_state_mask = S(ALE_S_CALLING_TO_HOST) |
+				  S(ALE_S_ROLE_TX) |
+				  S(ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS),
+		.onenter = ale_calling_onenter,
+		.action = ale_calling,
+	},
+	[ALE_S_RECEIVING_FROM_HOST] = {
+		.name = "RECEIVING_FROM_HOST",
+		.in_event_mask = S(ALE_E_RECEIVE_CALL) |
+				 S(ALE_E_RECEIVE_CALL_CONNECTED) |
+				 S(ALE_E_DISCONNECTED),
+		.out_state_mask = S(ALE_S_ROLE_RX) |
+				  S(ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS),
+		.onenter = ale_receiving_onenter,
+		.action = ale_receiving,
+	},
+	[ALE_S_ROLE_TX] = {
+		.name = "ROLE_TX",
+		.in_event_mask = S(ALE_E_CHG_ROLE_TO_RX) |
+				 S(ALE_E_DISCONNECTED),
+		.out_state_mask = S(ALE_S_ROLE_RX) |
+				  S(ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS),
+		.onenter = ale_role_tx_onenter,
+		.action = ale_role_tx,
+	},
+	[ALE_S_ROLE_RX] = {
+		.name = "ROLE_RX",
+		.in_event_mask = S(ALE_E_CHG_ROLE_TO_TX) |
+				 S(ALE_E_DISCONNECTED),
+		.out_state_mask = S(ALE_S_ROLE_TX) |
+				  S(ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS),
+		.onenter = ale_role_rx_onenter,
+		.action = ale_role_rx,
+	},
 };
 
 struct osmo_fsm ale_fsm = {
 	.name = "ALE-HF-Controller",
 	.states = ale_fsm_states,
 	.num_states = ARRAY_SIZE(ale_fsm_states),
-//	.timer_cb = ale_fsm_timer_cb,
+	.timer_cb = ale_fsm_timer_cb,
 	.log_subsys = ALE,
 	.event_names = ale_event_names,
 };
 
+struct ale_station *ale_station_alloc(void *ctx, cbuf_handle_t tx_data[ALE_TX_NUM_CLASSES],
+				       cbuf_handle_t rx_data[ALE_TX_NUM_CLASSES])
+{
+	struct ale_station *st = talloc_zero(ctx, struct ale_station);
+
+	OSMO_ASSERT(st);
+	memcpy(st->tx_rings, tx_data, sizeof(st->tx_rings));
+	memcpy(st->rx_rings, rx_data, sizeof(st->rx_rings));
+	st->tx_data = tx_data[ALE_TX_BULK];
+	st->arq = ale_arq_alloc(st->tx_data, rx_data[ALE_TX_BULK], ale_mode_get(ALE_MODE_DATAC3));
+	ale_rate_init(&st->rate, ALE_MODE_DATAC3, true);
+	st->txq = ale_txq_alloc(tx_data, rx_data);
+	st->comp = ale_comp_alloc(&st->txq->io);
+	st->compression = true;
+	st->vara_port = VARA_DEFAULT_PORT;
+	st->kiss_port = KISS_DEFAULT_PORT;
+	st->ardop_port = ARDOP_DEFAULT_PORT;
+	st->vara_prio = st->ardop_prio = st->local_prio = HOST_DEFAULT_PRIO;
+	st->vara_class = st->ardop_class = ALE_TX_BULK;
+	st->local_path = talloc_strdup(st, ALE_CLIENT_DEFAULT_PATH);
+	st->ui_tx = circular_buf_init(talloc_size(st, ALE_UI_RING_SIZE), ALE_UI_RING_SIZE);
+	st->batch = ale_batch_alloc(&st->txq->io, 0);
+	st->rec = ale_rec_alloc(ALE_AUDIO_RATE);
+	OSMO_ASSERT(st->rec);
+	st->spec = ale_spec_alloc(ALE_AUDIO_RATE);
+	OSMO_ASSERT(st->spec);
+	st->addr = ale_addr_alloc();
+	OSMO_ASSERT(st->addr);
+	st->lqa = ale_lqa_alloc(ALE_LQA_DEFAULT_SLOTS);
+	OSMO_ASSERT(st->lqa);
+	st->scan = talloc_zero(st, struct ale_scan);
+	OSMO_ASSERT(st->scan);
+	ale_scan_init(st->scan);
+	st->sound = talloc_zero(st, struct ale_sound);
+	OSMO_ASSERT(st->sound);
+	ale_sound_init(st->sound, ale_mode_get(ALE_MODE_DATAC13)->frame_ms, time(NULL));
+	osmo_timer_setup(&st->sound_timer, ale_sound_timer_cb, st);
+	ale_arq_set_io(st->arq, &st->batch->io);
+	osmo_timer_setup(&st->batch_timer, ale_batch_timer_cb, st);
+	st->fi = osmo_fsm_inst_alloc(&ale_fsm, st, st, LOGL_INFO, "ale");
+	OSMO_ASSERT(st->fi);
+
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		char name[ALE_FLIGHT_LABEL_LEN];
+
+		snprintf(name, sizeof(name), "tx-%s", ale_txq_class_names[i]);
+		ale_flight_ring(tx_data[i], name);
+		snprintf(name, sizeof(name), "rx-%s", ale_txq_class_names[i]);
+		ale_flight_ring(rx_data[i], name);
+	}
+	ale_flight_ring(st->ui_tx, "ui-tx");
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+		ale_stats_ring(ALE_RING_TX_EXPRESS + i, tx_data[i]);
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+		ale_stats_ring(ALE_RING_RX_EXPRESS + i, rx_data[i]);
+	ale_stats_ring(ALE_RING_UI_TX, st->ui_tx);
+	for (unsigned int i = 0; i < ale_fsm.num_states; i++)
+		ale_flight_label(FLIGHT_T_STATE, i, ale_fsm.states[i].name);
+
+	return st;
+}
+
+/* Called by the modem for each decoded frame */
+/* LQA of the channel we are on, and of the station if known */
+static void lqa_rx(struct ale_station *st, const char *addr, float snr_db, bool ok, bool sounding)
+{
+	time_t now = time(NULL);
+
+	ale_lqa_update(st->lqa, st->freq_hz, addr, snr_db, ok, sounding, now);
+	ale_sound_busy(st->sound, st->freq_hz, now);
+}
+
+void ale_station_rx_frame(struct ale_station *st, const uint8_t *buf, size_t len, float snr_db)
+{
+	struct osmo_fsm_inst *fi = st->fi;
+	struct ale_arq_ctrl ctrl;
+	int flags;
+
+	if (len < 1)
+		return;
+
+	if (buf[0] == ARQ_HDR_UI) {
+		const uint8_t *data;
+		int data_len = ale_arq_ui_decode(buf, len, &data);
+
+		if (data_len < 0) {
+			LOGPFSML(fi, LOGL_NOTICE, "Malformed %zu byte UI frame\n", len);
+			return;
+		}
+		st->ui_rx_frames++;
+		lqa_rx(st, NULL, snr_db, true, false);
+		ale_host_ui(st, data, data_len);
+		return;
+	}
+
+	if (fi->state == ALE_S_ROLE_RX || fi->state == ALE_S_RECEIVING_FROM_HOST)
+		ale_rate_rx_frame(&st->rate, snr_db, true);
+
+	/* data in RECEIVING_FROM_HOST: the caller got our acknowledgement */
+	if (!(buf[0] & ARQ_HDR_CTRL) && fi->state == ALE_S_RECEIVING_FROM_HOST)
+		osmo_fsm_inst_dispatch(fi, ALE_E_RECEIVE_CALL_CONNECTED, NULL);
+
+	if (fi->state != ALE_S_ROLE_RX && !(buf[0] & ARQ_HDR_CTRL))
+		return;
+
+	flags = ale_arq_rx_frame(st->arq, buf, len, &ctrl);
+	if (flags < 0) {
+		LOGPFSML(fi, LOGL_NOTICE, "Malformed %zu byte frame\n", len);
+		return;
+	}
+	lqa_rx(st, (flags & ARQ_HDR_CTRL) ? ctrl.src : st->remote, snr_db, true,
+	       (flags & ARQ_HDR_CTRL) && ctrl.type == ARQ_CTRL_SOUND);
+
+	if (flags & ARQ_HDR_CTRL) {
+		/* to no one, it was for the LQA */
+		if (ctrl.type == ARQ_CTRL_SOUND) {
+			LOGPFSML(fi, LOGL_DEBUG, "Sounding from %s, SNR %.1f dB\n", ctrl.src, snr_db);
+			return;
+		}
+		/* to no one either, the call right behind it says to whom */
+		if (ctrl.type == ARQ_CTRL_DICT) {
+			OSMO_STRLCPY_ARRAY(st->dict_from, ctrl.src);
+			st->dict_id = ctrl.dict_id;
+			return;
+		}
+		/* our callsign, or one of our nets */
+		if (strcmp(ctrl.dst, st->callsign) && !ale_addr_lookup(st->addr, ALE_ADDR_NET, ctrl.dst))
+			return;
+
+		switch (ctrl.type) {
+		case ARQ_CTRL_CALL:
+			if (ale_addr_lookup(st->addr, ALE_ADDR_DENY, ctrl.src)) {
+				LOGPFSML(fi, LOGL_INFO, "Call from %s denied by the address book\n", ctrl.src);
+				break;
+			}
+			if (fi->state == ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS ||
+			    (fi->state == ALE_S_RECEIVING_FROM_HOST && !strcmp(ctrl.src, st->remote)))
+				osmo_fsm_inst_dispatch(fi, ALE_E_RECEIVE_CALL, &ctrl);
+			break;
+		case ARQ_CTRL_CALL_ACK:
+			if (fi->state == ALE_S_CALLING_TO_HOST && !strcmp(ctrl.src, st->remote))
+				osmo_fsm_inst_dispatch(fi, ALE_E_MAKE_CALL_CONNECTED, &ctrl);
+			break;
+		case ARQ_CTRL_DISC:
+			if (!strcmp(ctrl.src, st->remote) &&
+			    (fi->state == ALE_S_ROLE_RX || fi->state == ALE_S_ROLE_TX))
+				osmo_fsm_inst_dispatch(fi, ALE_E_DISCONNECTED, NULL);
+			break;
+		case ARQ_CTRL_SOUND:
+		case ARQ_CTRL_DICT:
+			break;
+		}
+		return;
+	}
+
+	if (flags & ARQ_HDR_DATA)
+		ale_host_event(st, ALE_HOST_RX_DATA);
+	if (flags & ARQ_HDR_ACK)
+		ale_host_event(st, ALE_HOST_BUFFER);
+
+	if (flags & ARQ_HDR_EOT) {
+		ale_host_event(st, ALE_HOST_TURN);
+		osmo_fsm_inst_dispatch(fi, ALE_E_CHG_ROLE_TO_TX, NULL);
+	}
+}
+
+/* Called by the modem for a frame that synced but failed the CRC */
+void ale_station_rx_error(struct ale_station *st, float snr_db)
+{
+	lqa_rx(st, st->remote, snr_db, false, false);
+	if (st->fi->state == ALE_S_ROLE_RX)
+		ale_rate_rx_frame(&st->rate, snr_db, false);
+}
+
+/* Called by the modem when the first mode gets sync and when the last one
+ * loses it, the call detector of the scan */
+void ale_station_rx_sync(struct ale_station *st, bool sync)
+{
+	if (sync)
+		ale_sound_busy(st->sound, st->freq_hz, time(NULL));
+	ale_scan_detect(st->scan, sync, monotonic_ms());
+	ale_rig_kick(st);
+}
+
+/* Called by the modem once the last frame of our turn is on the air */
+void ale_station_tx_done(struct ale_station *st)
+{
+	if (st->ptt) {
+		st->ptt = false;
+		ale_host_event(st, ALE_HOST_PTT_OFF);
+	}
+	if (st->fi->state == ALE_S_ROLE_TX)
+		osmo_fsm_inst_dispatch(st->fi, ALE_E_CHG_ROLE_TO_RX, NULL);
+	else if (ale_station_idle(st))
+		osmo_timer_schedule(&st->sound_timer, 0, 0);
+}
+
+/* Host interface requests */
+
+bool ale_station_connected(struct ale_station *st)
+{
+	return st->fi->state == ALE_S_ROLE_TX || st->fi->state == ALE_S_ROLE_RX;
+}
+
+bool ale_station_idle(struct ale_station *st)
+{
+	return st->fi->state == ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS ||
+	       st->fi->state == ALE_S_READY_IDLE_REJECTING_CONNECTIONS;
+}
+
+/* Calling, or sending in a session */
+bool ale_station_has_turn(struct ale_station *st)
+{
+	return st->fi->state == ALE_S_CALLING_TO_HOST || st->fi->state == ALE_S_ROLE_TX;
+}
+
+int ale_station_call(struct ale_station *st, const char *remote)
+{
+	if (st->fi->state != ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS)
+		return -EBUSY;
+
+	return osmo_fsm_inst_dispatch(st->fi, ALE_E_MAKE_CALL, (void *) remote);
+}
+
+void ale_station_listen(struct ale_station *st, bool on)
+{
+	if (on && st->fi->state == ALE_S_READY_IDLE_REJECTING_CONNECTIONS)
+		osmo_fsm_inst_dispatch(st->fi, ALE_E_ACCEPT_CONNECTIONS, NULL);
+	else if (!on && st->fi->state == ALE_S_READY_IDLE_ACCEPTING_CONNECTIONS)
+		osmo_fsm_inst_dispatch(st->fi, ALE_E_REJECT_CONNECTIONS, NULL);
+}
+
+/* A clean disconnect waits for the peer to acknowledge the TX backlog */
+int ale_station_disconnect(struct ale_station *st, bool abort)
+{
+	switch (st->fi->state) {
+	case ALE_S_ROLE_TX:
+	case ALE_S_ROLE_RX:
+		if (!abort) {
+			st->disc_pending = true;
+			break;
+		}
+		ale_send_ctrl(st, ARQ_CTRL_DISC);
+		osmo_fsm_inst_dispatch(st->fi, ALE_E_DISCONNECTED, NULL);
+		break;
+	case ALE_S_CALLING_TO_HOST:
+	case ALE_S_RECEIVING_FROM_HOST:
+		osmo_fsm_inst_dispatch(st->fi, ALE_E_DISCONNECTED, NULL);
+		break;
+	default:
+		return -ENOTCONN;
+	}
+	return 0;
+}
+
+/* UI frames only go out between sessions, each in the smallest data mode
+ * it fits in */
+void ale_station_send_ui(struct ale_station *st)
+{
+	unsigned long sent = st->ui_tx_frames;
+	uint8_t data[ARQ_MAX_PAYLOAD];
+	int len;
+
+	if (!ale_station_idle(st))
+		return;
+
+	while ((len = circular_buf_get_record(st->ui_tx, data, sizeof(data))) > 0) {
+		const struct ale_mode *mode = NULL;
+
+		for (int i = 0; i < _NUM_ALE_MODES; i++) {
+			const struct ale_mode *m = ale_mode_get(i);
+
+			if (m->data && ale_mode_usable(m) && m->payload_bytes >= len + ARQ_UI_HDR_LEN &&
+			    (!mode || m->payload_bytes < mode->payload_bytes))
+				mode = m;
+		}
+		if (!mode) {
+			LOGPFSML(st->fi, LOGL_NOTICE, "Dropping %d byte UI frame, too long\n", len);
+			continue;
+		}
+
+		uint8_t frame[mode->payload_bytes];
+
+		ale_arq_ui_encode(frame, sizeof(frame), data, len);
+		ale_send_frame(st, mode, frame, sizeof(frame), 0);
+		st->ui_tx_frames++;
+	}
+	if (st->ui_tx_frames != sent)
+		ale_send_end(st);
+}
+
 static __attribute__((constructor)) void on_dso_load_cbsp_srv_fsm(void)
 {
 	osmo_fsm_register(&ale_fsm);
 }
-
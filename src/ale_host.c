@@ -0,0 +1,569 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_host.c
+ * @author agent
+ * @brief Host interfaces shared layer
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/netif/stream.h>
+
+#include "internal.h"
+#include "ale_uring.h"
+#include "ale_pool.h"
+#include "ale_lat.h"
+
+#define HOST_RX_LOW_WATER 4	// 1/4 of the RX ring free, else laggards are moved on
+#define HOST_CMD_POOL 32	// reply lines queued to the command sockets
+
+static LLIST_HEAD(host_ifs);
+static LLIST_HEAD(host_rx);
+static LLIST_HEAD(host_tx);
+static bool tx_scheduling;
+static struct ale_host_tx *host_tx_owner[ALE_TX_NUM_CLASSES];
+static struct ale_pool *cmd_pool;
+static struct ale_lat_marks rx_marks[ALE_TX_NUM_CLASSES];
+
+static void host_rx_reclaim(struct ale_station *st, enum ale_tx_class cls);
+
+void ale_host_register(struct ale_host_if *hif)
+{
+	llist_add_tail(&hif->list, &host_ifs);
+}
+
+void ale_host_unregister(struct ale_host_if *hif)
+{
+	llist_del(&hif->list);
+}
+
+void ale_host_event(struct ale_station *st, enum ale_host_event ev)
+{
+	struct ale_host_if *hif, *tmp;
+
+	switch (ev) {
+	case ALE_HOST_RX_DATA:
+		for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+			host_rx_reclaim(st, i);
+		break;
+	case ALE_HOST_BUFFER:
+	case ALE_HOST_TURN:
+		ale_host_tx_schedule(st);
+		break;
+	default:
+		break;
+	}
+
+	llist_for_each_entry_safe(hif, tmp, &host_ifs, list) {
+		if (hif->event)
+			hif->event(hif, st, ev);
+	}
+}
+
+void ale_host_ui(struct ale_station *st, const uint8_t *data, size_t len)
+{
+	struct ale_host_if *hif, *tmp;
+
+	llist_for_each_entry_safe(hif, tmp, &host_ifs, list) {
+		if (hif->ui)
+			hif->ui(hif, st, data, len);
+	}
+}
+
+size_t ale_host_tx_backlog(struct ale_station *st)
+{
+	return ale_txq_size(st->txq) + ale_arq_tx_inflight(st->arq);
+}
+
+struct osmo_stream_srv_link *ale_host_listen(void *ctx, struct ale_station *st, uint16_t port,
+					     int (*accept_cb)(struct osmo_stream_srv_link *link, int fd),
+					     void *data)
+{
+	const char *addr = st->host_bind ? st->host_bind : "127.0.0.1";
+	struct osmo_stream_srv_link *link = osmo_stream_srv_link_create(ctx);
+
+	if (!link)
+		return NULL;
+
+	// shared by the command ports of all the interfaces
+	if (!cmd_pool)
+		cmd_pool = ale_msgb_pool_alloc(st, "host-cmd", ALE_HOST_LINE_MAX + 1, HOST_CMD_POOL);
+
+	osmo_stream_srv_link_set_addr(link, addr);
+	osmo_stream_srv_link_set_port(link, port);
+	osmo_stream_srv_link_set_data(link, data);
+	osmo_stream_srv_link_set_accept_cb(link, accept_cb);
+	if (osmo_stream_srv_link_open(link) < 0) {
+		LOGP(ALE, LOGL_ERROR, "Can't listen on %s:%u\n", addr, port);
+		osmo_stream_srv_link_destroy(link);
+		return NULL;
+	}
+
+	return link;
+}
+
+ssize_t ale_host_sock_to_ring(int fd, cbuf_handle_t ring, size_t max)
+{
+	struct iovec iov[2];
+	int n = circular_buf_free_iov(ring, iov);
+	ssize_t rc;
+
+	if (!n || !max)
+		return -EAGAIN;
+
+	// trim the free space to max
+	if (iov[0].iov_len >= max) {
+		iov[0].iov_len = max;
+		n = 1;
+	} else if (n == 2 && iov[0].iov_len + iov[1].iov_len > max) {
+		iov[1].iov_len = max - iov[0].iov_len;
+	}
+
+	rc = readv(fd, iov, n);
+	if (rc < 0)
+		return (errno == EINTR || errno == EWOULDBLOCK) ? -EAGAIN : -errno;
+
+	circular_buf_commit(ring, rc);
+	return rc;
+}
+
+/* Releases the RX ring of a class up to its slowest reader. With nobody
+ * attached the data stays for the next client */
+static void host_rx_release(struct ale_station *st, enum ale_tx_class cls)
+{
+	uint64_t start = circular_buf_read_pos(st->rx_rings[cls]);
+	uint64_t min = UINT64_MAX;
+	struct ale_host_rx *rx;
+
+	llist_for_each_entry(rx, &host_rx, list) {
+		if (rx->cls == cls && rx->pos < min)
+			min = rx->pos;
+	}
+	if (min != UINT64_MAX && min > start)
+		circular_buf_consume(st->rx_rings[cls], min - start);
+	ale_host_rx_poll(st);
+}
+
+static void host_rx_reclaim(struct ale_station *st, enum ale_tx_class cls)
+{
+	cbuf_handle_t ring = st->rx_rings[cls];
+	size_t cap = circular_buf_capacity(ring);
+	uint64_t end, lead = 0;
+	struct ale_host_rx *rx;
+	bool readers = false;
+	size_t keep;
+
+	if (circular_buf_free_size(ring) >= cap / HOST_RX_LOW_WATER)
+		return;
+
+	end = circular_buf_read_pos(ring) + circular_buf_size(ring);
+	llist_for_each_entry(rx, &host_rx, list) {
+		if (rx->cls != cls)
+			continue;
+		readers = true;
+		if (rx->pos > lead)
+			lead = rx->pos;
+	}
+	if (!readers)
+		return;
+
+	// all equally behind is plain flow control, the ARQ waits for them
+	keep = end - lead;
+	if (keep < cap / 2)
+		keep = cap / 2;
+
+	llist_for_each_entry(rx, &host_rx, list) {
+		uint64_t lost;
+
+		if (rx->cls != cls || end - rx->pos <= keep)
+			continue;
+		if (rx->inflight) {
+			// moved on once the write is gone
+			if (rx->stalled)
+				rx->stalled(rx);
+			continue;
+		}
+		lost = end - keep - rx->pos;
+		rx->pos += lost;
+		rx->stats.lost += lost;
+		rx->stats.overruns++;
+		rate_ctr_add(&st->ctrs->ctr[ALE_CTR_HOST_RX_LOST], lost);
+		LOGP(ALE, LOGL_NOTICE, "%s client lagging behind, %" PRIu64 " %s RX bytes skipped\n",
+		     rx->name, lost, ale_txq_class_names[cls]);
+	}
+
+	host_rx_release(st, cls);
+}
+
+void ale_host_rx_poll(struct ale_station *st)
+{
+	uint64_t now = ale_lat_now();
+
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		uint64_t start = circular_buf_read_pos(st->rx_rings[i]);
+
+		ale_lat_passed(&rx_marks[i], start, now, ALE_LAT_RX_HOST, -1);
+		ale_lat_mark(&rx_marks[i], start + circular_buf_size(st->rx_rings[i]), now, 0);
+	}
+}
+
+void ale_host_rx_attach(struct ale_station *st, struct ale_host_rx *rx)
+{
+	rx->pos = circular_buf_read_pos(st->rx_rings[rx->cls]);
+	rx->inflight = 0;
+	llist_add_tail(&rx->list, &host_rx);
+	osmo_stat_item_set(st->stats->items[ALE_STAT_HOST_READERS], llist_count(&host_rx));
+}
+
+void ale_host_rx_detach(struct ale_station *st, struct ale_host_rx *rx)
+{
+	llist_del(&rx->list);
+	osmo_stat_item_set(st->stats->items[ALE_STAT_HOST_READERS], llist_count(&host_rx));
+	host_rx_release(st, rx->cls);
+}
+
+int ale_host_rx_iov(struct ale_station *st, struct ale_host_rx *rx, struct iovec iov[2])
+{
+	cbuf_handle_t ring = st->rx_rings[rx->cls];
+	int n = circular_buf_peek_iov(ring, rx->pos, iov);
+
+	// only a ring reset goes past the readers
+	if (n < 0) {
+		rx->pos = circular_buf_read_pos(ring);
+		n = circular_buf_peek_iov(ring, rx->pos, iov);
+	}
+	return n;
+}
+
+size_t ale_host_rx_pending(struct ale_station *st, struct ale_host_rx *rx)
+{
+	cbuf_handle_t ring = st->rx_rings[rx->cls];
+	uint64_t end = circular_buf_read_pos(ring) + circular_buf_size(ring);
+
+	return end > rx->pos ? end - rx->pos : 0;
+}
+
+void ale_host_rx_advance(struct ale_station *st, struct ale_host_rx *rx, size_t len)
+{
+	if (!len)
+		return;
+	rx->pos += len;
+	rx->stats.bytes += len;
+	rate_ctr_add(&st->ctrs->ctr[ALE_CTR_HOST_RX_BYTES], len);
+	host_rx_release(st, rx->cls);
+}
+
+void ale_host_rx_seek(struct ale_station *st, struct ale_host_rx *rx, uint64_t pos)
+{
+	cbuf_handle_t ring = st->rx_rings[rx->cls];
+	uint64_t end = circular_buf_read_pos(ring) + circular_buf_size(ring);
+
+	if (pos > end)
+		pos = end;
+	if (pos > rx->pos)
+		ale_host_rx_advance(st, rx, pos - rx->pos);
+}
+
+size_t ale_host_rx_read(struct ale_station *st, struct ale_host_rx *rx, uint8_t *buf, size_t len)
+{
+	struct iovec iov[2];
+	int n = ale_host_rx_iov(st, rx, iov);
+	size_t done = 0;
+
+	for (int i = 0; i < n && done < len; i++) {
+		size_t part = OSMO_MIN(iov[i].iov_len, len - done);
+
+		memcpy(buf + done, iov[i].iov_base, part);
+		done += part;
+	}
+	ale_host_rx_advance(st, rx, done);
+	return done;
+}
+
+ssize_t ale_host_rx_to_sock(int fd, struct ale_station *st, struct ale_host_rx *rx)
+{
+	struct iovec iov[2];
+	struct msghdr msg = { .msg_iov = iov };
+	ssize_t rc;
+
+	msg.msg_iovlen = ale_host_rx_iov(st, rx, iov);
+	if (!msg.msg_iovlen)
+		return 0;
+
+	rc = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (rc < 0)
+		return (errno == EINTR || errno == EWOULDBLOCK) ? 0 : -errno;
+
+	ale_host_rx_advance(st, rx, rc);
+	return rc;
+}
+
+struct llist_head *ale_host_rx_list(void)
+{
+	return &host_rx;
+}
+
+void ale_host_tx_attach(struct ale_station *st, struct ale_host_tx *tx)
+{
+	tx->waiting = false;
+	llist_add_tail(&tx->list, &host_tx);
+	osmo_stat_item_set(st->stats->items[ALE_STAT_HOST_WRITERS], llist_count(&host_tx));
+}
+
+void ale_host_tx_detach(struct ale_station *st, struct ale_host_tx *tx)
+{
+	llist_del(&tx->list);
+	osmo_stat_item_set(st->stats->items[ALE_STAT_HOST_WRITERS], llist_count(&host_tx));
+	if (host_tx_owner[tx->cls] != tx)
+		return;
+
+	// what it wrote still goes out first, then the class is free
+	host_tx_owner[tx->cls] = NULL;
+	ale_host_tx_schedule(st);
+}
+
+cbuf_handle_t ale_host_tx_ring(struct ale_station *st, struct ale_host_tx *tx)
+{
+	return st->tx_rings[tx->cls];
+}
+
+size_t ale_host_tx_quota(struct ale_station *st, struct ale_host_tx *tx)
+{
+	struct ale_host_tx *other;
+
+	if (!host_tx_owner[tx->cls]) {
+		// the ones already waiting for the class go first
+		llist_for_each_entry(other, &host_tx, list) {
+			if (other->waiting && other->cls == tx->cls)
+				return 0;
+		}
+		host_tx_owner[tx->cls] = tx;
+	}
+	// the ring size is the limit
+	return host_tx_owner[tx->cls] == tx ? SIZE_MAX : 0;
+}
+
+void ale_host_tx_wrote(struct ale_station *st, struct ale_host_tx *tx, size_t len)
+{
+	tx->stats.bytes += len;
+	rate_ctr_add(&st->ctrs->ctr[ALE_CTR_HOST_TX_BYTES], len);
+	// the tx-host latency starts now, not at the next scheduler read
+	ale_txq_poll(st->txq);
+}
+
+void ale_host_tx_wait(struct ale_station *st, struct ale_host_tx *tx)
+{
+	struct ale_host_tx *owner = host_tx_owner[tx->cls];
+
+	if (tx->waiting)
+		return;
+	if (owner && owner != tx)
+		LOGP(ALE, LOGL_NOTICE, "%s client waits, the %s TX stream is %s's\n", tx->name,
+		     ale_txq_class_names[tx->cls], owner->name);
+	tx->waiting = true;
+	tx->stats.waits++;
+	ale_host_tx_schedule(st);
+}
+
+static struct ale_host_tx *host_tx_next(enum ale_tx_class cls)
+{
+	struct ale_host_tx *tx, *best = NULL;
+
+	// the first in the list wins a tie, turns move it to the tail
+	llist_for_each_entry(tx, &host_tx, list) {
+		if (tx->waiting && tx->cls == cls && (!best || tx->prio > best->prio))
+			best = tx;
+	}
+	return best;
+}
+
+void ale_host_tx_schedule(struct ale_station *st)
+{
+	struct ale_host_tx *tx;
+
+	// resume() writing and waiting again lands here
+	if (tx_scheduling)
+		return;
+	tx_scheduling = true;
+
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		if (!circular_buf_free_size(st->tx_rings[i]))
+			continue;
+
+		tx = host_tx_owner[i] ? host_tx_owner[i] : host_tx_next(i);
+		if (!tx || !tx->waiting)
+			continue;
+
+		host_tx_owner[i] = tx;
+		tx->waiting = false;
+		llist_del(&tx->list);
+		llist_add_tail(&tx->list, &host_tx);
+		tx->resume(tx);
+	}
+
+	tx_scheduling = false;
+}
+
+struct ale_host_tx *ale_host_tx_owner(enum ale_tx_class cls)
+{
+	return host_tx_owner[cls];
+}
+
+struct llist_head *ale_host_tx_list(void)
+{
+	return &host_tx;
+}
+
+static void host_cmd_recv_cb(struct ale_uring_op *op, const uint8_t *buf, int res);
+
+void ale_host_cmd_attach(struct ale_host_cmd *cmd, struct osmo_stream_srv *conn)
+{
+	cmd->conn = conn;
+	cmd->line_len = 0;
+	cmd->buffer_sent = false;
+
+	ale_uring_release(cmd->uop);
+	cmd->uop = NULL;
+	if (conn && ale_uring_active()) {
+		struct osmo_fd *ofd = osmo_stream_srv_get_ofd(conn);
+
+		cmd->uop = ale_uring_recv_start(ofd->fd, host_cmd_recv_cb, cmd);
+		if (cmd->uop)
+			osmo_fd_read_disable(ofd);
+	}
+}
+
+void ale_host_cmd_reply(struct ale_host_cmd *cmd, const char *fmt, ...)
+{
+	struct msgb *msg;
+	va_list ap;
+	int len;
+
+	if (!cmd->conn)
+		return;
+
+	msg = ale_msgb_get(cmd_pool, "host-cmd");
+	if (!msg)
+		return;
+
+	va_start(ap, fmt);
+	len = vsnprintf((char *) msg->data, ALE_HOST_LINE_MAX, fmt, ap);
+	va_end(ap);
+	if (len >= ALE_HOST_LINE_MAX)
+		len = ALE_HOST_LINE_MAX - 1;
+
+	LOGP(ALE, LOGL_DEBUG, "%s -> %s\n", cmd->name, (char *) msg->data);
+	msg->data[len++] = '\r';
+	msgb_put(msg, len);
+	osmo_stream_srv_send(cmd->conn, msg);
+}
+
+void ale_host_cmd_buffer(struct ale_host_cmd *cmd, struct ale_station *st, bool force)
+{
+	size_t backlog = ale_host_tx_backlog(st);
+
+	if (!force && cmd->buffer_sent && backlog == cmd->last_buffer)
+		return;
+
+	cmd->buffer_sent = true;
+	cmd->last_buffer = backlog;
+	ale_host_cmd_reply(cmd, "BUFFER %zu", backlog);
+}
+
+static void host_cmd_line(struct ale_host_cmd *cmd)
+{
+	char *argv[ALE_HOST_MAX_ARGS];
+	char *tok, *save;
+	int argc = 0;
+
+	LOGP(ALE, LOGL_DEBUG, "%s <- %s\n", cmd->name, cmd->line);
+
+	for (tok = strtok_r(cmd->line, " ", &save); tok && argc < ARRAY_SIZE(argv);
+	     tok = strtok_r(NULL, " ", &save))
+		argv[argc++] = tok;
+	if (argc)
+		cmd->command(cmd, argc, argv);
+}
+
+static void host_cmd_input(struct ale_host_cmd *cmd, const char *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (buf[i] == '\r' || buf[i] == '\n') {
+			cmd->line[cmd->line_len] = 0;
+			host_cmd_line(cmd);
+			cmd->line_len = 0;
+			continue;
+		}
+		// overlong lines are cut, TNC commands are short
+		if (cmd->line_len < ALE_HOST_LINE_MAX - 1)
+			cmd->line[cmd->line_len++] = buf[i];
+	}
+}
+
+static void host_cmd_recv_cb(struct ale_uring_op *op, const uint8_t *buf, int res)
+{
+	struct ale_host_cmd *cmd = ale_uring_op_data(op);
+
+	if (res <= 0) {
+		osmo_stream_srv_destroy(cmd->conn);
+		return;
+	}
+	host_cmd_input(cmd, (const char *) buf, res);
+}
+
+int ale_host_cmd_read(struct ale_host_cmd *cmd)
+{
+	char buf[ALE_HOST_LINE_MAX];
+	ssize_t rc;
+
+	rc = recv(osmo_stream_srv_get_ofd(cmd->conn)->fd, buf, sizeof(buf), 0);
+	if (rc <= 0) {
+		if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+			return 0;
+		osmo_stream_srv_destroy(cmd->conn);
+		return -EBADF;
+	}
+
+	host_cmd_input(cmd, buf, rc);
+	return 0;
+}
+
+unsigned int ale_host_bitrate(struct ale_station *st)
+{
+	return ale_mode_bytes_per_min(st->arq->mode) * 8 / 60;
+}
@@ -0,0 +1,238 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_host.h
+ * @author agent
+ * @brief Host interfaces (VARA, KISS, ARDOP...) shared layer
+ *
+ * Host interfaces register here to get link events from the FSM and use
+ * the socket helpers to move data straight between their sockets and the
+ * data rings, without intermediate buffers. Several clients can be attached
+ * at once: each one reads the RX ring of a class through its own position
+ * in it (struct ale_host_rx) and waits for its turn to own the TX stream of
+ * its class (struct ale_host_tx). The line based command port (CR
+ * terminated commands and replies, BUFFER reports) is shared by the VARA
+ * and ARDOP interfaces.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/netif/stream.h>
+
+#include "ale_buf.h"
+#include "ale_client.h"
+
+struct ale_station;
+struct ale_uring_op;
+
+#define ALE_HOST_LINE_MAX 256
+#define ALE_HOST_MAX_ARGS 8
+
+enum ale_host_event {
+	ALE_HOST_PENDING,		// call being received
+	ALE_HOST_CANCELPENDING,		// it didn't complete
+	ALE_HOST_CONNECTED,
+	ALE_HOST_DISCONNECTED,		// session over, or call failed
+	ALE_HOST_PTT_ON,
+	ALE_HOST_PTT_OFF,
+	ALE_HOST_BUFFER,		// TX backlog may have changed
+	ALE_HOST_RX_DATA,		// new data in the RX ring
+	ALE_HOST_TURN,			// peer turn over, link quality updated
+};
+
+struct ale_host_if {
+	struct llist_head list;
+	const char *name;
+	/* link events, NULL if not interested */
+	void (*event)(struct ale_host_if *hif, struct ale_station *st,
+		      enum ale_host_event ev);
+	/* UI frame received (type byte + data), NULL if not interested */
+	void (*ui)(struct ale_host_if *hif, struct ale_station *st,
+		   const uint8_t *data, size_t len);
+	void *priv;
+};
+
+void ale_host_register(struct ale_host_if *hif);
+void ale_host_unregister(struct ale_host_if *hif);
+
+/* Notifies all the registered interfaces */
+void ale_host_event(struct ale_station *st, enum ale_host_event ev);
+
+/* Hands a received UI frame to the interested interfaces */
+void ale_host_ui(struct ale_station *st, const uint8_t *data, size_t len);
+
+/* Bytes written by the host not acknowledged by the peer yet */
+size_t ale_host_tx_backlog(struct ale_station *st);
+
+/* Listening socket on the host-bind address, NULL on error */
+struct osmo_stream_srv_link *ale_host_listen(void *ctx, struct ale_station *st, uint16_t port,
+					     int (*accept_cb)(struct osmo_stream_srv_link *link, int fd),
+					     void *data);
+
+/* RX fan-out: every attached reader gets the whole RX stream of its class
+ * out of the RX ring of the class through its own stream position, nothing
+ * is copied per reader. A ring is released up to its slowest reader. Once
+ * it runs low, readers lagging behind the fastest one are moved forward
+ * (the data is lost for them only), so a stuck client never holds up the
+ * ARQ. A class nobody reads keeps its data, and once its ring is full the
+ * ARQ waits as it does for any full ring. */
+struct ale_host_rx {
+	struct llist_head list;
+	const char *name;
+	enum ale_tx_class cls;		// the RX ring it reads, set before attaching
+	uint64_t pos;			// stream position of its next byte
+	size_t inflight;		// handed to an async write, still pinned
+	/* holding back the ring with a write in flight, cancel it. NULL if
+	 * the reader has no async writes */
+	void (*stalled)(struct ale_host_rx *rx);
+	void *priv;
+
+	struct {
+		uint64_t bytes;
+		uint64_t lost;
+		unsigned long overruns;
+	} stats;
+};
+
+/* Starts at the oldest data still in the ring */
+void ale_host_rx_attach(struct ale_station *st, struct ale_host_rx *rx);
+void ale_host_rx_detach(struct ale_station *st, struct ale_host_rx *rx);
+
+/* Data not delivered to the reader yet, as up to two regions of the ring */
+int ale_host_rx_iov(struct ale_station *st, struct ale_host_rx *rx, struct iovec iov[2]);
+size_t ale_host_rx_pending(struct ale_station *st, struct ale_host_rx *rx);
+
+/* len bytes delivered, the ring is released up to the slowest reader */
+void ale_host_rx_advance(struct ale_station *st, struct ale_host_rx *rx, size_t len);
+
+/* Delivered up to stream position pos (reported by the client itself) */
+void ale_host_rx_seek(struct ale_station *st, struct ale_host_rx *rx, uint64_t pos);
+
+/* Copies up to len pending bytes into buf and advances, returns the bytes */
+size_t ale_host_rx_read(struct ale_station *st, struct ale_host_rx *rx, uint8_t *buf, size_t len);
+
+/* Notes new data in the RX data rings and how far the readers released it,
+ * for the rx-host latency */
+void ale_host_rx_poll(struct ale_station *st);
+
+/* Writes the pending data of the reader to a socket. Returns the bytes
+ * written (0 if nothing is pending), or -errno */
+ssize_t ale_host_rx_to_sock(int fd, struct ale_station *st, struct ale_host_rx *rx);
+
+/* TX arbitration: the ring of a class is one stream to the peer, which
+ * can't tell the bytes of two writers apart, so one writer owns it at a
+ * time. The first one to ask for quota takes it and keeps it until it
+ * detaches; the others of the class wait, and the class goes to the
+ * waiting one of the highest priority next, round robin within a
+ * priority. The owner fills the ring freely. Writers of different classes
+ * don't compete, the rings are drained by the TX queue scheduler
+ * (ale_txq.h). */
+#define ALE_HOST_TX_PRIO_MAX 7
+
+struct ale_host_tx {
+	struct llist_head list;
+	const char *name;
+	unsigned int prio;		// 0..ALE_HOST_TX_PRIO_MAX, higher first
+	enum ale_tx_class cls;		// the ring it writes to
+	bool waiting;
+	/* it owns the class and there is room, it may write
+	 * ale_host_tx_quota() bytes */
+	void (*resume)(struct ale_host_tx *tx);
+	void *priv;
+
+	struct {
+		uint64_t bytes;
+		unsigned long waits;
+	} stats;
+};
+
+void ale_host_tx_attach(struct ale_station *st, struct ale_host_tx *tx);
+void ale_host_tx_detach(struct ale_station *st, struct ale_host_tx *tx);
+
+/* TX ring of the writer class */
+cbuf_handle_t ale_host_tx_ring(struct ale_station *st, struct ale_host_tx *tx);
+
+/* Bytes the writer may put in its TX ring now, 0: call ale_host_tx_wait().
+ * Takes the class if nobody owns it */
+size_t ale_host_tx_quota(struct ale_station *st, struct ale_host_tx *tx);
+
+/* len bytes written to the TX ring */
+void ale_host_tx_wrote(struct ale_station *st, struct ale_host_tx *tx, size_t len);
+
+/* Another writer owns the class or the ring is full, resume() is called
+ * once it may write */
+void ale_host_tx_wait(struct ale_station *st, struct ale_host_tx *tx);
+
+/* Resumes the waiting writers that may write now (done on the BUFFER and
+ * TURN events, and after a TX ring reset) */
+void ale_host_tx_schedule(struct ale_station *st);
+
+/* Writer owning the TX stream of a class, NULL if none */
+struct ale_host_tx *ale_host_tx_owner(enum ale_tx_class cls);
+
+/* Attached readers and writers, for the VTY */
+struct llist_head *ale_host_rx_list(void);
+struct llist_head *ale_host_tx_list(void);
+
+/* Reads from a socket straight into the ring free space, max bytes at
+ * most. Returns the bytes read, 0 on EOF, -EAGAIN if nothing was there or
+ * the ring is full, or another -errno */
+ssize_t ale_host_sock_to_ring(int fd, cbuf_handle_t ring, size_t max);
+
+/* Command port of one client */
+struct ale_host_cmd {
+	struct osmo_stream_srv *conn;		// NULL: no client
+	const char *name;			// for the logs
+	/* one command, split in words */
+	void (*command)(struct ale_host_cmd *cmd, int argc, char **argv);
+	void *priv;
+
+	char line[ALE_HOST_LINE_MAX];
+	size_t line_len;
+	bool buffer_sent;
+	size_t last_buffer;
+	struct ale_uring_op *uop;		// io_uring receive, NULL: osmo_fd
+};
+
+/* Reads the commands of the client, returns -EBADF once it is gone */
+int ale_host_cmd_read(struct ale_host_cmd *cmd);
+
+/* Client connected (conn) or gone (NULL). With host-io uring the commands
+ * come from an io_uring receive instead of the read callback */
+void ale_host_cmd_attach(struct ale_host_cmd *cmd, struct osmo_stream_srv *conn);
+
+void ale_host_cmd_reply(struct ale_host_cmd *cmd, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/* Sends "BUFFER <TX backlog>" if it changed since the last report */
+void ale_host_cmd_buffer(struct ale_host_cmd *cmd, struct ale_station *st, bool force);
+
+/* Modem throughput in bits per second at the current speed level */
+unsigned int ale_host_bitrate(struct ale_station *st);
@@ -0,0 +1,247 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_kiss.c
+ * @author agent
+ * @brief KISS framing
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "ale_kiss.h"
+
+// Private functions
+
+static void frame_end(struct ale_kiss *kiss, cbuf_handle_t records, unsigned int *frames)
+{
+    if (!kiss->discard && kiss->len)
+    {
+        if (circular_buf_put_record(records, kiss->frame, kiss->len))
+        {
+            kiss->stats.dropped++;
+        }
+        else
+        {
+            kiss->stats.frames++;
+            (*frames)++;
+        }
+    }
+
+    kiss->len = 0;
+    kiss->discard = false;
+    kiss->escape = false;
+}
+
+static void frame_append(struct ale_kiss *kiss, const uint8_t *data, size_t len)
+{
+    if (kiss->discard)
+        return;
+
+    if (kiss->len + len > KISS_MAX_FRAME)
+    {
+        kiss->stats.oversize++;
+        kiss->discard = true;
+        return;
+    }
+
+    memcpy(kiss->frame + kiss->len, data, len);
+    kiss->len += len;
+}
+
+// User APIs
+
+size_t ale_kiss_scan(const uint8_t *buf, size_t len)
+{
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i fend = _mm256_set1_epi8((char) KISS_FEND);
+    const __m256i fesc = _mm256_set1_epi8((char) KISS_FESC);
+
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (buf + i));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, fend),
+                                                                 _mm256_cmpeq_epi8(v, fesc)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i fend16 = _mm_set1_epi8((char) KISS_FEND);
+    const __m128i fesc16 = _mm_set1_epi8((char) KISS_FESC);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (buf + i));
+        unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, fend16),
+                                                           _mm_cmpeq_epi8(v, fesc16)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t fend = vdupq_n_u8(KISS_FEND);
+    const uint8x16_t fesc = vdupq_n_u8(KISS_FESC);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(buf + i);
+        uint8x16_t m = vorrq_u8(vceqq_u8(v, fend), vceqq_u8(v, fesc));
+        // 4 bits per byte
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+
+        if (bits)
+            return i + (__builtin_ctzll(bits) >> 2);
+    }
+#else
+    // SWAR: a byte of v ^ pattern is zero where v matches
+    const uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t v, a, b;
+
+        memcpy(&v, buf + i, sizeof(v));
+        a = v ^ (ones * KISS_FEND);
+        b = v ^ (ones * KISS_FESC);
+        if (((a - ones) & ~a & highs) | ((b - ones) & ~b & highs))
+            break;
+    }
+#endif
+
+    for (; i < len; i++)
+    {
+        if (buf[i] == KISS_FEND || buf[i] == KISS_FESC)
+            return i;
+    }
+
+    return len;
+}
+
+void ale_kiss_init(struct ale_kiss *kiss)
+{
+    memset(kiss, 0, sizeof(*kiss));
+}
+
+unsigned int ale_kiss_parse(struct ale_kiss *kiss, const uint8_t *buf, size_t len, cbuf_handle_t records)
+{
+    unsigned int frames = 0;
+    size_t pos = 0;
+
+    kiss->stats.bytes += len;
+
+    while (pos < len)
+    {
+        if (!kiss->in_frame)
+        {
+            const uint8_t *fend = memchr(buf + pos, KISS_FEND, len - pos);
+
+            if (!fend)
+                break;
+            pos = fend - buf + 1;
+            kiss->in_frame = true;
+            continue;
+        }
+
+        if (kiss->escape)
+        {
+            uint8_t c = buf[pos];
+
+            kiss->escape = false;
+            if (c == KISS_TFEND || c == KISS_TFESC)
+            {
+                c = (c == KISS_TFEND) ? KISS_FEND : KISS_FESC;
+                frame_append(kiss, &c, 1);
+                pos++;
+            }
+            else
+            {
+                // FEND here is handled as the end of the (discarded) frame
+                kiss->stats.errors++;
+                kiss->discard = true;
+                if (c != KISS_FEND)
+                    pos++;
+            }
+            continue;
+        }
+
+        size_t run = ale_kiss_scan(buf + pos, len - pos);
+
+        frame_append(kiss, buf + pos, run);
+        pos += run;
+        if (pos == len)
+            break;
+
+        if (buf[pos] == KISS_FESC)
+            kiss->escape = true;
+        else
+            frame_end(kiss, records, &frames);
+        pos++;
+    }
+
+    return frames;
+}
+
+int ale_kiss_encode(uint8_t *out, size_t size, const uint8_t *frame, size_t len)
+{
+    size_t pos = 0, o = 0;
+
+    if (size < 2)
+        return -1;
+    out[o++] = KISS_FEND;
+
+    while (pos < len)
+    {
+        size_t run = ale_kiss_scan(frame + pos, len - pos);
+
+        if (o + run + 1 > size)
+            return -1;
+        memcpy(out + o, frame + pos, run);
+        o += run;
+        pos += run;
+        if (pos == len)
+            break;
+
+        if (o + 3 > size)
+            return -1;
+        out[o++] = KISS_FESC;
+        out[o++] = frame[pos++] == KISS_FEND ? KISS_TFEND : KISS_TFESC;
+    }
+
+    if (o + 1 > size)
+        return -1;
+    out[o++] = KISS_FEND;
+
+    return o;
+}
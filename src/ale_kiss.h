@@ -0,0 +1,85 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_kiss.h
+ * @author agent
+ * @brief KISS framing
+ *
+ * Frames are FEND (0xc0) delimited, with FEND and FESC (0xdb) in the
+ * data escaped as FESC TFEND and FESC TFESC. The first byte of a frame is
+ * the type (VARA KISS: 0 AX.25, 1 AX.25 with 7 character call signs,
+ * 2 generic data) and is kept with the data.
+ *
+ * The stream is parsed in large batches: runs of plain bytes between two
+ * special ones are found with a vector compare (SSE2/AVX2 or NEON, 8 bytes
+ * at a time elsewhere) and copied in one go. Whole frames are stored as
+ * records in a circular buffer (circular_buf_put_record).
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+
+#define KISS_FEND  0xc0
+#define KISS_FESC  0xdb
+#define KISS_TFEND 0xdc
+#define KISS_TFESC 0xdd
+
+#define KISS_MAX_FRAME 512      // type byte included
+
+struct ale_kiss_stats {
+    unsigned long bytes;        // stream bytes parsed
+    unsigned long frames;
+    unsigned long errors;       // invalid escapes
+    unsigned long oversize;
+    unsigned long dropped;      // no room in the record ring
+};
+
+struct ale_kiss {
+    uint8_t frame[KISS_MAX_FRAME];
+    size_t len;
+    bool in_frame;      // a FEND was seen
+    bool escape;
+    bool discard;       // skip to the next FEND
+    struct ale_kiss_stats stats;
+};
+
+void ale_kiss_init(struct ale_kiss *kiss);
+
+/// Parses a chunk of the stream, the frames completed go to records.
+/// Returns the number of frames stored
+unsigned int ale_kiss_parse(struct ale_kiss *kiss, const uint8_t *buf, size_t len, cbuf_handle_t records);
+
+/// Encodes a frame (type byte + data) into out, returns the encoded length
+/// or -1 if size is not enough (2 * len + 2 always is)
+int ale_kiss_encode(uint8_t *out, size_t size, const uint8_t *frame, size_t len);
+
+/// Index of the first FEND or FESC byte of buf, len if there is none
+size_t ale_kiss_scan(const uint8_t *buf, size_t len);
@@ -0,0 +1,207 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * @file ale_kiss_srv.c
+ * @author agent
+ * @brief KISS over TCP host interface
+ *
+ * Any number of clients. The stream of each one is read in large batches
+ * and parsed by ale_kiss.c into the UI record ring of the station, which
+ * sends the frames as UI frames while no session is up. Received UI frames
+ * go to all the clients.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/netif/stream.h>
+
+#include "internal.h"
+#include "ale_kiss.h"
+#include "ale_uring.h"
+#include "ale_pool.h"
+
+#define KISS_READ_BATCH (16 * 1024)
+#define KISS_UI_POOL 32		// received UI frames queued to the clients
+
+struct kiss_srv {
+	struct ale_station *st;
+	struct osmo_stream_srv_link *link;
+	struct llist_head clients;
+	struct ale_host_if hif;
+	struct ale_pool *ui_pool;
+	uint8_t buf[KISS_READ_BATCH];
+};
+
+struct kiss_client {
+	struct llist_head list;
+	struct kiss_srv *srv;
+	struct osmo_stream_srv *conn;
+	struct ale_uring_op *uop;	// host-io uring receive
+	struct ale_kiss parser;
+};
+
+static int kiss_read_cb(struct osmo_stream_srv *conn)
+{
+	struct kiss_client *cli = osmo_stream_srv_get_data(conn);
+	struct kiss_srv *srv = cli->srv;
+	ssize_t rc;
+
+	rc = recv(osmo_stream_srv_get_ofd(conn)->fd, srv->buf, sizeof(srv->buf), 0);
+	if (rc <= 0) {
+		if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+			return 0;
+		osmo_stream_srv_destroy(conn);
+		return -EBADF;
+	}
+
+	if (ale_kiss_parse(&cli->parser, srv->buf, rc, srv->st->ui_tx))
+		ale_station_send_ui(srv->st);
+	return 0;
+}
+
+static void kiss_recv_cb(struct ale_uring_op *op, const uint8_t *buf, int res)
+{
+	struct kiss_client *cli = ale_uring_op_data(op);
+
+	if (res <= 0) {
+		osmo_stream_srv_destroy(cli->conn);
+		return;
+	}
+
+	if (ale_kiss_parse(&cli->parser, buf, res, cli->srv->st->ui_tx))
+		ale_station_send_ui(cli->srv->st);
+}
+
+static int kiss_closed_cb(struct osmo_stream_srv *conn)
+{
+	struct kiss_client *cli = osmo_stream_srv_get_data(conn);
+	struct ale_kiss_stats *ks = &cli->parser.stats;
+
+	LOGP(ALE, LOGL_NOTICE, "KISS client disconnected: %lu bytes, %lu frames, "
+	     "%lu bad escapes, %lu too long, %lu dropped\n",
+	     ks->bytes, ks->frames, ks->errors, ks->oversize, ks->dropped);
+	ale_uring_release(cli->uop);
+	llist_del(&cli->list);
+	talloc_free(cli);
+	return 0;
+}
+
+static int kiss_accept_cb(struct osmo_stream_srv_link *link, int fd)
+{
+	struct kiss_srv *srv = osmo_stream_srv_link_get_data(link);
+	struct kiss_client *cli = talloc_zero(srv, struct kiss_client);
+
+	OSMO_ASSERT(cli);
+	cli->srv = srv;
+	ale_kiss_init(&cli->parser);
+	/* not under cli: kiss_closed_cb() frees cli and osmo_stream_srv_destroy()
+	 * still uses the conn after it */
+	cli->conn = osmo_stream_srv_create(srv, link, fd, kiss_read_cb, kiss_closed_cb, cli);
+	if (!cli->conn) {
+		talloc_free(cli);
+		close(fd);
+		return -ENOMEM;
+	}
+	llist_add_tail(&cli->list, &srv->clients);
+
+	cli->uop = ale_uring_recv_start(fd, kiss_recv_cb, cli);
+	if (cli->uop)
+		osmo_fd_read_disable(osmo_stream_srv_get_ofd(cli->conn));
+
+	LOGP(ALE, LOGL_NOTICE, "KISS client connected\n");
+	return 0;
+}
+
+static void kiss_ui(struct ale_host_if *hif, struct ale_station *st,
+		    const uint8_t *data, size_t len)
+{
+	struct kiss_srv *srv = hif->priv;
+	struct kiss_client *cli;
+
+	llist_for_each_entry(cli, &srv->clients, list) {
+		struct msgb *msg = ale_msgb_get(srv->ui_pool, "kiss-rx");
+		int rc;
+
+		// one client missing the frame doesn't cut the others off
+		if (!msg) {
+			rate_ctr_inc(&st->ctrs->ctr[ALE_CTR_HOST_UI_DROPPED]);
+			continue;
+		}
+		rc = ale_kiss_encode(msg->data, msgb_tailroom(msg), data, len);
+		if (rc < 0) {
+			msgb_free(msg);
+			rate_ctr_inc(&st->ctrs->ctr[ALE_CTR_HOST_UI_DROPPED]);
+			continue;
+		}
+		msgb_put(msg, rc);
+		osmo_stream_srv_send(cli->conn, msg);
+	}
+}
+
+int ale_kiss_srv_init(void *ctx, struct ale_station *st)
+{
+	struct kiss_srv *srv;
+	size_t ui_max = 0;
+
+	if (!st->kiss_port)
+		return 0;
+
+	srv = talloc_zero(ctx, struct kiss_srv);
+	OSMO_ASSERT(srv);
+	srv->st = st;
+	INIT_LLIST_HEAD(&srv->clients);
+
+	// escaped worst case of the largest frame any mode carries
+	for (int m = 0; m < _NUM_ALE_MODES; m++)
+		ui_max = OSMO_MAX(ui_max, ale_mode_get(m)->payload_bytes);
+	srv->ui_pool = ale_msgb_pool_alloc(srv, "kiss-rx", 2 * ui_max + 2, KISS_UI_POOL);
+
+	srv->link = ale_host_listen(srv, st, st->kiss_port, kiss_accept_cb, srv);
+	if (!srv->link) {
+		talloc_free(srv);
+		return -1;
+	}
+
+	srv->hif = (struct ale_host_if) {
+		.name = "kiss",
+		.ui = kiss_ui,
+		.priv = srv,
+	};
+	ale_host_register(&srv->hif);
+
+	LOGP(ALE, LOGL_NOTICE, "KISS TNC on port %u\n", st->kiss_port);
+	return 0;
+}
@@ -0,0 +1,170 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_lat.c
+ * @author agent
+ * @brief Latency accounting of the data path
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ale_lat.h"
+
+const char *ale_lat_stage_names[_NUM_ALE_LAT_STAGES] = {
+    [ALE_LAT_TX_HOST] = "tx-host",
+    [ALE_LAT_TX_FRAMING] = "tx-framing",
+    [ALE_LAT_TX_QUEUE] = "tx-queue",
+    [ALE_LAT_TX_MODULATE] = "tx-modulate",
+    [ALE_LAT_TX_AUDIO] = "tx-audio",
+    [ALE_LAT_TX_FRAME] = "tx-frame",
+    [ALE_LAT_RX_AUDIO] = "rx-audio",
+    [ALE_LAT_RX_DEMOD] = "rx-demod",
+    [ALE_LAT_RX_QUEUE] = "rx-queue",
+    [ALE_LAT_RX_ARQ] = "rx-arq",
+    [ALE_LAT_RX_HOST] = "rx-host",
+};
+
+static struct ale_lat_hist hists[_NUM_ALE_LAT_STAGES];
+
+// User APIs
+
+uint64_t ale_lat_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void ale_lat_add(enum ale_lat_stage stage, uint64_t us)
+{
+    struct ale_lat_hist *h = &hists[stage];
+    unsigned int b = us ? 64 - __builtin_clzll(us) : 0;
+    uint64_t max = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+
+    if (b >= ALE_LAT_BUCKETS)
+        b = ALE_LAT_BUCKETS - 1;
+
+    atomic_fetch_add_explicit(&h->bucket[b], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_us, us, memory_order_relaxed);
+    while (us > max && !atomic_compare_exchange_weak_explicit(&h->max_us, &max, us,
+                                                              memory_order_relaxed,
+                                                              memory_order_relaxed));
+    // last, a reader seeing the count sees the bucket
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_release);
+}
+
+void ale_lat_since(enum ale_lat_stage stage, uint64_t since, uint64_t now)
+{
+    if (since && now >= since)
+        ale_lat_add(stage, now - since);
+}
+
+void ale_lat_mark(struct ale_lat_marks *marks, uint64_t end, uint64_t now, uint64_t born_us)
+{
+    unsigned int tail;
+
+    if (end <= marks->seen_end)
+        return;
+    marks->seen_end = end;
+
+    if (marks->count == ALE_LAT_MARKS)
+    {
+        marks->m[(marks->head + ALE_LAT_MARKS - 1) % ALE_LAT_MARKS].pos = end;
+        return;
+    }
+
+    tail = (marks->head + marks->count) % ALE_LAT_MARKS;
+    marks->m[tail].pos = end;
+    marks->m[tail].us = now;
+    marks->m[tail].born_us = born_us;
+    marks->count++;
+}
+
+void ale_lat_passed(struct ale_lat_marks *marks, uint64_t pos, uint64_t now,
+                    enum ale_lat_stage stage, int total)
+{
+    while (marks->count && marks->m[marks->head].pos <= pos)
+    {
+        ale_lat_since(stage, marks->m[marks->head].us, now);
+        if (total >= 0)
+            ale_lat_since(total, marks->m[marks->head].born_us, now);
+        marks->head = (marks->head + 1) % ALE_LAT_MARKS;
+        marks->count--;
+    }
+}
+
+void ale_lat_forget(struct ale_lat_marks *marks, uint64_t pos)
+{
+    while (marks->count && marks->m[marks->head].pos <= pos)
+    {
+        marks->head = (marks->head + 1) % ALE_LAT_MARKS;
+        marks->count--;
+    }
+}
+
+void ale_lat_snapshot(enum ale_lat_stage stage, struct ale_lat_snap *snap)
+{
+    struct ale_lat_hist *h = &hists[stage];
+
+    snap->count = atomic_load_explicit(&h->count, memory_order_acquire);
+    for (int b = 0; b < ALE_LAT_BUCKETS; b++)
+        snap->bucket[b] = atomic_load_explicit(&h->bucket[b], memory_order_relaxed);
+    snap->sum_us = atomic_load_explicit(&h->sum_us, memory_order_relaxed);
+    snap->max_us = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+}
+
+uint64_t ale_lat_quantile(const struct ale_lat_snap *snap, double p)
+{
+    unsigned long total = 0, seen = 0, want;
+
+    for (int b = 0; b < ALE_LAT_BUCKETS; b++)
+        total += snap->bucket[b];
+    if (!total)
+        return 0;
+
+    want = p * total;
+    if (want >= total)
+        want = total - 1;
+
+    for (int b = 0; b < ALE_LAT_BUCKETS - 1; b++)
+    {
+        seen += snap->bucket[b];
+        if (seen > want)
+            return (uint64_t) 1 << b < snap->max_us ? (uint64_t) 1 << b : snap->max_us;
+    }
+    return snap->max_us;
+}
+
+void ale_lat_diff(struct ale_lat_snap *out, const struct ale_lat_snap *cur,
+                  const struct ale_lat_snap *prev)
+{
+    for (int b = 0; b < ALE_LAT_BUCKETS; b++)
+        out->bucket[b] = cur->bucket[b] - prev->bucket[b];
+    out->count = cur->count - prev->count;
+    out->sum_us = cur->sum_us - prev->sum_us;
+    out->max_us = cur->max_us;
+}
@@ -0,0 +1,133 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_lat.h
+ * @author agent
+ * @brief Latency accounting of the data path
+ *
+ * Each stage a payload goes through has a histogram (log2 microsecond
+ * buckets, relaxed atomic counters: the stages are fed by the main and the
+ * modem thread). Where the data is a byte stream the stage is timed by
+ * stream position marks (struct ale_lat_marks): when the end of a ring
+ * moved, and when the reads passed that position. From framing on a frame
+ * carries the time its data was taken from the TX queue, which also gives
+ * the frame's total time to the air.
+ *
+ *  TX: host write -> TX queue read (tx-host) -> frame handed to the modem
+ *      (tx-framing: batching, waiting for the turn, retransmissions) ->
+ *      modem thread (tx-queue) -> last sample in the TX audio ring
+ *      (tx-modulate) -> audio client read it (tx-audio)
+ *  RX: audio client write -> modem read, from the ring fill (rx-audio) ->
+ *      frame decoded (rx-demod) -> main thread (rx-queue) -> delivered in
+ *      order (rx-arq: reordering, waiting for retransmissions) -> read by
+ *      the host (rx-host)
+ *
+ * The soundcard buffers of the audio client are beyond what is seen here.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define ALE_LAT_BUCKETS 28      // bucket b: [2^(b-1), 2^b) us, the last one open
+#define ALE_LAT_MARKS 64
+
+enum ale_lat_stage {
+    ALE_LAT_TX_HOST,
+    ALE_LAT_TX_FRAMING,
+    ALE_LAT_TX_QUEUE,
+    ALE_LAT_TX_MODULATE,
+    ALE_LAT_TX_AUDIO,
+    ALE_LAT_TX_FRAME,           // TX queue read to audio out, per frame
+    ALE_LAT_RX_AUDIO,
+    ALE_LAT_RX_DEMOD,
+    ALE_LAT_RX_QUEUE,
+    ALE_LAT_RX_ARQ,
+    ALE_LAT_RX_HOST,
+    _NUM_ALE_LAT_STAGES
+};
+
+extern const char *ale_lat_stage_names[_NUM_ALE_LAT_STAGES];
+
+struct ale_lat_hist {
+    atomic_ulong bucket[ALE_LAT_BUCKETS];
+    atomic_ulong count;
+    atomic_ullong sum_us;
+    atomic_ullong max_us;
+};
+
+struct ale_lat_snap {
+    unsigned long bucket[ALE_LAT_BUCKETS];
+    unsigned long count;
+    uint64_t sum_us;
+    uint64_t max_us;
+};
+
+/// Stream positions of a ring end, when they were seen and the time the
+/// data was born for a total (0: none)
+struct ale_lat_marks {
+    struct {
+        uint64_t pos;
+        uint64_t us;
+        uint64_t born_us;
+    } m[ALE_LAT_MARKS];
+    unsigned int head;
+    unsigned int count;
+    uint64_t seen_end;
+};
+
+/// CLOCK_MONOTONIC in microseconds
+uint64_t ale_lat_now(void);
+
+/// Adds a sample of us microseconds to stage
+void ale_lat_add(enum ale_lat_stage stage, uint64_t us);
+
+/// Adds the time from since (ale_lat_now()) to now, if since is set
+void ale_lat_since(enum ale_lat_stage stage, uint64_t since, uint64_t now);
+
+/// Notes that the ring end moved to stream position end at now; ignored
+/// if it did not move. Out of marks the newest one takes the new data too
+void ale_lat_mark(struct ale_lat_marks *marks, uint64_t end, uint64_t now, uint64_t born_us);
+
+/// The reads passed pos: the marks up to it are samples of stage, and of
+/// total for the marks with a born time. total < 0 for none
+void ale_lat_passed(struct ale_lat_marks *marks, uint64_t pos, uint64_t now,
+                    enum ale_lat_stage stage, int total);
+
+/// Drops the marks of data that went away (ring reset)
+void ale_lat_forget(struct ale_lat_marks *marks, uint64_t pos);
+
+/// Copies the counters of stage
+void ale_lat_snapshot(enum ale_lat_stage stage, struct ale_lat_snap *snap);
+
+/// Upper bound of the bucket holding the p (0 - 1) quantile, in
+/// microseconds (max_us for the open bucket), 0 without samples
+uint64_t ale_lat_quantile(const struct ale_lat_snap *snap, double p);
+
+/// Samples of cur not in prev (an older snapshot of the same stage); the
+/// max is the one of cur
+void ale_lat_diff(struct ale_lat_snap *out, const struct ale_lat_snap *cur,
+                  const struct ale_lat_snap *prev);
@@ -0,0 +1,327 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * @file ale_local.c
+ * @author agent
+ * @brief Control socket of libale-client
+ *
+ * Unix socket, one client. The payload goes through shared memory rings,
+ * this socket carries the commands and the events; RX after each write to
+ * the RX rings and BUFFER as the TX backlog changes wake up the blocking
+ * calls of the library (see ale_client.h). The client is an RX reader of
+ * the host layer like the TCP ones, one per class, and their positions
+ * move with its RXACK reports. It writes to TX rings of its own, which are
+ * moved to the daemon ones by a host layer TX writer per class, attached
+ * at the first TX report of the class: a data port read callback with no
+ * socket.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/netif/stream.h>
+
+#include "internal.h"
+
+struct local_tx {
+	struct ale_host_tx tx;
+	struct local_srv *srv;
+	cbuf_handle_t ring;		// client TX ring of the class
+	bool attached;
+	bool full;			// the client waits for room
+};
+
+struct local_srv {
+	struct ale_station *st;
+	struct osmo_stream_srv_link *link;
+	struct ale_host_cmd cmd;
+	struct ale_host_rx rx[ALE_TX_NUM_CLASSES];
+	struct local_tx tx[ALE_TX_NUM_CLASSES];
+	struct ale_host_if hif;
+};
+
+/* Moves what the client wrote to the TX ring of the class, as much as it
+ * may. Once the client is gone the writer stays until its ring is empty */
+static void local_tx_resume(struct ale_host_tx *tx)
+{
+	struct local_tx *ltx = tx->priv;
+	struct local_srv *srv = ltx->srv;
+	struct ale_station *st = srv->st;
+	cbuf_handle_t ring = ale_host_tx_ring(st, tx);
+	size_t len = OSMO_MIN(ale_host_tx_quota(st, tx), circular_buf_free_size(ring));
+	size_t done = 0;
+	struct iovec iov[2];
+	int n;
+
+	n = circular_buf_data_iov(ltx->ring, iov);
+	for (int i = 0; i < n && done < len; i++) {
+		size_t part = OSMO_MIN(iov[i].iov_len, len - done);
+
+		circular_buf_put_range(ring, iov[i].iov_base, part);
+		done += part;
+	}
+	if (done) {
+		circular_buf_consume(ltx->ring, done);
+		ale_host_tx_wrote(st, tx, done);
+	}
+
+	if (circular_buf_size(ltx->ring)) {
+		// not its turn, or the ring is full
+		ale_host_tx_wait(st, tx);
+	} else if (!srv->cmd.conn) {
+		ale_host_tx_detach(st, tx);
+		ltx->attached = false;
+	}
+
+	if (ltx->full && circular_buf_free_size(ltx->ring)) {
+		ltx->full = false;
+		ale_host_cmd_buffer(&srv->cmd, st, true);
+	}
+}
+
+/* TX <class> [WAIT] from the client */
+static void local_tx_report(struct local_srv *srv, enum ale_tx_class cls, bool wait)
+{
+	struct local_tx *ltx = &srv->tx[cls];
+
+	if (!ltx->attached) {
+		ltx->tx.prio = srv->st->local_prio;
+		ale_host_tx_attach(srv->st, &ltx->tx);
+		ltx->attached = true;
+	}
+	ltx->full |= wait;
+
+	// a waiting writer is resumed by the host layer
+	if (!ltx->tx.waiting) {
+		local_tx_resume(&ltx->tx);
+	} else if (ltx->full && circular_buf_free_size(ltx->ring)) {
+		// it took some between the client check and the report
+		ltx->full = false;
+		ale_host_cmd_buffer(&srv->cmd, srv->st, true);
+	}
+}
+
+static void local_command(struct ale_host_cmd *cmd, int argc, char **argv)
+{
+	struct local_srv *srv = cmd->priv;
+	struct ale_station *st = srv->st;
+
+	if (!strcasecmp(argv[0], "MYCALL") && argc == 2) {
+		if (strlen(argv[1]) > ARQ_CALLSIGN_LEN)
+			goto wrong;
+		OSMO_STRLCPY_ARRAY(st->callsign, argv[1]);
+	} else if (!strcasecmp(argv[0], "LISTEN") && argc == 2) {
+		ale_station_listen(st, !strcasecmp(argv[1], "ON"));
+	} else if (!strcasecmp(argv[0], "CONNECT") && argc == 2) {
+		if (strlen(argv[1]) > ARQ_CALLSIGN_LEN || ale_station_call(st, argv[1]) < 0)
+			goto wrong;
+	} else if (!strcasecmp(argv[0], "DISCONNECT")) {
+		if (ale_station_disconnect(st, false) < 0)
+			goto wrong;
+	} else if (!strcasecmp(argv[0], "ABORT")) {
+		ale_station_disconnect(st, true);
+	} else if (!strcasecmp(argv[0], "BUFFER")) {
+		ale_host_cmd_buffer(cmd, st, true);
+	} else if (!strcasecmp(argv[0], "RXACK") && (argc == 2 || argc == 3)) {
+		unsigned int cls = argc == 3 ? atoi(argv[2]) : ALE_TX_BULK;
+
+		// streamed by the library, never answered
+		if (cls < ALE_TX_NUM_CLASSES)
+			ale_host_rx_seek(st, &srv->rx[cls], strtoull(argv[1], NULL, 10));
+		return;
+	} else if (!strcasecmp(argv[0], "TX") && (argc == 2 || argc == 3)) {
+		unsigned int cls = atoi(argv[1]);
+
+		// streamed by the library too
+		if (cls < ALE_TX_NUM_CLASSES)
+			local_tx_report(srv, cls, argc == 3 && !strcasecmp(argv[2], "WAIT"));
+		return;
+	} else {
+		goto wrong;
+	}
+
+	ale_host_cmd_reply(cmd, "OK");
+	return;
+
+wrong:
+	ale_host_cmd_reply(cmd, "WRONG");
+}
+
+static int local_read_cb(struct osmo_stream_srv *conn)
+{
+	struct local_srv *srv = osmo_stream_srv_get_data(conn);
+
+	return ale_host_cmd_read(&srv->cmd);
+}
+
+static int local_closed_cb(struct osmo_stream_srv *conn)
+{
+	struct local_srv *srv = osmo_stream_srv_get_data(conn);
+
+	LOGP(ALE, LOGL_NOTICE, "Local client disconnected\n");
+	ale_host_cmd_attach(&srv->cmd, NULL);
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		struct local_tx *ltx = &srv->tx[i];
+
+		ale_host_rx_detach(srv->st, &srv->rx[i]);
+		ltx->full = false;
+		// what it wrote still goes out
+		if (ltx->attached && !ltx->tx.waiting)
+			local_tx_resume(&ltx->tx);
+	}
+	return 0;
+}
+
+static int local_accept_cb(struct osmo_stream_srv_link *link, int fd)
+{
+	struct local_srv *srv = osmo_stream_srv_link_get_data(link);
+	struct osmo_stream_srv *conn;
+
+	if (srv->cmd.conn) {
+		LOGP(ALE, LOGL_NOTICE, "Local client already attached, rejecting another one\n");
+		close(fd);
+		return -EBUSY;
+	}
+
+	conn = osmo_stream_srv_create(srv, link, fd, local_read_cb, local_closed_cb, srv);
+	if (!conn) {
+		close(fd);
+		return -ENOMEM;
+	}
+	ale_host_cmd_attach(&srv->cmd, conn);
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+		ale_host_rx_attach(srv->st, &srv->rx[i]);
+
+	LOGP(ALE, LOGL_NOTICE, "Local client attached\n");
+	// data may be waiting already
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		if (ale_host_rx_pending(srv->st, &srv->rx[i])) {
+			ale_host_cmd_reply(&srv->cmd, "RX");
+			break;
+		}
+	}
+	return 0;
+}
+
+static void local_event(struct ale_host_if *hif, struct ale_station *st, enum ale_host_event ev)
+{
+	struct local_srv *srv = hif->priv;
+	struct ale_host_cmd *cmd = &srv->cmd;
+
+	switch (ev) {
+	case ALE_HOST_PENDING:
+		ale_host_cmd_reply(cmd, "PENDING");
+		break;
+	case ALE_HOST_CANCELPENDING:
+		ale_host_cmd_reply(cmd, "CANCELPENDING");
+		break;
+	case ALE_HOST_CONNECTED:
+		ale_host_cmd_reply(cmd, "CONNECTED %s", st->remote);
+		break;
+	case ALE_HOST_DISCONNECTED:
+		ale_host_cmd_reply(cmd, "DISCONNECTED");
+		break;
+	case ALE_HOST_BUFFER:
+		ale_host_cmd_buffer(cmd, st, false);
+		break;
+	case ALE_HOST_RX_DATA:
+		ale_host_cmd_reply(cmd, "RX");
+		break;
+	case ALE_HOST_TURN:
+		ale_host_cmd_reply(cmd, "TURN");
+		// the ARQ took data from the TX ring for this turn
+		ale_host_cmd_buffer(cmd, st, false);
+		break;
+	default:
+		break;
+	}
+}
+
+int ale_local_init(void *ctx, struct ale_station *st)
+{
+	struct local_srv *srv;
+
+	if (!st->local_path)
+		return 0;
+
+	srv = talloc_zero(ctx, struct local_srv);
+	OSMO_ASSERT(srv);
+	srv->st = st;
+	srv->cmd = (struct ale_host_cmd) {
+		.name = "local",
+		.command = local_command,
+		.priv = srv,
+	};
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		srv->rx[i] = (struct ale_host_rx) {
+			.name = "local",
+			.cls = i,
+			.priv = srv,
+		};
+		srv->tx[i] = (struct local_tx) {
+			.tx = {
+				.name = "local",
+				.cls = i,
+				.resume = local_tx_resume,
+				.priv = &srv->tx[i],
+			},
+			.srv = srv,
+			.ring = circular_buf_init_shm(ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(i)),
+		};
+	}
+
+	srv->link = osmo_stream_srv_link_create(srv);
+	OSMO_ASSERT(srv->link);
+	osmo_stream_srv_link_set_domain(srv->link, AF_UNIX);
+	osmo_stream_srv_link_set_addr(srv->link, st->local_path);
+	osmo_stream_srv_link_set_data(srv->link, srv);
+	osmo_stream_srv_link_set_accept_cb(srv->link, local_accept_cb);
+	if (osmo_stream_srv_link_open(srv->link) < 0) {
+		LOGP(ALE, LOGL_ERROR, "Can't listen on %s\n", st->local_path);
+		osmo_stream_srv_link_destroy(srv->link);
+		for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+			circular_buf_free_shm(srv->tx[i].ring, ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(i));
+		talloc_free(srv);
+		return -1;
+	}
+
+	srv->hif = (struct ale_host_if) {
+		.name = "local",
+		.event = local_event,
+		.priv = srv,
+	};
+	ale_host_register(&srv->hif);
+
+	LOGP(ALE, LOGL_NOTICE, "libale-client socket on %s\n", st->local_path);
+	return 0;
+}
@@ -0,0 +1,185 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_log.c
+ * @author agent
+ * @brief Non-blocking logging for the real-time threads
+ *
+ */
+
+#define _GNU_SOURCE	// SCHED_IDLE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <osmocom/core/logging.h>
+#include <osmocom/core/utils.h>
+
+#include "internal.h"
+#include "ale_log.h"
+
+#define LOG_DRAIN_MS 20
+
+static _Atomic(struct ale_log_ring *) rings;
+static __thread struct ale_log_ring *tls_ring;
+static atomic_uint thread_count;
+
+/* lowest level that reaches a log target, per subsystem; 0 (the start
+ * value) lets everything through until the drain thread knows better */
+static atomic_int min_level[ALE_LOG_MAX_SUBSYS];
+
+static pthread_t drain_thread;
+
+static void refresh_levels(void)
+{
+	unsigned int num = OSMO_MIN(osmo_log_info->num_cat, ALE_LOG_MAX_SUBSYS);
+
+	for (unsigned int ss = 0; ss < num; ss++) {
+		int level = LOGL_DEBUG;
+
+		while (level <= LOGL_FATAL && !log_check_level(ss, level))
+			level++;
+		atomic_store_explicit(&min_level[ss], level, memory_order_relaxed);
+	}
+}
+
+static void drain_ring(struct ale_log_ring *ring)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	unsigned long drops;
+
+	for (; tail != head; tail++) {
+		const struct ale_log_rec *rec = &ring->rec[tail % ALE_LOG_RECORDS];
+
+		LOGPSRC(rec->subsys, rec->level, rec->file, rec->line, "[%s] %s", ring->name, rec->text);
+		atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	}
+
+	drops = atomic_load_explicit(&ring->drops, memory_order_relaxed);
+	if (drops != ring->drops_seen) {
+		LOGP(ALE, LOGL_NOTICE, "[%s] %lu log records dropped, ring full\n",
+		     ring->name, drops - ring->drops_seen);
+		ring->drops_seen = drops;
+	}
+}
+
+static void *drain_main(void *arg)
+{
+	struct sched_param param = { 0 };
+	struct timespec ts = { 0, LOG_DRAIN_MS * 1000000L };
+
+	// gets the CPU when the real-time threads leave it
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+	while (1) {
+		struct ale_log_ring *ring;
+
+		refresh_levels();
+		for (ring = atomic_load(&rings); ring; ring = ring->next)
+			drain_ring(ring);
+		nanosleep(&ts, NULL);
+	}
+
+	return NULL;
+}
+
+int ale_log_thread_init(const char *name)
+{
+	struct ale_log_ring *ring;
+
+	if (tls_ring)
+		return 0;
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return -ENOMEM;
+	if (name)
+		snprintf(ring->name, sizeof(ring->name), "%s", name);
+	else
+		snprintf(ring->name, sizeof(ring->name), "thread-%u", atomic_fetch_add(&thread_count, 1));
+
+	// rings are never removed, a push is all the list needs
+	ring->next = atomic_load(&rings);
+	while (!atomic_compare_exchange_weak(&rings, &ring->next, ring))
+		;
+	tls_ring = ring;
+
+	return 0;
+}
+
+int ale_log_start(void)
+{
+	return -pthread_create(&drain_thread, NULL, drain_main, NULL);
+}
+
+struct ale_log_ring *ale_log_rings(void)
+{
+	return atomic_load(&rings);
+}
+
+void ale_log_rt(int subsys, int level, const char *file, int line, const char *fmt, ...)
+{
+	struct ale_log_ring *ring = tls_ring;
+	struct ale_log_rec *rec;
+	uint32_t head;
+	va_list ap;
+	int len;
+
+	if (subsys < ALE_LOG_MAX_SUBSYS &&
+	    level < atomic_load_explicit(&min_level[subsys], memory_order_relaxed))
+		return;
+
+	if (!ring) {
+		if (ale_log_thread_init(NULL) < 0)
+			return;
+		ring = tls_ring;
+	}
+
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= ALE_LOG_RECORDS) {
+		atomic_fetch_add_explicit(&ring->drops, 1, memory_order_relaxed);
+		return;
+	}
+
+	rec = &ring->rec[head % ALE_LOG_RECORDS];
+	rec->subsys = subsys;
+	rec->level = level;
+	rec->file = file;
+	rec->line = line;
+	va_start(ap, fmt);
+	len = vsnprintf(rec->text, sizeof(rec->text), fmt, ap);
+	va_end(ap);
+	// a cut line keeps its end of line
+	if (len >= (int) sizeof(rec->text))
+		rec->text[sizeof(rec->text) - 2] = '\n';
+
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	atomic_fetch_add_explicit(&ring->records, 1, memory_order_relaxed);
+}
@@ -0,0 +1,85 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_log.h
+ * @author agent
+ * @brief Non-blocking logging for the real-time threads
+ *
+ * libosmocore logging takes a mutex (log_enable_multithread()) and writes
+ * to its targets in the caller, so a LOGP() from the modem thread can
+ * wait on another thread's I/O. LOGP_RT() only formats the line into a
+ * ring owned by the calling thread (single producer, single consumer, no
+ * locks and no syscalls) and returns; a low priority thread drains all
+ * the rings into the osmocom log targets. A full ring drops the record
+ * and counts it, the drain thread reports the drops.
+ *
+ * The level check uses a copy of the osmocom log levels the drain thread
+ * refreshes, so records below the configured level cost a load and a
+ * compare.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define ALE_LOG_RECORDS 256	// per thread
+#define ALE_LOG_TEXT 128
+#define ALE_LOG_MAX_SUBSYS 8
+
+struct ale_log_rec {
+	uint8_t subsys;
+	uint8_t level;
+	uint16_t line;
+	const char *file;
+	char text[ALE_LOG_TEXT];
+};
+
+struct ale_log_ring {
+	struct ale_log_ring *next;
+	char name[16];
+	_Atomic uint32_t head;		// written by the owner thread
+	_Atomic uint32_t tail;		// by the drain thread
+	atomic_ulong records;
+	atomic_ulong drops;
+	unsigned long drops_seen;	// drain thread: already reported
+	struct ale_log_rec rec[ALE_LOG_RECORDS];
+};
+
+/* Gives the calling thread its ring, to be done when the thread starts:
+ * a thread without one gets it (and a malloc) on its first record */
+int ale_log_thread_init(const char *name);
+
+/* Starts the drain thread */
+int ale_log_start(void);
+
+/* Registered rings, a lock-free list (see next) */
+struct ale_log_ring *ale_log_rings(void);
+
+void ale_log_rt(int subsys, int level, const char *file, int line, const char *fmt, ...)
+	__attribute__((format(printf, 5, 6)));
+
+#define LOGP_RT(ss, level, fmt, args...) \
+	ale_log_rt(ss, level, __FILE__, __LINE__, fmt, ##args)
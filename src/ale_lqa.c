@@ -0,0 +1,328 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_lqa.c
+ * @author agent
+ * @brief Link quality analysis store
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ale_lqa.h"
+
+#define LQA_PROBES 16
+
+_Static_assert(sizeof(struct ale_lqa_entry) == 64, "one cache line per entry");
+_Static_assert(sizeof(struct ale_lqa_file_hdr) == 64, "entries cache line aligned");
+
+// Private functions
+
+static size_t map_size(unsigned int slots)
+{
+    return sizeof(struct ale_lqa_file_hdr) + (size_t) slots * sizeof(struct ale_lqa_entry);
+}
+
+static void hdr_init(struct ale_lqa_file_hdr *hdr, unsigned int slots)
+{
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, ALE_LQA_MAGIC, sizeof(hdr->magic));
+    hdr->version = ALE_LQA_VERSION;
+    hdr->slots = slots;
+    hdr->entry_size = sizeof(struct ale_lqa_entry);
+}
+
+static void addr_key(char key[ALE_LQA_ADDR_LEN], const char *addr)
+{
+    memset(key, 0, ALE_LQA_ADDR_LEN);
+    if (addr)
+        memcpy(key, addr, strnlen(addr, ALE_LQA_ADDR_LEN));
+}
+
+static unsigned int key_hash(struct ale_lqa *lqa, uint32_t freq_hz, const char key[ALE_LQA_ADDR_LEN])
+{
+    uint64_t a;
+
+    memcpy(&a, key, sizeof(a));
+    a ^= (uint64_t) freq_hz * 0x9e3779b97f4a7c15ULL;
+    a *= 0xff51afd7ed558ccdULL;
+    return (a >> 32) & (lqa->slots - 1);
+}
+
+static float decay(struct ale_lqa *lqa, const struct ale_lqa_entry *e, time_t now)
+{
+    if (now <= (time_t) e->updated)
+        return 1.0f;
+    return exp2f(-(float) (now - e->updated) / lqa->half_life);
+}
+
+static struct ale_lqa_entry *entry_find(struct ale_lqa *lqa, uint32_t freq_hz, const char *key)
+{
+    unsigned int h = key_hash(lqa, freq_hz, key);
+
+    for (int i = 0; i < LQA_PROBES; i++, h = (h + 1) & (lqa->slots - 1))
+    {
+        struct ale_lqa_entry *e = &lqa->table[h];
+
+        if (!e->freq_hz)
+            return NULL;
+        if (e->freq_hz == freq_hz && !memcmp(e->addr, key, ALE_LQA_ADDR_LEN))
+            return e;
+    }
+    return NULL;
+}
+
+/// The entry of a key, a free slot for it or the one with the least
+/// weight left in its probe window
+static struct ale_lqa_entry *entry_get(struct ale_lqa *lqa, uint32_t freq_hz, const char *key, time_t now)
+{
+    unsigned int h = key_hash(lqa, freq_hz, key);
+    struct ale_lqa_entry *victim = NULL;
+    float least = INFINITY;
+
+    for (int i = 0; i < LQA_PROBES; i++, h = (h + 1) & (lqa->slots - 1))
+    {
+        struct ale_lqa_entry *e = &lqa->table[h];
+        float w;
+
+        if (e->freq_hz == freq_hz && !memcmp(e->addr, key, ALE_LQA_ADDR_LEN))
+            return e;
+        if (!e->freq_hz)
+        {
+            victim = e;
+            break;
+        }
+        w = e->weight * decay(lqa, e, now);
+        if (w < least)
+        {
+            least = w;
+            victim = e;
+        }
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->freq_hz = freq_hz;
+    memcpy(victim->addr, key, ALE_LQA_ADDR_LEN);
+    victim->updated = now;
+    return victim;
+}
+
+static void entry_update(struct ale_lqa *lqa, struct ale_lqa_entry *e, float snr_db, bool ok,
+                         bool sounding, time_t now)
+{
+    float f = decay(lqa, e, now);
+    float weight = e->weight * f + 1;
+    float alpha = 1 / weight;
+    float delta = snr_db - e->snr_db;
+
+    // exponentially weighted mean and variance
+    e->snr_db += alpha * delta;
+    e->snr_var = (1 - alpha) * (e->snr_var + alpha * delta * delta);
+    e->errors = e->errors * f + !ok;
+    e->weight = weight;
+    e->updated = now;
+    e->frames += !sounding;
+    e->crc_errors += !ok;
+    e->soundings += sounding;
+}
+
+static void info_fill(struct ale_lqa *lqa, const struct ale_lqa_entry *e, time_t now,
+                      struct ale_lqa_info *info)
+{
+    float f = decay(lqa, e, now);
+
+    info->weight = e->weight * f;
+    info->snr_db = e->snr_db;
+    info->snr_sd = sqrtf(e->snr_var);
+    info->fer = e->weight > 0 ? e->errors / e->weight : 0;
+    info->age_s = now > (time_t) e->updated ? now - e->updated : 0;
+    info->score = ale_lqa_score(info);
+}
+
+// User APIs
+
+struct ale_lqa *ale_lqa_alloc(unsigned int slots)
+{
+    struct ale_lqa *lqa = calloc(1, sizeof(*lqa));
+    void *map;
+
+    if (!lqa)
+        return NULL;
+    if (slots < LQA_PROBES || (slots & (slots - 1)))
+        slots = ALE_LQA_DEFAULT_SLOTS;
+
+    map = mmap(NULL, map_size(slots), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+    {
+        free(lqa);
+        return NULL;
+    }
+    lqa->half_life = ALE_LQA_DEFAULT_HALF_LIFE;
+    lqa->slots = slots;
+    lqa->map_size = map_size(slots);
+    lqa->hdr = map;
+    lqa->table = (struct ale_lqa_entry *) (lqa->hdr + 1);
+    hdr_init(lqa->hdr, slots);
+
+    return lqa;
+}
+
+void ale_lqa_free(struct ale_lqa *lqa)
+{
+    if (lqa->file)
+        msync(lqa->hdr, lqa->map_size, MS_SYNC);
+    munmap(lqa->hdr, lqa->map_size);
+    free(lqa);
+}
+
+int ale_lqa_open(struct ale_lqa *lqa, const char *path)
+{
+    struct ale_lqa_file_hdr *hdr;
+    struct stat sb;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    bool valid;
+
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &sb) < 0 || (sb.st_size != (off_t) lqa->map_size && ftruncate(fd, lqa->map_size) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    hdr = mmap(NULL, lqa->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED)
+        return -1;
+
+    valid = sb.st_size == (off_t) lqa->map_size && !memcmp(hdr->magic, ALE_LQA_MAGIC, sizeof(hdr->magic)) &&
+            hdr->version == ALE_LQA_VERSION && hdr->slots == lqa->slots &&
+            hdr->entry_size == sizeof(struct ale_lqa_entry);
+    if (!valid)
+        memcpy(hdr, lqa->hdr, lqa->map_size);
+
+    if (lqa->file)
+        msync(lqa->hdr, lqa->map_size, MS_SYNC);
+    munmap(lqa->hdr, lqa->map_size);
+    lqa->hdr = hdr;
+    lqa->table = (struct ale_lqa_entry *) (hdr + 1);
+    lqa->file = true;
+
+    return 0;
+}
+
+void ale_lqa_update(struct ale_lqa *lqa, uint32_t freq_hz, const char *addr, float snr_db, bool ok,
+                    bool sounding, time_t now)
+{
+    char key[ALE_LQA_ADDR_LEN];
+
+    if (!freq_hz)
+        return;
+
+    addr_key(key, NULL);
+    entry_update(lqa, entry_get(lqa, freq_hz, key, now), snr_db, ok, sounding, now);
+    if (addr && addr[0])
+    {
+        addr_key(key, addr);
+        entry_update(lqa, entry_get(lqa, freq_hz, key, now), snr_db, ok, sounding, now);
+    }
+}
+
+bool ale_lqa_get(struct ale_lqa *lqa, uint32_t freq_hz, const char *addr, time_t now,
+                 struct ale_lqa_info *info)
+{
+    char key[ALE_LQA_ADDR_LEN];
+    const struct ale_lqa_entry *e;
+
+    addr_key(key, addr);
+    e = entry_find(lqa, freq_hz, key);
+    if (!e)
+        return false;
+    info_fill(lqa, e, now, info);
+    return true;
+}
+
+float ale_lqa_score(const struct ale_lqa_info *info)
+{
+    float margin = info->snr_db - ALE_LQA_SNR_FLOOR;
+
+    if (margin <= 0)
+        return 0;
+    return margin * (1 - info->fer) * info->weight / (info->weight + 1);
+}
+
+int ale_lqa_best(struct ale_lqa *lqa, const char *addr, const uint32_t *freqs, unsigned int n,
+                 time_t now, float *score)
+{
+    char chan[ALE_LQA_ADDR_LEN], station[ALE_LQA_ADDR_LEN];
+    float best_score = -1;
+    int best = -1;
+
+    addr_key(chan, NULL);
+    addr_key(station, addr);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const struct ale_lqa_entry *e = NULL;
+        struct ale_lqa_info info;
+        float s;
+
+        if (addr && addr[0])
+            e = entry_find(lqa, freqs[i], station);
+        if (e)
+        {
+            info_fill(lqa, e, now, &info);
+            s = info.score;
+        }
+        else
+        {
+            e = entry_find(lqa, freqs[i], chan);
+            if (!e)
+                continue;
+            info_fill(lqa, e, now, &info);
+            s = info.score / 2;
+        }
+
+        if (s > best_score)
+        {
+            best_score = s;
+            best = i;
+        }
+    }
+
+    if (score)
+        *score = best_score;
+    return best;
+}
+
+void ale_lqa_clear(struct ale_lqa *lqa)
+{
+    memset(lqa->table, 0, (size_t) lqa->slots * sizeof(*lqa->table));
+}
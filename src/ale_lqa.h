@@ -0,0 +1,132 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_lqa.h
+ * @author agent
+ * @brief Link quality analysis store
+ *
+ * SNR and frame error history per channel, and per station on a channel,
+ * fed by the FSM with every frame the demodulator decodes or fails the CRC
+ * of, and every sounding. Values are exponentially decayed with the age:
+ * each update first scales the weight of the history by
+ * 2^(-age / half_life), then adds the new sample with weight 1. Queries
+ * apply the decay up to now without writing.
+ *
+ * The table is an open addressing hash table of 64 byte entries, one cache
+ * line each, keyed by (frequency, station), where the empty station is the
+ * channel as a whole. It lives in a memory-mapped file, so the history is
+ * there right after a restart; without a file it is anonymous memory. When
+ * the probe window of a key is full the entry with the least weight left
+ * is replaced.
+ *
+ * All calls on one thread, the main one in the daemon.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define ALE_LQA_MAGIC "ALELQA1"
+#define ALE_LQA_VERSION 1
+#define ALE_LQA_ADDR_LEN 8
+#define ALE_LQA_DEFAULT_SLOTS 4096
+#define ALE_LQA_DEFAULT_HALF_LIFE 3600  // seconds
+#define ALE_LQA_SNR_FLOOR -5.0f         // dB, no link below
+
+struct ale_lqa_file_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint32_t entry_size;
+    uint32_t reserved[11];
+};
+
+struct ale_lqa_entry {
+    char addr[ALE_LQA_ADDR_LEN];    // NUL padded, all NUL: the channel
+    uint32_t freq_hz;               // 0: free slot
+    uint32_t updated;               // unix time
+    float weight;                   // decayed samples
+    float snr_db;                   // decayed mean
+    float snr_var;                  // decayed variance
+    float errors;                   // decayed frames failing the CRC
+    uint32_t frames;                // since the entry was created
+    uint32_t crc_errors;
+    uint32_t soundings;
+    uint32_t reserved[5];
+};
+
+/// Decayed view of an entry
+struct ale_lqa_info {
+    float weight;
+    float snr_db;
+    float snr_sd;
+    float fer;                      // frame error rate
+    uint32_t age_s;
+    float score;
+};
+
+struct ale_lqa {
+    unsigned int half_life;         // seconds, from any time on
+    unsigned int slots;             // power of 2
+    struct ale_lqa_file_hdr *hdr;
+    struct ale_lqa_entry *table;
+    size_t map_size;
+    bool file;
+};
+
+/// Creates an empty store in memory
+struct ale_lqa *ale_lqa_alloc(unsigned int slots);
+
+void ale_lqa_free(struct ale_lqa *lqa);
+
+/// Moves the store to a memory-mapped file, created if needed. The
+/// history in the file is kept if it has this layout, else the one in
+/// memory is written to it
+/// Returns 0 on success, -1 with errno set on error (the store is unchanged)
+int ale_lqa_open(struct ale_lqa *lqa, const char *path);
+
+/// Adds a frame (ok: passed the CRC) or a sounding heard on a channel,
+/// from a station or NULL, to the channel and station entries
+void ale_lqa_update(struct ale_lqa *lqa, uint32_t freq_hz, const char *addr, float snr_db, bool ok,
+                    bool sounding, time_t now);
+
+/// Decayed view of a channel (addr NULL or "") or a station on it
+/// Returns false if there is no entry
+bool ale_lqa_get(struct ale_lqa *lqa, uint32_t freq_hz, const char *addr, time_t now,
+                 struct ale_lqa_info *info);
+
+/// Score of an entry: SNR above ALE_LQA_SNR_FLOOR, times the frames
+/// passing the CRC and a confidence of weight / (weight + 1)
+float ale_lqa_score(const struct ale_lqa_info *info);
+
+/// The best of n channels to reach a station (NULL: anyone), by the
+/// station's score on a channel or else half the channel's
+/// Returns the index in freqs, or -1 if none has history
+int ale_lqa_best(struct ale_lqa *lqa, const char *addr, const uint32_t *freqs, unsigned int n,
+                 time_t now, float *score);
+
+/// Drops all history
+void ale_lqa_clear(struct ale_lqa *lqa);
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <signal.h>
@@ -45,6 +46,10 @@
 #include <osmocom/vty/misc.h>
 
 #include "internal.h"
+#include "ale_uring.h"
+#include "ale_pool.h"
+#include "ale_log.h"
+#include "ale_flight.h"
 
 static void *tall_ale_ctx;
 
@@ -148,6 +153,31 @@ static void handle_options(int argc, char **argv)
     }
 }
 
+static volatile sig_atomic_t reload_pending;
+
+/* Re-reads the address book from the config file, and nothing else: the
+ * other commands would act again on the running station. The old book
+ * stays in use, and staged, unless the whole new one parses */
+static void reload_config(void)
+{
+    struct ale_addr_book *book;
+    unsigned int line;
+
+    book = ale_addr_read(cmdline_config.config_file, &line);
+    if (!book) {
+        if (errno == EINVAL)
+            fprintf(stderr, "Bad address in '%s' line %u, address book not reloaded\n",
+                    cmdline_config.config_file, line);
+        else
+            fprintf(stderr, "Failed to re-read the config file '%s', address book not reloaded: %s\n",
+                    cmdline_config.config_file, strerror(errno));
+        return;
+    }
+    if (ale_addr_replace(g_ale->addr, book) < 0)
+        fprintf(stderr, "Address book not reloaded: %s\n", strerror(errno));
+    ale_addr_free(book);
+}
+
 static void signal_handler(int signal)
 {
     fprintf(stdout, "signal %d received\n", signal);
@@ -156,10 +186,18 @@ static void signal_handler(int signal)
     case SIGUSR1:
         talloc_report(tall_vty_ctx, stderr);
         talloc_report_full(tall_ale_ctx, stderr);
+        ale_pool_report(stderr);
+        if (ale_flight_dump(ale_flight_file()) < 0)
+            fprintf(stderr, "Flight recorder dump to %s failed: %s\n", ale_flight_file(), strerror(errno));
+        else
+            fprintf(stderr, "Flight recorder dumped to %s\n", ale_flight_file());
         break;
     case SIGUSR2:
         talloc_report_full(tall_vty_ctx, stderr);
         break;
+    case SIGHUP:
+        reload_pending = 1;
+        break;
     default:
         break;
     }
@@ -167,8 +205,12 @@ static void signal_handler(int signal)
 
 int main(int argc, char **argv)
 {
+    cbuf_handle_t tx_data[ALE_TX_NUM_CLASSES], rx_data[ALE_TX_NUM_CLASSES], tx_audio, rx_audio;
+    struct ale_modem *modem;
     int rc;
 
+    ale_flight_thread_init("main");
+
     tall_ale_ctx = talloc_named_const(NULL, 1, "rhizo-ale");
     msgb_talloc_ctx_init(tall_ale_ctx, 0);
     osmo_init_logging2(tall_ale_ctx, &log_info);
@@ -181,14 +223,36 @@ int main(int argc, char **argv)
     handle_options(argc, argv);
 
     logging_vty_add_cmds();
+    osmo_stats_vty_add_cmds();
     osmo_fsm_vty_add_cmds();
 
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+        tx_data[i] = circular_buf_init_shm(ALE_DATA_RING_SIZE, ALE_SHM_TX_KEY(i));
+        rx_data[i] = circular_buf_init_shm(ALE_DATA_RING_SIZE, ALE_SHM_RX_KEY(i));
+    }
+    g_ale = ale_station_alloc(tall_ale_ctx, tx_data, rx_data);
+    rc = ale_stats_init(tall_ale_ctx, g_ale);
+    if (rc < 0) {
+        fprintf(stderr, "Error allocating the statistics\n");
+        exit(1);
+    }
+
+    tx_audio = circular_buf_init_shm(ALE_AUDIO_RING_SIZE, ALE_SHM_TX_AUDIO_KEY);
+    rx_audio = circular_buf_init_shm(ALE_AUDIO_RING_SIZE, ALE_SHM_RX_AUDIO_KEY);
+    modem = ale_modem_alloc(tall_ale_ctx, g_ale, tx_audio, rx_audio);
+
+    g_ale->addr->loading = true;
     rc = vty_read_config_file(cmdline_config.config_file, NULL);
     if (rc < 0) {
         fprintf(stderr, "Failed ot parse the config file '%s'\n",
                 cmdline_config.config_file);
         exit(1);
     }
+    g_ale->addr->loading = false;
+    if (ale_addr_commit(g_ale->addr) < 0) {
+        fprintf(stderr, "Error building the address book\n");
+        exit(1);
+    }
 
     rc = telnet_init_dynif(tall_ale_ctx, NULL, vty_get_bind_addr(), cmdline_config.vty_port);
     if (rc < 0) {
@@ -196,9 +260,40 @@ int main(int argc, char **argv)
         exit(1);
     }
 
+    // falls back to the poll loop by itself
+    if (g_ale->host_io_uring)
+        ale_uring_init(tall_ale_ctx, g_ale);
+
+    rc = ale_vara_init(tall_ale_ctx, g_ale);
+    if (rc < 0) {
+        fprintf(stderr, "Error binding the VARA TNC ports\n");
+        exit(1);
+    }
+
+    rc = ale_ardop_init(tall_ale_ctx, g_ale);
+    if (rc < 0) {
+        fprintf(stderr, "Error binding the ARDOP TNC ports\n");
+        exit(1);
+    }
+
+    rc = ale_local_init(tall_ale_ctx, g_ale);
+    if (rc < 0) {
+        fprintf(stderr, "Error binding the local client socket\n");
+        exit(1);
+    }
+
+    rc = ale_kiss_srv_init(tall_ale_ctx, g_ale);
+    if (rc < 0) {
+        fprintf(stderr, "Error binding the KISS TNC port\n");
+        exit(1);
+    }
+
     signal(SIGUSR1, &signal_handler);
     signal(SIGUSR2, &signal_handler);
     osmo_init_ignore_signals();
+    // after the above, which ignores it
+    signal(SIGHUP, &signal_handler);
+    ale_flight_catch_abort();
 
     if (cmdline_config.daemonize) {
         rc = osmo_daemonize();
@@ -208,9 +303,42 @@ int main(int argc, char **argv)
         }
     }
 
+    /* threads are started after the fork, the child only has the thread
+     * that called fork() and would inherit any lock held at that moment */
+
+    // drains LOGP_RT() of the real-time threads
+    rc = ale_log_start();
+    if (rc < 0)
+        fprintf(stderr, "Log drain thread not started, real-time threads can't log\n");
+
+    // after the log drain, the modem thread logs through it
+    rc = ale_modem_start(modem);
+    if (rc < 0)
+        fprintf(stderr, "Modem not started, no frames will be sent or received\n");
+
+    // the FSM sees the modem hooks ale_modem_start() set
+    osmo_fsm_inst_dispatch(g_ale->fi, ALE_E_INIT, NULL);
+
+    if (g_ale->rec->cfg.dir[0] && ale_rec_start(g_ale->rec) < 0)
+        fprintf(stderr, "RX audio recorder not started: %s\n", strerror(errno));
+
+    if (g_ale->lqa_file && ale_lqa_open(g_ale->lqa, g_ale->lqa_file) < 0)
+        fprintf(stderr, "LQA history kept in memory only, could not map %s: %s\n", g_ale->lqa_file,
+                strerror(errno));
+
+    if (g_ale->spec->enabled && ale_spec_start(g_ale->spec) < 0)
+        fprintf(stderr, "Spectrum feed not started: %s\n", strerror(errno));
+
+    if (ale_rig_init(tall_ale_ctx, g_ale) < 0)
+        fprintf(stderr, "Channel scan not started\n");
+
     while (1) {
         rc = osmo_select_main(0);
         if (rc < 0)
             exit(3);
+        if (reload_pending) {
+            reload_pending = 0;
+            reload_config();
+        }
     }
 }
@@ -0,0 +1,116 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_mode.c
+ * @author agent
+ * @brief OFDM modem modes
+ *
+ * Figures taken from codec2 README_data.md (raw data modes).
+ *
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "ale_mode.h"
+
+static const struct ale_mode ale_modes[_NUM_ALE_MODES] = {
+    [ALE_MODE_DATAC13] = {
+        .id = ALE_MODE_DATAC13,
+        .name = "datac13",
+        .payload_bytes = 14,
+        .frame_ms = 1720,
+        .min_snr_db = -4.0,
+        .data = false,
+    },
+    [ALE_MODE_DATAC4] = {
+        .id = ALE_MODE_DATAC4,
+        .name = "datac4",
+        .payload_bytes = 54,
+        .frame_ms = 4970,
+        .min_snr_db = -4.0,
+        .data = true,
+    },
+    [ALE_MODE_DATAC0] = {
+        .id = ALE_MODE_DATAC0,
+        .name = "datac0",
+        .payload_bytes = 14,
+        .frame_ms = 440,
+        .min_snr_db = 0.0,
+        .data = false,
+    },
+    [ALE_MODE_DATAC3] = {
+        .id = ALE_MODE_DATAC3,
+        .name = "datac3",
+        .payload_bytes = 126,
+        .frame_ms = 3140,
+        .min_snr_db = 0.0,
+        .data = true,
+    },
+    [ALE_MODE_DATAC1] = {
+        .id = ALE_MODE_DATAC1,
+        .name = "datac1",
+        .payload_bytes = 510,
+        .frame_ms = 4160,
+        .min_snr_db = 5.0,
+        .data = true,
+    },
+};
+
+// modes the modem can't carry, set once at startup
+static bool rejected[_NUM_ALE_MODES];
+
+const struct ale_mode *ale_mode_get(enum ale_mode_id id)
+{
+    if (id < 0 || id >= _NUM_ALE_MODES)
+        return NULL;
+
+    return &ale_modes[id];
+}
+
+const struct ale_mode *ale_mode_by_name(const char *name)
+{
+    for (int i = 0; i < _NUM_ALE_MODES; i++)
+    {
+        if (!strcasecmp(ale_modes[i].name, name))
+            return &ale_modes[i];
+    }
+
+    return NULL;
+}
+
+void ale_mode_reject(enum ale_mode_id id)
+{
+    if (id >= 0 && id < _NUM_ALE_MODES)
+        rejected[id] = true;
+}
+
+bool ale_mode_usable(const struct ale_mode *mode)
+{
+    return !rejected[mode->id];
+}
+
+unsigned int ale_mode_bytes_per_min(const struct ale_mode *mode)
+{
+    return (unsigned int) (mode->payload_bytes * 60000 / mode->frame_ms);
+}
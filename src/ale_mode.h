@@ -0,0 +1,69 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_mode.h
+ * @author agent
+ * @brief OFDM modem modes
+ *
+ * Table of the codec2 OFDM data modes used by the link, ordered from the
+ * most robust to the fastest one.
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+enum ale_mode_id {
+    ALE_MODE_DATAC13,
+    ALE_MODE_DATAC4,
+    ALE_MODE_DATAC0,
+    ALE_MODE_DATAC3,
+    ALE_MODE_DATAC1,
+    _NUM_ALE_MODES
+};
+
+struct ale_mode {
+    enum ale_mode_id id;
+    const char *name;
+    size_t payload_bytes;   // link layer bytes per modem frame (CRC excluded)
+    unsigned int frame_ms;  // airtime of one modem frame
+    float min_snr_db;       // SNR (3 kHz) for ~10% frame error rate in AWGN
+    bool data;              // usable as a data mode (speed level)
+};
+
+/// Returns the mode description, NULL if id is invalid
+const struct ale_mode *ale_mode_get(enum ale_mode_id id);
+
+/// Returns the mode description by name (eg. "datac1"), NULL if not found
+const struct ale_mode *ale_mode_by_name(const char *name);
+
+/// Takes a mode out of use: the modem does not carry its payload size
+void ale_mode_reject(enum ale_mode_id id);
+
+/// False once the mode was rejected
+bool ale_mode_usable(const struct ale_mode *mode);
+
+/// Raw link throughput of a mode, in bytes per minute
+unsigned int ale_mode_bytes_per_min(const struct ale_mode *mode);
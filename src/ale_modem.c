@@ -0,0 +1,728 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_modem.c
+ * @author agent
+ * @brief codec2 OFDM modem thread
+ *
+ * The modem thread reads 8 kHz 16 bit samples from the RX audio ring and
+ * runs one freedv raw data demodulator per mode in parallel, so frames
+ * are received whatever level the peer is using. Frames queued by the FSM
+ * are modulated into the TX audio ring. The rings are in shared memory,
+ * the radio/soundcard process sits on the other side.
+ *
+ * Decoded frames and end of transmission are handed to the main thread
+ * through a small queue and an eventfd registered in the osmocom select
+ * loop, so the FSM only ever runs in the main thread.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+
+#ifdef HAVE_CODEC2
+#include <codec2/freedv_api.h>
+#endif
+
+#include "internal.h"
+#include "ale_pool.h"
+#include "ale_log.h"
+#include "ale_flight.h"
+#include "ale_probe.h"
+#include "ale_lat.h"
+
+#define MODEM_QUEUE_LEN 32
+#define MODEM_RATE ALE_AUDIO_RATE
+#define MODEM_BLOCK 160         // 20 ms
+#define MODEM_IDLE_US 10000
+#define MODEM_TX_BUFS 2         // sample buffers of the frame being modulated
+#define MODEM_WAVES 4           // cached bursts of frames sent again and again (soundings)
+
+/* TX event flags */
+#define MODEM_TX_CACHED 0x01    // keep the burst in the cache, or send the cached one
+#define MODEM_TX_PREPARE 0x02   // only modulate it into the cache
+
+enum modem_evt_type {
+	MODEM_EVT_RX_FRAME,
+	MODEM_EVT_RX_ERROR,
+	MODEM_EVT_TX_DONE,
+	MODEM_EVT_SYNC,         // the call detector: len 1 once any mode syncs, 0 once none is
+	MODEM_EVT_TX_FRAME,     // main -> modem
+	MODEM_EVT_TX_END,       // main -> modem, after the last frame of a burst
+};
+
+struct modem_evt {
+	enum modem_evt_type type;
+	enum ale_mode_id mode;
+	float snr_db;
+	uint64_t born_us;       // TX: data taken from the TX queue
+	uint64_t queued_us;     // put in the queue between the threads
+	uint8_t flags;          // TX: MODEM_TX_*
+	uint16_t len;
+	uint8_t data[ARQ_MAX_PAYLOAD];
+};
+
+struct modem_queue {
+	unsigned int head;
+	unsigned int tail;
+	struct modem_evt evt[MODEM_QUEUE_LEN];
+};
+
+struct modem_demod {
+#ifdef HAVE_CODEC2
+	struct freedv *fdv;
+#endif
+	size_t payload;         // bytes per frame without CRC
+	int sync;               // last seen, for the flight recorder
+	int16_t *fifo;
+	size_t fifo_len;
+	size_t fifo_size;
+};
+
+/* A whole burst, preamble to postamble, keyed by the mode and the frame */
+struct modem_wave {
+	bool valid;
+	enum ale_mode_id mode;
+	uint16_t len;
+	uint8_t data[ARQ_MAX_PAYLOAD];
+	int16_t *samples;
+	size_t n;
+	uint64_t used_us;
+};
+
+struct ale_modem {
+	struct ale_station *st;
+	cbuf_handle_t tx_audio;
+	cbuf_handle_t rx_audio;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	struct modem_queue tx_queue;    // main -> modem
+	struct modem_queue rx_queue;    // modem -> main
+	struct osmo_fd evt_ofd;
+
+	struct modem_demod demod[_NUM_ALE_MODES];
+	unsigned int synced;            // modes in sync, modem thread only
+	struct ale_pool *tx_samples;    // largest burst part of any mode
+	struct modem_wave waves[MODEM_WAVES];   // modem thread only
+	size_t wave_max;                // samples of the longest burst
+	struct ale_lat_marks tx_marks;  // frame ends in the TX audio ring
+	struct ale_modem_stats stats;   // written by the modem thread only
+};
+
+/* single writer, the stats timer only reads */
+#define MODEM_STAT_INC(modem, field) \
+	atomic_store_explicit(&(modem)->stats.field, \
+			      atomic_load_explicit(&(modem)->stats.field, memory_order_relaxed) + 1, \
+			      memory_order_relaxed)
+
+static struct ale_modem *g_modem;
+
+static bool queue_push(struct ale_modem *modem, struct modem_queue *q, const struct modem_evt *evt)
+{
+	/* frames leave the last slot to the end of their burst */
+	unsigned int len = evt->type == MODEM_EVT_TX_FRAME ? MODEM_QUEUE_LEN - 1 : MODEM_QUEUE_LEN;
+	bool ok = false;
+
+	pthread_mutex_lock(&modem->lock);
+	if (q->head - q->tail < len) {
+		q->evt[q->head % MODEM_QUEUE_LEN] = *evt;
+		q->head++;
+		ok = true;
+	}
+	pthread_mutex_unlock(&modem->lock);
+
+	return ok;
+}
+
+static bool queue_pop(struct ale_modem *modem, struct modem_queue *q, struct modem_evt *evt)
+{
+	bool ok = false;
+
+	pthread_mutex_lock(&modem->lock);
+	if (q->head != q->tail) {
+		*evt = q->evt[q->tail % MODEM_QUEUE_LEN];
+		q->tail++;
+		ok = true;
+	}
+	pthread_mutex_unlock(&modem->lock);
+
+	return ok;
+}
+
+#ifdef HAVE_CODEC2
+/* modem thread side */
+static void modem_post(struct ale_modem *modem, struct modem_evt *evt)
+{
+	uint64_t one = 1;
+
+	evt->queued_us = ale_lat_now();
+	if (!queue_push(modem, &modem->rx_queue, evt)) {
+		LOGP_RT(ALE, LOGL_ERROR, "Modem RX queue full, dropping event\n");
+		return;
+	}
+	if (write(modem->evt_ofd.fd, &one, sizeof(one)) < 0)
+		return;
+}
+
+static const int freedv_modes[_NUM_ALE_MODES] = {
+	[ALE_MODE_DATAC13] = FREEDV_MODE_DATAC13,
+	[ALE_MODE_DATAC4] = FREEDV_MODE_DATAC4,
+	[ALE_MODE_DATAC0] = FREEDV_MODE_DATAC0,
+	[ALE_MODE_DATAC3] = FREEDV_MODE_DATAC3,
+	[ALE_MODE_DATAC1] = FREEDV_MODE_DATAC1,
+};
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* the audio client read past these frame ends */
+static void tx_audio_passed(struct ale_modem *modem)
+{
+	ale_lat_passed(&modem->tx_marks, circular_buf_read_pos(modem->tx_audio), ale_lat_now(),
+		       ALE_LAT_TX_AUDIO, ALE_LAT_TX_FRAME);
+}
+
+static void audio_write(struct ale_modem *modem, const int16_t *samples, size_t n)
+{
+	size_t len = n * sizeof(int16_t);
+
+	while (circular_buf_free_size(modem->tx_audio) < len) {
+		usleep(MODEM_IDLE_US);
+		tx_audio_passed(modem);
+	}
+
+	circular_buf_put_range(modem->tx_audio, (uint8_t *) samples, len);
+}
+
+/* A burst is in the TX audio ring */
+static void tx_sent(struct ale_modem *modem, const struct modem_evt *evt, uint64_t start)
+{
+	uint64_t end = ale_lat_now();
+
+	ale_lat_since(ALE_LAT_TX_MODULATE, start, end);
+	ale_lat_mark(&modem->tx_marks, circular_buf_read_pos(modem->tx_audio) +
+		     circular_buf_size(modem->tx_audio), end, evt->born_us);
+	MODEM_STAT_INC(modem, tx_frames);
+}
+
+/* The cached burst of a frame, modulated into the least recently used
+ * slot on a miss */
+static struct modem_wave *modem_wave(struct ale_modem *modem, const struct modem_evt *evt)
+{
+	struct freedv *fdv = modem->demod[evt->mode].fdv;
+	size_t payload = modem->demod[evt->mode].payload;
+	struct modem_wave *w = &modem->waves[0];
+	uint8_t bytes[payload + 2];
+	uint16_t crc;
+	size_t n;
+
+	for (int i = 0; i < MODEM_WAVES; i++) {
+		struct modem_wave *c = &modem->waves[i];
+
+		if (c->valid && c->mode == evt->mode && c->len == evt->len && !memcmp(c->data, evt->data, evt->len)) {
+			MODEM_STAT_INC(modem, wave_hits);
+			c->used_us = ale_lat_now();
+			return c;
+		}
+		if (!c->valid || c->used_us < w->used_us)
+			w = c;
+	}
+
+	memset(bytes, 0, sizeof(bytes));
+	memcpy(bytes, evt->data, OSMO_MIN(evt->len, payload));
+	crc = freedv_gen_crc16(bytes, payload);
+	bytes[payload] = crc >> 8;
+	bytes[payload + 1] = crc & 0xff;
+
+	n = freedv_rawdatapreambletx(fdv, w->samples);
+	freedv_rawdatatx(fdv, w->samples + n, bytes);
+	n += freedv_get_n_tx_modem_samples(fdv);
+	n += freedv_rawdatapostambletx(fdv, w->samples + n);
+
+	w->valid = true;
+	w->mode = evt->mode;
+	w->len = evt->len;
+	memcpy(w->data, evt->data, evt->len);
+	w->n = n;
+	w->used_us = ale_lat_now();
+	MODEM_STAT_INC(modem, wave_misses);
+	return w;
+}
+
+static bool modem_tx_wave(struct ale_modem *modem, const struct modem_evt *evt)
+{
+	uint64_t start = ale_lat_now();
+	const struct modem_wave *w;
+
+	ale_lat_since(ALE_LAT_TX_QUEUE, evt->queued_us, start);
+	w = modem_wave(modem, evt);
+	if (evt->flags & MODEM_TX_PREPARE)
+		return false;
+
+	ale_flight_rec(FLIGHT_MODEM_TX, evt->mode, evt->len);
+	audio_write(modem, w->samples, w->n);
+	tx_sent(modem, evt, start);
+	return true;
+}
+
+/* Returns true if audio was written */
+static bool modem_tx(struct ale_modem *modem, const struct modem_evt *evt)
+{
+	struct freedv *fdv = modem->demod[evt->mode].fdv;
+	size_t payload = modem->demod[evt->mode].payload;
+	int n = freedv_get_n_tx_modem_samples(fdv);
+	int n_pre = freedv_get_n_tx_preamble_modem_samples(fdv);
+	int n_post = freedv_get_n_tx_postamble_modem_samples(fdv);
+	uint8_t bytes[payload + 2];
+	uint64_t start = ale_lat_now();
+	int16_t *samples;
+	uint16_t crc;
+
+	if (evt->flags & MODEM_TX_CACHED)
+		return modem_tx_wave(modem, evt);
+
+	ale_lat_since(ALE_LAT_TX_QUEUE, evt->queued_us, start);
+	samples = ale_pool_get(modem->tx_samples);
+
+	memset(bytes, 0, sizeof(bytes));
+	memcpy(bytes, evt->data, OSMO_MIN(evt->len, payload));
+	crc = freedv_gen_crc16(bytes, payload);
+	bytes[payload] = crc >> 8;
+	bytes[payload + 1] = crc & 0xff;
+
+	ale_flight_rec(FLIGHT_MODEM_TX, evt->mode, evt->len);
+	n_pre = freedv_rawdatapreambletx(fdv, samples);
+	audio_write(modem, samples, n_pre);
+	freedv_rawdatatx(fdv, samples, bytes);
+	audio_write(modem, samples, n);
+	n_post = freedv_rawdatapostambletx(fdv, samples);
+	audio_write(modem, samples, n_post);
+	ale_pool_put(modem->tx_samples, samples);
+
+	tx_sent(modem, evt, start);
+	return true;
+}
+
+/* Tells the main thread when the first mode gets sync and when the last
+ * one loses it, the scan extends its dwell on that */
+static void modem_sync(struct ale_modem *modem, enum ale_mode_id m, int sync)
+{
+	unsigned int was = modem->synced;
+	struct modem_evt evt = { .type = MODEM_EVT_SYNC, .mode = m };
+
+	if (sync)
+		modem->synced |= 1 << m;
+	else
+		modem->synced &= ~(1 << m);
+	if (!was == !modem->synced)
+		return;
+
+	evt.len = !!modem->synced;
+	modem_post(modem, &evt);
+}
+
+static void modem_rx(struct ale_modem *modem, const int16_t *block, size_t n, uint64_t read_us)
+{
+	for (int m = 0; m < _NUM_ALE_MODES; m++) {
+		struct modem_demod *d = &modem->demod[m];
+		uint64_t cpu = thread_cpu_ns();
+		size_t nin;
+
+		if (!d->fdv)
+			continue;
+		if (d->fifo_len + n > d->fifo_size)
+			d->fifo_len = 0;
+		memcpy(d->fifo + d->fifo_len, block, n * sizeof(int16_t));
+		d->fifo_len += n;
+
+		while (d->fifo_len >= (nin = freedv_nin(d->fdv))) {
+			uint8_t bytes[d->payload + 2];
+			struct modem_evt evt = { .mode = m };
+			int sync, nbytes;
+
+			nbytes = freedv_rawdatarx(d->fdv, bytes, d->fifo);
+			d->fifo_len -= nin;
+			memmove(d->fifo, d->fifo + nin, d->fifo_len * sizeof(int16_t));
+
+			sync = freedv_get_sync(d->fdv);
+			if (sync != d->sync) {
+				ale_flight_rec(FLIGHT_MODEM_SYNC, m, sync);
+				ALE_PROBE2(modem__sync, m, sync);
+				if (!sync)
+					MODEM_STAT_INC(modem, sync_lost);
+				ale_rec_event(modem->st->rec, REC_SYNC, m, sync);
+				d->sync = sync;
+				modem_sync(modem, m, sync);
+			}
+
+			if (nbytes <= 0)
+				continue;
+
+			freedv_get_modem_stats(d->fdv, &sync, &evt.snr_db);
+			atomic_store_explicit(&modem->stats.snr_db10, (int) (evt.snr_db * 10),
+					      memory_order_relaxed);
+			if (freedv_gen_crc16(bytes, d->payload) != ((bytes[d->payload] << 8) | bytes[d->payload + 1])) {
+				LOGP_RT(ALE, LOGL_DEBUG, "%s frame with CRC error, SNR %.1f dB\n",
+					ale_mode_get(m)->name, evt.snr_db);
+				ale_flight_rec(FLIGHT_MODEM_CRC, m, (int32_t) (evt.snr_db * 10));
+				ALE_PROBE3(modem__decode, m, (int) (evt.snr_db * 10), 0);
+				MODEM_STAT_INC(modem, rx_crc);
+				ale_rec_event(modem->st->rec, REC_CRC, m, (int32_t) (evt.snr_db * 10));
+				evt.type = MODEM_EVT_RX_ERROR;
+			} else {
+				LOGP_RT(ALE, LOGL_DEBUG, "%s frame decoded, SNR %.1f dB\n",
+					ale_mode_get(m)->name, evt.snr_db);
+				ale_flight_rec(FLIGHT_MODEM_RX, m, (int32_t) (evt.snr_db * 10));
+				ALE_PROBE3(modem__decode, m, (int) (evt.snr_db * 10), 1);
+				MODEM_STAT_INC(modem, rx_frames);
+				MODEM_STAT_INC(modem, rx_mode[m]);
+				ale_rec_event(modem->st->rec, REC_FRAME, m, (int32_t) (evt.snr_db * 10));
+				ale_lat_since(ALE_LAT_RX_DEMOD, read_us, ale_lat_now());
+				evt.type = MODEM_EVT_RX_FRAME;
+				evt.len = d->payload;
+				memcpy(evt.data, bytes, d->payload);
+			}
+			modem_post(modem, &evt);
+		}
+		atomic_store_explicit(&modem->stats.demod_ns[m],
+				      atomic_load_explicit(&modem->stats.demod_ns[m], memory_order_relaxed) +
+				      thread_cpu_ns() - cpu, memory_order_relaxed);
+	}
+}
+
+static void *modem_thread(void *arg)
+{
+	struct ale_modem *modem = arg;
+	int16_t block[MODEM_BLOCK];
+	enum ale_mode_id mode = ALE_MODE_DATAC13;
+	bool burst = false;     // frames sent, the end not seen yet
+	struct modem_evt evt;
+	size_t fill;
+
+	// no LOGP() from here on, it may block on the log targets
+	ale_log_thread_init("modem");
+	ale_flight_thread_init("modem");
+
+	while (1) {
+		bool end = false;
+
+		/* half duplex: pending transmissions take over the modem */
+		while (!end && queue_pop(modem, &modem->tx_queue, &evt)) {
+			if (evt.type == MODEM_EVT_TX_END) {
+				end = true;
+			} else if (modem_tx(modem, &evt)) {
+				burst = true;
+				mode = evt.mode;
+			}
+		}
+
+		/* the queue may run dry in the middle of a burst, it is only over
+		 * once its end is in the TX audio and played out */
+		if (end) {
+			while (!circular_buf_empty(modem->tx_audio)) {
+				usleep(MODEM_IDLE_US);
+				tx_audio_passed(modem);
+			}
+			tx_audio_passed(modem);
+			ale_flight_rec(FLIGHT_MODEM_TX_DONE, mode, 0);
+			evt.type = MODEM_EVT_TX_DONE;
+			evt.mode = mode;
+			modem_post(modem, &evt);
+			burst = false;
+			continue;
+		}
+
+		/* the rest of the burst is still to come, we are not listening */
+		if (burst) {
+			usleep(MODEM_IDLE_US);
+			tx_audio_passed(modem);
+			continue;
+		}
+
+		fill = circular_buf_size(modem->rx_audio);
+		if (fill < sizeof(block)) {
+			usleep(MODEM_IDLE_US);
+			continue;
+		}
+
+		// the oldest sample was written that long ago
+		ale_lat_add(ALE_LAT_RX_AUDIO, fill / sizeof(int16_t) * 1000000ULL / MODEM_RATE);
+		circular_buf_get_range(modem->rx_audio, (uint8_t *) block, sizeof(block));
+		ale_rec_audio(modem->st->rec, block, MODEM_BLOCK);
+		ale_spec_audio(modem->st->spec, block, MODEM_BLOCK);
+		modem_rx(modem, block, MODEM_BLOCK, ale_lat_now());
+	}
+
+	return NULL;
+}
+
+static int modem_open(struct ale_modem *modem)
+{
+	size_t tx_max = 0;
+
+	for (int m = 0; m < _NUM_ALE_MODES; m++) {
+		struct modem_demod *d = &modem->demod[m];
+		const struct ale_mode *mode = ale_mode_get(m);
+
+		d->fdv = freedv_open(freedv_modes[m]);
+		if (!d->fdv) {
+			LOGP(ALE, LOGL_ERROR, "Could not open freedv mode %s\n", mode->name);
+			return -1;
+		}
+		freedv_set_frames_per_burst(d->fdv, 1);
+
+		/* frames of another size would be cut or padded on the air and
+		 * the peer would not decode them as sent */
+		d->payload = freedv_get_bits_per_modem_frame(d->fdv) / 8 - 2;
+		if (d->payload != mode->payload_bytes) {
+			LOGP(ALE, LOGL_ERROR, "Mode %s carries %zu bytes, expected %zu, not using it\n",
+			     mode->name, d->payload, mode->payload_bytes);
+			freedv_close(d->fdv);
+			d->fdv = NULL;
+			// calls, soundings and acknowledgements go in it
+			if (m == ALE_MODE_DATAC13)
+				return -1;
+			ale_mode_reject(m);
+			continue;
+		}
+
+		d->fifo_size = 2 * freedv_get_n_max_modem_samples(d->fdv) + MODEM_BLOCK;
+		d->fifo = talloc_zero_array(modem, int16_t, d->fifo_size);
+
+		tx_max = OSMO_MAX(tx_max, freedv_get_n_tx_modem_samples(d->fdv));
+		tx_max = OSMO_MAX(tx_max, freedv_get_n_tx_preamble_modem_samples(d->fdv));
+		tx_max = OSMO_MAX(tx_max, freedv_get_n_tx_postamble_modem_samples(d->fdv));
+		modem->wave_max = OSMO_MAX(modem->wave_max, freedv_get_n_tx_preamble_modem_samples(d->fdv) +
+					   freedv_get_n_tx_modem_samples(d->fdv) +
+					   freedv_get_n_tx_postamble_modem_samples(d->fdv));
+	}
+	modem->tx_samples = ale_pool_alloc(modem, "modem-tx", tx_max * sizeof(int16_t), MODEM_TX_BUFS);
+	for (int i = 0; i < MODEM_WAVES; i++)
+		modem->waves[i].samples = talloc_zero_array(modem, int16_t, modem->wave_max);
+
+	return 0;
+}
+#else
+static int modem_open(struct ale_modem *modem)
+{
+	LOGP(ALE, LOGL_ERROR, "Built without codec2, no modem available\n");
+	return -ENOTSUP;
+}
+
+static void *modem_thread(void *arg)
+{
+	return NULL;
+}
+#endif
+
+/* main thread side */
+static int modem_evt_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct ale_modem *modem = ofd->data;
+	struct modem_evt evt;
+	uint64_t count;
+
+	if (read(ofd->fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		return -1;
+
+	while (queue_pop(modem, &modem->rx_queue, &evt)) {
+		if (evt.type != MODEM_EVT_TX_DONE)
+			ale_lat_since(ALE_LAT_RX_QUEUE, evt.queued_us, ale_lat_now());
+		switch (evt.type) {
+		case MODEM_EVT_RX_FRAME:
+			ale_station_rx_frame(modem->st, evt.data, evt.len, evt.snr_db);
+			break;
+		case MODEM_EVT_RX_ERROR:
+			ale_station_rx_error(modem->st, evt.snr_db);
+			break;
+		case MODEM_EVT_TX_DONE:
+			ale_station_tx_done(modem->st);
+			break;
+		case MODEM_EVT_SYNC:
+			ale_station_rx_sync(modem->st, evt.len);
+			break;
+		case MODEM_EVT_TX_FRAME:
+		case MODEM_EVT_TX_END:
+			// never posted by the modem thread
+			break;
+		}
+	}
+	ale_host_rx_poll(modem->st);
+
+	return 0;
+}
+
+static int modem_tx_frame(struct ale_station *st, const struct ale_mode *mode,
+			  const uint8_t *buf, size_t len, uint64_t born_us)
+{
+	struct modem_evt evt = {
+		.type = MODEM_EVT_TX_FRAME,
+		.mode = mode->id,
+		.born_us = born_us,
+		.queued_us = ale_lat_now(),
+		.len = OSMO_MIN(len, sizeof(evt.data)),
+	};
+
+	ale_lat_since(ALE_LAT_TX_FRAMING, born_us, evt.queued_us);
+
+	if (!ale_mode_usable(mode)) {
+		LOGP(ALE, LOGL_ERROR, "Mode %s rejected, dropping frame\n", mode->name);
+		return -1;
+	}
+
+	memcpy(evt.data, buf, evt.len);
+	if (!queue_push(g_modem, &g_modem->tx_queue, &evt)) {
+		LOGP(ALE, LOGL_ERROR, "Modem TX queue full, dropping frame\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int modem_tx_cached(struct ale_station *st, const struct ale_mode *mode,
+			   const uint8_t *buf, size_t len, bool send)
+{
+	struct modem_evt evt = {
+		.type = MODEM_EVT_TX_FRAME,
+		.mode = mode->id,
+		.queued_us = ale_lat_now(),
+		.flags = MODEM_TX_CACHED | (send ? 0 : MODEM_TX_PREPARE),
+		.len = OSMO_MIN(len, sizeof(evt.data)),
+	};
+
+	memcpy(evt.data, buf, evt.len);
+	if (!queue_push(g_modem, &g_modem->tx_queue, &evt)) {
+		LOGP(ALE, LOGL_ERROR, "Modem TX queue full, dropping frame\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int modem_tx_end(struct ale_station *st)
+{
+	struct modem_evt evt = {
+		.type = MODEM_EVT_TX_END,
+		.queued_us = ale_lat_now(),
+	};
+
+	if (!queue_push(g_modem, &g_modem->tx_queue, &evt)) {
+		LOGP(ALE, LOGL_ERROR, "Modem TX queue full, dropping the end of the burst\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+struct ale_modem *ale_modem_alloc(void *ctx, struct ale_station *st,
+				  cbuf_handle_t tx_audio, cbuf_handle_t rx_audio)
+{
+	struct ale_modem *modem = talloc_zero(ctx, struct ale_modem);
+
+	OSMO_ASSERT(modem);
+	modem->st = st;
+	modem->tx_audio = tx_audio;
+	modem->rx_audio = rx_audio;
+	pthread_mutex_init(&modem->lock, NULL);
+	modem->evt_ofd.fd = -1;
+	st->modem = modem;
+	ale_flight_ring(tx_audio, "tx-audio");
+	ale_flight_ring(rx_audio, "rx-audio");
+	ale_stats_ring(ALE_RING_TX_AUDIO, tx_audio);
+	ale_stats_ring(ALE_RING_RX_AUDIO, rx_audio);
+	ale_stats_modem(&modem->stats);
+
+	return modem;
+}
+
+int ale_modem_start(struct ale_modem *modem)
+{
+	int fd;
+
+	if (modem_open(modem) < 0)
+		return -1;
+
+	fd = eventfd(0, EFD_NONBLOCK);
+	if (fd < 0)
+		return -errno;
+	osmo_fd_setup(&modem->evt_ofd, fd, OSMO_FD_READ, modem_evt_cb, modem, 0);
+	if (osmo_fd_register(&modem->evt_ofd) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	g_modem = modem;
+	modem->st->tx_frame = modem_tx_frame;
+	modem->st->tx_cached = modem_tx_cached;
+	modem->st->tx_end = modem_tx_end;
+
+	if (pthread_create(&modem->thread, NULL, modem_thread, modem)) {
+		LOGP(ALE, LOGL_ERROR, "Could not start the modem thread\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+const struct ale_modem_stats *ale_modem_get_stats(struct ale_modem *modem)
+{
+	return &modem->stats;
+}
+
+cbuf_handle_t ale_modem_rx_audio(struct ale_modem *modem)
+{
+	return modem->rx_audio;
+}
+
+cbuf_handle_t ale_modem_tx_audio(struct ale_modem *modem)
+{
+	return modem->tx_audio;
+}
+
+/* CPU time of the modem thread so far, 0 if not running */
+uint64_t ale_modem_cpu_ns(struct ale_modem *modem)
+{
+	struct timespec ts;
+	clockid_t clk;
+
+	if (!g_modem || pthread_getcpuclockid(modem->thread, &clk) || clock_gettime(clk, &ts))
+		return 0;
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
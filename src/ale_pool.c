@@ -0,0 +1,232 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_pool.c
+ * @author agent
+ * @brief Preallocated frame pools
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+
+#include "ale_pool.h"
+
+static LLIST_HEAD(pools);
+
+static void pool_push(struct ale_pool *pool, uint32_t idx)
+{
+	uint64_t old = atomic_load_explicit(&pool->head, memory_order_relaxed);
+	uint64_t new;
+
+	do {
+		atomic_store_explicit(&pool->next[idx], (uint32_t) old, memory_order_relaxed);
+		new = (((old >> 32) + 1) << 32) | (idx + 1);
+	} while (!atomic_compare_exchange_weak_explicit(&pool->head, &old, new,
+							memory_order_release, memory_order_relaxed));
+
+	atomic_fetch_sub_explicit(&pool->stats.in_use, 1, memory_order_relaxed);
+}
+
+static int pool_pop(struct ale_pool *pool)
+{
+	uint64_t old = atomic_load_explicit(&pool->head, memory_order_acquire);
+	uint64_t new;
+	uint32_t top;
+	unsigned int in_use;
+
+	do {
+		top = (uint32_t) old;
+		if (!top)
+			return -1;
+		new = (((old >> 32) + 1) << 32) |
+		      atomic_load_explicit(&pool->next[top - 1], memory_order_relaxed);
+	} while (!atomic_compare_exchange_weak_explicit(&pool->head, &old, new,
+							memory_order_acquire, memory_order_acquire));
+
+	atomic_fetch_add_explicit(&pool->stats.gets, 1, memory_order_relaxed);
+	in_use = atomic_fetch_add_explicit(&pool->stats.in_use, 1, memory_order_relaxed) + 1;
+	// a racy peak is good enough for the report
+	if (in_use > atomic_load_explicit(&pool->stats.peak, memory_order_relaxed))
+		atomic_store_explicit(&pool->stats.peak, in_use, memory_order_relaxed);
+
+	return top - 1;
+}
+
+// runs before the objects are freed, they must not go back to the list
+static int pool_destructor(struct ale_pool *pool)
+{
+	pool->closing = true;
+	llist_del(&pool->list);
+	return 0;
+}
+
+static struct ale_pool *pool_create(void *ctx, const char *name, size_t size, unsigned int count)
+{
+	struct ale_pool *pool = talloc_zero(ctx, struct ale_pool);
+
+	OSMO_ASSERT(pool && count);
+	talloc_set_name_const(pool, name);
+	pool->name = name;
+	pool->size = size;
+	pool->count = count;
+	pool->next = talloc_zero_array(pool, _Atomic uint32_t, count);
+	OSMO_ASSERT(pool->next);
+	llist_add_tail(&pool->list, &pools);
+	talloc_set_destructor(pool, pool_destructor);
+
+	return pool;
+}
+
+static void pool_fill(struct ale_pool *pool)
+{
+	// pushes count down in_use, start from the other side
+	atomic_store(&pool->stats.in_use, pool->count);
+	for (unsigned int i = pool->count; i-- > 0;)
+		pool_push(pool, i);
+}
+
+struct ale_pool *ale_pool_alloc(void *ctx, const char *name, size_t size, unsigned int count)
+{
+	struct ale_pool *pool = pool_create(ctx, name, size, count);
+
+	pool->slab = talloc_zero_size(pool, size * count);
+	OSMO_ASSERT(pool->slab);
+	pool_fill(pool);
+
+	return pool;
+}
+
+static int pool_msgb_destructor(struct msgb *msg)
+{
+	struct ale_pool *pool = (struct ale_pool *) msg->cb[0];
+
+	if (pool->closing)
+		return 0;
+
+	// back to the free list instead of freeing it
+	pool_push(pool, msg->cb[1]);
+	return -1;
+}
+
+struct ale_pool *ale_msgb_pool_alloc(void *ctx, const char *name, size_t size, unsigned int count)
+{
+	struct ale_pool *pool = pool_create(ctx, name, size, count);
+
+	pool->msgs = talloc_zero_array(pool, struct msgb *, count);
+	OSMO_ASSERT(pool->msgs);
+	for (unsigned int i = 0; i < count; i++) {
+		struct msgb *msg = msgb_alloc_c(pool, size, name);
+
+		OSMO_ASSERT(msg);
+		msg->cb[0] = (unsigned long) pool;
+		msg->cb[1] = i;
+		talloc_set_destructor(msg, pool_msgb_destructor);
+		pool->msgs[i] = msg;
+	}
+	pool_fill(pool);
+
+	return pool;
+}
+
+void ale_pool_free(struct ale_pool *pool)
+{
+	talloc_free(pool);
+}
+
+void *ale_pool_get(struct ale_pool *pool)
+{
+	int idx = pool_pop(pool);
+
+	if (idx < 0) {
+		atomic_fetch_add_explicit(&pool->stats.misses, 1, memory_order_relaxed);
+		return malloc(pool->size);
+	}
+	return pool->slab + (size_t) idx * pool->size;
+}
+
+void ale_pool_put(struct ale_pool *pool, void *obj)
+{
+	uint8_t *p = obj;
+
+	if (!p)
+		return;
+	if (p < pool->slab || p >= pool->slab + pool->size * pool->count) {
+		free(p);
+		return;
+	}
+	pool_push(pool, (p - pool->slab) / pool->size);
+}
+
+struct msgb *ale_msgb_get(struct ale_pool *pool, const char *name)
+{
+	struct msgb *msg = ale_msgb_take(pool, name);
+
+	if (!msg) {
+		atomic_fetch_add_explicit(&pool->stats.misses, 1, memory_order_relaxed);
+		return msgb_alloc(pool->size, name);
+	}
+	return msg;
+}
+
+struct msgb *ale_msgb_take(struct ale_pool *pool, const char *name)
+{
+	struct msgb *msg;
+	int idx = pool_pop(pool);
+
+	if (idx < 0)
+		return NULL;
+
+	msg = pool->msgs[idx];
+	msgb_reset(msg);
+	INIT_LLIST_HEAD(&msg->list);
+	msg->cb[0] = (unsigned long) pool;
+	msg->cb[1] = idx;
+	talloc_set_name_const(msg, name);
+
+	return msg;
+}
+
+struct llist_head *ale_pool_list(void)
+{
+	return &pools;
+}
+
+void ale_pool_report(FILE *f)
+{
+	struct ale_pool *pool;
+
+	fprintf(f, "frame pools:\n");
+	llist_for_each_entry(pool, &pools, list) {
+		struct ale_pool_stats *ps = &pool->stats;
+
+		fprintf(f, "  %-12s %4u x %5zu bytes, %u in use (peak %u), %lu gets, %lu misses\n",
+			pool->name, pool->count, pool->size, atomic_load(&ps->in_use),
+			atomic_load(&ps->peak), atomic_load(&ps->gets), atomic_load(&ps->misses));
+	}
+}
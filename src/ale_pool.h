@@ -0,0 +1,103 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_pool.h
+ * @author agent
+ * @brief Preallocated frame pools
+ *
+ * Fixed size objects allocated once at startup, so that nothing on the
+ * frame path (modem sample buffers, msgbs to the host sockets) goes to
+ * malloc while a link is up. The free objects sit on a lock-free stack
+ * (tagged head against ABA), so any thread may take and return them.
+ *
+ * Pooled msgbs are plain talloc msgbs with a destructor that puts them
+ * back on the free list: whoever sends them frees them with msgb_free() as
+ * usual. An empty pool falls back to a normal allocation, which is
+ * counted as a miss: a steady state has no misses.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/msgb.h>
+
+struct ale_pool_stats {
+	atomic_ulong gets;
+	atomic_ulong misses;		// pool empty, allocated instead
+	atomic_uint in_use;
+	atomic_uint peak;
+};
+
+struct ale_pool {
+	struct llist_head list;
+	const char *name;
+	size_t size;			// object size, data room of msgb pools
+	unsigned int count;
+	bool closing;
+
+	uint8_t *slab;			// block pools: the objects back to back
+	struct msgb **msgs;		// msgb pools: index -> msgb
+
+	/* free list: links and top hold index + 1, the top has a tag in the
+	 * upper half that changes with every update */
+	_Atomic uint32_t *next;
+	_Atomic uint64_t head;
+
+	struct ale_pool_stats stats;
+};
+
+/* Pool of count blocks of size bytes */
+struct ale_pool *ale_pool_alloc(void *ctx, const char *name, size_t size, unsigned int count);
+
+/* Pool of count msgbs with size bytes of data room */
+struct ale_pool *ale_msgb_pool_alloc(void *ctx, const char *name, size_t size, unsigned int count);
+
+/* Frees the pool and its objects, none may be in use (freeing the talloc
+ * parent does the same) */
+void ale_pool_free(struct ale_pool *pool);
+
+/* A block, malloc'ed if the pool is empty. NULL only on malloc failure */
+void *ale_pool_get(struct ale_pool *pool);
+
+/* Returns a block from ale_pool_get() */
+void ale_pool_put(struct ale_pool *pool, void *obj);
+
+/* A reset msgb, allocated if the pool is empty; release it with msgb_free() */
+struct msgb *ale_msgb_get(struct ale_pool *pool, const char *name);
+
+/* Same from the pool only, NULL once it is empty: the pool size bounds
+ * what a sender may queue */
+struct msgb *ale_msgb_take(struct ale_pool *pool, const char *name);
+
+/* All pools, for the VTY */
+struct llist_head *ale_pool_list(void);
+
+/* One line per pool, next to the talloc report */
+void ale_pool_report(FILE *f);
@@ -0,0 +1,62 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_probe.h
+ * @author agent
+ * @brief USDT probes of the data path
+ *
+ * Static probes for perf / bpftrace under the provider rhizo_ale, built
+ * when sys/sdt.h (systemtap-sdt-dev) is found. A probe site is a single
+ * nop until a tracer attaches, and its arguments are operands the code
+ * at the site has at hand anyway (fields read under the ring lock, not
+ * computed), so the disabled cost is that nop.
+ *
+ *  ring__put / ring__get   (cbuf, len, head, tail, max, full)
+ *                          occupancy = full ? max : (head - tail + max) % max
+ *  shm__attach             (key, size, addr)
+ *  shm__detach             (key, size, addr)
+ *  fsm__state              (old, new, old name, new name)
+ *  modem__sync             (mode, sync)
+ *  modem__decode           (mode, SNR in 0.1 dB, CRC ok)
+ *
+ * List them with: bpftrace -l 'usdt:/usr/bin/rhizo-ale:rhizo_ale:*' (perf:
+ * perf buildid-cache --add, then perf list sdt_rhizo_ale)
+ * Examples are in contrib/bpftrace.
+ *
+ */
+
+#pragma once
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define ALE_PROBE2(name, a, b) DTRACE_PROBE2(rhizo_ale, name, a, b)
+#define ALE_PROBE3(name, a, b, c) DTRACE_PROBE3(rhizo_ale, name, a, b, c)
+#define ALE_PROBE4(name, a, b, c, d) DTRACE_PROBE4(rhizo_ale, name, a, b, c, d)
+#define ALE_PROBE6(name, a, b, c, d, e, f) DTRACE_PROBE6(rhizo_ale, name, a, b, c, d, e, f)
+#else
+#define ALE_PROBE2(name, a, b) do {} while (0)
+#define ALE_PROBE3(name, a, b, c) do {} while (0)
+#define ALE_PROBE4(name, a, b, c, d) do {} while (0)
+#define ALE_PROBE6(name, a, b, c, d, e, f) do {} while (0)
+#endif
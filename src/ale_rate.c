@@ -0,0 +1,189 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_rate.c
+ * @author agent
+ * @brief Speed level (gear-shift) controller
+ *
+ */
+
+#include <string.h>
+
+#include "ale_rate.h"
+
+const char *ale_rate_reason_names[_NUM_RATE_REASONS] = {
+    [RATE_HOLD] = "hold",
+    [RATE_UP] = "up",
+    [RATE_DOWN_SNR] = "down-snr",
+    [RATE_DOWN_FER] = "down-fer",
+    [RATE_DOWN_RETRY] = "down-retry",
+};
+
+// Private functions
+
+static float ewma(float est, float sample)
+{
+    return est + RATE_ALPHA * (sample - est);
+}
+
+static int level_step(enum ale_mode_id level, int dir)
+{
+    for (int id = level + dir; id >= 0 && id < _NUM_ALE_MODES; id += dir)
+    {
+        const struct ale_mode *mode = ale_mode_get(id);
+
+        if (mode->data && ale_mode_usable(mode))
+            return id;
+    }
+
+    return -1;
+}
+
+static enum ale_rate_reason decide(struct ale_rate *rate)
+{
+    const struct ale_mode *cur = ale_mode_get(rate->level);
+    int up = level_step(rate->level, 1);
+    int down = level_step(rate->level, -1);
+
+    if (down >= 0)
+    {
+        if (rate->snr_valid && rate->snr_db < cur->min_snr_db + RATE_DOWN_MARGIN_DB)
+            return RATE_DOWN_SNR;
+        if (rate->fer > RATE_MIN_ERR_DOWN)
+            return RATE_DOWN_FER;
+        if (rate->retry > RATE_MIN_ERR_DOWN)
+            return RATE_DOWN_RETRY;
+    }
+
+    if (up >= 0 && rate->snr_valid &&
+        rate->snr_db > ale_mode_get(up)->min_snr_db + RATE_UP_MARGIN_DB &&
+        rate->fer < RATE_MAX_ERR_UP && rate->retry < RATE_MAX_ERR_UP)
+    {
+        if (++rate->good_turns >= RATE_UP_TURNS)
+            return RATE_UP;
+        return RATE_HOLD;
+    }
+
+    rate->good_turns = 0;
+    return RATE_HOLD;
+}
+
+// User APIs
+
+void ale_rate_init(struct ale_rate *rate, enum ale_mode_id level, bool enabled)
+{
+    memset(rate, 0, sizeof(*rate));
+    rate->enabled = enabled;
+    rate->level = level;
+}
+
+void ale_rate_reset(struct ale_rate *rate)
+{
+    rate->snr_valid = false;
+    rate->snr_db = 0;
+    rate->rx_snr_valid = false;
+    rate->rx_snr_db = 0;
+    rate->fer = 0;
+    rate->retry = 0;
+    rate->good_turns = 0;
+    rate->last_tx_frames = 0;
+    rate->last_tx_retransmissions = 0;
+    rate->last_snr_reports = 0;
+}
+
+void ale_rate_rx_frame(struct ale_rate *rate, float snr_db, bool ok)
+{
+    rate->stats.rx_frames++;
+    if (!ok)
+        rate->stats.rx_errors++;
+
+    if (!rate->rx_snr_valid)
+    {
+        rate->rx_snr_db = snr_db;
+        rate->rx_snr_valid = true;
+    }
+    else
+    {
+        rate->rx_snr_db = ewma(rate->rx_snr_db, snr_db);
+    }
+
+    rate->fer = ewma(rate->fer, ok ? 0.0f : 1.0f);
+}
+
+const struct ale_mode *ale_rate_turn(struct ale_rate *rate, const struct ale_arq_stats *arq)
+{
+    unsigned long frames = arq->tx_frames - rate->last_tx_frames;
+    unsigned long retx = arq->tx_retransmissions - rate->last_tx_retransmissions;
+
+    rate->last_tx_frames = arq->tx_frames;
+    rate->last_tx_retransmissions = arq->tx_retransmissions;
+
+    // the modem rejected it, the nearest level it has
+    if (!ale_mode_usable(ale_mode_get(rate->level)))
+    {
+        int id = level_step(rate->level, -1);
+
+        if (id < 0)
+            id = level_step(rate->level, 1);
+        if (id >= 0)
+            rate->level = id;
+    }
+    rate->stats.turns_at[rate->level]++;
+
+    if (frames)
+        rate->retry = ewma(rate->retry, (float) retx / frames);
+
+    // already smoothed by the peer
+    if (arq->rx_snr_reports != rate->last_snr_reports)
+    {
+        rate->snr_db = arq->peer_snr_db;
+        rate->snr_valid = true;
+        rate->last_snr_reports = arq->rx_snr_reports;
+    }
+
+    if (!rate->enabled)
+        return ale_mode_get(rate->level);
+
+    rate->last = decide(rate);
+    rate->stats.decisions[rate->last]++;
+
+    switch (rate->last) {
+    case RATE_UP:
+        rate->level = level_step(rate->level, 1);
+        rate->good_turns = 0;
+        break;
+    case RATE_DOWN_SNR:
+    case RATE_DOWN_FER:
+    case RATE_DOWN_RETRY:
+        rate->level = level_step(rate->level, -1);
+        rate->good_turns = 0;
+        // estimates of the old level say little about the new one
+        rate->fer = 0;
+        rate->retry = 0;
+        break;
+    default:
+        break;
+    }
+
+    return ale_mode_get(rate->level);
+}
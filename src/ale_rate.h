@@ -0,0 +1,102 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_rate.h
+ * @author agent
+ * @brief Speed level (gear-shift) controller
+ *
+ * Keeps exponentially decaying estimates of the SNR and frame error rate
+ * of the received frames and of the retransmission ratio of our turns,
+ * and moves the data mode one level up or down at each turnover. The SNR
+ * the level goes on is the one the peer reports in its acknowledgements:
+ * ours only tells how the peer is heard, and is what we report to it. Going
+ * up needs a margin over the next level threshold during several turns,
+ * going down is immediate, so the level does not flap.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "ale_mode.h"
+#include "ale_arq.h"
+
+#define RATE_ALPHA 0.25f            // weight of a new sample
+#define RATE_UP_MARGIN_DB 3.0f      // over the next level min_snr_db
+#define RATE_DOWN_MARGIN_DB -1.0f   // under the current level min_snr_db
+#define RATE_UP_TURNS 2             // good turns in a row to go up
+#define RATE_MAX_ERR_UP 0.1f        // max fer/retry ratio to go up
+#define RATE_MIN_ERR_DOWN 0.5f      // fer/retry ratio forcing a level down
+
+enum ale_rate_reason {
+    RATE_HOLD,
+    RATE_UP,
+    RATE_DOWN_SNR,
+    RATE_DOWN_FER,
+    RATE_DOWN_RETRY,
+    _NUM_RATE_REASONS
+};
+
+struct ale_rate_stats {
+    unsigned long decisions[_NUM_RATE_REASONS];
+    unsigned long turns_at[_NUM_ALE_MODES];
+    unsigned long rx_frames;
+    unsigned long rx_errors;
+};
+
+struct ale_rate {
+    bool enabled;
+    enum ale_mode_id level;
+    enum ale_rate_reason last;
+
+    // estimates
+    bool snr_valid;
+    float snr_db;               // of our frames at the peer, as reported
+    bool rx_snr_valid;
+    float rx_snr_db;            // of the peer frames here
+    float fer;
+    float retry;
+
+    unsigned int good_turns;
+    unsigned long last_tx_frames;
+    unsigned long last_tx_retransmissions;
+    unsigned long last_snr_reports;
+
+    struct ale_rate_stats stats;
+};
+
+extern const char *ale_rate_reason_names[_NUM_RATE_REASONS];
+
+void ale_rate_init(struct ale_rate *rate, enum ale_mode_id level, bool enabled);
+
+/// New session: estimates are cleared, the level is kept
+void ale_rate_reset(struct ale_rate *rate);
+
+/// Feeds a received frame (ok) or a frame that synced but failed CRC, for
+/// the SNR reported back to the peer and the frame error rate
+void ale_rate_rx_frame(struct ale_rate *rate, float snr_db, bool ok);
+
+/// Called at each turnover with the ARQ counters and the last SNR the peer
+/// reported, returns the data mode of the next turn
+const struct ale_mode *ale_rate_turn(struct ale_rate *rate, const struct ale_arq_stats *arq);
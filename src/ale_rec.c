@@ -0,0 +1,512 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_rec.c
+ * @author agent
+ * @brief Recorder of the received audio
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "ale_rec.h"
+
+#define REC_IDLE_US 20000
+
+struct rec_msg {
+    uint16_t type;
+    uint16_t a;
+    int32_t b;
+    int64_t ts_ns;
+};
+
+struct ale_rec_file {
+    char name[64];              // without the extension
+    uint64_t first_pos;
+    uint64_t end_pos;
+    bool kept;
+};
+
+static const char *type_names[_NUM_REC_TYPES] = {
+    [REC_AUDIO] = "audio",
+    [REC_CHUNK] = "chunk",
+    [REC_SYNC] = "sync",
+    [REC_FRAME] = "frame",
+    [REC_CRC] = "crc-error",
+    [REC_FREQ] = "frequency",
+    [REC_KEEP] = "keep",
+};
+
+// Private functions
+
+static int64_t realtime_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void stat_inc(_Atomic unsigned long *ctr)
+{
+    atomic_fetch_add_explicit(ctr, 1, memory_order_relaxed);
+}
+
+static void idx_flush(struct ale_rec *rec)
+{
+    size_t len = rec->idx_len * sizeof(rec->idx_buf[0]);
+
+    if (rec->idx_fd >= 0 && len && write(rec->idx_fd, rec->idx_buf, len) != (ssize_t) len)
+        stat_inc(&rec->stats.errors);
+    rec->idx_len = 0;
+}
+
+static void idx_add(struct ale_rec *rec, int64_t ts_ns, uint16_t type, uint16_t a, int32_t b)
+{
+    struct ale_rec_idx *idx;
+
+    if (rec->idx_len == sizeof(rec->idx_buf) / sizeof(rec->idx_buf[0]))
+        idx_flush(rec);
+
+    idx = &rec->idx_buf[rec->idx_len++];
+    memset(idx, 0, sizeof(*idx));
+    idx->ts_ns = ts_ns;
+    idx->pos = rec->pos;
+    idx->freq_hz = rec->chunk_freq;
+    idx->type = type;
+    idx->a = a;
+    idx->b = b;
+}
+
+static void file_path(struct ale_rec *rec, char *path, size_t size, const char *prefix,
+                      const char *name, const char *ext)
+{
+    snprintf(path, size, "%s/%s%s.%s", rec->cfg.dir, prefix, name, ext);
+}
+
+static void file_keep(struct ale_rec *rec, struct ale_rec_file *f)
+{
+    static const char *exts[] = { "rec", "idx" };
+
+    if (f->kept)
+        return;
+
+    for (int i = 0; i < 2; i++)
+    {
+        char path[ALE_REC_PATH_LEN + 80], keep[ALE_REC_PATH_LEN + 80];
+
+        file_path(rec, path, sizeof(path), "", f->name, exts[i]);
+        file_path(rec, keep, sizeof(keep), "keep-", f->name, exts[i]);
+        if (link(path, keep) < 0 && errno != EEXIST)
+            stat_inc(&rec->stats.errors);
+    }
+    f->kept = true;
+    stat_inc(&rec->stats.kept);
+}
+
+static void file_remove(struct ale_rec *rec, struct ale_rec_file *f)
+{
+    char path[ALE_REC_PATH_LEN + 80];
+
+    file_path(rec, path, sizeof(path), "", f->name, "rec");
+    unlink(path);
+    file_path(rec, path, sizeof(path), "", f->name, "idx");
+    unlink(path);
+}
+
+static void file_close(struct ale_rec *rec)
+{
+    struct ale_rec_file *f = rec->cur;
+    char path[ALE_REC_PATH_LEN + 80];
+    size_t used;
+
+    if (!f)
+        return;
+
+    idx_flush(rec);
+    close(rec->idx_fd);
+    rec->idx_fd = -1;
+
+    // the unused preallocated chunks go
+    used = sizeof(struct ale_rec_file_hdr) + (size_t) rec->chunk_no *
+        (sizeof(struct ale_rec_chunk) + rec->cfg.chunk_samples * sizeof(int16_t));
+    munmap(rec->map, rec->map_size);
+    rec->map = NULL;
+    rec->chunk = NULL;
+    file_path(rec, path, sizeof(path), "", f->name, "rec");
+    if (truncate(path, used) < 0)
+        stat_inc(&rec->stats.errors);
+
+    f->end_pos = rec->pos;
+    if (f->first_pos < rec->keep_until)
+        file_keep(rec, f);
+    rec->cur = NULL;
+}
+
+static int file_open(struct ale_rec *rec, int64_t ts_ns)
+{
+    size_t chunk_size = sizeof(struct ale_rec_chunk) + rec->cfg.chunk_samples * sizeof(int16_t);
+    char path[ALE_REC_PATH_LEN + 80];
+    struct ale_rec_file_hdr *hdr;
+    struct ale_rec_file *f;
+    time_t secs = ts_ns / 1000000000;
+    struct tm tm;
+    char stamp[32];
+    int fd, rc;
+
+    // the oldest goes, its "keep-" links stay
+    if (rec->files_count == rec->cfg.files)
+    {
+        file_remove(rec, &rec->files[rec->files_head]);
+        rec->files_head = (rec->files_head + 1) % rec->cfg.files;
+        rec->files_count--;
+    }
+    f = &rec->files[(rec->files_head + rec->files_count) % rec->cfg.files];
+    memset(f, 0, sizeof(*f));
+    gmtime_r(&secs, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    snprintf(f->name, sizeof(f->name), "rx-%s-%lu", stamp,
+             atomic_load_explicit(&rec->stats.files, memory_order_relaxed));
+    f->first_pos = rec->pos;
+
+    rec->file_chunks = ((size_t) rec->cfg.file_mb << 20) / chunk_size;
+    if (!rec->file_chunks)
+        rec->file_chunks = 1;
+    rec->map_size = sizeof(*hdr) + rec->file_chunks * chunk_size;
+
+    file_path(rec, path, sizeof(path), "", f->name, "rec");
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+    // blocks now instead of at a page fault later
+    rc = posix_fallocate(fd, 0, rec->map_size);
+    if (rc)
+    {
+        close(fd);
+        unlink(path);
+        errno = rc;
+        return -1;
+    }
+    rec->map = mmap(NULL, rec->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (rec->map == MAP_FAILED)
+    {
+        rec->map = NULL;
+        unlink(path);
+        return -1;
+    }
+
+    file_path(rec, path, sizeof(path), "", f->name, "idx");
+    rec->idx_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (rec->idx_fd < 0)
+        stat_inc(&rec->stats.errors);
+
+    hdr = (struct ale_rec_file_hdr *) rec->map;
+    memcpy(hdr->magic, ALE_REC_MAGIC, sizeof(hdr->magic));
+    hdr->version = ALE_REC_VERSION;
+    hdr->rate = rec->rate;
+    hdr->chunk_samples = rec->cfg.chunk_samples;
+    hdr->chunks = 0;
+
+    rec->cur = f;
+    rec->files_count++;
+    rec->chunk_no = 0;
+    rec->chunk = NULL;
+    rec->file_start_ns = ts_ns;
+    stat_inc(&rec->stats.files);
+
+    return 0;
+}
+
+/// Starts a chunk at the current position, in a new file if needed
+static int chunk_open(struct ale_rec *rec, int64_t ts_ns, uint32_t dropped)
+{
+    size_t chunk_size = sizeof(struct ale_rec_chunk) + rec->cfg.chunk_samples * sizeof(int16_t);
+
+    if (rec->cur && (rec->chunk_no == rec->file_chunks ||
+                     ts_ns - rec->file_start_ns >= (int64_t) rec->cfg.file_secs * 1000000000))
+        file_close(rec);
+    if (!rec->cur && file_open(rec, ts_ns) < 0)
+    {
+        stat_inc(&rec->stats.errors);
+        return -1;
+    }
+
+    rec->chunk_freq = atomic_load_explicit(&rec->freq_hz, memory_order_relaxed);
+    rec->chunk = (struct ale_rec_chunk *) (rec->map + sizeof(struct ale_rec_file_hdr) +
+                                           rec->chunk_no * chunk_size);
+    rec->chunk->ts_ns = ts_ns;
+    rec->chunk->pos = rec->pos;
+    rec->chunk->freq_hz = rec->chunk_freq;
+    rec->chunk->samples = 0;
+    ((struct ale_rec_file_hdr *) rec->map)->chunks = ++rec->chunk_no;
+    idx_add(rec, ts_ns, REC_CHUNK, rec->chunk_no - 1, dropped);
+    stat_inc(&rec->stats.chunks);
+
+    return 0;
+}
+
+static void rec_samples(struct ale_rec *rec, int64_t ts_ns, const int16_t *samples, size_t n)
+{
+    uint32_t freq = atomic_load_explicit(&rec->freq_hz, memory_order_relaxed);
+
+    // one frequency per chunk
+    if (rec->chunk && freq != rec->chunk_freq)
+    {
+        rec->chunk = NULL;
+        rec->chunk_freq = freq;
+        idx_add(rec, ts_ns, REC_FREQ, 0, freq);
+    }
+
+    while (n)
+    {
+        size_t part;
+
+        if (!rec->chunk || rec->chunk->samples == rec->cfg.chunk_samples)
+        {
+            if (chunk_open(rec, ts_ns, 0) < 0)
+            {
+                // lost, but the positions stay right
+                rec->pos += n;
+                return;
+            }
+        }
+
+        part = rec->cfg.chunk_samples - rec->chunk->samples;
+        if (part > n)
+            part = n;
+        memcpy((int16_t *) (rec->chunk + 1) + rec->chunk->samples, samples, part * sizeof(int16_t));
+        rec->chunk->samples += part;
+        rec->pos += part;
+        samples += part;
+        n -= part;
+        ts_ns += (int64_t) part * 1000000000 / rec->rate;
+        atomic_fetch_add_explicit(&rec->stats.samples, part, memory_order_relaxed);
+    }
+}
+
+static void rec_keep(struct ale_rec *rec, unsigned int secs)
+{
+    uint64_t span = (uint64_t) secs * rec->rate;
+    uint64_t from = rec->pos > span ? rec->pos - span : 0;
+
+    idx_add(rec, realtime_ns(), REC_KEEP, secs, 0);
+    if (rec->pos + span > rec->keep_until)
+        rec->keep_until = rec->pos + span;
+
+    // the closed files of the seconds before, the current one when closed
+    for (unsigned int i = 0; i < rec->files_count; i++)
+    {
+        struct ale_rec_file *f = &rec->files[(rec->files_head + i) % rec->cfg.files];
+
+        if (f != rec->cur && f->end_pos > from)
+            file_keep(rec, f);
+    }
+}
+
+static void *rec_thread(void *arg)
+{
+    struct ale_rec *rec = arg;
+    uint8_t buf[sizeof(struct rec_msg) + ALE_REC_MAX_BLOCK * sizeof(int16_t)];
+    struct rec_msg *msg = (struct rec_msg *) buf;
+
+    while (1)
+    {
+        unsigned int keep = atomic_exchange(&rec->keep_req, 0);
+        int len;
+
+        if (keep)
+            rec_keep(rec, keep);
+
+        len = circular_buf_get_record(rec->tee, buf, sizeof(buf));
+        if (len < (int) sizeof(*msg))
+        {
+            if (!atomic_load(&rec->running))
+                break;
+            idx_flush(rec);
+            usleep(REC_IDLE_US);
+            continue;
+        }
+
+        switch (msg->type)
+        {
+        case REC_AUDIO:
+            // a gap in the stream starts a new chunk
+            if (msg->b)
+            {
+                rec->pos += msg->b;
+                rec->chunk = NULL;
+                atomic_fetch_add_explicit(&rec->stats.dropped, msg->b, memory_order_relaxed);
+                if (chunk_open(rec, msg->ts_ns, msg->b) < 0)
+                    break;
+            }
+            rec_samples(rec, msg->ts_ns, (const int16_t *) (msg + 1),
+                        (len - sizeof(*msg)) / sizeof(int16_t));
+            break;
+        default:
+            idx_add(rec, msg->ts_ns, msg->type, msg->a, msg->b);
+            break;
+        }
+    }
+
+    file_close(rec);
+    return NULL;
+}
+
+static int tee_put(struct ale_rec *rec, const struct rec_msg *msg, const int16_t *samples, size_t n)
+{
+    uint8_t buf[sizeof(*msg) + ALE_REC_MAX_BLOCK * sizeof(int16_t)];
+
+    memcpy(buf, msg, sizeof(*msg));
+    if (n)
+        memcpy(buf + sizeof(*msg), samples, n * sizeof(int16_t));
+    return circular_buf_put_record(rec->tee, buf, sizeof(*msg) + n * sizeof(int16_t));
+}
+
+// User APIs
+
+struct ale_rec *ale_rec_alloc(unsigned int rate)
+{
+    struct ale_rec *rec = calloc(1, sizeof(*rec));
+
+    if (!rec)
+        return NULL;
+
+    rec->tee = circular_buf_init(malloc(ALE_REC_TEE_SIZE), ALE_REC_TEE_SIZE);
+    rec->rate = rate;
+    rec->idx_fd = -1;
+    rec->cfg.file_secs = ALE_REC_DEFAULT_FILE_SECS;
+    rec->cfg.file_mb = ALE_REC_DEFAULT_FILE_MB;
+    rec->cfg.files = ALE_REC_DEFAULT_FILES;
+    rec->cfg.keep_secs = ALE_REC_DEFAULT_KEEP_SECS;
+    rec->cfg.chunk_samples = rate;
+
+    return rec;
+}
+
+void ale_rec_free(struct ale_rec *rec)
+{
+    ale_rec_stop(rec);
+    free(rec->tee->buffer);
+    circular_buf_free(rec->tee);
+    free(rec->files);
+    free(rec);
+}
+
+int ale_rec_start(struct ale_rec *rec)
+{
+    if (atomic_load(&rec->running))
+        return 0;
+    if (!rec->cfg.dir[0] || rec->cfg.files < 2 || !rec->cfg.chunk_samples)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    free(rec->files);
+    rec->files = calloc(rec->cfg.files, sizeof(*rec->files));
+    if (!rec->files)
+        return -1;
+    rec->files_head = rec->files_count = 0;
+    rec->keep_until = 0;
+
+    atomic_store(&rec->running, true);
+    if (pthread_create(&rec->thread, NULL, rec_thread, rec))
+    {
+        atomic_store(&rec->running, false);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    return 0;
+}
+
+void ale_rec_stop(struct ale_rec *rec)
+{
+    if (!atomic_exchange(&rec->running, false))
+        return;
+    pthread_join(rec->thread, NULL);
+}
+
+bool ale_rec_running(struct ale_rec *rec)
+{
+    return atomic_load(&rec->running);
+}
+
+void ale_rec_audio(struct ale_rec *rec, const int16_t *samples, size_t n)
+{
+    struct rec_msg msg = { .type = REC_AUDIO };
+
+    if (!atomic_load_explicit(&rec->running, memory_order_relaxed))
+        return;
+
+    msg.ts_ns = realtime_ns();
+    while (n)
+    {
+        size_t part = n < ALE_REC_MAX_BLOCK ? n : ALE_REC_MAX_BLOCK;
+
+        // the gap before goes with the next samples that fit
+        msg.b = rec->dropped;
+        if (tee_put(rec, &msg, samples, part) < 0)
+            rec->dropped += part;
+        else
+            rec->dropped = 0;
+
+        samples += part;
+        n -= part;
+        msg.ts_ns += (int64_t) part * 1000000000 / rec->rate;
+    }
+}
+
+void ale_rec_event(struct ale_rec *rec, enum ale_rec_type type, uint16_t a, int32_t b)
+{
+    struct rec_msg msg = { .type = type, .a = a, .b = b };
+
+    if (!atomic_load_explicit(&rec->running, memory_order_relaxed))
+        return;
+
+    msg.ts_ns = realtime_ns();
+    tee_put(rec, &msg, NULL, 0);
+}
+
+void ale_rec_set_freq(struct ale_rec *rec, uint32_t hz)
+{
+    atomic_store_explicit(&rec->freq_hz, hz, memory_order_relaxed);
+}
+
+void ale_rec_keep(struct ale_rec *rec, unsigned int secs)
+{
+    atomic_store(&rec->keep_req, secs ? secs : rec->cfg.keep_secs);
+}
+
+const char *ale_rec_type_name(enum ale_rec_type type)
+{
+    return type < _NUM_REC_TYPES ? type_names[type] : "?";
+}
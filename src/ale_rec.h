@@ -0,0 +1,190 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_rec.h
+ * @author agent
+ * @brief Recorder of the received audio
+ *
+ * The modem thread hands every block it reads from the RX audio ring, and
+ * its sync and decode events, to ale_rec_audio() / ale_rec_event(): a copy
+ * into an in-memory ring of records and nothing else, dropping (and
+ * counting) when the recorder lags behind. A reader cursor on the RX audio
+ * ring itself would hold the ring back for the audio client instead.
+ *
+ * The recorder thread writes the audio into preallocated, memory-mapped
+ * recording files of fixed size chunks, each chunk stamped with the wall
+ * clock, the stream position and the radio frequency of its first sample.
+ * Next to each recording file an index file lists the chunks and events
+ * with the same stamps, so a decode failure is found without scanning the
+ * audio. Files are rotated by size or age, the last few are kept.
+ *
+ * ale_rec_keep() (VTY "recorder keep") marks an event and keeps the files
+ * covering the seconds before and after it: they get a hard link with the
+ * "keep-" prefix, which the rotation does not remove.
+ *
+ * Recording file layout: struct ale_rec_file_hdr, then chunks of struct
+ * ale_rec_chunk followed by chunk_samples 16 bit samples. Index file: a
+ * sequence of struct ale_rec_idx.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "ale_buf.h"
+
+#define ALE_REC_MAGIC "ALERECA"
+#define ALE_REC_VERSION 1
+#define ALE_REC_TEE_SIZE (64 * 1024)    // 4 s of 8 kHz audio
+#define ALE_REC_MAX_BLOCK 512           // samples per ale_rec_audio() record
+#define ALE_REC_PATH_LEN 256
+
+#define ALE_REC_DEFAULT_FILE_SECS 600
+#define ALE_REC_DEFAULT_FILE_MB 16
+#define ALE_REC_DEFAULT_FILES 12
+#define ALE_REC_DEFAULT_KEEP_SECS 30
+
+enum ale_rec_type {
+    REC_AUDIO,                  // (tee only) the samples follow
+    REC_CHUNK,                  // a: chunk in the file, b: samples dropped before
+    REC_SYNC,                   // a: mode, b: 1 in sync, 0 lost
+    REC_FRAME,                  // a: mode, b: SNR in 0.1 dB
+    REC_CRC,                    // a: mode, b: SNR in 0.1 dB
+    REC_FREQ,                   // b: Hz
+    REC_KEEP,                   // a: seconds before and after
+    _NUM_REC_TYPES
+};
+
+struct ale_rec_file_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t rate;
+    uint32_t chunk_samples;
+    uint32_t chunks;            // complete or being written
+};
+
+struct ale_rec_chunk {
+    int64_t ts_ns;              // CLOCK_REALTIME of the first sample
+    uint64_t pos;               // stream position of the first sample
+    uint32_t freq_hz;           // 0: unknown
+    uint32_t samples;           // written so far
+};
+
+struct ale_rec_idx {
+    int64_t ts_ns;
+    uint64_t pos;
+    uint32_t freq_hz;
+    uint16_t type;
+    uint16_t a;
+    int32_t b;
+    uint32_t reserved;
+};
+
+struct ale_rec_cfg {
+    char dir[ALE_REC_PATH_LEN]; // empty: recorder off
+    unsigned int file_secs;     // rotation by age
+    unsigned int file_mb;       // rotation by size
+    unsigned int files;         // recording files kept, "keep-" ones aside
+    unsigned int keep_secs;     // ale_rec_keep() default
+    unsigned int chunk_samples;
+};
+
+struct ale_rec_stats {
+    _Atomic uint64_t samples;   // written to files
+    _Atomic uint64_t dropped;   // the recorder lagged behind
+    _Atomic unsigned long chunks;
+    _Atomic unsigned long files;
+    _Atomic unsigned long kept;
+    _Atomic unsigned long errors;
+};
+
+struct ale_rec_file;
+
+struct ale_rec {
+    struct ale_rec_cfg cfg;     // read by ale_rec_start()
+    unsigned int rate;
+
+    // producer side, one thread
+    cbuf_handle_t tee;
+    uint64_t dropped;           // not reported in the tee yet
+
+    _Atomic uint32_t freq_hz;
+    _Atomic unsigned int keep_req;  // seconds, 0: none
+    _Atomic bool running;
+    pthread_t thread;
+
+    // recorder thread
+    uint64_t pos;               // stream position of the next sample
+    struct ale_rec_file *files; // cfg.files, oldest at files_head
+    unsigned int files_head;
+    unsigned int files_count;
+    struct ale_rec_file *cur;
+    uint8_t *map;
+    size_t map_size;
+    struct ale_rec_chunk *chunk;
+    unsigned int chunk_no;
+    unsigned int file_chunks;
+    int64_t file_start_ns;
+    int idx_fd;
+    struct ale_rec_idx idx_buf[64];
+    unsigned int idx_len;
+    uint64_t keep_until;        // stream position
+    uint32_t chunk_freq;
+
+    struct ale_rec_stats stats;
+};
+
+/// Creates a stopped recorder of rate Hz audio, with the default config
+struct ale_rec *ale_rec_alloc(unsigned int rate);
+
+void ale_rec_free(struct ale_rec *rec);
+
+/// Starts the recorder thread with rec->cfg
+/// Returns 0 on success, -1 with errno set on error
+int ale_rec_start(struct ale_rec *rec);
+
+/// Stops the recorder thread, after it wrote what was handed over
+void ale_rec_stop(struct ale_rec *rec);
+
+bool ale_rec_running(struct ale_rec *rec);
+
+/// Hands n received samples to the recorder, never blocks
+/// Requires: a single producer thread, also for ale_rec_event()
+void ale_rec_audio(struct ale_rec *rec, const int16_t *samples, size_t n);
+
+/// Puts an event in the index, at the position after the last samples
+void ale_rec_event(struct ale_rec *rec, enum ale_rec_type type, uint16_t a, int32_t b);
+
+/// Radio frequency of the samples from now on, from any thread
+void ale_rec_set_freq(struct ale_rec *rec, uint32_t hz);
+
+/// Keeps the files covering secs seconds (0: cfg.keep_secs) before and
+/// after now, from any thread
+void ale_rec_keep(struct ale_rec *rec, unsigned int secs);
+
+/// Name of an index type
+const char *ale_rec_type_name(enum ale_rec_type type);
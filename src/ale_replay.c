@@ -0,0 +1,232 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_replay.c
+ * @author agent
+ * @brief Replay of recorded RX audio
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ale_replay.h"
+
+#define REPLAY_BLOCK 160        // samples, 20 ms at 8 kHz
+#define REPLAY_IDLE_US 2000
+
+// Private functions
+
+static int64_t clock_ns(clockid_t clk)
+{
+    struct timespec ts;
+
+    clock_gettime(clk, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const struct ale_rec_chunk *chunk_get(struct ale_replay *rp, unsigned int n)
+{
+    return (const struct ale_rec_chunk *) (rp->map + sizeof(*rp->hdr) + n * rp->chunk_size);
+}
+
+static void wait_room(struct ale_replay *rp, cbuf_handle_t ring, size_t len)
+{
+    while (circular_buf_free_size(ring) < len && !atomic_load_explicit(&rp->stop, memory_order_relaxed))
+    {
+        if (rp->idle)
+            rp->idle(rp->arg);
+        usleep(REPLAY_IDLE_US);
+    }
+}
+
+// sample at stream offset ts_ns (from the first chunk) is due
+static void wait_due(struct ale_replay *rp, int64_t start_ns, int64_t ts_ns)
+{
+    int64_t due = start_ns + (int64_t) (ts_ns / rp->speed);
+    int64_t now;
+
+    while ((now = clock_ns(CLOCK_MONOTONIC)) < due && !atomic_load_explicit(&rp->stop, memory_order_relaxed))
+    {
+        if (rp->idle)
+            rp->idle(rp->arg);
+        usleep((due - now) / 1000 < REPLAY_IDLE_US ? (due - now) / 1000 : REPLAY_IDLE_US);
+    }
+}
+
+static void *replay_thread(void *arg)
+{
+    struct ale_replay *rp = arg;
+
+    ale_replay_run(rp, rp->ring);
+    ale_replay_close(rp);
+    atomic_store(&rp->busy, false);
+    return NULL;
+}
+
+// User APIs
+
+int ale_replay_open(struct ale_replay *rp, const char *path)
+{
+    struct stat sb;
+    int fd;
+
+    memset(&rp->stats, 0, sizeof(rp->stats));
+    atomic_store(&rp->stop, false);
+    rp->map = NULL;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &sb) < 0 || (size_t) sb.st_size < sizeof(*rp->hdr))
+    {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    rp->map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (rp->map == MAP_FAILED)
+    {
+        rp->map = NULL;
+        return -1;
+    }
+    rp->size = sb.st_size;
+    rp->hdr = (const struct ale_rec_file_hdr *) rp->map;
+    rp->chunk_size = sizeof(struct ale_rec_chunk) + rp->hdr->chunk_samples * sizeof(int16_t);
+
+    // a recording cut short by a crash has fewer chunks than announced
+    if (memcmp(rp->hdr->magic, ALE_REC_MAGIC, sizeof(rp->hdr->magic)) ||
+        rp->hdr->version != ALE_REC_VERSION || !rp->hdr->rate ||
+        sizeof(*rp->hdr) + rp->hdr->chunks * rp->chunk_size > rp->size)
+    {
+        ale_replay_close(rp);
+        errno = EINVAL;
+        return -1;
+    }
+    madvise(rp->map, rp->size, MADV_SEQUENTIAL);
+
+    return 0;
+}
+
+void ale_replay_close(struct ale_replay *rp)
+{
+    if (rp->map)
+        munmap(rp->map, rp->size);
+    rp->map = NULL;
+}
+
+double ale_replay_secs(struct ale_replay *rp)
+{
+    uint64_t samples = 0;
+
+    for (unsigned int i = 0; i < rp->hdr->chunks; i++)
+        samples += chunk_get(rp, i)->samples;
+
+    return (double) samples / rp->hdr->rate;
+}
+
+int ale_replay_run(struct ale_replay *rp, cbuf_handle_t ring)
+{
+    int64_t cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    int64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    int64_t first_ts = rp->hdr->chunks ? chunk_get(rp, 0)->ts_ns : 0;
+    uint64_t next_pos = rp->hdr->chunks ? chunk_get(rp, 0)->pos : 0;
+    uint32_t freq = 0;
+
+    for (unsigned int c = 0; c < rp->hdr->chunks; c++)
+    {
+        const struct ale_rec_chunk *chunk = chunk_get(rp, c);
+        const int16_t *samples = (const int16_t *) (chunk + 1);
+
+        if (chunk->pos != next_pos)
+            rp->stats.gaps++;
+        next_pos = chunk->pos + chunk->samples;
+        if (rp->freq && chunk->freq_hz != freq)
+            rp->freq(rp->arg, chunk->freq_hz);
+        freq = chunk->freq_hz;
+
+        for (uint32_t i = 0; i < chunk->samples; i += REPLAY_BLOCK)
+        {
+            size_t n = chunk->samples - i < REPLAY_BLOCK ? chunk->samples - i : REPLAY_BLOCK;
+
+            if (rp->speed > 0)
+                wait_due(rp, start_ns, chunk->ts_ns - first_ts +
+                         (int64_t) i * 1000000000 / rp->hdr->rate);
+            wait_room(rp, ring, n * sizeof(int16_t));
+            if (atomic_load_explicit(&rp->stop, memory_order_relaxed))
+            {
+                rp->stats.cpu_ns += clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+                return -1;
+            }
+            circular_buf_put_range(ring, (uint8_t *) (samples + i), n * sizeof(int16_t));
+            rp->stats.samples += n;
+        }
+        rp->stats.chunks++;
+    }
+
+    rp->stats.cpu_ns += clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    return 0;
+}
+
+int ale_replay_start(struct ale_replay *rp, const char *path, cbuf_handle_t ring)
+{
+    if (atomic_exchange(&rp->busy, true))
+    {
+        errno = EBUSY;
+        return -1;
+    }
+    if (ale_replay_open(rp, path) < 0)
+    {
+        atomic_store(&rp->busy, false);
+        return -1;
+    }
+    snprintf(rp->path, sizeof(rp->path), "%s", path);
+    rp->ring = ring;
+    if (pthread_create(&rp->thread, NULL, replay_thread, rp))
+    {
+        ale_replay_close(rp);
+        atomic_store(&rp->busy, false);
+        errno = EAGAIN;
+        return -1;
+    }
+    pthread_detach(rp->thread);
+
+    return 0;
+}
+
+void ale_replay_stop(struct ale_replay *rp)
+{
+    atomic_store(&rp->stop, true);
+}
+
+bool ale_replay_busy(struct ale_replay *rp)
+{
+    return atomic_load(&rp->busy);
+}
@@ -0,0 +1,99 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_replay.h
+ * @author agent
+ * @brief Replay of recorded RX audio
+ *
+ * Streams the chunks of an ale_rec recording file into an RX audio ring,
+ * in the place of the audio client: as fast as the ring takes them, or
+ * paced by the original chunk timestamps at a chosen speed-up. Gaps in the
+ * recording are not filled, the demodulator sees them spliced.
+ *
+ * The daemon replays into its live RX audio ring from the VTY
+ * ("replay FILE"); rhizo-ale-replay runs the modem and the FSM on batches
+ * of files, one process per core.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "ale_buf.h"
+#include "ale_rec.h"
+
+struct ale_replay_stats {
+    uint64_t samples;
+    unsigned long chunks;
+    unsigned long gaps;         // chunks not following the previous one
+    uint64_t cpu_ns;            // of the feeding thread
+};
+
+struct ale_replay {
+    uint8_t *map;
+    size_t size;
+    const struct ale_rec_file_hdr *hdr;
+    size_t chunk_size;
+
+    double speed;               // 0: as fast as the ring takes it
+    _Atomic bool stop;
+    void (*idle)(void *arg);    // called while waiting for room, or NULL
+    void *arg;
+    void (*freq)(void *arg, uint32_t hz);   // chunk frequency changed, or NULL
+
+    // ale_replay_start()
+    char path[256];
+    cbuf_handle_t ring;
+    _Atomic bool busy;
+    pthread_t thread;
+
+    struct ale_replay_stats stats;
+};
+
+/// Maps a recording file and checks its header. Clears the stats and stop,
+/// the other settings stay
+/// Returns 0 on success, -1 with errno set on error
+int ale_replay_open(struct ale_replay *rp, const char *path);
+
+void ale_replay_close(struct ale_replay *rp);
+
+/// Audio in the file, in seconds
+double ale_replay_secs(struct ale_replay *rp);
+
+/// Streams the whole file into ring, blocking, until done or rp->stop
+/// Returns 0 when done, -1 if stopped
+int ale_replay_run(struct ale_replay *rp, cbuf_handle_t ring);
+
+/// Opens path and streams it into ring from a thread of its own, one
+/// replay at a time per rp
+/// Returns 0 on success, -1 with errno set on error (EBUSY: still running)
+int ale_replay_start(struct ale_replay *rp, const char *path, cbuf_handle_t ring);
+
+/// Makes a running replay stop soon
+void ale_replay_stop(struct ale_replay *rp);
+
+bool ale_replay_busy(struct ale_replay *rp);
@@ -0,0 +1,406 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_replay_main.c
+ * @author agent
+ * @brief rhizo-ale-replay: the RX pipeline on recorded audio
+ *
+ * Runs each recording file given through the modem and the FSM of a
+ * station of its own, in a child process, as many at once as there are
+ * cores (-j). The file is streamed into the private RX audio ring as fast
+ * as the modem takes it, or at -s times real time. Per file the decodes,
+ * CRC errors and sync losses are reported with the CPU time of each
+ * stage: feeding, demodulation per mode and the main thread (FSM, ARQ).
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include <osmocom/core/stats.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/application.h>
+
+#include "internal.h"
+#include "ale_replay.h"
+
+#define REPLAY_MAX_JOBS 256
+#define REPLAY_TAIL_BYTES (160 * sizeof(int16_t))   // less than a modem block stays unread
+#define REPLAY_POLL_USECS 10000
+#define REPLAY_SETTLE_POLLS 5   // modem events of the last blocks
+
+static const struct log_info_cat log_info_cat[] = {
+    [ALE] = {
+        .name = "ALE",
+        .description = "Rhizomatica HF ALE System",
+        .enabled = 1,
+        .loglevel = LOGL_ERROR,
+    },
+};
+
+static const struct log_info log_info = {
+    .cat = log_info_cat,
+    .num_cat = ARRAY_SIZE(log_info_cat),
+};
+
+static struct {
+    int jobs;
+    double speed;
+    const char *callsign;
+    bool verbose;
+} cfg;
+
+struct replay_result {
+    int err;                    // errno, 0: replayed
+    double audio_s;
+    double wall_s;
+    unsigned long gaps;
+    uint64_t frames;
+    uint64_t crc;
+    uint64_t sync_lost;
+    uint64_t rx_mode[_NUM_ALE_MODES];
+    uint64_t demod_ns[_NUM_ALE_MODES];
+    uint64_t modem_ns;
+    uint64_t feed_ns;
+    uint64_t main_ns;
+    uint64_t calls;
+    uint64_t arq_frames;
+};
+
+struct replay_job {
+    struct ale_replay rp;
+    struct ale_modem *modem;
+    cbuf_handle_t rx_audio;
+    _Atomic bool fed;
+    unsigned int settle;
+    bool finished;
+    struct osmo_timer_list timer;
+};
+
+static uint64_t clock_ns(clockid_t clk)
+{
+    struct timespec ts;
+
+    clock_gettime(clk, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* nobody plays the TX audio */
+static void drain_tx(void *arg)
+{
+    struct replay_job *job = arg;
+    cbuf_handle_t tx_audio = ale_modem_tx_audio(job->modem);
+
+    circular_buf_consume(tx_audio, circular_buf_size(tx_audio));
+}
+
+static void *feed_thread(void *arg)
+{
+    struct replay_job *job = arg;
+
+    ale_replay_run(&job->rp, job->rx_audio);
+    atomic_store(&job->fed, true);
+    return NULL;
+}
+
+static void poll_cb(void *data)
+{
+    struct replay_job *job = data;
+
+    drain_tx(job);
+    if (atomic_load(&job->fed) && circular_buf_size(job->rx_audio) < REPLAY_TAIL_BYTES)
+        job->finished = ++job->settle >= REPLAY_SETTLE_POLLS;
+    osmo_timer_schedule(&job->timer, 0, REPLAY_POLL_USECS);
+}
+
+static cbuf_handle_t ring_alloc(void *ctx, size_t size)
+{
+    return circular_buf_init(talloc_size(ctx, size), size);
+}
+
+/* child process: one station on private rings */
+static int replay_file(const char *path, struct replay_result *res)
+{
+    void *ctx = talloc_named_const(NULL, 1, "rhizo-ale-replay");
+    cbuf_handle_t tx_data[ALE_TX_NUM_CLASSES], rx_data[ALE_TX_NUM_CLASSES];
+    const struct ale_modem_stats *ms;
+    struct replay_job job = { 0 };
+    struct ale_station *st;
+    uint64_t wall, main_cpu;
+    pthread_t feeder;
+
+    if (ale_replay_open(&job.rp, path) < 0)
+        return -errno;
+    res->audio_s = ale_replay_secs(&job.rp);
+    job.rp.speed = cfg.speed;
+    job.rp.idle = drain_tx;
+    job.rp.arg = &job;
+
+    msgb_talloc_ctx_init(ctx, 0);
+    osmo_init_logging2(ctx, &log_info);
+    log_enable_multithread();
+    osmo_stats_init(ctx);
+
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+        tx_data[i] = ring_alloc(ctx, ALE_DATA_RING_SIZE);
+        rx_data[i] = ring_alloc(ctx, ALE_DATA_RING_SIZE);
+    }
+    st = ale_station_alloc(ctx, tx_data, rx_data);
+    g_ale = st;
+    if (cfg.callsign)
+        OSMO_STRLCPY_ARRAY(st->callsign, cfg.callsign);
+    if (ale_stats_init(ctx, st) < 0)
+        return -ENOMEM;
+
+    job.rx_audio = ring_alloc(ctx, ALE_AUDIO_RING_SIZE);
+    job.modem = ale_modem_alloc(ctx, st, ring_alloc(ctx, ALE_AUDIO_RING_SIZE), job.rx_audio);
+    if (ale_modem_start(job.modem) < 0)
+        return -ENOTSUP;
+    osmo_fsm_inst_dispatch(st->fi, ALE_E_INIT, NULL);
+
+    osmo_timer_setup(&job.timer, poll_cb, &job);
+    osmo_timer_schedule(&job.timer, 0, REPLAY_POLL_USECS);
+
+    wall = clock_ns(CLOCK_MONOTONIC);
+    main_cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    if (pthread_create(&feeder, NULL, feed_thread, &job))
+        return -EAGAIN;
+    while (!job.finished)
+        osmo_select_main(0);
+    pthread_join(feeder, NULL);
+
+    ms = ale_modem_get_stats(job.modem);
+    res->wall_s = (clock_ns(CLOCK_MONOTONIC) - wall) / 1e9;
+    res->main_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID) - main_cpu;
+    res->modem_ns = ale_modem_cpu_ns(job.modem);
+    res->feed_ns = job.rp.stats.cpu_ns;
+    res->gaps = job.rp.stats.gaps;
+    res->frames = atomic_load(&ms->rx_frames);
+    res->crc = atomic_load(&ms->rx_crc);
+    res->sync_lost = atomic_load(&ms->sync_lost);
+    for (int m = 0; m < _NUM_ALE_MODES; m++) {
+        res->rx_mode[m] = atomic_load(&ms->rx_mode[m]);
+        res->demod_ns[m] = atomic_load(&ms->demod_ns[m]);
+    }
+    res->calls = st->ctrs->ctr[ALE_CTR_CALL_IN].current;
+    res->arq_frames = st->arq->stats.rx_frames;
+
+    return 0;
+}
+
+static void print_result(const char *path, const struct replay_result *res)
+{
+    uint64_t demod = 0;
+
+    if (res->err) {
+        printf("%-32s %s\n", path, strerror(res->err));
+        return;
+    }
+    for (int m = 0; m < _NUM_ALE_MODES; m++)
+        demod += res->demod_ns[m];
+
+    printf("%-32s %8.1f %7.2f %7.1fx %6lu %5lu %5lu %5lu %8.1f %8.1f %8.1f\n", path,
+           res->audio_s, res->wall_s, res->wall_s > 0 ? res->audio_s / res->wall_s : 0,
+           (unsigned long) res->frames, (unsigned long) res->crc, (unsigned long) res->sync_lost,
+           res->gaps, res->feed_ns / 1e6, demod / 1e6, res->main_ns / 1e6);
+    if (!cfg.verbose)
+        return;
+    for (int m = 0; m < _NUM_ALE_MODES; m++)
+        printf("    %-10s %6lu decodes %8.1f ms\n", ale_mode_get(m)->name,
+               (unsigned long) res->rx_mode[m], res->demod_ns[m] / 1e6);
+    printf("    calls %lu, ARQ frames %lu, modem thread %.1f ms\n", (unsigned long) res->calls,
+           (unsigned long) res->arq_frames, res->modem_ns / 1e6);
+}
+
+static void print_help(void)
+{
+    printf("Usage: rhizo-ale-replay [options] FILE.rec...\n"
+           "Options:\n"
+           "  -j	--jobs N	Files replayed at once (Default: one per core)\n"
+           "  -s	--speed X	Pace by the recording timestamps, X times real time\n"
+           "			(Default: as fast as the modem takes it)\n"
+           "  -c	--callsign CALL	Own callsign, calls to it are answered\n"
+           "  -v	--verbose	Decodes and CPU time per mode\n"
+           "  -h	--help		This text\n");
+}
+
+static void handle_options(int argc, char **argv)
+{
+    cfg.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    while (1) {
+        int option_index = 0, c;
+        static const struct option long_options[] = {
+            { "help", 0, 0, 'h' },
+            { "jobs", 1, 0, 'j' },
+            { "speed", 1, 0, 's' },
+            { "callsign", 1, 0, 'c' },
+            { "verbose", 0, 0, 'v' },
+            { NULL, 0, 0, 0 }
+        };
+
+        c = getopt_long(argc, argv, "hj:s:c:v", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 'h':
+            print_help();
+            exit(0);
+            break;
+        case 'j':
+            cfg.jobs = atoi(optarg);
+            break;
+        case 's':
+            cfg.speed = atof(optarg);
+            break;
+        case 'c':
+            cfg.callsign = optarg;
+            break;
+        case 'v':
+            cfg.verbose = true;
+            break;
+        default:
+            print_help();
+            exit(1);
+            break;
+        }
+    }
+
+    if (cfg.jobs < 1)
+        cfg.jobs = 1;
+    if (cfg.jobs > REPLAY_MAX_JOBS)
+        cfg.jobs = REPLAY_MAX_JOBS;
+    if (optind == argc) {
+        print_help();
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct {
+        pid_t pid;
+        int fd;
+        int file;
+    } running[REPLAY_MAX_JOBS];
+    struct replay_result *results, total = { 0 };
+    int files, next = 0, active = 0, failed = 0;
+
+    handle_options(argc, argv);
+    files = argc - optind;
+    results = calloc(files, sizeof(*results));
+    if (!results)
+        exit(1);
+
+    printf("%-32s %8s %7s %8s %6s %5s %5s %5s %8s %8s %8s\n", "File", "Audio s", "Wall s", "Speed",
+           "Frames", "CRC", "Sync-", "Gaps", "Feed ms", "Demod ms", "Main ms");
+
+    while (next < files || active) {
+        struct replay_result *res;
+        int status, fds[2], i;
+        pid_t pid;
+
+        if (next < files && active < cfg.jobs) {
+            if (pipe(fds) < 0) {
+                perror("pipe");
+                exit(1);
+            }
+            pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                exit(1);
+            }
+            if (!pid) {
+                struct replay_result r = { 0 };
+                int rc = replay_file(argv[optind + next], &r);
+
+                r.err = rc < 0 ? -rc : 0;
+                if (write(fds[1], &r, sizeof(r)) != sizeof(r))
+                    _exit(2);
+                _exit(0);
+            }
+            close(fds[1]);
+            running[active].pid = pid;
+            running[active].fd = fds[0];
+            running[active].file = next++;
+            active++;
+            continue;
+        }
+
+        pid = wait(&status);
+        for (i = 0; i < active && running[i].pid != pid; i++);
+        if (i == active)
+            continue;
+
+        res = &results[running[i].file];
+        if (read(running[i].fd, res, sizeof(*res)) != sizeof(*res))
+            res->err = ECHILD;
+        close(running[i].fd);
+        print_result(argv[optind + running[i].file], res);
+        running[i] = running[--active];
+    }
+
+    for (int f = 0; f < files; f++) {
+        struct replay_result *res = &results[f];
+
+        if (res->err) {
+            failed++;
+            continue;
+        }
+        total.audio_s += res->audio_s;
+        total.frames += res->frames;
+        total.crc += res->crc;
+        total.sync_lost += res->sync_lost;
+        total.gaps += res->gaps;
+        total.feed_ns += res->feed_ns;
+        total.main_ns += res->main_ns;
+        for (int m = 0; m < _NUM_ALE_MODES; m++) {
+            total.rx_mode[m] += res->rx_mode[m];
+            total.demod_ns[m] += res->demod_ns[m];
+        }
+    }
+
+    printf("\n%d files, %d failed, %.1f s of audio\n", files, failed, total.audio_s);
+    printf("%-10s %8s %10s %12s\n", "Mode", "Decodes", "Demod ms", "ms per audio s");
+    for (int m = 0; m < _NUM_ALE_MODES; m++)
+        printf("%-10s %8lu %10.1f %12.3f\n", ale_mode_get(m)->name, (unsigned long) total.rx_mode[m],
+               total.demod_ns[m] / 1e6, total.audio_s > 0 ? total.demod_ns[m] / 1e6 / total.audio_s : 0);
+    printf("Frames %lu, CRC errors %lu, sync losses %lu; feed %.1f ms, main thread %.1f ms\n",
+           (unsigned long) total.frames, (unsigned long) total.crc, (unsigned long) total.sync_lost,
+           total.feed_ns / 1e6, total.main_ns / 1e6);
+
+    free(results);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,308 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_rig.c
+ * @author agent
+ * @brief Rig control and the channel scan timer
+ *
+ * Drives the scanning engine (ale_scan.c) from an osmo_timer on the main
+ * thread: every change of the scan (a hop, a call holding it, the call
+ * detector) goes through ale_rig_kick(), which runs the engine and arms
+ * the timer for its next deadline.
+ *
+ * Two channel change hooks are registered. The station one keeps the
+ * channel of the LQA, the recorder and the spectrum up to date. The
+ * rigctld one (hamlib's rig daemon, "rig rigctld HOST PORT") sends "F
+ * <Hz>" on a non-blocking TCP connection and does not wait for the reply,
+ * so a hop costs one send(); the replies ("RPRT <n>") are read as they
+ * come and the errors counted. A rig more than RIG_MAX_PENDING commands
+ * behind, or not connected, fails the hop and the scan counts the dwell
+ * as missed. The connection is retried every RIG_RECONNECT_SECS.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <osmocom/core/select.h>
+#include <osmocom/core/socket.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+
+#include "internal.h"
+
+#define RIG_MAX_PENDING 4       // commands without a reply yet
+#define RIG_RECONNECT_SECS 5
+#define RIG_LINE_LEN 64
+
+struct ale_rig {
+	struct ale_station *st;
+	struct osmo_timer_list scan_timer;
+	struct osmo_timer_list reconnect_timer;
+	struct osmo_fd ofd;
+	char line[RIG_LINE_LEN];
+	size_t line_len;
+	struct ale_rig_stats stats;
+};
+
+static struct ale_rig g_rig = { .ofd = { .fd = -1 } };
+
+static uint64_t monotonic_ms(void)
+{
+	struct timespec ts;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static void scan_timer_cb(void *data)
+{
+	ale_rig_kick(data);
+}
+
+/* Channel change hook of the station */
+static int station_tune(void *arg, uint32_t freq_hz)
+{
+	struct ale_station *st = arg;
+
+	st->freq_hz = freq_hz;
+	ale_rec_set_freq(st->rec, freq_hz);
+	ale_spec_set_freq(st->spec, freq_hz);
+	return 0;
+}
+
+static void rig_close(struct ale_rig *rig)
+{
+	if (rig->ofd.fd < 0)
+		return;
+	osmo_fd_unregister(&rig->ofd);
+	close(rig->ofd.fd);
+	rig->ofd.fd = -1;
+	rig->line_len = 0;
+	rig->stats.connected = false;
+	rig->stats.pending = 0;
+}
+
+static void rig_lost(struct ale_rig *rig, const char *why)
+{
+	LOGP(ALE, LOGL_ERROR, "rigctld %s:%u %s, retrying in %d s\n", rig->st->rig_host,
+	     rig->st->rig_port, why, RIG_RECONNECT_SECS);
+	rig_close(rig);
+	osmo_timer_schedule(&rig->reconnect_timer, RIG_RECONNECT_SECS, 0);
+}
+
+static void rig_reply(struct ale_rig *rig, const char *line)
+{
+	int rc;
+
+	if (sscanf(line, "RPRT %d", &rc) != 1)
+		return;
+	if (rig->stats.pending)
+		rig->stats.pending--;
+	if (rc != 0) {
+		rig->stats.errors++;
+		LOGP(ALE, LOGL_NOTICE, "rigctld: %s\n", line);
+	}
+}
+
+/* One command on its way, the reply is read by rig_fd_cb() */
+static int rig_send(struct ale_rig *rig, uint32_t freq_hz)
+{
+	char cmd[32];
+	ssize_t rc;
+	int len;
+
+	if (!rig->stats.connected || rig->stats.pending >= RIG_MAX_PENDING) {
+		rig->stats.busy++;
+		return -1;
+	}
+
+	len = snprintf(cmd, sizeof(cmd), "F %u\n", freq_hz);
+	rc = send(rig->ofd.fd, cmd, len, MSG_NOSIGNAL);
+	if (rc != len) {
+		rig->stats.busy++;
+		// a command cut in two would garble the next one
+		if (rc >= 0 || errno != EAGAIN)
+			rig_lost(rig, rc < 0 ? strerror(errno) : "short write");
+		return -1;
+	}
+	rig->stats.sent++;
+	rig->stats.pending++;
+	return 0;
+}
+
+static int rig_fd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct ale_rig *rig = ofd->data;
+	ssize_t rc;
+
+	if (what & OSMO_FD_WRITE) {
+		int err = 0;
+		socklen_t len = sizeof(err);
+
+		// the connect() finished
+		osmo_fd_write_disable(ofd);
+		if (getsockopt(ofd->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+			rig_lost(rig, strerror(err ? err : errno));
+			return 0;
+		}
+		rig->stats.connected = true;
+		LOGP(ALE, LOGL_NOTICE, "rigctld %s:%u connected\n", rig->st->rig_host, rig->st->rig_port);
+		// tune to where the scan is
+		if (rig->st->freq_hz)
+			rig_send(rig, rig->st->freq_hz);
+	}
+	if (!(what & OSMO_FD_READ))
+		return 0;
+
+	rc = recv(ofd->fd, rig->line + rig->line_len, sizeof(rig->line) - rig->line_len - 1, 0);
+	if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+	if (rc <= 0) {
+		rig_lost(rig, rc < 0 ? strerror(errno) : "closed the connection");
+		return -EBADF;
+	}
+	rig->line_len += rc;
+	rig->line[rig->line_len] = 0;
+
+	for (char *nl; (nl = strchr(rig->line, '\n')); ) {
+		*nl = 0;
+		rig_reply(rig, rig->line);
+		rig->line_len -= nl + 1 - rig->line;
+		memmove(rig->line, nl + 1, rig->line_len + 1);
+	}
+	// a line too long for us is not a reply
+	if (rig->line_len == sizeof(rig->line) - 1)
+		rig->line_len = 0;
+	return 0;
+}
+
+static void rig_connect(struct ale_rig *rig)
+{
+	struct ale_station *st = rig->st;
+	int fd;
+
+	rig_close(rig);
+	osmo_timer_del(&rig->reconnect_timer);
+	if (!st->rig_host)
+		return;
+
+	fd = osmo_sock_init(AF_UNSPEC, SOCK_STREAM, IPPROTO_TCP, st->rig_host, st->rig_port,
+			    OSMO_SOCK_F_CONNECT | OSMO_SOCK_F_NONBLOCK);
+	if (fd < 0) {
+		rig_lost(rig, "unreachable");
+		return;
+	}
+	osmo_fd_setup(&rig->ofd, fd, OSMO_FD_READ | OSMO_FD_WRITE, rig_fd_cb, rig, 0);
+	if (osmo_fd_register(&rig->ofd) < 0) {
+		close(fd);
+		rig->ofd.fd = -1;
+	}
+}
+
+static void reconnect_timer_cb(void *data)
+{
+	rig_connect(data);
+}
+
+/* Channel change hook of the rig */
+static int rig_tune(void *arg, uint32_t freq_hz)
+{
+	struct ale_rig *rig = arg;
+
+	if (!rig->st->rig_host)
+		return 0;
+	return rig_send(rig, freq_hz);
+}
+
+void ale_rig_kick(struct ale_station *st)
+{
+	struct ale_rig *rig = &g_rig;
+	uint64_t now, next;
+
+	if (!rig->st)
+		return;
+
+	now = monotonic_ms();
+	next = ale_scan_tick(st->scan, now);
+	if (!next) {
+		osmo_timer_del(&rig->scan_timer);
+		return;
+	}
+	next = next > now ? next - now : 0;
+	osmo_timer_schedule(&rig->scan_timer, next / 1000, (next % 1000) * 1000);
+}
+
+int ale_rig_scan(struct ale_station *st, const char *list)
+{
+	int rc = 0;
+
+	if (!g_rig.st)
+		return 0;
+
+	if (list)
+		rc = ale_scan_start(st->scan, list, monotonic_ms());
+	else
+		ale_scan_stop(st->scan);
+	ale_rig_kick(st);
+	return rc;
+}
+
+void ale_rig_connect(struct ale_station *st)
+{
+	if (g_rig.st)
+		rig_connect(&g_rig);
+}
+
+const struct ale_rig_stats *ale_rig_get_stats(void)
+{
+	return &g_rig.stats;
+}
+
+int ale_rig_init(void *ctx, struct ale_station *st)
+{
+	struct ale_rig *rig = &g_rig;
+
+	rig->st = st;
+	osmo_timer_setup(&rig->scan_timer, scan_timer_cb, st);
+	osmo_timer_setup(&rig->reconnect_timer, reconnect_timer_cb, rig);
+	ale_scan_add_hook(st->scan, station_tune, st);
+	ale_scan_add_hook(st->scan, rig_tune, rig);
+
+	rig_connect(rig);
+	if (st->scan_list && ale_rig_scan(st, st->scan_list) < 0) {
+		LOGP(ALE, LOGL_ERROR, "Scan list %s is empty or not configured\n", st->scan_list);
+		return -1;
+	}
+	if (st->scan_list)
+		LOGP(ALE, LOGL_NOTICE, "Scanning %s, %u channels\n", st->scan_list, st->scan->list->count);
+	return 0;
+}
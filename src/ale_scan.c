@@ -0,0 +1,289 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_scan.c
+ * @author agent
+ * @brief Channel scanning engine
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ale_scan.h"
+
+#define RATE_WINDOW_MS 10000
+
+// Private functions
+
+static unsigned int channel_dwell(const struct ale_scan_list *list, const struct ale_scan_channel *ch)
+{
+    return ch->dwell_ms ? ch->dwell_ms : list->dwell_ms;
+}
+
+static void rate_reset(struct ale_scan *scan, uint64_t now_ms)
+{
+    scan->rate_start = now_ms;
+    scan->rate_hops = 0;
+}
+
+static void tune(struct ale_scan *scan, unsigned int idx, uint64_t now_ms)
+{
+    struct ale_scan_channel *ch = &scan->list->ch[idx];
+
+    scan->cur = idx;
+    scan->hook_failed = false;
+    for (unsigned int i = 0; i < scan->num_hooks; i++)
+    {
+        if (scan->hooks[i].fn(scan->hooks[i].arg, ch->freq_hz) < 0)
+            scan->hook_failed = true;
+    }
+    if (scan->hook_failed)
+        scan->stats.hook_errors++;
+
+    scan->detected = false;
+    scan->dwell_start = now_ms;
+    scan->dwell_end = now_ms + channel_dwell(scan->list, ch);
+    scan->stats.hops++;
+    scan->rate_hops++;
+}
+
+/// Accounts the dwell being left at now_ms
+static void dwell_done(struct ale_scan *scan, uint64_t now_ms)
+{
+    struct ale_scan_channel *ch = &scan->list->ch[scan->cur];
+    unsigned int late = now_ms > scan->dwell_end ? now_ms - scan->dwell_end : 0;
+    unsigned int slack = channel_dwell(scan->list, ch) / 4;
+
+    if (slack < ALE_SCAN_SLACK_MS)
+        slack = ALE_SCAN_SLACK_MS;
+
+    ch->dwells++;
+    scan->stats.dwells++;
+    if (late > scan->stats.max_late_ms)
+        scan->stats.max_late_ms = late;
+    if (late > slack || scan->hook_failed)
+    {
+        ch->missed++;
+        scan->stats.missed++;
+    }
+}
+
+// User APIs
+
+void ale_scan_init(struct ale_scan *scan)
+{
+    memset(scan, 0, sizeof(*scan));
+    scan->extend_ms = ALE_SCAN_DEFAULT_EXTEND_MS;
+    scan->max_extend_ms = ALE_SCAN_DEFAULT_MAX_EXTEND_MS;
+}
+
+struct ale_scan_list *ale_scan_list_get(struct ale_scan *scan, const char *name, bool create)
+{
+    struct ale_scan_list *list;
+
+    for (unsigned int i = 0; i < scan->num_lists; i++)
+    {
+        if (!strcmp(scan->lists[i].name, name))
+            return &scan->lists[i];
+    }
+    if (!create || scan->num_lists == ALE_SCAN_MAX_LISTS || strlen(name) >= ALE_SCAN_NAME_LEN)
+        return NULL;
+
+    list = &scan->lists[scan->num_lists++];
+    memset(list, 0, sizeof(*list));
+    snprintf(list->name, sizeof(list->name), "%s", name);
+    list->dwell_ms = ALE_SCAN_DEFAULT_DWELL_MS;
+    return list;
+}
+
+int ale_scan_list_del(struct ale_scan *scan, const char *name)
+{
+    struct ale_scan_list *list = ale_scan_list_get(scan, name, false);
+    unsigned int i;
+
+    if (!list)
+        return -1;
+    i = list - scan->lists;
+
+    // the active list moves down with the others
+    if (scan->list == list)
+        ale_scan_stop(scan);
+    else if (scan->list > list)
+        scan->list--;
+    memmove(&scan->lists[i], &scan->lists[i + 1], (scan->num_lists - i - 1) * sizeof(*list));
+    scan->num_lists--;
+    return 0;
+}
+
+int ale_scan_channel_add(struct ale_scan_list *list, uint32_t freq_hz, unsigned int dwell_ms)
+{
+    for (unsigned int i = 0; i < list->count; i++)
+    {
+        if (list->ch[i].freq_hz == freq_hz)
+        {
+            list->ch[i].dwell_ms = dwell_ms;
+            return 0;
+        }
+    }
+    if (list->count == ALE_SCAN_MAX_CHANNELS)
+        return -1;
+
+    memset(&list->ch[list->count], 0, sizeof(list->ch[0]));
+    list->ch[list->count].freq_hz = freq_hz;
+    list->ch[list->count].dwell_ms = dwell_ms;
+    list->count++;
+    return 0;
+}
+
+int ale_scan_channel_del(struct ale_scan_list *list, uint32_t freq_hz)
+{
+    for (unsigned int i = 0; i < list->count; i++)
+    {
+        if (list->ch[i].freq_hz == freq_hz)
+        {
+            memmove(&list->ch[i], &list->ch[i + 1], (list->count - i - 1) * sizeof(list->ch[0]));
+            list->count--;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int ale_scan_add_hook(struct ale_scan *scan, ale_scan_hook_t fn, void *arg)
+{
+    if (scan->num_hooks == ALE_SCAN_MAX_HOOKS)
+        return -1;
+    scan->hooks[scan->num_hooks].fn = fn;
+    scan->hooks[scan->num_hooks].arg = arg;
+    scan->num_hooks++;
+    return 0;
+}
+
+int ale_scan_start(struct ale_scan *scan, const char *name, uint64_t now_ms)
+{
+    struct ale_scan_list *list = ale_scan_list_get(scan, name, false);
+
+    if (!list || !list->count)
+        return -1;
+
+    scan->list = list;
+    scan->held = false;
+    rate_reset(scan, now_ms);
+    tune(scan, 0, now_ms);
+    return 0;
+}
+
+void ale_scan_stop(struct ale_scan *scan)
+{
+    scan->list = NULL;
+    scan->stats.rate = 0;
+}
+
+bool ale_scan_running(struct ale_scan *scan)
+{
+    return scan->list != NULL;
+}
+
+void ale_scan_hold(struct ale_scan *scan, bool hold, uint64_t now_ms)
+{
+    if (!scan->list || hold == scan->held)
+        return;
+
+    scan->held = hold;
+    if (hold)
+        return;
+
+    // the channel the call was on gets a full dwell again
+    scan->dwell_start = now_ms;
+    scan->dwell_end = now_ms + channel_dwell(scan->list, &scan->list->ch[scan->cur]);
+    rate_reset(scan, now_ms);
+}
+
+int ale_scan_goto(struct ale_scan *scan, unsigned int idx, uint64_t now_ms)
+{
+    if (!scan->list || idx >= scan->list->count)
+        return -1;
+    if (idx != scan->cur)
+        tune(scan, idx, now_ms);
+    return 0;
+}
+
+uint64_t ale_scan_detect(struct ale_scan *scan, bool active, uint64_t now_ms)
+{
+    struct ale_scan_channel *ch;
+    uint64_t base, end;
+
+    if (!scan->list || scan->held)
+        return 0;
+    if (active == scan->detected)
+        return scan->dwell_end;
+
+    ch = &scan->list->ch[scan->cur];
+    base = scan->dwell_start + channel_dwell(scan->list, ch);
+    scan->detected = active;
+    if (active)
+    {
+        // in sync: stay up to the limit
+        ch->detections++;
+        scan->stats.detections++;
+        if (scan->dwell_end <= base && scan->max_extend_ms)
+        {
+            ch->extended++;
+            scan->stats.extended++;
+        }
+        scan->dwell_end = base + scan->max_extend_ms;
+        return scan->dwell_end;
+    }
+
+    // sync lost: a while longer for the next frame, then on with the scan
+    end = now_ms + scan->extend_ms;
+    if (end > base + scan->max_extend_ms)
+        end = base + scan->max_extend_ms;
+    scan->dwell_end = end > base ? end : base;
+    return scan->dwell_end;
+}
+
+uint64_t ale_scan_tick(struct ale_scan *scan, uint64_t now_ms)
+{
+    if (!scan->list || scan->held)
+        return 0;
+
+    if (now_ms - scan->rate_start >= RATE_WINDOW_MS)
+    {
+        scan->stats.rate = scan->rate_hops * 1000.0f / (now_ms - scan->rate_start);
+        rate_reset(scan, now_ms);
+    }
+
+    if (now_ms < scan->dwell_end)
+        return scan->dwell_end;
+
+    dwell_done(scan, now_ms);
+    tune(scan, (scan->cur + 1) % scan->list->count, now_ms);
+    return scan->dwell_end;
+}
+
+uint32_t ale_scan_freq(struct ale_scan *scan)
+{
+    return scan->list ? scan->list->ch[scan->cur].freq_hz : 0;
+}
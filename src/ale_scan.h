@@ -0,0 +1,164 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_scan.h
+ * @author agent
+ * @brief Channel scanning engine
+ *
+ * Steps the radio through the channels of a scan list, each for its dwell
+ * time, and calls the channel change hooks (rig tuning, the frequency
+ * stamps of the recorder and the spectrum) at every hop. The call
+ * detector gates the dwell: while the demodulator is in sync the dwell is
+ * extended up to max_extend_ms, and after it loses sync for extend_ms
+ * more, so a call is not left half heard. A call in progress holds the
+ * scan on its channel.
+ *
+ * The engine has no clock or timer of its own: ale_scan_tick() is called
+ * with the time and returns the time of its next deadline. The daemon
+ * drives it from an osmo_timer, tests from a simulated clock.
+ *
+ * A dwell is missed when the hop out of it came later than the slack
+ * allows, or when a hook failed to change the channel. The scan rate is
+ * the channels per second over the last ten seconds of scanning.
+ *
+ * All calls on one thread, the main one in the daemon.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ALE_SCAN_MAX_LISTS 8
+#define ALE_SCAN_MAX_CHANNELS 100
+#define ALE_SCAN_MAX_HOOKS 4
+#define ALE_SCAN_NAME_LEN 16
+
+#define ALE_SCAN_DEFAULT_DWELL_MS 500
+#define ALE_SCAN_DEFAULT_EXTEND_MS 1000     // after the detector goes quiet
+#define ALE_SCAN_DEFAULT_MAX_EXTEND_MS 10000
+#define ALE_SCAN_SLACK_MS 20                // or a quarter of the dwell, if more
+
+struct ale_scan_channel {
+    uint32_t freq_hz;
+    unsigned int dwell_ms;                  // 0: the list's
+    unsigned long dwells;
+    unsigned long missed;
+    unsigned long extended;
+    unsigned long detections;
+};
+
+struct ale_scan_list {
+    char name[ALE_SCAN_NAME_LEN];
+    unsigned int dwell_ms;
+    unsigned int count;
+    struct ale_scan_channel ch[ALE_SCAN_MAX_CHANNELS];
+};
+
+/// Called at every channel change, returns 0 when the radio is there
+typedef int (*ale_scan_hook_t)(void *arg, uint32_t freq_hz);
+
+struct ale_scan_stats {
+    unsigned long hops;
+    unsigned long dwells;
+    unsigned long missed;
+    unsigned long extended;
+    unsigned long detections;
+    unsigned long hook_errors;
+    unsigned int max_late_ms;
+    float rate;                             // channels per second
+};
+
+struct ale_scan {
+    struct ale_scan_list lists[ALE_SCAN_MAX_LISTS];
+    unsigned int num_lists;
+    unsigned int extend_ms;                 // after sync is lost
+    unsigned int max_extend_ms;             // past the dwell, in all
+
+    struct {
+        ale_scan_hook_t fn;
+        void *arg;
+    } hooks[ALE_SCAN_MAX_HOOKS];
+    unsigned int num_hooks;
+
+    // running
+    struct ale_scan_list *list;             // NULL: not scanning
+    unsigned int cur;
+    bool held;
+    bool detected;
+    bool hook_failed;
+    uint64_t dwell_start;
+    uint64_t dwell_end;
+    uint64_t rate_start;
+    unsigned long rate_hops;
+
+    struct ale_scan_stats stats;
+};
+
+void ale_scan_init(struct ale_scan *scan);
+
+/// A list by name, created if create and there is room, or NULL
+struct ale_scan_list *ale_scan_list_get(struct ale_scan *scan, const char *name, bool create);
+
+/// Removes a list, stops the scan if it is the active one
+/// Returns 0 on success, -1 if there is no such list
+int ale_scan_list_del(struct ale_scan *scan, const char *name);
+
+/// Adds a channel, or changes its dwell (0: the list's)
+/// Returns 0 on success, -1 if the list is full
+int ale_scan_channel_add(struct ale_scan_list *list, uint32_t freq_hz, unsigned int dwell_ms);
+
+/// Returns 0 on success, -1 if there is no such channel
+int ale_scan_channel_del(struct ale_scan_list *list, uint32_t freq_hz);
+
+/// Returns 0 on success, -1 if all hooks are taken
+int ale_scan_add_hook(struct ale_scan *scan, ale_scan_hook_t fn, void *arg);
+
+/// Starts scanning a list from its first channel
+/// Returns 0 on success, -1 if it does not exist or is empty
+int ale_scan_start(struct ale_scan *scan, const char *name, uint64_t now_ms);
+
+void ale_scan_stop(struct ale_scan *scan);
+
+bool ale_scan_running(struct ale_scan *scan);
+
+/// Holds the scan on its channel (a call), or releases it with a fresh dwell
+void ale_scan_hold(struct ale_scan *scan, bool hold, uint64_t now_ms);
+
+/// Goes to a channel of the list now, for a call
+/// Returns 0 on success, -1 if not scanning or idx is out of the list
+int ale_scan_goto(struct ale_scan *scan, unsigned int idx, uint64_t now_ms);
+
+/// The call detector: the demodulator got (active) or lost sync
+/// Returns the time of the next deadline, moved by the detector, 0 if
+/// there is none
+uint64_t ale_scan_detect(struct ale_scan *scan, bool active, uint64_t now_ms);
+
+/// Hops if the dwell is over
+/// Returns the time of the next deadline, 0 if there is none (not
+/// scanning or held)
+uint64_t ale_scan_tick(struct ale_scan *scan, uint64_t now_ms);
+
+/// The channel the scan is on, 0 if not scanning
+uint32_t ale_scan_freq(struct ale_scan *scan);
@@ -32,11 +32,14 @@
 
 
 #include "ale_shm.h"
+#include "ale_probe.h"
 
 bool shm_is_created(key_t key, size_t size)
 {
-    int shmid = shmget(key, size, 0);
+    // any size, a segment left by an older build is found too
+    int shmid = shmget(key, 0, 0);
 
+    (void) size;
     if (shmid == -1)
     {
         return false;
@@ -60,8 +63,10 @@ bool shm_create(key_t key, size_t size)
 
 bool shm_destroy(key_t key, size_t size)
 {
-    int shmid = shmget(1, size, 0);
+    // any size too, the segment goes whatever it was created with
+    int shmid = shmget(key, 0, 0);
 
+    (void) size;
     if (shmid == -1)
     {
         return false;
@@ -75,13 +80,17 @@ bool shm_destroy(key_t key, size_t size)
 void *shm_attach(key_t key, size_t size)
 {
     int shmid = shmget(key, size, 0);
+    void *ptr;
 
     if (shmid == -1)
     {
         return NULL;
     }
 
-    return shmat(shmid, NULL,0);
+    ptr = shmat(shmid, NULL,0);
+    ALE_PROBE3(shm__attach, key, size, ptr);
+
+    return ptr;
 }
 
 bool shm_dettach(key_t key, size_t size, void *ptr)
@@ -93,6 +102,7 @@ bool shm_dettach(key_t key, size_t size, void *ptr)
         return false;
     }
 
+    ALE_PROBE3(shm__detach, key, size, ptr);
     shmdt(ptr);
 
     return true;
@@ -0,0 +1,206 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_sound.c
+ * @author agent
+ * @brief Sounding scheduler
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "ale_sound.h"
+
+#define SD_REF_DB 6.0f              // SNR spread counted as fully uncertain
+#define NO_HISTORY_PRIORITY 3.0f    // the top of the scale
+
+// Private functions
+
+static struct ale_sound_channel *channel_get(struct ale_sound *snd, uint32_t freq_hz, bool create)
+{
+    struct ale_sound_channel *ch;
+
+    for (unsigned int i = 0; i < snd->count; i++)
+    {
+        if (snd->ch[i].freq_hz == freq_hz)
+            return &snd->ch[i];
+    }
+    if (!create || snd->count == ALE_SOUND_MAX_CHANNELS)
+        return NULL;
+
+    ch = &snd->ch[snd->count++];
+    memset(ch, 0, sizeof(*ch));
+    ch->freq_hz = freq_hz;
+    return ch;
+}
+
+static void refill(struct ale_sound *snd, time_t now)
+{
+    float max = (float) snd->window_s * snd->duty_permille;
+
+    if (now <= snd->budget_time)
+        return;
+    // duty per mille of each second is that many ms
+    snd->budget_ms += (float) (now - snd->budget_time) * snd->duty_permille;
+    if (snd->budget_ms > max)
+        snd->budget_ms = max;
+    snd->budget_time = now;
+}
+
+// User APIs
+
+void ale_sound_init(struct ale_sound *snd, unsigned int airtime_ms, time_t now)
+{
+    memset(snd, 0, sizeof(*snd));
+    snd->stale_s = ALE_SOUND_DEFAULT_STALE_S;
+    snd->interval_s = ALE_SOUND_DEFAULT_INTERVAL_S;
+    snd->busy_s = ALE_SOUND_DEFAULT_BUSY_S;
+    snd->duty_permille = ALE_SOUND_DEFAULT_DUTY;
+    snd->window_s = ALE_SOUND_DEFAULT_WINDOW_S;
+    snd->airtime_ms = airtime_ms;
+    snd->budget_time = now;
+}
+
+void ale_sound_busy(struct ale_sound *snd, uint32_t freq_hz, time_t now)
+{
+    struct ale_sound_channel *ch;
+
+    if (!freq_hz || !(ch = channel_get(snd, freq_hz, true)))
+        return;
+    ch->busy_until = now + snd->busy_s;
+}
+
+float ale_sound_priority(struct ale_sound *snd, struct ale_lqa *lqa, uint32_t freq_hz, time_t now)
+{
+    struct ale_lqa_info info;
+    float uncertainty;
+
+    if (!ale_lqa_get(lqa, freq_hz, NULL, now, &info))
+        return NO_HISTORY_PRIORITY;
+
+    uncertainty = 1.0f / (1.0f + info.weight) + fminf(info.snr_sd / SD_REF_DB, 1.0f);
+    return (float) info.age_s / snd->stale_s * (1.0f + uncertainty);
+}
+
+int ale_sound_pick(struct ale_sound *snd, struct ale_lqa *lqa, const uint32_t *freqs, unsigned int n,
+                   time_t now, time_t *next)
+{
+    float best_priority = 0;
+    int best = -1;
+
+    *next = 0;
+    if (!snd->enabled)
+        return -1;
+
+    refill(snd, now);
+    *next = now + snd->interval_s;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        struct ale_sound_channel *ch = channel_get(snd, freqs[i], true);
+        struct ale_lqa_info info;
+        time_t at;
+        float p;
+
+        if (!ch)
+            continue;
+
+        // heard after our last sounding: someone is there
+        if (ch->backoff && ale_lqa_get(lqa, ch->freq_hz, NULL, now, &info) &&
+            info.age_s < now - ch->last_sound)
+            ch->backoff = 0;
+
+        if (now < ch->busy_until)
+        {
+            snd->stats.busy++;
+            if (ch->busy_until < *next)
+                *next = ch->busy_until;
+            continue;
+        }
+        if (ch->backoff)
+        {
+            at = ch->last_sound + ((time_t) snd->interval_s << (ch->backoff - 1));
+            if (now < at)
+            {
+                if (at < *next)
+                    *next = at;
+                continue;
+            }
+        }
+
+        p = ch->priority = ale_sound_priority(snd, lqa, ch->freq_hz, now);
+        if (p >= 1.0f)
+        {
+            if (p > best_priority)
+            {
+                best_priority = p;
+                best = i;
+            }
+            continue;
+        }
+        // the priority grows with the age at most 3 times as fast as 1 / stale_s
+        at = now + (time_t) ((1.0f - p) * snd->stale_s / NO_HISTORY_PRIORITY);
+        if (at < *next)
+            *next = at;
+    }
+
+    if (best >= 0 && snd->budget_ms < snd->airtime_ms)
+    {
+        snd->stats.no_budget++;
+        if (snd->duty_permille)
+            *next = now + (time_t) ceilf((snd->airtime_ms - snd->budget_ms) / snd->duty_permille);
+        best = -1;
+    }
+    if (*next <= now)
+        *next = now + 1;
+    return best;
+}
+
+void ale_sound_sent(struct ale_sound *snd, uint32_t freq_hz, time_t now)
+{
+    struct ale_sound_channel *ch = channel_get(snd, freq_hz, true);
+
+    refill(snd, now);
+    snd->budget_ms -= snd->airtime_ms;
+    snd->stats.soundings++;
+    snd->stats.airtime_ms += snd->airtime_ms;
+    if (!ch)
+        return;
+
+    ch->last_sound = now;
+    ch->soundings++;
+    if (ch->backoff < ALE_SOUND_MAX_BACKOFF)
+        ch->backoff++;
+}
+
+unsigned int ale_sound_budget(struct ale_sound *snd, time_t now)
+{
+    refill(snd, now);
+    return snd->budget_ms > 0 ? snd->budget_ms : 0;
+}
+
+struct ale_sound_channel *ale_sound_channel(struct ale_sound *snd, uint32_t freq_hz)
+{
+    return channel_get(snd, freq_hz, false);
+}
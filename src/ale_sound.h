@@ -0,0 +1,125 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_sound.h
+ * @author agent
+ * @brief Sounding scheduler
+ *
+ * Decides when to sound and on which channel, instead of a fixed
+ * interval. A channel is due when its LQA estimate (ale_lqa.h) is stale
+ * or uncertain:
+ *
+ *   priority = age / stale_s * (1 + 1 / (1 + weight) + min(snr_sd / 6 dB, 1))
+ *
+ * and it is due at 1 or more: a well known channel after stale_s, one
+ * with little or scattered history up to three times sooner, one without
+ * any at once. The most due channel is sounded.
+ *
+ * A channel is left alone for busy_s after any activity on it (the
+ * demodulator synced, a frame was heard), and for interval_s after a
+ * sounding. That gap doubles with every further sounding nothing was heard
+ * after, up to 2^(ALE_SOUND_MAX_BACKOFF - 1) times, so dead channels cost little
+ * airtime; anything heard on the channel resets it.
+ *
+ * The airtime is a token bucket: it fills at duty_permille of the time,
+ * holds at most that share of window_s, and every sounding takes its
+ * airtime out. Without enough left nothing is sounded.
+ *
+ * All calls on one thread, the main one in the daemon.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "ale_lqa.h"
+
+#define ALE_SOUND_MAX_CHANNELS 100
+#define ALE_SOUND_MAX_BACKOFF 5
+
+#define ALE_SOUND_DEFAULT_STALE_S 1800
+#define ALE_SOUND_DEFAULT_INTERVAL_S 300
+#define ALE_SOUND_DEFAULT_BUSY_S 30
+#define ALE_SOUND_DEFAULT_DUTY 10           // per mille of the airtime
+#define ALE_SOUND_DEFAULT_WINDOW_S 3600
+
+struct ale_sound_channel {
+    uint32_t freq_hz;
+    time_t last_sound;                      // 0: never
+    time_t busy_until;
+    unsigned int backoff;                   // soundings nothing was heard after
+    unsigned long soundings;
+    float priority;                         // at the last pick
+};
+
+struct ale_sound_stats {
+    unsigned long soundings;
+    unsigned long busy;                     // picks a busy channel was skipped in
+    unsigned long no_budget;                // picks that found no airtime left
+    unsigned long airtime_ms;
+};
+
+struct ale_sound {
+    bool enabled;
+    unsigned int stale_s;
+    unsigned int interval_s;
+    unsigned int busy_s;
+    unsigned int duty_permille;
+    unsigned int window_s;
+    unsigned int airtime_ms;                // of one sounding
+
+    float budget_ms;
+    time_t budget_time;
+
+    struct ale_sound_channel ch[ALE_SOUND_MAX_CHANNELS];
+    unsigned int count;
+    struct ale_sound_stats stats;
+};
+
+/// Defaults, disabled, with an empty airtime budget from now
+void ale_sound_init(struct ale_sound *snd, unsigned int airtime_ms, time_t now);
+
+/// Activity on a channel: no sounding there for busy_s
+void ale_sound_busy(struct ale_sound *snd, uint32_t freq_hz, time_t now);
+
+/// Staleness times uncertainty of the estimate of a channel, 1 or more
+/// is due
+float ale_sound_priority(struct ale_sound *snd, struct ale_lqa *lqa, uint32_t freq_hz, time_t now);
+
+/// The channel of n to sound now, if any. *next is set to the time it is
+/// worth asking again
+/// Returns the index in freqs, -1 if none
+int ale_sound_pick(struct ale_sound *snd, struct ale_lqa *lqa, const uint32_t *freqs, unsigned int n,
+                   time_t now, time_t *next);
+
+/// A sounding went out on a channel, its airtime is taken from the budget
+void ale_sound_sent(struct ale_sound *snd, uint32_t freq_hz, time_t now);
+
+/// Airtime left in the budget, in ms
+unsigned int ale_sound_budget(struct ale_sound *snd, time_t now);
+
+/// The state of a channel, NULL if it was never picked from or marked
+struct ale_sound_channel *ale_sound_channel(struct ale_sound *snd, uint32_t freq_hz);
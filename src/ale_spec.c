@@ -0,0 +1,550 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_spec.c
+ * @author agent
+ * @brief Spectrum and waterfall feed for GUIs
+ *
+ */
+
+#define _GNU_SOURCE     // SCHED_IDLE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "ale_spec.h"
+#include "ale_shm.h"
+
+#define SPEC_IDLE_US 20000
+#define SPEC_BLOCK 256          // samples taken from the tee at a time
+#define SPEC_DB_STEPS 2         // per dB
+
+// FFT plan of n points, arrays 16 byte aligned for the vector butterflies
+struct ale_spec_fft {
+    unsigned int n;
+    float *re;
+    float *im;
+    float *tw_re;               // stage of half size h at [h, 2h)
+    float *tw_im;
+    float *window;
+    unsigned int *rev;          // bit reversal of the input index
+    float ref;                  // power of a full scale sine
+};
+
+// Private functions
+
+static int64_t realtime_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void stat_add(_Atomic uint64_t *ctr, uint64_t n)
+{
+    atomic_store_explicit(ctr, atomic_load_explicit(ctr, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+static void fft_free(struct ale_spec_fft *fft)
+{
+    if (!fft)
+        return;
+    free(fft->re);
+    free(fft->im);
+    free(fft->tw_re);
+    free(fft->tw_im);
+    free(fft->window);
+    free(fft->rev);
+    free(fft);
+}
+
+static float *fft_array(unsigned int n)
+{
+    return aligned_alloc(16, n * sizeof(float));
+}
+
+static struct ale_spec_fft *fft_alloc(unsigned int n)
+{
+    struct ale_spec_fft *fft = calloc(1, sizeof(*fft));
+    unsigned int bits = __builtin_ctz(n);
+    double gain = 0;
+
+    if (!fft)
+        return NULL;
+    fft->n = n;
+    fft->re = fft_array(n);
+    fft->im = fft_array(n);
+    fft->tw_re = fft_array(n);
+    fft->tw_im = fft_array(n);
+    fft->window = fft_array(n);
+    fft->rev = malloc(n * sizeof(*fft->rev));
+    if (!fft->re || !fft->im || !fft->tw_re || !fft->tw_im || !fft->window || !fft->rev)
+    {
+        fft_free(fft);
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        unsigned int r = 0;
+
+        for (unsigned int b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        fft->rev[i] = r;
+
+        fft->window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+        gain += fft->window[i];
+    }
+
+    for (unsigned int h = 1; h < n; h <<= 1)
+    {
+        for (unsigned int j = 0; j < h; j++)
+        {
+            fft->tw_re[h + j] = cos(M_PI * j / h);
+            fft->tw_im[h + j] = -sin(M_PI * j / h);
+        }
+    }
+
+    // a full scale sine peaks at half the window gain times full scale
+    fft->ref = (gain / 2 * 32768) * (gain / 2 * 32768);
+
+    return fft;
+}
+
+static void fft_run(struct ale_spec_fft *fft, const int16_t *x)
+{
+    float *re = fft->re, *im = fft->im;
+    unsigned int n = fft->n;
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        re[fft->rev[i]] = x[i] * fft->window[i];
+        im[fft->rev[i]] = 0;
+    }
+
+    for (unsigned int h = 1; h < n; h <<= 1)
+    {
+        const float *wr = fft->tw_re + h, *wi = fft->tw_im + h;
+
+        for (unsigned int k = 0; k < n; k += 2 * h)
+        {
+            unsigned int j = 0;
+
+#if defined(__SSE2__)
+            for (; h >= 4 && j < h; j += 4)
+            {
+                __m128 ar = _mm_load_ps(re + k + j), ai = _mm_load_ps(im + k + j);
+                __m128 br = _mm_load_ps(re + k + j + h), bi = _mm_load_ps(im + k + j + h);
+                __m128 cr = _mm_load_ps(wr + j), ci = _mm_load_ps(wi + j);
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(br, cr), _mm_mul_ps(bi, ci));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(br, ci), _mm_mul_ps(bi, cr));
+
+                _mm_store_ps(re + k + j, _mm_add_ps(ar, tr));
+                _mm_store_ps(im + k + j, _mm_add_ps(ai, ti));
+                _mm_store_ps(re + k + j + h, _mm_sub_ps(ar, tr));
+                _mm_store_ps(im + k + j + h, _mm_sub_ps(ai, ti));
+            }
+#elif defined(__ARM_NEON)
+            for (; h >= 4 && j < h; j += 4)
+            {
+                float32x4_t ar = vld1q_f32(re + k + j), ai = vld1q_f32(im + k + j);
+                float32x4_t br = vld1q_f32(re + k + j + h), bi = vld1q_f32(im + k + j + h);
+                float32x4_t cr = vld1q_f32(wr + j), ci = vld1q_f32(wi + j);
+                float32x4_t tr = vmlsq_f32(vmulq_f32(br, cr), bi, ci);
+                float32x4_t ti = vmlaq_f32(vmulq_f32(br, ci), bi, cr);
+
+                vst1q_f32(re + k + j, vaddq_f32(ar, tr));
+                vst1q_f32(im + k + j, vaddq_f32(ai, ti));
+                vst1q_f32(re + k + j + h, vsubq_f32(ar, tr));
+                vst1q_f32(im + k + j + h, vsubq_f32(ai, ti));
+            }
+#endif
+            // the first stages, and all of them without vector units
+            for (; j < h; j++)
+            {
+                float tr = re[k + j + h] * wr[j] - im[k + j + h] * wi[j];
+                float ti = re[k + j + h] * wi[j] + im[k + j + h] * wr[j];
+
+                re[k + j + h] = re[k + j] - tr;
+                im[k + j + h] = im[k + j] - ti;
+                re[k + j] += tr;
+                im[k + j] += ti;
+            }
+        }
+    }
+}
+
+/// Adds the power of the first bins FFT outputs
+static void power_add(float *power, const float *re, const float *im, unsigned int bins)
+{
+    unsigned int i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 4 <= bins; i += 4)
+    {
+        __m128 r = _mm_load_ps(re + i), m = _mm_load_ps(im + i);
+
+        _mm_storeu_ps(power + i, _mm_add_ps(_mm_loadu_ps(power + i),
+                                            _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m))));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= bins; i += 4)
+    {
+        float32x4_t r = vld1q_f32(re + i), m = vld1q_f32(im + i);
+
+        vst1q_f32(power + i, vmlaq_f32(vmlaq_f32(vld1q_f32(power + i), r, r), m, m));
+    }
+#endif
+    for (; i < bins; i++)
+        power[i] += re[i] * re[i] + im[i] * im[i];
+}
+
+static void frame_publish(struct ale_spec *sp)
+{
+    struct ale_spec_shm *shm = sp->shm;
+    uint64_t n = atomic_load_explicit(&shm->frames, memory_order_relaxed);
+    struct ale_spec_frame *frame = &shm->frame[n % ALE_SPEC_SLOTS];
+    unsigned int bins = sp->fft->n / 2;
+    float scale = 1.0f / (sp->fft->ref * sp->power_ffts);
+
+    atomic_store_explicit(&frame->seq, 2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    frame->ts_ns = realtime_ns();
+    frame->freq_hz = atomic_load_explicit(&sp->freq_hz, memory_order_relaxed);
+    frame->bins = bins;
+    frame->ffts = sp->power_ffts;
+    for (unsigned int i = 0; i < bins; i++)
+    {
+        float db = 10 * log10f(sp->power[i] * scale + 1e-30f);
+        int v = 255 + (int) lrintf(db * SPEC_DB_STEPS);
+
+        frame->db[i] = v < 0 ? 0 : v > 255 ? 255 : v;
+    }
+
+    atomic_store_explicit(&frame->seq, 2 * n + 2, memory_order_release);
+    atomic_store_explicit(&shm->frames, n + 1, memory_order_release);
+
+    memset(sp->power, 0, bins * sizeof(float));
+    sp->power_ffts = 0;
+    stat_add(&sp->stats.frames, 1);
+}
+
+/// Takes the bins and fps, a new FFT size starts over
+static int spec_plan(struct ale_spec *sp, unsigned int *hop, unsigned int *step)
+{
+    unsigned int bins = atomic_load_explicit(&sp->bins, memory_order_relaxed);
+    unsigned int fps = atomic_load_explicit(&sp->fps, memory_order_relaxed);
+
+    if (!sp->fft || sp->fft->n != 2 * bins)
+    {
+        fft_free(sp->fft);
+        sp->fft = fft_alloc(2 * bins);
+        if (!sp->fft)
+            return -1;
+        sp->hist_len = 0;
+        sp->since_frame = 0;
+        sp->power_ffts = 0;
+        memset(sp->power, 0, sizeof(sp->power));
+    }
+
+    // FFTs overlap by half, or more to give each frame one
+    *hop = sp->rate / fps;
+    *step = bins < *hop ? bins : *hop;
+    return 0;
+}
+
+static void *spec_thread(void *arg)
+{
+    struct ale_spec *sp = arg;
+    struct sched_param param = { 0 };
+    uint64_t cpu = thread_cpu_ns();
+    unsigned int hop, step;
+
+    // gets the CPU when the demodulator leaves it
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+    while (atomic_load(&sp->running))
+    {
+        size_t avail = circular_buf_size(sp->tee) / sizeof(int16_t);
+        uint64_t now;
+
+        if (!avail)
+        {
+            now = thread_cpu_ns();
+            stat_add(&sp->stats.cpu_ns, now - cpu);
+            cpu = now;
+            usleep(SPEC_IDLE_US);
+            continue;
+        }
+
+        if (spec_plan(sp, &hop, &step) < 0)
+        {
+            usleep(SPEC_IDLE_US);
+            continue;
+        }
+
+        while (avail)
+        {
+            unsigned int n = sp->fft->n;
+            unsigned int part = n - sp->hist_len;
+
+            if (part > avail)
+                part = avail;
+            if (part > SPEC_BLOCK)
+                part = SPEC_BLOCK;
+            circular_buf_get_range(sp->tee, (uint8_t *) (sp->hist + sp->hist_len), part * sizeof(int16_t));
+            sp->hist_len += part;
+            sp->since_frame += part;
+            avail -= part;
+            if (sp->hist_len < n)
+                continue;
+
+            fft_run(sp->fft, sp->hist);
+            power_add(sp->power, sp->fft->re, sp->fft->im, n / 2);
+            sp->power_ffts++;
+            stat_add(&sp->stats.ffts, 1);
+
+            // frames at FFT ends, hop apart on average
+            if (sp->since_frame >= hop)
+            {
+                frame_publish(sp);
+                sp->since_frame = sp->since_frame - hop < hop ? sp->since_frame - hop : 0;
+            }
+
+            memmove(sp->hist, sp->hist + step, (n - step) * sizeof(int16_t));
+            sp->hist_len = n - step;
+        }
+    }
+
+    stat_add(&sp->stats.cpu_ns, thread_cpu_ns() - cpu);
+    return NULL;
+}
+
+// User APIs
+
+struct ale_spec *ale_spec_alloc(unsigned int rate)
+{
+    struct ale_spec *sp = calloc(1, sizeof(*sp));
+
+    if (!sp)
+        return NULL;
+
+    sp->tee = circular_buf_init(malloc(ALE_SPEC_TEE_SIZE), ALE_SPEC_TEE_SIZE);
+    sp->rate = rate;
+    sp->bins = ALE_SPEC_DEFAULT_BINS;
+    sp->fps = ALE_SPEC_DEFAULT_FPS;
+
+    return sp;
+}
+
+void ale_spec_free(struct ale_spec *sp)
+{
+    ale_spec_stop(sp);
+    fft_free(sp->fft);
+    free(sp->tee->buffer);
+    circular_buf_free(sp->tee);
+    free(sp);
+}
+
+int ale_spec_start(struct ale_spec *sp)
+{
+    struct ale_spec_shm *shm;
+
+    if (atomic_load(&sp->running))
+        return 0;
+
+    if (shm_is_created(ALE_SPEC_SHM_KEY, sizeof(*shm)))
+    {
+        fprintf(stderr, "shm key %u already created. Re-creating.\n", ALE_SPEC_SHM_KEY);
+        shm_destroy(ALE_SPEC_SHM_KEY, sizeof(*shm));
+    }
+    if (!shm_create(ALE_SPEC_SHM_KEY, sizeof(*shm)))
+        return -1;
+    shm = shm_attach(ALE_SPEC_SHM_KEY, sizeof(*shm));
+    if (shm == (void *) -1 || !shm)
+    {
+        shm_destroy(ALE_SPEC_SHM_KEY, sizeof(*shm));
+        return -1;
+    }
+
+    memset(shm, 0, sizeof(*shm));
+    shm->version = ALE_SPEC_VERSION;
+    shm->rate = sp->rate;
+    shm->slots = ALE_SPEC_SLOTS;
+    shm->max_bins = ALE_SPEC_MAX_BINS;
+    atomic_thread_fence(memory_order_release);
+    memcpy(shm->magic, ALE_SPEC_MAGIC, sizeof(shm->magic));
+    sp->shm = shm;
+
+    circular_buf_reset(sp->tee);
+    atomic_store(&sp->running, true);
+    if (pthread_create(&sp->thread, NULL, spec_thread, sp))
+    {
+        atomic_store(&sp->running, false);
+        shm_dettach(ALE_SPEC_SHM_KEY, sizeof(*shm), shm);
+        shm_destroy(ALE_SPEC_SHM_KEY, sizeof(*shm));
+        sp->shm = NULL;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    return 0;
+}
+
+void ale_spec_stop(struct ale_spec *sp)
+{
+    if (!atomic_exchange(&sp->running, false))
+        return;
+    pthread_join(sp->thread, NULL);
+
+    shm_dettach(ALE_SPEC_SHM_KEY, sizeof(*sp->shm), sp->shm);
+    shm_destroy(ALE_SPEC_SHM_KEY, sizeof(*sp->shm));
+    sp->shm = NULL;
+}
+
+bool ale_spec_running(struct ale_spec *sp)
+{
+    return atomic_load(&sp->running);
+}
+
+void ale_spec_audio(struct ale_spec *sp, const int16_t *samples, size_t n)
+{
+    if (!atomic_load_explicit(&sp->running, memory_order_relaxed))
+        return;
+
+    if (circular_buf_free_size(sp->tee) < n * sizeof(int16_t))
+        stat_add(&sp->stats.dropped, n);
+    else
+        circular_buf_put_range(sp->tee, (uint8_t *) samples, n * sizeof(int16_t));
+}
+
+int ale_spec_set(struct ale_spec *sp, unsigned int bins, unsigned int fps)
+{
+    if (bins < ALE_SPEC_MIN_BINS || bins > ALE_SPEC_MAX_BINS || (bins & (bins - 1)) ||
+        !fps || fps > ALE_SPEC_MAX_FPS)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    atomic_store(&sp->bins, bins);
+    atomic_store(&sp->fps, fps);
+    return 0;
+}
+
+void ale_spec_set_freq(struct ale_spec *sp, uint32_t hz)
+{
+    atomic_store_explicit(&sp->freq_hz, hz, memory_order_relaxed);
+}
+
+int ale_spec_viewers(struct ale_spec *sp)
+{
+    struct shmid_ds ds;
+    int shmid;
+
+    if (!sp->shm)
+        return 0;
+    shmid = shmget(ALE_SPEC_SHM_KEY, 0, 0);
+    if (shmid == -1 || shmctl(shmid, IPC_STAT, &ds) < 0)
+        return 0;
+    return ds.shm_nattch - 1;
+}
+
+const struct ale_spec_shm *ale_spec_attach(void)
+{
+    int shmid = shmget(ALE_SPEC_SHM_KEY, 0, 0);
+    struct ale_spec_shm *shm;
+
+    if (shmid == -1)
+        return NULL;
+    shm = shmat(shmid, NULL, SHM_RDONLY);
+    if (shm == (void *) -1)
+        return NULL;
+
+    if (memcmp(shm->magic, ALE_SPEC_MAGIC, sizeof(shm->magic)) || shm->version != ALE_SPEC_VERSION)
+    {
+        shmdt(shm);
+        errno = EPROTO;
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    return shm;
+}
+
+void ale_spec_detach(const struct ale_spec_shm *shm)
+{
+    shmdt(shm);
+}
+
+int ale_spec_read(const struct ale_spec_shm *shm, uint64_t n, struct ale_spec_frame *frame)
+{
+    const struct ale_spec_frame *slot = &shm->frame[n % ALE_SPEC_SLOTS];
+    uint64_t seq, done = 2 * n + 2;
+
+    if (n >= atomic_load_explicit(&shm->frames, memory_order_acquire))
+        return 1;
+
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != done)
+        return -1;
+
+    frame->ts_ns = slot->ts_ns;
+    frame->freq_hz = slot->freq_hz;
+    frame->bins = slot->bins;
+    frame->ffts = slot->ffts;
+    memcpy(frame->db, slot->db, slot->bins <= ALE_SPEC_MAX_BINS ? slot->bins : ALE_SPEC_MAX_BINS);
+
+    // the writer got there in the meantime
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != done)
+        return -1;
+    atomic_store_explicit(&frame->seq, done, memory_order_relaxed);
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_spec.h
+ * @author agent
+ * @brief Spectrum and waterfall feed for GUIs
+ *
+ * The modem thread hands every block it reads from the RX audio ring to
+ * ale_spec_audio(), a copy into an in-memory tee like the recorder's. A
+ * spectrum thread at SCHED_IDLE priority windows the audio (Hann), runs
+ * a radix-2 FFT with SSE / NEON butterflies and averages the power of the
+ * FFTs of a frame period into one frame of bins magnitudes.
+ *
+ * Frames are published in a System V shared memory segment
+ * (ALE_SPEC_SHM_KEY): a ring of ALE_SPEC_SLOTS frames, the newest
+ * overwriting the oldest. Each slot carries a sequence number, odd while
+ * the frame is being written, so viewers never write into the segment,
+ * any number of them can attach, and a slow one only misses frames.
+ * Viewers attach with ale_spec_attach() and copy frames out with
+ * ale_spec_read().
+ *
+ * Bins are 0.5 dB steps of the power relative to a full scale sine: 255
+ * is 0 dBFS, 0 is -127.5 dBFS or less. Bin k is centered on
+ * k * rate / (2 * bins) Hz.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "ale_buf.h"
+
+#define ALE_SPEC_SHM_KEY 66674
+#define ALE_SPEC_MAGIC "ALESPEC"
+#define ALE_SPEC_VERSION 1
+#define ALE_SPEC_SLOTS 64
+#define ALE_SPEC_MIN_BINS 64
+#define ALE_SPEC_MAX_BINS 4096
+#define ALE_SPEC_MAX_FPS 50
+#define ALE_SPEC_TEE_SIZE (32 * 1024)   // 2 s of 8 kHz audio
+
+#define ALE_SPEC_DEFAULT_BINS 512
+#define ALE_SPEC_DEFAULT_FPS 10
+
+struct ale_spec_frame {
+    _Atomic uint64_t seq;       // 2 * n + 1 while frame n is written, then 2 * n + 2
+    int64_t ts_ns;              // CLOCK_REALTIME when computed
+    uint32_t freq_hz;           // radio frequency, 0: unknown
+    uint16_t bins;
+    uint16_t ffts;              // averaged in this frame
+    uint8_t db[ALE_SPEC_MAX_BINS];
+};
+
+struct ale_spec_shm {
+    char magic[8];              // set last
+    uint32_t version;
+    uint32_t rate;
+    uint32_t slots;
+    uint32_t max_bins;
+    _Atomic uint64_t frames;    // written so far, frame n is in slot n % slots
+    struct ale_spec_frame frame[ALE_SPEC_SLOTS];
+};
+
+struct ale_spec_stats {
+    _Atomic uint64_t frames;
+    _Atomic uint64_t ffts;
+    _Atomic uint64_t dropped;   // samples, the spectrum thread lagged behind
+    _Atomic uint64_t cpu_ns;    // of the spectrum thread
+};
+
+struct ale_spec_fft;
+
+struct ale_spec {
+    bool enabled;               // read by the daemon start
+    unsigned int rate;
+
+    // from any thread, taken at the next FFT
+    _Atomic unsigned int bins;
+    _Atomic unsigned int fps;
+    _Atomic uint32_t freq_hz;
+
+    cbuf_handle_t tee;          // one producer, the spectrum thread
+
+    _Atomic bool running;
+    pthread_t thread;
+    struct ale_spec_shm *shm;
+
+    // spectrum thread
+    struct ale_spec_fft *fft;
+    int16_t hist[2 * ALE_SPEC_MAX_BINS];
+    unsigned int hist_len;
+    unsigned int since_frame;   // samples
+    float power[ALE_SPEC_MAX_BINS];
+    unsigned int power_ffts;
+
+    struct ale_spec_stats stats;
+};
+
+/// Creates a stopped spectrum feed of rate Hz audio, with the defaults
+struct ale_spec *ale_spec_alloc(unsigned int rate);
+
+void ale_spec_free(struct ale_spec *sp);
+
+/// Creates the shared memory segment and starts the spectrum thread
+/// Returns 0 on success, -1 with errno set on error
+int ale_spec_start(struct ale_spec *sp);
+
+/// Stops the spectrum thread and removes the segment, attached viewers
+/// keep theirs until they detach
+void ale_spec_stop(struct ale_spec *sp);
+
+bool ale_spec_running(struct ale_spec *sp);
+
+/// Hands n received samples to the spectrum thread, never blocks
+/// Requires: a single producer thread
+void ale_spec_audio(struct ale_spec *sp, const int16_t *samples, size_t n);
+
+/// Bins per frame, a power of 2 from ALE_SPEC_MIN_BINS to ALE_SPEC_MAX_BINS,
+/// and frames per second, from any thread
+/// Returns 0 on success, -1 with errno EINVAL on a bad value
+int ale_spec_set(struct ale_spec *sp, unsigned int bins, unsigned int fps);
+
+/// Radio frequency of the samples from now on, from any thread
+void ale_spec_set_freq(struct ale_spec *sp, uint32_t hz);
+
+/// Viewers attached to the segment
+int ale_spec_viewers(struct ale_spec *sp);
+
+// Viewer side
+
+/// Attaches to the daemon's segment, read only
+/// Returns NULL with errno set if there is none or it is not initialized
+const struct ale_spec_shm *ale_spec_attach(void);
+
+void ale_spec_detach(const struct ale_spec_shm *shm);
+
+/// Copies frame n out, n from 0 to shm->frames - 1
+/// Returns 0 on success, 1 if not written yet, -1 if overwritten already
+int ale_spec_read(const struct ale_spec_shm *shm, uint64_t n, struct ale_spec_frame *frame);
@@ -0,0 +1,289 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_stats.c
+ * @author agent
+ * @brief Statistics export through osmo_stats
+ *
+ * One rate counter group and one stat item group for the station, sent by
+ * the configured osmo_stats reporters (statsd, log). The FSM and the host
+ * interfaces count straight into them, from the main thread. Nothing else
+ * touches the osmocom counters: the ARQ keeps its plain counters, the
+ * modem thread its own relaxed atomics, the rings their stream positions
+ * and the latency histograms their buckets, and once a second the main
+ * thread folds what changed since into the groups.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+#include "internal.h"
+#include "ale_lat.h"
+
+#define STATS_INTERVAL_SECS 1
+
+#define RING_CTR(ring, name) \
+	[ALE_CTR_RING_BYTES + (ring)] = { "ring:" name ":bytes", "Bytes read from the " name " ring" }
+
+static const struct rate_ctr_desc ale_ctr_desc[_NUM_ALE_CTRS] = {
+	[ALE_CTR_CALL_OUT] = { "call:out", "Calls made" },
+	[ALE_CTR_CALL_IN] = { "call:in", "Calls received" },
+	[ALE_CTR_CALL_CONNECTED] = { "call:connected", "Calls connected" },
+	[ALE_CTR_CALL_FAILED] = { "call:failed", "Calls not answered" },
+	[ALE_CTR_CALL_ENDED] = { "call:ended", "Sessions ended" },
+	[ALE_CTR_ARQ_TX_FRAMES] = { "arq:tx-frames", "ARQ frames sent" },
+	[ALE_CTR_ARQ_TX_RETRANS] = { "arq:tx-retransmissions", "ARQ frames sent again" },
+	[ALE_CTR_ARQ_TX_BYTES] = { "arq:tx-bytes", "New data bytes sent" },
+	[ALE_CTR_ARQ_RX_FRAMES] = { "arq:rx-frames", "ARQ frames received" },
+	[ALE_CTR_ARQ_RX_DUPLICATES] = { "arq:rx-duplicates", "ARQ frames received twice" },
+	[ALE_CTR_ARQ_RX_BYTES] = { "arq:rx-bytes", "Data bytes delivered in order" },
+	[ALE_CTR_ARQ_TURNS] = { "arq:turns", "Link turnovers" },
+	[ALE_CTR_MODEM_TX_FRAMES] = { "modem:tx-frames", "Frames modulated" },
+	[ALE_CTR_MODEM_RX_FRAMES] = { "modem:rx-frames", "Frames decoded" },
+	[ALE_CTR_MODEM_RX_CRC] = { "modem:rx-crc-errors", "Frames with CRC errors" },
+	[ALE_CTR_MODEM_SYNC_LOST] = { "modem:sync-lost", "Demodulator sync losses" },
+	[ALE_CTR_HOST_TX_BYTES] = { "host:tx-bytes", "Bytes written by host clients" },
+	[ALE_CTR_HOST_RX_BYTES] = { "host:rx-bytes", "Bytes read by host clients" },
+	[ALE_CTR_HOST_RX_LOST] = { "host:rx-lost", "Bytes skipped for lagging host clients" },
+	[ALE_CTR_HOST_UI_DROPPED] = { "host:ui-dropped", "UI frames not passed to a KISS client" },
+	RING_CTR(ALE_RING_TX_EXPRESS, "tx-express"),
+	RING_CTR(ALE_RING_TX_INTERACTIVE, "tx-interactive"),
+	RING_CTR(ALE_RING_TX_BULK, "tx-bulk"),
+	RING_CTR(ALE_RING_RX_EXPRESS, "rx-express"),
+	RING_CTR(ALE_RING_RX_INTERACTIVE, "rx-interactive"),
+	RING_CTR(ALE_RING_RX_DATA, "rx-data"),
+	RING_CTR(ALE_RING_UI_TX, "ui-tx"),
+	RING_CTR(ALE_RING_TX_AUDIO, "tx-audio"),
+	RING_CTR(ALE_RING_RX_AUDIO, "rx-audio"),
+};
+
+static const struct rate_ctr_group_desc ale_ctrg_desc = {
+	.group_name_prefix = "ale",
+	.group_description = "HF ALE Controller",
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+	.num_ctr = ARRAY_SIZE(ale_ctr_desc),
+	.ctr_desc = ale_ctr_desc,
+};
+
+#define RING_ITEM(ring, name) \
+	[ALE_STAT_RING_FILL + (ring)] = { "ring:" name ":fill", "Fill level of the " name " ring", "%", 16, 0 }
+
+#define LAT_ITEMS(stage, name, desc) \
+	[ALE_STAT_LATENCY + 2 * (stage)] = { "latency:" name ":avg", desc ", average", "us", 16, 0 }, \
+	[ALE_STAT_LATENCY + 2 * (stage) + 1] = { "latency:" name ":p99", desc ", 99th percentile", "us", 16, 0 }
+
+static const struct osmo_stat_item_desc ale_stat_desc[ALE_STAT_LATENCY + 2 * _NUM_ALE_LAT_STAGES] = {
+	[ALE_STAT_MODEM_SNR] = { "modem:snr", "SNR of the last decoded frame", "dB/10", 16, 0 },
+	[ALE_STAT_CALL_SETUP] = { "call:setup-time", "Call to session start", "ms", 16, 0 },
+	[ALE_STAT_ARQ_TX_RATE] = { "arq:tx-rate", "New data sent", "B/s", 16, 0 },
+	[ALE_STAT_ARQ_GOODPUT] = { "arq:goodput", "Data delivered in order", "B/s", 16, 0 },
+	[ALE_STAT_HOST_READERS] = { "host:readers", "Host clients reading", "", 16, 0 },
+	[ALE_STAT_HOST_WRITERS] = { "host:writers", "Host clients writing", "", 16, 0 },
+	RING_ITEM(ALE_RING_TX_EXPRESS, "tx-express"),
+	RING_ITEM(ALE_RING_TX_INTERACTIVE, "tx-interactive"),
+	RING_ITEM(ALE_RING_TX_BULK, "tx-bulk"),
+	RING_ITEM(ALE_RING_RX_EXPRESS, "rx-express"),
+	RING_ITEM(ALE_RING_RX_INTERACTIVE, "rx-interactive"),
+	RING_ITEM(ALE_RING_RX_DATA, "rx-data"),
+	RING_ITEM(ALE_RING_UI_TX, "ui-tx"),
+	RING_ITEM(ALE_RING_TX_AUDIO, "tx-audio"),
+	RING_ITEM(ALE_RING_RX_AUDIO, "rx-audio"),
+	LAT_ITEMS(ALE_LAT_TX_HOST, "tx-host", "Host write to TX queue read"),
+	LAT_ITEMS(ALE_LAT_TX_FRAMING, "tx-framing", "TX queue read to frame handed to the modem"),
+	LAT_ITEMS(ALE_LAT_TX_QUEUE, "tx-queue", "Frame handed to the modem to modem thread"),
+	LAT_ITEMS(ALE_LAT_TX_MODULATE, "tx-modulate", "Modem thread to last sample in the TX audio ring"),
+	LAT_ITEMS(ALE_LAT_TX_AUDIO, "tx-audio", "TX audio ring to audio client"),
+	LAT_ITEMS(ALE_LAT_TX_FRAME, "tx-frame", "TX queue read to audio client, per frame"),
+	LAT_ITEMS(ALE_LAT_RX_AUDIO, "rx-audio", "RX audio ring fill"),
+	LAT_ITEMS(ALE_LAT_RX_DEMOD, "rx-demod", "RX audio read to frame decoded"),
+	LAT_ITEMS(ALE_LAT_RX_QUEUE, "rx-queue", "Frame decoded to main thread"),
+	LAT_ITEMS(ALE_LAT_RX_ARQ, "rx-arq", "Frame received to delivered in order"),
+	LAT_ITEMS(ALE_LAT_RX_HOST, "rx-host", "RX data ring to host read"),
+};
+
+static const struct osmo_stat_item_group_desc ale_statg_desc = {
+	.group_name_prefix = "ale",
+	.group_description = "HF ALE Controller",
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+	.num_items = ARRAY_SIZE(ale_stat_desc),
+	.item_desc = ale_stat_desc,
+};
+
+/* folded so far */
+static struct {
+	cbuf_handle_t ring[_NUM_ALE_RINGS];
+	uint64_t ring_pos[_NUM_ALE_RINGS];
+	const struct ale_modem_stats *modem;
+	struct ale_modem_stats modem_prev;
+	struct ale_arq_stats arq_prev;
+	struct ale_lat_snap lat_prev[_NUM_ALE_LAT_STAGES];
+} folded;
+
+static struct osmo_timer_list stats_timer;
+
+static void ctr_fold(struct ale_station *st, enum ale_ctr ctr, uint64_t cur, uint64_t prev)
+{
+	if (cur > prev)
+		rate_ctr_add(&st->ctrs->ctr[ctr], cur - prev);
+}
+
+static void modem_fold(struct ale_station *st)
+{
+	const struct ale_modem_stats *ms = folded.modem;
+	struct ale_modem_stats *prev = &folded.modem_prev;
+	uint64_t cur;
+
+	if (!ms)
+		return;
+
+#define MODEM_FOLD(field, ctr) \
+	cur = atomic_load_explicit(&ms->field, memory_order_relaxed); \
+	ctr_fold(st, ctr, cur, prev->field); \
+	prev->field = cur
+
+	MODEM_FOLD(tx_frames, ALE_CTR_MODEM_TX_FRAMES);
+	MODEM_FOLD(rx_frames, ALE_CTR_MODEM_RX_FRAMES);
+	MODEM_FOLD(rx_crc, ALE_CTR_MODEM_RX_CRC);
+	MODEM_FOLD(sync_lost, ALE_CTR_MODEM_SYNC_LOST);
+#undef MODEM_FOLD
+
+	osmo_stat_item_set(st->stats->items[ALE_STAT_MODEM_SNR],
+			   atomic_load_explicit(&ms->snr_db10, memory_order_relaxed));
+}
+
+static void arq_fold(struct ale_station *st, unsigned int secs)
+{
+	const struct ale_arq_stats *cur = &st->arq->stats;
+	struct ale_arq_stats *prev = &folded.arq_prev;
+
+	ctr_fold(st, ALE_CTR_ARQ_TX_FRAMES, cur->tx_frames, prev->tx_frames);
+	ctr_fold(st, ALE_CTR_ARQ_TX_RETRANS, cur->tx_retransmissions, prev->tx_retransmissions);
+	ctr_fold(st, ALE_CTR_ARQ_TX_BYTES, cur->tx_bytes, prev->tx_bytes);
+	ctr_fold(st, ALE_CTR_ARQ_RX_FRAMES, cur->rx_frames, prev->rx_frames);
+	ctr_fold(st, ALE_CTR_ARQ_RX_DUPLICATES, cur->rx_duplicates, prev->rx_duplicates);
+	ctr_fold(st, ALE_CTR_ARQ_RX_BYTES, cur->rx_bytes, prev->rx_bytes);
+	ctr_fold(st, ALE_CTR_ARQ_TURNS, cur->turns, prev->turns);
+
+	if (secs) {
+		osmo_stat_item_set(st->stats->items[ALE_STAT_ARQ_TX_RATE],
+				   (cur->tx_bytes - prev->tx_bytes) / secs);
+		osmo_stat_item_set(st->stats->items[ALE_STAT_ARQ_GOODPUT],
+				   (cur->rx_bytes - prev->rx_bytes) / secs);
+	}
+	*prev = *cur;
+}
+
+static void rings_fold(struct ale_station *st)
+{
+	for (int i = 0; i < _NUM_ALE_RINGS; i++) {
+		cbuf_handle_t ring = folded.ring[i];
+		uint64_t pos;
+
+		if (!ring)
+			continue;
+
+		// the read position also moves on resets, which count as read
+		pos = circular_buf_read_pos(ring);
+		ctr_fold(st, ALE_CTR_RING_BYTES + i, pos, folded.ring_pos[i]);
+		folded.ring_pos[i] = pos;
+		osmo_stat_item_set(st->stats->items[ALE_STAT_RING_FILL + i],
+				   circular_buf_size(ring) * 100 / circular_buf_capacity(ring));
+	}
+}
+
+static void lat_fold(struct ale_station *st)
+{
+	for (int i = 0; i < _NUM_ALE_LAT_STAGES; i++) {
+		struct ale_lat_snap cur, diff;
+
+		ale_lat_snapshot(i, &cur);
+		ale_lat_diff(&diff, &cur, &folded.lat_prev[i]);
+		folded.lat_prev[i] = cur;
+		if (!diff.count)
+			continue;
+
+		osmo_stat_item_set(st->stats->items[ALE_STAT_LATENCY + 2 * i], diff.sum_us / diff.count);
+		osmo_stat_item_set(st->stats->items[ALE_STAT_LATENCY + 2 * i + 1],
+				   ale_lat_quantile(&diff, 0.99));
+	}
+}
+
+static void stats_timer_cb(void *data)
+{
+	struct ale_station *st = data;
+
+	// shm clients read the RX data rings without telling us
+	ale_host_rx_poll(st);
+
+	modem_fold(st);
+	arq_fold(st, STATS_INTERVAL_SECS);
+	rings_fold(st);
+	lat_fold(st);
+
+	osmo_timer_schedule(&stats_timer, STATS_INTERVAL_SECS, 0);
+}
+
+/* Registers a ring for the byte counter and fill level, before or after
+ * ale_stats_init() */
+void ale_stats_ring(enum ale_ring ring, cbuf_handle_t cbuf)
+{
+	folded.ring[ring] = cbuf;
+	folded.ring_pos[ring] = circular_buf_read_pos(cbuf);
+}
+
+void ale_stats_modem(const struct ale_modem_stats *ms)
+{
+	folded.modem = ms;
+}
+
+/* ale_arq_reset() clears the ARQ counters, the rest of the session is
+ * folded in before. No rates for this partial interval */
+void ale_stats_arq_flush(struct ale_station *st)
+{
+	if (!st->ctrs)
+		return;
+
+	arq_fold(st, 0);
+	memset(&folded.arq_prev, 0, sizeof(folded.arq_prev));
+}
+
+int ale_stats_init(void *ctx, struct ale_station *st)
+{
+	st->ctrs = rate_ctr_group_alloc(ctx, &ale_ctrg_desc, 0);
+	st->stats = osmo_stat_item_group_alloc(ctx, &ale_statg_desc, 0);
+	if (!st->ctrs || !st->stats)
+		return -ENOMEM;
+
+	folded.arq_prev = st->arq->stats;
+	osmo_timer_setup(&stats_timer, stats_timer_cb, st);
+	osmo_timer_schedule(&stats_timer, STATS_INTERVAL_SECS, 0);
+
+	return 0;
+}
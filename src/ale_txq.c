@@ -0,0 +1,369 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_txq.c
+ * @author agent
+ * @brief TX priority classes
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
+
+#include "ale_txq.h"
+#include "ale_lat.h"
+
+const char *ale_txq_class_names[ALE_TX_NUM_CLASSES] = {
+    [ALE_TX_EXPRESS] = "express",
+    [ALE_TX_INTERACTIVE] = "interactive",
+    [ALE_TX_BULK] = "bulk",
+};
+
+// Private functions
+
+// the reads passed these marks: their data waited that long
+static void class_latency(struct ale_txq_class *c)
+{
+    uint64_t pos = circular_buf_read_pos(c->ring);
+    uint64_t now = ale_lat_now();
+
+    while (c->mark_count && c->marks[c->mark_head].pos <= pos)
+    {
+        uint64_t us = now - c->marks[c->mark_head].us;
+        double ms = us / 1000.0;
+
+        ale_lat_add(ALE_LAT_TX_HOST, us);
+        c->stats.lat_count++;
+        c->stats.lat_sum_ms += ms;
+        if (ms > c->stats.lat_max_ms)
+            c->stats.lat_max_ms = ms;
+        c->mark_head = (c->mark_head + 1) % TXQ_LAT_MARKS;
+        c->mark_count--;
+    }
+}
+
+// one record of the class, with as much of the ring as fits in len
+static size_t class_read(struct ale_txq *txq, unsigned int i, uint8_t *buf, size_t len)
+{
+    struct ale_txq_class *c = &txq->cls[i];
+    size_t n = circular_buf_size(c->ring);
+
+    if (len <= TXQ_REC_HDR)
+        return 0;
+    if (n > len - TXQ_REC_HDR)
+        n = len - TXQ_REC_HDR;
+    if (n > TXQ_REC_MAX)
+        n = TXQ_REC_MAX;
+    if (!n || circular_buf_get_range(c->ring, buf + TXQ_REC_HDR, n))
+        return 0;
+
+    buf[0] = i << 6 | n >> 8;
+    buf[1] = n & 0xff;
+
+    c->stats.bytes += n;
+    c->stats.turns++;
+    class_latency(c);
+
+    return TXQ_REC_HDR + n;
+}
+
+// deficit round robin over the weighted classes, a record header is paid
+// for from the deficit like the payload
+static size_t weighted_read(struct ale_txq *txq, uint8_t *buf, size_t len)
+{
+    unsigned int idle = 0;
+    size_t done = 0;
+
+    while (len - done > TXQ_REC_HDR && idle < ALE_TX_NUM_CLASSES)
+    {
+        struct ale_txq_class *c = &txq->cls[txq->turn];
+        size_t n = 0;
+
+        if (!c->strict && !circular_buf_empty(c->ring))
+        {
+            if (c->deficit <= TXQ_REC_HDR)
+                c->deficit = c->weight * TXQ_QUANTUM;
+            n = class_read(txq, txq->turn, buf + done, len - done < c->deficit ? len - done : c->deficit);
+        }
+
+        if (!n)
+        {
+            // an idle class does not save up credit
+            c->deficit = 0;
+            txq->turn = (txq->turn + 1) % ALE_TX_NUM_CLASSES;
+            idle++;
+            continue;
+        }
+
+        idle = 0;
+        done += n;
+        c->deficit -= n;
+        if (c->deficit <= TXQ_REC_HDR)
+        {
+            c->deficit = 0;
+            txq->turn = (txq->turn + 1) % ALE_TX_NUM_CLASSES;
+        }
+    }
+
+    return done;
+}
+
+static size_t io_read(void *priv, uint8_t *buf, size_t len)
+{
+    struct ale_txq *txq = priv;
+    size_t done = 0;
+
+    ale_txq_poll(txq);
+
+    for (unsigned int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        size_t n;
+
+        while (txq->cls[i].strict && (n = class_read(txq, i, buf + done, len - done)))
+            done += n;
+    }
+
+    return done + weighted_read(txq, buf + done, len - done);
+}
+
+// walks the records of a chunk from the current parser state; without
+// commit it only adds up the payload of each class in need
+static bool rx_records(struct ale_txq *txq, const uint8_t *buf, size_t len,
+                       size_t need[ALE_TX_NUM_CLASSES], bool commit)
+{
+    uint8_t hdr[TXQ_REC_HDR];
+    unsigned int hdr_len = txq->rx_hdr_len;
+    unsigned int cls = txq->rx_cls;
+    size_t left = txq->rx_left;
+
+    memcpy(hdr, txq->rx_hdr, sizeof(hdr));
+
+    while (len)
+    {
+        size_t n;
+
+        if (!left)
+        {
+            hdr[hdr_len++] = *buf++;
+            len--;
+            if (hdr_len < TXQ_REC_HDR)
+                continue;
+
+            hdr_len = 0;
+            cls = hdr[0] >> 6;
+            left = (hdr[0] & 0x3f) << 8 | hdr[1];
+            if (cls >= ALE_TX_NUM_CLASSES || !left)
+                return false;
+            continue;
+        }
+
+        n = len < left ? len : left;
+        if (commit)
+        {
+            circular_buf_put_range(txq->cls[cls].rx_ring, (uint8_t *) buf, n);
+            txq->cls[cls].stats.rx_bytes += n;
+        }
+        else
+            need[cls] += n;
+        buf += n;
+        len -= n;
+        left -= n;
+    }
+
+    if (commit)
+    {
+        memcpy(txq->rx_hdr, hdr, sizeof(hdr));
+        txq->rx_hdr_len = hdr_len;
+        txq->rx_cls = cls;
+        txq->rx_left = left;
+    }
+
+    return true;
+}
+
+static bool io_write(void *priv, const uint8_t *buf, size_t len)
+{
+    struct ale_txq *txq = priv;
+    size_t need[ALE_TX_NUM_CLASSES] = { 0 };
+
+    // the record boundaries are lost, the ARQ must not ack anything more
+    if (txq->rx_error)
+        return false;
+
+    if (!rx_records(txq, buf, len, need, false))
+    {
+        txq->rx_error = true;
+        txq->rx_errors++;
+        return false;
+    }
+
+    // all of it or nothing, the ARQ hands it in again
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        if (need[i] > circular_buf_free_size(txq->cls[i].rx_ring))
+            return false;
+    }
+
+    return rx_records(txq, buf, len, need, true);
+}
+
+static bool io_pending(void *priv)
+{
+    struct ale_txq *txq = priv;
+
+    ale_txq_poll(txq);
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        if (!circular_buf_empty(txq->cls[i].ring))
+            return true;
+    }
+    return false;
+}
+
+static size_t io_avail(void *priv)
+{
+    struct ale_txq *txq = priv;
+    size_t avail = 0;
+
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        size_t n = circular_buf_size(txq->cls[i].ring);
+
+        // a frame that can hold it all needs the headers too
+        if (n)
+            avail += n + TXQ_REC_HDR * ((n + TXQ_REC_MAX - 1) / TXQ_REC_MAX);
+    }
+    return avail;
+}
+
+// User APIs
+
+struct ale_txq *ale_txq_alloc(cbuf_handle_t tx_rings[ALE_TX_NUM_CLASSES],
+                              cbuf_handle_t rx_rings[ALE_TX_NUM_CLASSES])
+{
+    struct ale_txq *txq = calloc(1, sizeof(struct ale_txq));
+    assert(txq);
+
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        assert(tx_rings[i] && rx_rings[i]);
+        txq->cls[i].ring = tx_rings[i];
+        txq->cls[i].rx_ring = rx_rings[i];
+        txq->cls[i].seen_end = circular_buf_read_pos(tx_rings[i]) + circular_buf_size(tx_rings[i]);
+    }
+    txq->cls[ALE_TX_EXPRESS].strict = true;
+    txq->cls[ALE_TX_INTERACTIVE].weight = 4;
+    txq->cls[ALE_TX_BULK].weight = 1;
+    txq->turn = ALE_TX_INTERACTIVE;
+
+    txq->io = (struct ale_arq_io) {
+        .read = io_read,
+        .write = io_write,
+        .pending = io_pending,
+        .avail = io_avail,
+        .priv = txq,
+    };
+
+    return txq;
+}
+
+void ale_txq_free(struct ale_txq *txq)
+{
+    free(txq);
+}
+
+void ale_txq_reset(struct ale_txq *txq)
+{
+    txq->rx_hdr_len = 0;
+    txq->rx_left = 0;
+    txq->rx_error = false;
+}
+
+void ale_txq_set_weight(struct ale_txq *txq, enum ale_tx_class cls, unsigned int weight)
+{
+    if (weight < 1)
+        weight = 1;
+    if (weight > TXQ_MAX_WEIGHT)
+        weight = TXQ_MAX_WEIGHT;
+    txq->cls[cls].weight = weight;
+}
+
+void ale_txq_poll(struct ale_txq *txq)
+{
+    uint64_t now = ale_lat_now();
+
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        struct ale_txq_class *c = &txq->cls[i];
+        uint64_t start = circular_buf_read_pos(c->ring);
+        uint64_t end = start + circular_buf_size(c->ring);
+
+        // marks left behind without a read: the ring was reset
+        while (c->mark_count && c->marks[c->mark_head].pos <= start)
+        {
+            c->mark_head = (c->mark_head + 1) % TXQ_LAT_MARKS;
+            c->mark_count--;
+        }
+
+        if (end <= c->seen_end)
+            continue;
+        c->seen_end = end;
+
+        // out of marks: the newest one takes the new data too
+        if (c->mark_count == TXQ_LAT_MARKS)
+        {
+            c->marks[(c->mark_head + TXQ_LAT_MARKS - 1) % TXQ_LAT_MARKS].pos = end;
+            continue;
+        }
+        c->marks[(c->mark_head + c->mark_count) % TXQ_LAT_MARKS].pos = end;
+        c->marks[(c->mark_head + c->mark_count) % TXQ_LAT_MARKS].us = now;
+        c->mark_count++;
+    }
+}
+
+size_t ale_txq_size(struct ale_txq *txq)
+{
+    size_t size = 0;
+
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+        size += circular_buf_size(txq->cls[i].ring);
+    return size;
+}
+
+double ale_txq_latency(const struct ale_txq_stats *stats)
+{
+    return stats->lat_count ? stats->lat_sum_ms / stats->lat_count : 0;
+}
+
+int ale_txq_class_parse(const char *name)
+{
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        if (!strcasecmp(name, ale_txq_class_names[i]))
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,135 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_txq.h
+ * @author agent
+ * @brief TX priority classes
+ *
+ * Outgoing data is queued in one ring per class (see enum ale_tx_class):
+ * the express ring is served first whenever it has data, the interactive
+ * and bulk rings share what is left by deficit round robin, in proportion
+ * to their weights. The queue is the data source of the framing stage, so
+ * every modem frame is filled by asking the scheduler again: a keystroke
+ * written while a bulk transfer is queued goes out in the next frame
+ * instead of behind the bulk backlog.
+ *
+ * Each class is its own stream: the reads cut the rings into records of
+ * [class (2 bits) | length (14 bits), BE | payload], whole records only, and
+ * the peer's queue parses them back out of whatever chunks the ARQ (or the
+ * inflater) hands it and writes each payload to the RX ring of its class. A
+ * chunk is taken whole or refused whole, so a full RX ring of one class
+ * only holds up the link the way a single RX ring did.
+ *
+ * The queueing delay of each class is measured by noting when the end of
+ * its ring moves (ale_txq_poll(), also run on every pending check and by
+ * the host writers) and when the reads pass that stream position. The
+ * samples also go to the tx-host stage of the latency accounting.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+#include "ale_arq.h"
+#include "ale_client.h"
+
+#define TXQ_QUANTUM 256         // bytes per weight unit and round
+#define TXQ_MAX_WEIGHT 64
+#define TXQ_LAT_MARKS 32
+#define TXQ_REC_HDR 2           // class and length of a record
+#define TXQ_REC_MAX 0x3fff      // payload bytes a record header can count
+
+extern const char *ale_txq_class_names[ALE_TX_NUM_CLASSES];
+
+struct ale_txq_stats {
+    uint64_t bytes;             // payload sent
+    uint64_t rx_bytes;          // payload received for the class
+    unsigned long turns;        // times the scheduler served it
+    unsigned long lat_count;
+    double lat_sum_ms;
+    double lat_max_ms;
+};
+
+struct ale_txq_class {
+    cbuf_handle_t ring;
+    cbuf_handle_t rx_ring;      // the peer's records of the class go there
+    bool strict;                // served before the weighted classes
+    unsigned int weight;
+    size_t deficit;
+
+    // stream positions of the ring end and when they were first seen (us)
+    struct {
+        uint64_t pos;
+        uint64_t us;
+    } marks[TXQ_LAT_MARKS];
+    unsigned int mark_head;
+    unsigned int mark_count;
+    uint64_t seen_end;
+
+    struct ale_txq_stats stats;
+};
+
+struct ale_txq {
+    struct ale_txq_class cls[ALE_TX_NUM_CLASSES];
+    struct ale_arq_io io;
+    unsigned int turn;              // weighted class being served
+
+    // record being received
+    uint8_t rx_hdr[TXQ_REC_HDR];
+    unsigned int rx_hdr_len;
+    unsigned int rx_cls;
+    size_t rx_left;
+    bool rx_error;                  // a header made no sense, the stream is lost
+    unsigned long rx_errors;
+};
+
+/// Queue over one TX ring per class; received records go to the RX ring of
+/// their class
+struct ale_txq *ale_txq_alloc(cbuf_handle_t tx_rings[ALE_TX_NUM_CLASSES],
+                              cbuf_handle_t rx_rings[ALE_TX_NUM_CLASSES]);
+
+void ale_txq_free(struct ale_txq *txq);
+
+/// New session: no record is being received
+void ale_txq_reset(struct ale_txq *txq);
+
+/// Weight of a weighted class, 1 to TXQ_MAX_WEIGHT
+void ale_txq_set_weight(struct ale_txq *txq, enum ale_tx_class cls, unsigned int weight);
+
+/// Notes new data in the rings, for the latency figures
+void ale_txq_poll(struct ale_txq *txq);
+
+/// Bytes queued in all classes
+size_t ale_txq_size(struct ale_txq *txq);
+
+/// Average queueing delay of a class in ms, 0 without samples
+double ale_txq_latency(const struct ale_txq_stats *stats);
+
+/// Parses a class name, -1 if unknown
+int ale_txq_class_parse(const char *name);
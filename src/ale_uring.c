@@ -0,0 +1,505 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * @file ale_uring.c
+ * @author agent
+ * @brief io_uring backend of the host sockets
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+
+#include "internal.h"
+#include "ale_uring.h"
+
+#ifdef HAVE_LIBURING
+
+#include <sys/eventfd.h>
+#include <liburing.h>
+
+#define URING_ENTRIES 256
+#define URING_BUFS 64		// provided buffers of the multishot receives
+#define URING_BUF_SIZE 4096
+#define URING_BGID 0
+#define URING_CANCEL_TAG ((uint64_t) 1)	// user_data of cancel requests
+
+enum uring_op_type {
+	URING_RECV,
+	URING_TO_RING,
+	URING_FROM_RING,
+};
+
+struct ale_uring_op {
+	enum uring_op_type type;
+	int fd;
+	cbuf_handle_t ring;
+	struct ale_station *st;		// URING_FROM_RING
+	struct ale_host_rx *rx;
+	int buf_index;
+	ale_uring_data_cb data_cb;
+	ale_uring_recv_cb recv_cb;
+	void *data;
+
+	bool armed;		// request in the kernel
+	bool in_cb;
+	bool released;
+};
+
+static struct {
+	bool active;
+	void *ctx;
+	struct io_uring ring;
+	struct osmo_fd efd;
+	struct osmo_timer_list flush_timer;
+	struct io_uring_buf_ring *br;
+	uint8_t *bufs;
+	cbuf_handle_t rings[2 * ALE_TX_NUM_CLASSES];	// fixed buffer index: TX classes, RX classes
+	unsigned int pending;	// SQEs not submitted yet
+	struct ale_uring_stats stats;
+} g_uring;
+
+static void uring_flush(void)
+{
+	int rc;
+
+	if (!g_uring.pending)
+		return;
+
+	rc = io_uring_submit(&g_uring.ring);
+	if (rc < 0)
+		LOGP(ALE, LOGL_ERROR, "io_uring submit failed: %s\n", strerror(-rc));
+	g_uring.stats.submits++;
+	g_uring.stats.sqes += g_uring.pending;
+	g_uring.pending = 0;
+}
+
+static void uring_flush_timer_cb(void *data)
+{
+	uring_flush();
+}
+
+static struct io_uring_sqe *uring_sqe(void)
+{
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&g_uring.ring);
+
+	if (!sqe) {
+		// submission queue full, make room
+		uring_flush();
+		sqe = io_uring_get_sqe(&g_uring.ring);
+	}
+	if (sqe) {
+		g_uring.pending++;
+		// batched with whatever else comes in this loop iteration
+		if (!osmo_timer_pending(&g_uring.flush_timer))
+			osmo_timer_schedule(&g_uring.flush_timer, 0, 0);
+	}
+	return sqe;
+}
+
+static void uring_op_free_if_done(struct ale_uring_op *op)
+{
+	if (op->released && !op->armed && !op->in_cb)
+		talloc_free(op);
+}
+
+static void uring_recv_arm(struct ale_uring_op *op)
+{
+	struct io_uring_sqe *sqe = uring_sqe();
+
+	if (!sqe)
+		return;
+	io_uring_prep_recv_multishot(sqe, op->fd, NULL, 0, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BGID;
+	io_uring_sqe_set_data(sqe, op);
+	op->armed = true;
+}
+
+static void uring_recv_done(struct ale_uring_op *op, struct io_uring_cqe *cqe)
+{
+	const uint8_t *buf = NULL;
+	unsigned int bid = 0;
+	bool more = cqe->flags & IORING_CQE_F_MORE;
+	int res = cqe->res;
+
+	if (cqe->flags & IORING_CQE_F_BUFFER) {
+		bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+		buf = g_uring.bufs + bid * URING_BUF_SIZE;
+	}
+
+	op->armed = more;
+	if (!op->released) {
+		op->in_cb = true;
+		// out of provided buffers: not the end, just re-arm below
+		if (res != -ENOBUFS)
+			op->recv_cb(op, buf, res);
+		op->in_cb = false;
+	}
+
+	if (buf) {
+		io_uring_buf_ring_add(g_uring.br, (void *) buf, URING_BUF_SIZE, bid,
+				      io_uring_buf_ring_mask(URING_BUFS), 0);
+		io_uring_buf_ring_advance(g_uring.br, 1);
+	}
+
+	// multishot ended without error (e.g. CQ overflow), keep receiving
+	if (!op->armed && !op->released && (res > 0 || res == -ENOBUFS))
+		uring_recv_arm(op);
+}
+
+static void uring_ring_done(struct ale_uring_op *op, struct io_uring_cqe *cqe)
+{
+	int res = cqe->res;
+
+	op->armed = false;
+	if (op->type == URING_TO_RING) {
+		if (res > 0)
+			circular_buf_commit(op->ring, res);
+	} else if (!op->released) {
+		// a released reader may be gone already
+		op->rx->inflight = 0;
+		if (res > 0)
+			ale_host_rx_advance(op->st, op->rx, res);
+	}
+
+	if (!op->released) {
+		op->in_cb = true;
+		op->data_cb(op, res);
+		op->in_cb = false;
+	}
+}
+
+static int uring_efd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct io_uring_cqe *cqe;
+	unsigned int head, count = 0;
+	uint64_t val;
+
+	if (read(ofd->fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		return -errno;
+	g_uring.stats.wakeups++;
+
+	io_uring_for_each_cqe(&g_uring.ring, head, cqe) {
+		struct ale_uring_op *op = io_uring_cqe_get_data(cqe);
+
+		count++;
+		if ((uintptr_t) op == URING_CANCEL_TAG)
+			continue;
+
+		if (op->type == URING_RECV)
+			uring_recv_done(op, cqe);
+		else
+			uring_ring_done(op, cqe);
+		uring_op_free_if_done(op);
+	}
+	io_uring_cq_advance(&g_uring.ring, count);
+	g_uring.stats.cqes += count;
+
+	// requests re-armed by the callbacks
+	uring_flush();
+	return 0;
+}
+
+int ale_uring_init(void *ctx, struct ale_station *st)
+{
+	struct io_uring_probe *probe;
+	struct iovec iov[ARRAY_SIZE(g_uring.rings)];
+	int rc, efd;
+
+	rc = io_uring_queue_init(URING_ENTRIES, &g_uring.ring, 0);
+	if (rc < 0) {
+		LOGP(ALE, LOGL_NOTICE, "io_uring not available (%s), using the poll loop\n", strerror(-rc));
+		return -ENOTSUP;
+	}
+
+	probe = io_uring_get_probe_ring(&g_uring.ring);
+	if (!probe || !io_uring_opcode_supported(probe, IORING_OP_RECV) ||
+	    !io_uring_opcode_supported(probe, IORING_OP_READ_FIXED) ||
+	    !io_uring_opcode_supported(probe, IORING_OP_WRITE_FIXED)) {
+		LOGP(ALE, LOGL_NOTICE, "io_uring lacks the needed operations, using the poll loop\n");
+		rc = -ENOTSUP;
+		goto err_probe;
+	}
+	io_uring_free_probe(probe);
+	probe = NULL;
+
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		g_uring.rings[i] = st->tx_rings[i];
+		g_uring.rings[ALE_TX_NUM_CLASSES + i] = st->rx_rings[i];
+	}
+	for (int i = 0; i < ARRAY_SIZE(g_uring.rings); i++) {
+		iov[i].iov_base = g_uring.rings[i]->buffer;
+		iov[i].iov_len = circular_buf_capacity(g_uring.rings[i]);
+	}
+	rc = io_uring_register_buffers(&g_uring.ring, iov, ARRAY_SIZE(g_uring.rings));
+	if (rc < 0)
+		goto err_probe;
+
+	g_uring.br = io_uring_setup_buf_ring(&g_uring.ring, URING_BUFS, URING_BGID, 0, &rc);
+	if (!g_uring.br)
+		goto err_probe;
+	g_uring.bufs = talloc_size(ctx, URING_BUFS * URING_BUF_SIZE);
+	OSMO_ASSERT(g_uring.bufs);
+	for (int i = 0; i < URING_BUFS; i++)
+		io_uring_buf_ring_add(g_uring.br, g_uring.bufs + i * URING_BUF_SIZE, URING_BUF_SIZE, i,
+				      io_uring_buf_ring_mask(URING_BUFS), i);
+	io_uring_buf_ring_advance(g_uring.br, URING_BUFS);
+
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (efd < 0 || io_uring_register_eventfd(&g_uring.ring, efd) < 0) {
+		rc = -errno;
+		goto err_probe;
+	}
+	osmo_fd_setup(&g_uring.efd, efd, OSMO_FD_READ, uring_efd_cb, NULL, 0);
+	osmo_fd_register(&g_uring.efd);
+	osmo_timer_setup(&g_uring.flush_timer, uring_flush_timer_cb, NULL);
+
+	g_uring.ctx = ctx;
+	g_uring.active = true;
+	LOGP(ALE, LOGL_NOTICE, "Host sockets on io_uring\n");
+	return 0;
+
+err_probe:
+	if (probe)
+		io_uring_free_probe(probe);
+	io_uring_queue_exit(&g_uring.ring);
+	LOGP(ALE, LOGL_NOTICE, "io_uring setup failed (%s), using the poll loop\n", strerror(-rc));
+	return -ENOTSUP;
+}
+
+bool ale_uring_active(void)
+{
+	return g_uring.active;
+}
+
+const struct ale_uring_stats *ale_uring_stats(void)
+{
+	return &g_uring.stats;
+}
+
+struct ale_uring_op *ale_uring_recv_start(int fd, ale_uring_recv_cb cb, void *data)
+{
+	struct ale_uring_op *op;
+
+	if (!g_uring.active)
+		return NULL;
+
+	op = talloc_zero(g_uring.ctx, struct ale_uring_op);
+	OSMO_ASSERT(op);
+	op->type = URING_RECV;
+	op->fd = fd;
+	op->recv_cb = cb;
+	op->data = data;
+
+	uring_recv_arm(op);
+	return op;
+}
+
+static struct ale_uring_op *uring_ring_op(int fd, cbuf_handle_t ring, enum uring_op_type type,
+					 ale_uring_data_cb cb, void *data)
+{
+	struct ale_uring_op *op;
+	int index = -1;
+
+	if (!g_uring.active)
+		return NULL;
+
+	for (int i = 0; i < ARRAY_SIZE(g_uring.rings); i++) {
+		if (g_uring.rings[i] == ring)
+			index = i;
+	}
+	if (index < 0)
+		return NULL;
+
+	op = talloc_zero(g_uring.ctx, struct ale_uring_op);
+	OSMO_ASSERT(op);
+	op->type = type;
+	op->fd = fd;
+	op->ring = ring;
+	op->buf_index = index;
+	op->data_cb = cb;
+	op->data = data;
+
+	return op;
+}
+
+struct ale_uring_op *ale_uring_ring_op(int fd, cbuf_handle_t ring,
+				       ale_uring_data_cb cb, void *data)
+{
+	return uring_ring_op(fd, ring, URING_TO_RING, cb, data);
+}
+
+struct ale_uring_op *ale_uring_rx_op(int fd, struct ale_station *st, struct ale_host_rx *rx,
+				     ale_uring_data_cb cb, void *data)
+{
+	struct ale_uring_op *op = uring_ring_op(fd, st->rx_rings[rx->cls], URING_FROM_RING, cb, data);
+
+	if (op) {
+		op->st = st;
+		op->rx = rx;
+	}
+	return op;
+}
+
+int ale_uring_arm(struct ale_uring_op *op, size_t max)
+{
+	struct io_uring_sqe *sqe;
+	struct iovec iov[2];
+	size_t len;
+
+	if (op->armed)
+		return 0;
+
+	// one contiguous region per request, the next one follows
+	if (op->type == URING_TO_RING) {
+		if (!circular_buf_free_iov(op->ring, iov))
+			return -EAGAIN;
+	} else {
+		if (ale_host_rx_iov(op->st, op->rx, iov) <= 0)
+			return -EAGAIN;
+	}
+	len = iov[0].iov_len < max ? iov[0].iov_len : max;
+	if (!len)
+		return -EAGAIN;
+
+	sqe = uring_sqe();
+	if (!sqe)
+		return -EAGAIN;
+	if (op->type == URING_TO_RING)
+		io_uring_prep_read_fixed(sqe, op->fd, iov[0].iov_base, len, 0, op->buf_index);
+	else
+		io_uring_prep_write_fixed(sqe, op->fd, iov[0].iov_base, len, 0, op->buf_index);
+	io_uring_sqe_set_data(sqe, op);
+	op->armed = true;
+	if (op->type == URING_FROM_RING)
+		op->rx->inflight = len;
+
+	return 0;
+}
+
+void ale_uring_cancel(struct ale_uring_op *op)
+{
+	struct io_uring_sqe *sqe;
+
+	if (!op->armed)
+		return;
+
+	sqe = uring_sqe();
+	if (sqe) {
+		io_uring_prep_cancel(sqe, op, 0);
+		io_uring_sqe_set_data(sqe, (void *) URING_CANCEL_TAG);
+	}
+}
+
+void ale_uring_release(struct ale_uring_op *op)
+{
+	struct io_uring_sqe *sqe;
+
+	if (!op)
+		return;
+
+	op->released = true;
+	if (op->armed) {
+		sqe = uring_sqe();
+		if (sqe) {
+			io_uring_prep_cancel(sqe, op, 0);
+			io_uring_sqe_set_data(sqe, (void *) URING_CANCEL_TAG);
+		}
+		// the socket is closed next, the cancel must be in before
+		uring_flush();
+	}
+	uring_op_free_if_done(op);
+}
+
+void *ale_uring_op_data(struct ale_uring_op *op)
+{
+	return op->data;
+}
+
+#else /* HAVE_LIBURING */
+
+int ale_uring_init(void *ctx, struct ale_station *st)
+{
+	LOGP(ALE, LOGL_NOTICE, "Built without liburing, using the poll loop\n");
+	return -ENOTSUP;
+}
+
+bool ale_uring_active(void)
+{
+	return false;
+}
+
+const struct ale_uring_stats *ale_uring_stats(void)
+{
+	static const struct ale_uring_stats none;
+
+	return &none;
+}
+
+struct ale_uring_op *ale_uring_recv_start(int fd, ale_uring_recv_cb cb, void *data)
+{
+	return NULL;
+}
+
+struct ale_uring_op *ale_uring_ring_op(int fd, cbuf_handle_t ring,
+				       ale_uring_data_cb cb, void *data)
+{
+	return NULL;
+}
+
+struct ale_uring_op *ale_uring_rx_op(int fd, struct ale_station *st, struct ale_host_rx *rx,
+				     ale_uring_data_cb cb, void *data)
+{
+	return NULL;
+}
+
+int ale_uring_arm(struct ale_uring_op *op, size_t max)
+{
+	return -ENOTSUP;
+}
+
+void ale_uring_cancel(struct ale_uring_op *op)
+{
+}
+
+void ale_uring_release(struct ale_uring_op *op)
+{
+}
+
+void *ale_uring_op_data(struct ale_uring_op *op)
+{
+	return NULL;
+}
+
+#endif /* HAVE_LIBURING */
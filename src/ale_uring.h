@@ -0,0 +1,105 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * @file ale_uring.h
+ * @author agent
+ * @brief io_uring backend of the host sockets
+ *
+ * Optional replacement of the osmo_fd read callbacks of the host
+ * interfaces (host-io uring). The TX and RX data rings are registered as
+ * fixed buffers: data sockets are read straight into the TX ring free
+ * space and written from the RX ring contents. Command and KISS sockets
+ * use multishot receive with a provided buffer ring, so one request keeps
+ * delivering. Requests queued while handling events go to the kernel in
+ * one submission, and all completions are reaped on a single eventfd
+ * wake-up of the select loop.
+ *
+ * Without liburing (or a kernel without the needed operations)
+ * ale_uring_init() fails and the interfaces keep their osmo_fd path.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ale_buf.h"
+
+struct ale_station;
+struct ale_host_rx;
+struct ale_uring_op;
+
+/* Ring operations: res bytes moved (already committed to the TX ring or
+ * delivered to the RX reader), 0 on EOF or -errno */
+typedef void (*ale_uring_data_cb)(struct ale_uring_op *op, int res);
+
+/* Multishot receive: res bytes in buf, 0 on EOF or -errno (the operation
+ * is over then) */
+typedef void (*ale_uring_recv_cb)(struct ale_uring_op *op, const uint8_t *buf, int res);
+
+struct ale_uring_stats {
+	unsigned long submits;		// io_uring_submit() calls
+	unsigned long sqes;
+	unsigned long cqes;
+	unsigned long wakeups;		// eventfd reads
+};
+
+/* Sets the backend up for the station rings, -ENOTSUP if unavailable */
+int ale_uring_init(void *ctx, struct ale_station *st);
+
+bool ale_uring_active(void);
+
+const struct ale_uring_stats *ale_uring_stats(void);
+
+/* Operations outlive their owner until the kernel lets them go, they are
+ * allocated from the ale_uring_init() context */
+
+/* Receives from fd until EOF, error or release */
+struct ale_uring_op *ale_uring_recv_start(int fd, ale_uring_recv_cb cb, void *data);
+
+/* Reads fd straight into a registered ring, one request per
+ * ale_uring_arm() */
+struct ale_uring_op *ale_uring_ring_op(int fd, cbuf_handle_t ring,
+				       ale_uring_data_cb cb, void *data);
+
+/* Writes the pending RX data of a reader to fd from the registered RX
+ * ring, the reader position moves on completion */
+struct ale_uring_op *ale_uring_rx_op(int fd, struct ale_station *st, struct ale_host_rx *rx,
+				     ale_uring_data_cb cb, void *data);
+
+/* Queues a request of max bytes at most. Returns 0 if queued or already
+ * pending, -EAGAIN if the ring is full (reads) or nothing is pending */
+int ale_uring_arm(struct ale_uring_op *op, size_t max);
+
+/* Cancels the pending request, if any; it completes with -ECANCELED or
+ * with what it moved until then */
+void ale_uring_cancel(struct ale_uring_op *op);
+
+/* Cancels the operation, it is freed once the kernel is done with it. Call
+ * before closing fd */
+void ale_uring_release(struct ale_uring_op *op);
+
+void *ale_uring_op_data(struct ale_uring_op *op);
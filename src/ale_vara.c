@@ -0,0 +1,430 @@
+/* Rhizomatica ALE HF controller */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: AGPL-3.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * @file ale_vara.c
+ * @author agent
+ * @brief VARA compatible TNC interface
+ *
+ * Command port (8300 by default) and data port (command port + 1) pair,
+ * following doc/VARA Protocol Native TNC Commands, so Winlink clients
+ * (Pat, Winlink Express...) can drive the controller. One client per
+ * port. Data goes straight between the data socket and the TX/RX data
+ * rings, as one of the RX readers and TX writers of the host layer; while
+ * the TX ring is full or another client has the turn the data socket is not
+ * read and TCP flow control pushes back on the client, which also gets
+ * BUFFER reports of the bytes not acknowledged by the peer yet.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/netif/stream.h>
+
+#include "internal.h"
+#include "ale_uring.h"
+
+#define VARA_BW 2300
+#define VARA_IAMALIVE_SECS 60
+#define VARA_RX_RETRY_USECS 100000
+
+struct vara_tnc {
+	struct ale_station *st;
+	struct osmo_stream_srv_link *cmd_link;
+	struct osmo_stream_srv_link *data_link;
+	struct ale_host_cmd cmd;
+	struct osmo_stream_srv *data;
+	struct ale_host_rx rx;
+	struct ale_host_tx tx;
+	// host-io uring: data port requests
+	struct ale_uring_op *data_in;
+	struct ale_uring_op *data_out;
+
+	struct osmo_timer_list alive_timer;
+	struct osmo_timer_list rx_timer;
+	struct ale_host_if hif;
+};
+
+/* Reads the data port again, it owns its TX stream and the ring has room */
+static void vara_data_resume(struct ale_host_tx *tx)
+{
+	struct vara_tnc *vara = tx->priv;
+
+	if (vara->data_in) {
+		if (ale_uring_arm(vara->data_in, ale_host_tx_quota(vara->st, tx)) < 0)
+			ale_host_tx_wait(vara->st, tx);
+	} else if (vara->data)
+		osmo_fd_read_enable(osmo_stream_srv_get_ofd(vara->data));
+}
+
+static void vara_rx_flush(struct vara_tnc *vara)
+{
+	ssize_t rc;
+
+	if (!vara->data)
+		return;
+
+	// completes once the socket takes it, no retries needed
+	if (vara->data_out) {
+		ale_uring_arm(vara->data_out, SIZE_MAX);
+		return;
+	}
+
+	rc = ale_host_rx_to_sock(osmo_stream_srv_get_ofd(vara->data)->fd, vara->st, &vara->rx);
+	if (rc < 0) {
+		LOGP(ALE, LOGL_NOTICE, "VARA data port write failed: %s\n", strerror(-rc));
+		return;
+	}
+
+	// socket full or the ring wrapped around
+	if (ale_host_rx_pending(vara->st, &vara->rx))
+		osmo_timer_schedule(&vara->rx_timer, 0, VARA_RX_RETRY_USECS);
+}
+
+static void vara_rx_stalled(struct ale_host_rx *rx)
+{
+	struct vara_tnc *vara = rx->priv;
+
+	ale_uring_cancel(vara->data_out);
+}
+
+static void vara_rx_timer_cb(void *data)
+{
+	vara_rx_flush(data);
+}
+
+static void vara_alive_timer_cb(void *data)
+{
+	struct vara_tnc *vara = data;
+
+	ale_host_cmd_reply(&vara->cmd, "IAMALIVE");
+	osmo_timer_schedule(&vara->alive_timer, VARA_IAMALIVE_SECS, 0);
+}
+
+/* Commands that only tune VARA internals, accepted and ignored */
+static const char *vara_noop_cmds[] = {
+	"BW500", "BW2300", "BW2750", "CHAT", "WINLINK", "P2P", "PUBLIC",
+	"CQFRAME", "TUNE", "ENCRYPTION",
+};
+
+static void vara_command(struct ale_host_cmd *cmd, int argc, char **argv)
+{
+	struct vara_tnc *vara = cmd->priv;
+	struct ale_station *st = vara->st;
+
+	if (!strcasecmp(argv[0], "MYCALL") && argc >= 2) {
+		// only the first call sign is used
+		if (strlen(argv[1]) > ARQ_CALLSIGN_LEN)
+			goto wrong;
+		OSMO_STRLCPY_ARRAY(st->callsign, argv[1]);
+	} else if (!strcasecmp(argv[0], "LISTEN") && argc == 2) {
+		ale_station_listen(st, !strcasecmp(argv[1], "ON"));
+	} else if (!strcasecmp(argv[0], "CONNECT") && argc >= 3) {
+		if (strlen(argv[1]) > ARQ_CALLSIGN_LEN || strlen(argv[2]) > ARQ_CALLSIGN_LEN)
+			goto wrong;
+		OSMO_STRLCPY_ARRAY(st->callsign, argv[1]);
+		if (ale_station_call(st, argv[2]) < 0)
+			goto wrong;
+	} else if (!strcasecmp(argv[0], "DISCONNECT")) {
+		if (ale_station_disconnect(st, false) == -ENOTCONN) {
+			ale_host_cmd_reply(&vara->cmd, "OK");
+			ale_host_cmd_reply(&vara->cmd, "DISCONNECTED");
+			return;
+		}
+	} else if (!strcasecmp(argv[0], "ABORT")) {
+		ale_station_disconnect(st, true);
+	} else if (!strcasecmp(argv[0], "COMPRESSION") && argc == 2) {
+		st->compression = !!strcasecmp(argv[1], "OFF");
+	} else if (!strcasecmp(argv[0], "VERSION")) {
+		ale_host_cmd_reply(&vara->cmd, "VERSION rhizo-ale %s", PACKAGE_VERSION);
+		return;
+	} else if (!strcasecmp(argv[0], "CLEANTXBUFFER")) {
+		cbuf_handle_t ring = ale_host_tx_ring(st, &vara->tx);
+
+		if (circular_buf_empty(ring)) {
+			ale_host_cmd_reply(&vara->cmd, "CLEANTXBUFFERBUFFEREMPTY");
+			return;
+		}
+		circular_buf_reset(ring);
+		ale_host_cmd_reply(&vara->cmd, "CLEANTXBUFFEROK");
+		ale_host_cmd_buffer(&vara->cmd, vara->st, false);
+		ale_host_tx_schedule(st);
+		return;
+	} else {
+		for (int i = 0; i < ARRAY_SIZE(vara_noop_cmds); i++) {
+			if (!strcasecmp(argv[0], vara_noop_cmds[i])) {
+				ale_host_cmd_reply(&vara->cmd, "OK");
+				return;
+			}
+		}
+		goto wrong;
+	}
+
+	ale_host_cmd_reply(&vara->cmd, "OK");
+	return;
+
+wrong:
+	ale_host_cmd_reply(&vara->cmd, "WRONG");
+}
+
+static int vara_cmd_read_cb(struct osmo_stream_srv *conn)
+{
+	struct vara_tnc *vara = osmo_stream_srv_get_data(conn);
+
+	return ale_host_cmd_read(&vara->cmd);
+}
+
+static int vara_cmd_closed_cb(struct osmo_stream_srv *conn)
+{
+	struct vara_tnc *vara = osmo_stream_srv_get_data(conn);
+
+	LOGP(ALE, LOGL_NOTICE, "VARA command client disconnected\n");
+	ale_host_cmd_attach(&vara->cmd, NULL);
+	osmo_timer_del(&vara->alive_timer);
+	return 0;
+}
+
+static int vara_data_read_cb(struct osmo_stream_srv *conn)
+{
+	struct vara_tnc *vara = osmo_stream_srv_get_data(conn);
+	struct osmo_fd *ofd = osmo_stream_srv_get_ofd(conn);
+	cbuf_handle_t ring = ale_host_tx_ring(vara->st, &vara->tx);
+	ssize_t rc;
+
+	rc = ale_host_sock_to_ring(ofd->fd, ring, ale_host_tx_quota(vara->st, &vara->tx));
+	if (rc == -EAGAIN) {
+		if (!circular_buf_free_size(ring) || !ale_host_tx_quota(vara->st, &vara->tx)) {
+			osmo_fd_read_disable(ofd);
+			ale_host_tx_wait(vara->st, &vara->tx);
+		}
+		return 0;
+	}
+	if (rc <= 0) {
+		osmo_stream_srv_destroy(conn);
+		return -EBADF;
+	}
+
+	ale_host_tx_wrote(vara->st, &vara->tx, rc);
+	ale_host_cmd_buffer(&vara->cmd, vara->st, false);
+	return 0;
+}
+
+static void vara_data_in_cb(struct ale_uring_op *op, int res)
+{
+	struct vara_tnc *vara = ale_uring_op_data(op);
+
+	if (res <= 0) {
+		osmo_stream_srv_destroy(vara->data);
+		return;
+	}
+
+	ale_host_tx_wrote(vara->st, &vara->tx, res);
+	ale_host_cmd_buffer(&vara->cmd, vara->st, false);
+	// stops while the ring is full or another client owns the class
+	if (ale_uring_arm(op, ale_host_tx_quota(vara->st, &vara->tx)) < 0)
+		ale_host_tx_wait(vara->st, &vara->tx);
+}
+
+static void vara_data_out_cb(struct ale_uring_op *op, int res)
+{
+	if (res < 0) {
+		if (res != -ECANCELED)
+			LOGP(ALE, LOGL_NOTICE, "VARA data port write failed: %s\n", strerror(-res));
+		return;
+	}
+	ale_uring_arm(op, SIZE_MAX);
+}
+
+static int vara_data_closed_cb(struct osmo_stream_srv *conn)
+{
+	struct vara_tnc *vara = osmo_stream_srv_get_data(conn);
+
+	LOGP(ALE, LOGL_NOTICE, "VARA data client disconnected\n");
+	vara->data = NULL;
+	ale_uring_release(vara->data_in);
+	ale_uring_release(vara->data_out);
+	vara->data_in = vara->data_out = NULL;
+	ale_host_rx_detach(vara->st, &vara->rx);
+	ale_host_tx_detach(vara->st, &vara->tx);
+	osmo_timer_del(&vara->rx_timer);
+	return 0;
+}
+
+static int vara_cmd_accept_cb(struct osmo_stream_srv_link *link, int fd)
+{
+	struct vara_tnc *vara = osmo_stream_srv_link_get_data(link);
+	struct osmo_stream_srv *conn;
+
+	if (vara->cmd.conn) {
+		LOGP(ALE, LOGL_NOTICE, "VARA command port busy, rejecting client\n");
+		close(fd);
+		return -EBUSY;
+	}
+
+	conn = osmo_stream_srv_create(vara, link, fd, vara_cmd_read_cb, vara_cmd_closed_cb, vara);
+	if (!conn) {
+		close(fd);
+		return -ENOMEM;
+	}
+	ale_host_cmd_attach(&vara->cmd, conn);
+
+	LOGP(ALE, LOGL_NOTICE, "VARA command client connected\n");
+	osmo_timer_schedule(&vara->alive_timer, VARA_IAMALIVE_SECS, 0);
+	return 0;
+}
+
+static int vara_data_accept_cb(struct osmo_stream_srv_link *link, int fd)
+{
+	struct vara_tnc *vara = osmo_stream_srv_link_get_data(link);
+
+	if (vara->data) {
+		LOGP(ALE, LOGL_NOTICE, "VARA data port busy, rejecting client\n");
+		close(fd);
+		return -EBUSY;
+	}
+
+	vara->data = osmo_stream_srv_create(vara, link, fd, vara_data_read_cb, vara_data_closed_cb, vara);
+	if (!vara->data) {
+		close(fd);
+		return -ENOMEM;
+	}
+
+	vara->rx.cls = vara->st->vara_class;
+	ale_host_rx_attach(vara->st, &vara->rx);
+	vara->tx.prio = vara->st->vara_prio;
+	vara->tx.cls = vara->st->vara_class;
+	ale_host_tx_attach(vara->st, &vara->tx);
+
+	if (ale_uring_active()) {
+		vara->data_in = ale_uring_ring_op(fd, ale_host_tx_ring(vara->st, &vara->tx),
+						  vara_data_in_cb, vara);
+		vara->data_out = ale_uring_rx_op(fd, vara->st, &vara->rx, vara_data_out_cb, vara);
+		osmo_fd_read_disable(osmo_stream_srv_get_ofd(vara->data));
+		vara_data_resume(&vara->tx);
+	}
+
+	LOGP(ALE, LOGL_NOTICE, "VARA data client connected\n");
+	vara_rx_flush(vara);
+	return 0;
+}
+
+static void vara_event(struct ale_host_if *hif, struct ale_station *st, enum ale_host_event ev)
+{
+	struct vara_tnc *vara = hif->priv;
+
+	switch (ev) {
+	case ALE_HOST_PENDING:
+		ale_host_cmd_reply(&vara->cmd, "PENDING");
+		break;
+	case ALE_HOST_CANCELPENDING:
+		ale_host_cmd_reply(&vara->cmd, "CANCELPENDING");
+		break;
+	case ALE_HOST_CONNECTED:
+		// source is the calling station
+		if (st->call_tries)
+			ale_host_cmd_reply(&vara->cmd, "CONNECTED %s %s %d", st->callsign, st->remote, VARA_BW);
+		else
+			ale_host_cmd_reply(&vara->cmd, "CONNECTED %s %s %d", st->remote, st->callsign, VARA_BW);
+		break;
+	case ALE_HOST_DISCONNECTED:
+		ale_host_cmd_reply(&vara->cmd, "DISCONNECTED");
+		break;
+	case ALE_HOST_PTT_ON:
+		ale_host_cmd_reply(&vara->cmd, "PTT ON");
+		break;
+	case ALE_HOST_PTT_OFF:
+		ale_host_cmd_reply(&vara->cmd, "PTT OFF");
+		break;
+	case ALE_HOST_BUFFER:
+		ale_host_cmd_buffer(&vara->cmd, vara->st, false);
+		break;
+	case ALE_HOST_RX_DATA:
+		vara_rx_flush(vara);
+		break;
+	case ALE_HOST_TURN:
+		if (st->rate.rx_snr_valid)
+			ale_host_cmd_reply(&vara->cmd, "SN %.1f", st->rate.rx_snr_db);
+		ale_host_cmd_reply(&vara->cmd, "BITRATE (%d) %u BPS", st->arq->mode->id, ale_host_bitrate(st));
+		break;
+	}
+}
+
+int ale_vara_init(void *ctx, struct ale_station *st)
+{
+	struct vara_tnc *vara;
+
+	if (!st->vara_port)
+		return 0;
+
+	vara = talloc_zero(ctx, struct vara_tnc);
+	OSMO_ASSERT(vara);
+	vara->st = st;
+	osmo_timer_setup(&vara->alive_timer, vara_alive_timer_cb, vara);
+	osmo_timer_setup(&vara->rx_timer, vara_rx_timer_cb, vara);
+	vara->rx = (struct ale_host_rx) {
+		.name = "VARA",
+		.stalled = vara_rx_stalled,
+		.priv = vara,
+	};
+	vara->tx = (struct ale_host_tx) {
+		.name = "VARA",
+		.resume = vara_data_resume,
+		.priv = vara,
+	};
+
+	vara->cmd = (struct ale_host_cmd) {
+		.name = "VARA",
+		.command = vara_command,
+		.priv = vara,
+	};
+	vara->cmd_link = ale_host_listen(vara, st, st->vara_port, vara_cmd_accept_cb, vara);
+	vara->data_link = ale_host_listen(vara, st, st->vara_port + 1, vara_data_accept_cb, vara);
+	if (!vara->cmd_link || !vara->data_link) {
+		if (vara->cmd_link)
+			osmo_stream_srv_link_destroy(vara->cmd_link);
+		if (vara->data_link)
+			osmo_stream_srv_link_destroy(vara->data_link);
+		talloc_free(vara);
+		return -1;
+	}
+
+	vara->hif = (struct ale_host_if) {
+		.name = "vara",
+		.event = vara_event,
+		.priv = vara,
+	};
+	ale_host_register(&vara->hif);
+
+	LOGP(ALE, LOGL_NOTICE, "VARA TNC on port %u (data %u)\n", st->vara_port, st->vara_port + 1);
+	return 0;
+}
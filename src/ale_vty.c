@@ -1,12 +1,24 @@
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <inttypes.h>
 
 #include <osmocom/core/utils.h>
+#include <osmocom/core/talloc.h>
 
 #include <osmocom/vty/command.h>
 #include <osmocom/vty/buffer.h>
 #include <osmocom/vty/vty.h>
 
+#include "internal.h"
+#include "ale_uring.h"
+#include "ale_pool.h"
+#include "ale_log.h"
+#include "ale_flight.h"
+#include "ale_lat.h"
+#include "ale_replay.h"
+
 enum ale_vty_node {
 	ALE_NODE = _LAST_OSMOVTY_NODE + 1
 };
@@ -17,6 +29,10 @@ static struct cmd_node ale_node = {
 	1,
 };
 
+/* "replay": modem counters when it started */
+static struct ale_replay vty_replay;
+static uint64_t replay_frames, replay_crc, replay_sync_lost;
+
 DEFUN(cfg_ale, cfg_ale_cmd,
 	"ale",
 	"HF ALE Controller\n")
@@ -25,9 +41,1150 @@ DEFUN(cfg_ale, cfg_ale_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_ale_callsign, cfg_ale_callsign_cmd,
+	"callsign WORD",
+	"Station callsign\n"
+	"Callsign, up to 8 characters (A-Z, 0-9, / and -)\n")
+{
+	if (strlen(argv[0]) > ARQ_CALLSIGN_LEN) {
+		vty_out(vty, "%% Callsign too long%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	OSMO_STRLCPY_ARRAY(g_ale->callsign, argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_data_mode, cfg_ale_data_mode_cmd,
+	"data-mode (datac4|datac3|datac1)",
+	"Initial speed level (or fixed one without rate adaptation)\n"
+	"DATAC4, 54 bytes per frame\n"
+	"DATAC3, 126 bytes per frame\n"
+	"DATAC1, 510 bytes per frame\n")
+{
+	const struct ale_mode *mode = ale_mode_by_name(argv[0]);
+
+	if (!ale_mode_usable(mode)) {
+		vty_out(vty, "%% The modem does not carry %s%s", mode->name, VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	g_ale->rate.level = mode->id;
+	ale_arq_set_mode(g_ale->arq, mode);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_rate_adaptation, cfg_ale_rate_adaptation_cmd,
+	"rate-adaptation",
+	"Change the speed level from the measured SNR and error rates\n")
+{
+	g_ale->rate.enabled = true;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_rate_adaptation, cfg_ale_no_rate_adaptation_cmd,
+	"no rate-adaptation",
+	NO_STR "Keep the configured data-mode\n")
+{
+	g_ale->rate.enabled = false;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_compression, cfg_ale_compression_cmd,
+	"compression",
+	"Offer payload compression in the call setup\n")
+{
+	g_ale->compression = true;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_compression, cfg_ale_no_compression_cmd,
+	"no compression",
+	NO_STR "Send the payload as is\n")
+{
+	g_ale->compression = false;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_comp_dict, cfg_ale_comp_dict_cmd,
+	"compression-dictionary (default|FILE)",
+	"Preset dictionary of the compressor, both ends must use the same\n"
+	"Built-in email header dictionary\n"
+	"File with the dictionary, up to 32 KiB\n")
+{
+	uint8_t *dict;
+	FILE *fp;
+	size_t len;
+
+	if (!strcmp(argv[0], "default")) {
+		ale_comp_set_dict(g_ale->comp, NULL, 0);
+		TALLOC_FREE(g_ale->comp_dict);
+		return CMD_SUCCESS;
+	}
+
+	fp = fopen(argv[0], "rb");
+	if (!fp) {
+		vty_out(vty, "%% Can't open %s: %s%s", argv[0], strerror(errno), VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	dict = malloc(COMP_MAX_DICT + 1);
+	len = fread(dict, 1, COMP_MAX_DICT + 1, fp);
+	fclose(fp);
+
+	if (!len || ale_comp_set_dict(g_ale->comp, dict, len) < 0) {
+		vty_out(vty, "%% Dictionary must be 1 to %d bytes%s", COMP_MAX_DICT, VTY_NEWLINE);
+		free(dict);
+		return CMD_WARNING;
+	}
+	free(dict);
+	osmo_talloc_replace_string(g_ale, &g_ale->comp_dict, argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_tx_batch, cfg_ale_tx_batch_cmd,
+	"tx-batch-deadline <0-600000>",
+	"Hold partly filled TX frames until more host data fills them\n"
+	"Maximum time data may be held, in milliseconds (0 to send partial frames right away)\n")
+{
+	g_ale->batch->deadline_ms = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_host_bind, cfg_ale_host_bind_cmd,
+	"host-bind A.B.C.D",
+	"Address the host interface ports listen on\n"
+	"IPv4 address (127.0.0.1 by default)\n")
+{
+	osmo_talloc_replace_string(g_ale, &g_ale->host_bind, argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_host_io, cfg_ale_host_io_cmd,
+	"host-io (poll|uring)",
+	"Socket I/O of the host interfaces (read at start up)\n"
+	"osmo_fd callbacks of the select loop\n"
+	"io_uring, falls back to poll when unavailable\n")
+{
+	g_ale->host_io_uring = !strcmp(argv[0], "uring");
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_vara_port, cfg_ale_vara_port_cmd,
+	"vara-port <0-65534>",
+	"VARA compatible TNC command port, the data port is the next one\n"
+	"TCP port (8300 by default), 0 to disable\n")
+{
+	g_ale->vara_port = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_ardop_port, cfg_ale_ardop_port_cmd,
+	"ardop-port <0-65534>",
+	"ARDOP compatible TNC command port, the data port is the next one\n"
+	"TCP port (8515 by default), 0 to disable\n")
+{
+	g_ale->ardop_port = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_host_prio, cfg_ale_host_prio_cmd,
+	"host-priority (vara|ardop|local) <0-7>",
+	"Order in which host clients waiting for the same TX class get it\n"
+	"VARA data port\n" "ARDOP data port\n" "libale-client\n"
+	"Higher goes first (3 by default)\n")
+{
+	if (!strcmp(argv[0], "vara"))
+		g_ale->vara_prio = atoi(argv[1]);
+	else if (!strcmp(argv[0], "ardop"))
+		g_ale->ardop_prio = atoi(argv[1]);
+	else
+		g_ale->local_prio = atoi(argv[1]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_host_class, cfg_ale_host_class_cmd,
+	"host-class (vara|ardop) (express|interactive|bulk)",
+	"Priority class of the stream a host client sends and receives\n"
+	"VARA data port\n" "ARDOP data port\n"
+	"Served first, for short urgent traffic\n"
+	"Weighted share, for keyboard chat and small requests\n"
+	"Weighted share, for file and mail transfers (default)\n")
+{
+	enum ale_tx_class cls = ale_txq_class_parse(argv[1]);
+
+	if (!strcmp(argv[0], "vara"))
+		g_ale->vara_class = cls;
+	else
+		g_ale->ardop_class = cls;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_tx_weight, cfg_ale_tx_weight_cmd,
+	"tx-weight (interactive|bulk) <1-64>",
+	"Share of the frames left over by the express class\n"
+	"Interactive class (4 by default)\n" "Bulk class (1 by default)\n"
+	"Weight, in quanta of 256 bytes per round\n")
+{
+	ale_txq_set_weight(g_ale->txq, ale_txq_class_parse(argv[0]), atoi(argv[1]));
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_kiss_port, cfg_ale_kiss_port_cmd,
+	"kiss-port <0-65535>",
+	"KISS TNC port, frames are sent as UI frames between sessions\n"
+	"TCP port (8100 by default), 0 to disable\n")
+{
+	g_ale->kiss_port = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_local_socket, cfg_ale_local_socket_cmd,
+	"local-socket PATH",
+	"Control socket of libale-client, the shared memory fast path\n"
+	"Unix socket path (" ALE_CLIENT_DEFAULT_PATH " by default)\n")
+{
+	osmo_talloc_replace_string(g_ale, &g_ale->local_path, argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_flight_file, cfg_ale_flight_file_cmd,
+	"flight-recorder-file PATH",
+	"Flight recorder dump written on SIGUSR1 and on abort\n"
+	"File path (" ALE_FLIGHT_DEFAULT_FILE " by default)\n")
+{
+	ale_flight_set_file(argv[0]);
+	return CMD_SUCCESS;
+}
+
+#define REC_STR "Recorder of the received audio\n"
+
+DEFUN(cfg_ale_rec_dir, cfg_ale_rec_dir_cmd,
+	"recorder directory PATH",
+	REC_STR "Record into a directory, from the next start\n" "Directory path\n")
+{
+	struct ale_rec_cfg *cfg = &g_ale->rec->cfg;
+
+	if (strlen(argv[0]) >= sizeof(cfg->dir)) {
+		vty_out(vty, "%% Path too long%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	OSMO_STRLCPY_ARRAY(cfg->dir, argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_rec, cfg_ale_no_rec_cmd,
+	"no recorder",
+	NO_STR "Do not record the received audio (default)\n")
+{
+	g_ale->rec->cfg.dir[0] = 0;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_rec_rotate, cfg_ale_rec_rotate_cmd,
+	"recorder rotate (size|time) <1-86400>",
+	REC_STR "Start a new recording file\n"
+	"When a file reaches a size, in MB (" OSMO_STRINGIFY_VAL(ALE_REC_DEFAULT_FILE_MB) " by default)\n"
+	"When a file reaches an age, in seconds (" OSMO_STRINGIFY_VAL(ALE_REC_DEFAULT_FILE_SECS)
+	" by default)\n"
+	"Limit\n")
+{
+	struct ale_rec_cfg *cfg = &g_ale->rec->cfg;
+
+	if (argv[0][0] == 's')
+		cfg->file_mb = OSMO_MIN(atoi(argv[1]), 2048);
+	else
+		cfg->file_secs = atoi(argv[1]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_rec_files, cfg_ale_rec_files_cmd,
+	"recorder files <2-1000>",
+	REC_STR "Recording files kept, the oldest is removed (kept ones aside)\n"
+	"Number of files (" OSMO_STRINGIFY_VAL(ALE_REC_DEFAULT_FILES) " by default)\n")
+{
+	g_ale->rec->cfg.files = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_rec_keep_secs, cfg_ale_rec_keep_secs_cmd,
+	"recorder keep-seconds <1-3600>",
+	REC_STR "Seconds kept before and after a \"recorder keep\"\n"
+	"Seconds (" OSMO_STRINGIFY_VAL(ALE_REC_DEFAULT_KEEP_SECS) " by default)\n")
+{
+	g_ale->rec->cfg.keep_secs = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_frequency, cfg_ale_frequency_cmd,
+	"frequency <0-30000000>",
+	"Channel the radio is on, when not scanning\n" "Dial frequency in Hz, 0: unknown\n")
+{
+	g_ale->freq_hz = atoi(argv[0]);
+	ale_rec_set_freq(g_ale->rec, g_ale->freq_hz);
+	ale_spec_set_freq(g_ale->spec, g_ale->freq_hz);
+	return CMD_SUCCESS;
+}
+
+#define LQA_STR "Link quality analysis store\n"
+
+DEFUN(cfg_ale_lqa_file, cfg_ale_lqa_file_cmd,
+	"lqa file PATH",
+	LQA_STR "Keep the history in a memory-mapped file, from the next start\n" "File path\n")
+{
+	osmo_talloc_replace_string(g_ale, &g_ale->lqa_file, argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_lqa_file, cfg_ale_no_lqa_file_cmd,
+	"no lqa file",
+	NO_STR LQA_STR "Keep the history in memory only (default)\n")
+{
+	TALLOC_FREE(g_ale->lqa_file);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_lqa_half_life, cfg_ale_lqa_half_life_cmd,
+	"lqa half-life <60-2592000>",
+	LQA_STR "Age at which a sample counts half\n"
+	"Seconds (" OSMO_STRINGIFY_VAL(ALE_LQA_DEFAULT_HALF_LIFE) " by default)\n")
+{
+	g_ale->lqa->half_life = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+#define ADDR_STR "Address book entry\n" \
+	"Address, '?' for any one character, a trailing '*' for any rest\n"
+#define ADDR_KIND_STR "A known station, or a group of them\n" \
+	"One of our net or group addresses, calls to it are answered\n" \
+	"Calls from it are ignored\n"
+
+DEFUN(cfg_ale_address, cfg_ale_address_cmd,
+	"address PATTERN (station|net|deny) [NAME]",
+	ADDR_STR ADDR_KIND_STR "Name shown in the logs\n")
+{
+	if (ale_addr_add(g_ale->addr, argv[0], ale_addr_kind_by_name(argv[1]), argc > 2 ? argv[2] : NULL) < 0) {
+		vty_out(vty, "%% Bad address %s: %s%s", argv[0], strerror(errno), VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_address, cfg_ale_no_address_cmd,
+	"no address PATTERN (station|net|deny)",
+	NO_STR ADDR_STR ADDR_KIND_STR)
+{
+	if (ale_addr_del(g_ale->addr, argv[0], ale_addr_kind_by_name(argv[1])) < 0) {
+		vty_out(vty, "%% No %s address %s%s", argv[1], argv[0], VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	return CMD_SUCCESS;
+}
+
+#define SPEC_STR "Spectrum feed in shared memory for GUIs\n"
+
+DEFUN(cfg_ale_spec, cfg_ale_spec_cmd,
+	"spectrum",
+	"Publish the spectrum of the received audio in shared memory, from the next start\n")
+{
+	g_ale->spec->enabled = true;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_spec, cfg_ale_no_spec_cmd,
+	"no spectrum",
+	NO_STR "Do not publish the spectrum (default)\n")
+{
+	g_ale->spec->enabled = false;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_spec_bins, cfg_ale_spec_bins_cmd,
+	"spectrum bins (64|128|256|512|1024|2048|4096)",
+	SPEC_STR "Bins per frame, over 0 to 4 kHz\n"
+	"64 bins\n" "128 bins\n" "256 bins\n" "512 bins (default)\n" "1024 bins\n" "2048 bins\n" "4096 bins\n")
+{
+	ale_spec_set(g_ale->spec, atoi(argv[0]), atomic_load(&g_ale->spec->fps));
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_spec_fps, cfg_ale_spec_fps_cmd,
+	"spectrum frame-rate <1-50>",
+	SPEC_STR "Frames per second, the FFTs in between are averaged\n"
+	"Frames per second (" OSMO_STRINGIFY_VAL(ALE_SPEC_DEFAULT_FPS) " by default)\n")
+{
+	ale_spec_set(g_ale->spec, atomic_load(&g_ale->spec->bins), atoi(argv[0]));
+	return CMD_SUCCESS;
+}
+
+#define SCAN_STR "Channel scan\n"
+#define SCAN_LIST_STR "Scan list\n" "Name of the list\n"
+
+DEFUN(cfg_ale_scan_list_channel, cfg_ale_scan_list_channel_cmd,
+	"scan-list NAME channel <100000-30000000> [<10-60000>]",
+	SCAN_LIST_STR "Add a channel, or change its dwell\n" "Dial frequency in Hz\n"
+	"Dwell in ms (the dwell of the list by default)\n")
+{
+	struct ale_scan_list *list = ale_scan_list_get(g_ale->scan, argv[0], true);
+
+	if (!list) {
+		vty_out(vty, "%% Too many scan lists, or the name is longer than %d%s",
+			ALE_SCAN_NAME_LEN - 1, VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	if (ale_scan_channel_add(list, atoi(argv[1]), argc > 2 ? atoi(argv[2]) : 0) < 0) {
+		vty_out(vty, "%% Scan list %s is full%s", argv[0], VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_scan_list_channel, cfg_ale_no_scan_list_channel_cmd,
+	"no scan-list NAME channel <100000-30000000>",
+	NO_STR SCAN_LIST_STR "Remove a channel\n" "Dial frequency in Hz\n")
+{
+	struct ale_scan_list *list = ale_scan_list_get(g_ale->scan, argv[0], false);
+
+	if (!list || ale_scan_channel_del(list, atoi(argv[1])) < 0) {
+		vty_out(vty, "%% No channel %s in scan list %s%s", argv[1], argv[0], VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	// the scan starts over on what is left of its list
+	if (g_ale->scan->list == list)
+		ale_rig_scan(g_ale, list->count ? list->name : NULL);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_scan_list_dwell, cfg_ale_scan_list_dwell_cmd,
+	"scan-list NAME dwell <10-60000>",
+	SCAN_LIST_STR "Dwell on the channels without their own\n"
+	"Milliseconds (" OSMO_STRINGIFY_VAL(ALE_SCAN_DEFAULT_DWELL_MS) " by default)\n")
+{
+	struct ale_scan_list *list = ale_scan_list_get(g_ale->scan, argv[0], true);
+
+	if (!list) {
+		vty_out(vty, "%% Too many scan lists, or the name is longer than %d%s",
+			ALE_SCAN_NAME_LEN - 1, VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	list->dwell_ms = atoi(argv[1]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_scan_list, cfg_ale_no_scan_list_cmd,
+	"no scan-list NAME",
+	NO_STR SCAN_LIST_STR)
+{
+	if (ale_scan_list_del(g_ale->scan, argv[0]) < 0) {
+		vty_out(vty, "%% No scan list %s%s", argv[0], VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	ale_rig_kick(g_ale);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_scan, cfg_ale_scan_cmd,
+	"scan NAME",
+	SCAN_STR "Scan list to scan while idle\n")
+{
+	bool running = g_ale->scan->list && !strcmp(g_ale->scan->list->name, argv[0]);
+
+	osmo_talloc_replace_string(g_ale, &g_ale->scan_list, argv[0]);
+	if (!running && ale_rig_scan(g_ale, argv[0]) < 0) {
+		vty_out(vty, "%% Scan list %s is empty or not configured%s", argv[0], VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_scan, cfg_ale_no_scan_cmd,
+	"no scan",
+	NO_STR "Stay on the configured frequency (default)\n")
+{
+	TALLOC_FREE(g_ale->scan_list);
+	ale_rig_scan(g_ale, NULL);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_scan_extension, cfg_ale_scan_extension_cmd,
+	"scan dwell-extension <0-60000> <0-600000>",
+	SCAN_STR "Dwell extension while the modem is in sync\n"
+	"Milliseconds to stay once the sync is lost (" OSMO_STRINGIFY_VAL(ALE_SCAN_DEFAULT_EXTEND_MS) " by default)\n"
+	"Longest extension in milliseconds, 0: none (" OSMO_STRINGIFY_VAL(ALE_SCAN_DEFAULT_MAX_EXTEND_MS) " by default)\n")
+{
+	g_ale->scan->extend_ms = atoi(argv[0]);
+	g_ale->scan->max_extend_ms = atoi(argv[1]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_rig, cfg_ale_rig_cmd,
+	"rig rigctld HOST <1-65535>",
+	"Rig control, tunes the radio to the channels of the scan\n" "hamlib rig daemon over TCP\n"
+	"Host name or address\n" "TCP port (4532 is the rigctld default)\n")
+{
+	osmo_talloc_replace_string(g_ale, &g_ale->rig_host, argv[0]);
+	g_ale->rig_port = atoi(argv[1]);
+	ale_rig_connect(g_ale);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_rig, cfg_ale_no_rig_cmd,
+	"no rig",
+	NO_STR "No rig control, the radio stays where it is (default)\n")
+{
+	TALLOC_FREE(g_ale->rig_host);
+	ale_rig_connect(g_ale);
+	return CMD_SUCCESS;
+}
+
+#define SOUND_STR "Soundings, to keep the LQA of the channels fresh\n"
+
+DEFUN(cfg_ale_sound, cfg_ale_sound_cmd,
+	"sounding",
+	"Sound while idle, on the channels whose LQA is stale or uncertain\n")
+{
+	g_ale->sound->enabled = true;
+	osmo_timer_schedule(&g_ale->sound_timer, 0, 0);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_sound, cfg_ale_no_sound_cmd,
+	"no sounding",
+	NO_STR "Do not sound (default)\n")
+{
+	g_ale->sound->enabled = false;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_sound_stale, cfg_ale_sound_stale_cmd,
+	"sounding stale-after <60-86400>",
+	SOUND_STR "Age at which a well known channel is due, uncertain ones up to 3 times sooner\n"
+	"Seconds (" OSMO_STRINGIFY_VAL(ALE_SOUND_DEFAULT_STALE_S) " by default)\n")
+{
+	g_ale->sound->stale_s = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_sound_interval, cfg_ale_sound_interval_cmd,
+	"sounding interval <10-86400>",
+	SOUND_STR "Shortest gap between soundings of a channel, doubled while nothing is heard there\n"
+	"Seconds (" OSMO_STRINGIFY_VAL(ALE_SOUND_DEFAULT_INTERVAL_S) " by default)\n")
+{
+	g_ale->sound->interval_s = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_sound_busy, cfg_ale_sound_busy_cmd,
+	"sounding busy-hold <0-3600>",
+	SOUND_STR "No sounding on a channel after activity on it\n"
+	"Seconds (" OSMO_STRINGIFY_VAL(ALE_SOUND_DEFAULT_BUSY_S) " by default)\n")
+{
+	g_ale->sound->busy_s = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_sound_duty, cfg_ale_sound_duty_cmd,
+	"sounding duty-cycle <1-1000> [<60-86400>]",
+	SOUND_STR "Airtime budget of the soundings\n"
+	"Per mille of the time (" OSMO_STRINGIFY_VAL(ALE_SOUND_DEFAULT_DUTY) " by default)\n"
+	"Seconds of it that can be saved up (" OSMO_STRINGIFY_VAL(ALE_SOUND_DEFAULT_WINDOW_S) " by default)\n")
+{
+	g_ale->sound->duty_permille = atoi(argv[0]);
+	if (argc > 1)
+		g_ale->sound->window_s = atoi(argv[1]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_ale_no_local_socket, cfg_ale_no_local_socket_cmd,
+	"no local-socket",
+	NO_STR "Disable the libale-client control socket\n")
+{
+	TALLOC_FREE(g_ale->local_path);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_rate, show_ale_rate_cmd,
+	"show ale rate",
+	SHOW_STR "HF ALE Controller\n" "Speed level controller\n")
+{
+	struct ale_rate *rate = &g_ale->rate;
+
+	vty_out(vty, "Speed level: %s (rate adaptation %s)%s",
+		ale_mode_get(rate->level)->name, rate->enabled ? "on" : "off", VTY_NEWLINE);
+	if (rate->snr_valid)
+		vty_out(vty, " SNR at the peer: %.1f dB%s", rate->snr_db, VTY_NEWLINE);
+	else
+		vty_out(vty, " SNR at the peer: none%s", VTY_NEWLINE);
+	if (rate->rx_snr_valid)
+		vty_out(vty, " SNR here: %.1f dB%s", rate->rx_snr_db, VTY_NEWLINE);
+	else
+		vty_out(vty, " SNR here: none%s", VTY_NEWLINE);
+	vty_out(vty, " Frame error rate: %.3f, retransmission ratio: %.3f%s",
+		rate->fer, rate->retry, VTY_NEWLINE);
+	vty_out(vty, " Frames received: %lu, CRC errors: %lu%s",
+		rate->stats.rx_frames, rate->stats.rx_errors, VTY_NEWLINE);
+	vty_out(vty, " Last decision: %s%s", ale_rate_reason_names[rate->last], VTY_NEWLINE);
+
+	vty_out(vty, " Decisions:%s", VTY_NEWLINE);
+	for (int i = 0; i < _NUM_RATE_REASONS; i++)
+		vty_out(vty, "  %-10s %lu%s", ale_rate_reason_names[i],
+			rate->stats.decisions[i], VTY_NEWLINE);
+
+	vty_out(vty, " Turns per level:%s", VTY_NEWLINE);
+	for (int i = 0; i < _NUM_ALE_MODES; i++) {
+		const struct ale_mode *mode = ale_mode_get(i);
+
+		if (mode->data)
+			vty_out(vty, "  %-10s %lu%s%s", mode->name, rate->stats.turns_at[i],
+				ale_mode_usable(mode) ? "" : " (rejected by the modem)", VTY_NEWLINE);
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_compression, show_ale_compression_cmd,
+	"show ale compression",
+	SHOW_STR "HF ALE Controller\n" "Payload compression of the current (or last) session\n")
+{
+	struct ale_comp *comp = g_ale->comp;
+	struct ale_comp_stats *cs = &comp->stats;
+
+	vty_out(vty, "Compression: %s, dictionary %s (%zu bytes, id %08x)%s",
+		g_ale->compression ? "offered" : "off",
+		g_ale->comp_dict ? g_ale->comp_dict : "default",
+		comp->dict_len, comp->dict_id, VTY_NEWLINE);
+	vty_out(vty, " Session: %s%s", comp->active ?
+		(comp->use_dict ? "compressed" : "compressed, no dictionary") : "not compressed",
+		VTY_NEWLINE);
+	vty_out(vty, " TX: %lu -> %lu bytes, ratio %.2f, %lu flushes%s",
+		cs->tx_in, cs->tx_out, ale_comp_ratio(cs), cs->tx_flushes, VTY_NEWLINE);
+	vty_out(vty, " RX: %lu -> %lu bytes, %lu errors, %lu dictionary mismatches%s", cs->rx_in,
+		cs->rx_out, cs->rx_errors, cs->dict_mismatches, VTY_NEWLINE);
+	vty_out(vty, " CPU: %.2f ms%s", cs->cpu_ms, VTY_NEWLINE);
+	if (comp->dict_refused)
+		vty_out(vty, " Dictionary withdrawn, a peer used another one%s", VTY_NEWLINE);
+	if (comp->rx_error)
+		vty_out(vty, " Decompression failed, session ending%s", VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_batch, show_ale_batch_cmd,
+	"show ale batch",
+	SHOW_STR "HF ALE Controller\n" "TX frame aggregation\n")
+{
+	struct ale_batch_stats *bs = &g_ale->batch->stats;
+
+	vty_out(vty, "TX batching deadline: %u ms%s", g_ale->batch->deadline_ms, VTY_NEWLINE);
+	vty_out(vty, " Data frames: %lu, fill ratio %.3f (%lu of %lu bytes)%s",
+		bs->frames, ale_batch_fill(bs), bs->bytes, bs->capacity, VTY_NEWLINE);
+	vty_out(vty, " Partial frames held: %lu%s", bs->holds, VTY_NEWLINE);
+	vty_out(vty, " Flush reasons:%s", VTY_NEWLINE);
+	for (int i = 0; i < _NUM_BATCH_REASONS; i++)
+		vty_out(vty, "  %-10s %lu%s", ale_batch_reason_names[i], bs->flushes[i], VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_host_io, show_ale_host_io_cmd,
+	"show ale host-io",
+	SHOW_STR "HF ALE Controller\n" "Socket I/O backend of the host interfaces\n")
+{
+	const struct ale_uring_stats *us = ale_uring_stats();
+
+	vty_out(vty, "Host I/O: %s%s", ale_uring_active() ? "io_uring" :
+		g_ale->host_io_uring ? "poll (io_uring unavailable)" : "poll", VTY_NEWLINE);
+	if (!ale_uring_active())
+		return CMD_SUCCESS;
+
+	vty_out(vty, " Submissions: %lu (%lu requests), completions: %lu, wake-ups: %lu%s",
+		us->submits, us->sqes, us->cqes, us->wakeups, VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_host_clients, show_ale_host_clients_cmd,
+	"show ale host-clients",
+	SHOW_STR "HF ALE Controller\n" "Host clients reading and writing the data rings\n")
+{
+	struct ale_host_rx *rx;
+	struct ale_host_tx *tx;
+
+	vty_out(vty, "RX readers (rings:");
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+		vty_out(vty, " %s %zu of %zu bytes used%s", ale_txq_class_names[i],
+			circular_buf_size(g_ale->rx_rings[i]), circular_buf_capacity(g_ale->rx_rings[i]),
+			i < ALE_TX_NUM_CLASSES - 1 ? "," : "");
+	vty_out(vty, "):%s", VTY_NEWLINE);
+	llist_for_each_entry(rx, ale_host_rx_list(), list) {
+		vty_out(vty, " %-6s %s, %" PRIu64 " bytes, %zu pending, %" PRIu64 " lost in %lu overruns%s",
+			rx->name, ale_txq_class_names[rx->cls], rx->stats.bytes,
+			ale_host_rx_pending(g_ale, rx), rx->stats.lost, rx->stats.overruns, VTY_NEWLINE);
+	}
+
+	vty_out(vty, "TX writers:%s", VTY_NEWLINE);
+	llist_for_each_entry(tx, ale_host_tx_list(), list) {
+		vty_out(vty, " %-6s %s, priority %u, %" PRIu64 " bytes, %lu waits%s%s%s", tx->name,
+			ale_txq_class_names[tx->cls], tx->prio, tx->stats.bytes, tx->stats.waits,
+			ale_host_tx_owner(tx->cls) == tx ? ", owner" : "",
+			tx->waiting ? ", waiting" : "", VTY_NEWLINE);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_tx_queues, show_ale_tx_queues_cmd,
+	"show ale tx-queues",
+	SHOW_STR "HF ALE Controller\n" "TX priority classes and their queueing delay\n")
+{
+	ale_txq_poll(g_ale->txq);
+	for (int i = 0; i < ALE_TX_NUM_CLASSES; i++) {
+		const struct ale_txq_class *c = &g_ale->txq->cls[i];
+		const struct ale_txq_stats *qs = &c->stats;
+
+		if (c->strict)
+			vty_out(vty, "%s (strict):%s", ale_txq_class_names[i], VTY_NEWLINE);
+		else
+			vty_out(vty, "%s (weight %u):%s", ale_txq_class_names[i], c->weight, VTY_NEWLINE);
+		vty_out(vty, " Queued: %zu of %zu bytes%s", circular_buf_size(c->ring),
+			circular_buf_capacity(c->ring), VTY_NEWLINE);
+		vty_out(vty, " Sent: %" PRIu64 " bytes in %lu turns%s", qs->bytes, qs->turns, VTY_NEWLINE);
+		vty_out(vty, " Received: %" PRIu64 " bytes, RX ring %zu of %zu bytes used%s", qs->rx_bytes,
+			circular_buf_size(c->rx_ring), circular_buf_capacity(c->rx_ring), VTY_NEWLINE);
+		vty_out(vty, " Latency: avg %.0f ms, max %.0f ms (%lu samples)%s",
+			ale_txq_latency(qs), qs->lat_max_ms, qs->lat_count, VTY_NEWLINE);
+	}
+	if (g_ale->txq->rx_errors)
+		vty_out(vty, "Broken RX record streams: %lu%s", g_ale->txq->rx_errors, VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_pools, show_ale_pools_cmd,
+	"show ale pools",
+	SHOW_STR "HF ALE Controller\n" "Preallocated frame pools, misses are allocations\n")
+{
+	struct ale_pool *pool;
+
+	llist_for_each_entry(pool, ale_pool_list(), list) {
+		const struct ale_pool_stats *ps = &pool->stats;
+
+		vty_out(vty, "%-10s %u x %zu bytes, %u in use (peak %u), %lu gets, %lu misses%s",
+			pool->name, pool->count, pool->size, atomic_load(&ps->in_use), atomic_load(&ps->peak),
+			atomic_load(&ps->gets), atomic_load(&ps->misses), VTY_NEWLINE);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_rt_log, show_ale_rt_log_cmd,
+	"show ale rt-log",
+	SHOW_STR "HF ALE Controller\n" "Log rings of the real-time threads\n")
+{
+	struct ale_log_ring *ring;
+
+	for (ring = ale_log_rings(); ring; ring = ring->next) {
+		vty_out(vty, "%-10s %lu records, %u queued, %lu dropped%s", ring->name,
+			atomic_load(&ring->records), atomic_load(&ring->head) - atomic_load(&ring->tail),
+			atomic_load(&ring->drops), VTY_NEWLINE);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_flight, show_ale_flight_cmd,
+	"show ale flight-recorder",
+	SHOW_STR "HF ALE Controller\n" "Event buffers of the flight recorder\n")
+{
+	struct ale_flight_buf *buf;
+
+	for (buf = ale_flight_bufs(); buf; buf = buf->next) {
+		uint64_t seq = atomic_load(&buf->seq);
+
+		vty_out(vty, "%-10s %" PRIu64 " events, last %u held%s", buf->name, seq,
+			(unsigned int) OSMO_MIN(seq, ALE_FLIGHT_EVENTS), VTY_NEWLINE);
+	}
+	vty_out(vty, "Dump file %s%s", ale_flight_file(), VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+DEFUN(flight_dump, flight_dump_cmd,
+	"flight-recorder dump [PATH]",
+	"Flight recorder of the data path\n"
+	"Write the event buffers to a file, decoded by rhizo-ale-flight\n"
+	"File path (the flight-recorder-file by default)\n")
+{
+	const char *path = argc > 0 ? argv[0] : ale_flight_file();
+
+	if (ale_flight_dump(path) < 0) {
+		vty_out(vty, "%% Could not write %s: %s%s", path, strerror(errno), VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	vty_out(vty, "Dumped to %s%s", path, VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_rec, show_ale_rec_cmd,
+	"show ale recorder",
+	SHOW_STR "HF ALE Controller\n" "Recorder of the received audio\n")
+{
+	struct ale_rec *rec = g_ale->rec;
+	struct ale_rec_stats *rs = &rec->stats;
+
+	if (!ale_rec_running(rec)) {
+		vty_out(vty, "Recorder off%s", VTY_NEWLINE);
+		return CMD_SUCCESS;
+	}
+	vty_out(vty, "Recording to %s, %u files of up to %u MB / %u s%s", rec->cfg.dir,
+		rec->cfg.files, rec->cfg.file_mb, rec->cfg.file_secs, VTY_NEWLINE);
+	vty_out(vty, " Samples: %" PRIu64 " written, %" PRIu64 " dropped%s",
+		atomic_load(&rs->samples), atomic_load(&rs->dropped), VTY_NEWLINE);
+	vty_out(vty, " Files: %lu, chunks: %lu, kept: %lu, errors: %lu%s", atomic_load(&rs->files),
+		atomic_load(&rs->chunks), atomic_load(&rs->kept), atomic_load(&rs->errors), VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+static int lqa_entry_cmp(const void *a, const void *b)
+{
+	const struct ale_lqa_entry *ea = *(const struct ale_lqa_entry **) a;
+	const struct ale_lqa_entry *eb = *(const struct ale_lqa_entry **) b;
+
+	if (ea->freq_hz != eb->freq_hz)
+		return ea->freq_hz < eb->freq_hz ? -1 : 1;
+	return memcmp(ea->addr, eb->addr, sizeof(ea->addr));
+}
+
+DEFUN(show_lqa, show_lqa_cmd,
+	"show lqa [ADDRESS]",
+	SHOW_STR "Link quality per channel and station, decayed to now\n"
+	"Only this station (all channels and stations by default)\n")
+{
+	struct ale_lqa *lqa = g_ale->lqa;
+	const struct ale_lqa_entry **list;
+	char addr[ALE_LQA_ADDR_LEN] = { 0 };
+	time_t now = time(NULL);
+	unsigned int n = 0;
+
+	if (argc > 0)
+		memcpy(addr, argv[0], strnlen(argv[0], sizeof(addr)));
+	list = talloc_array(g_ale, const struct ale_lqa_entry *, lqa->slots);
+	for (unsigned int i = 0; i < lqa->slots; i++) {
+		const struct ale_lqa_entry *e = &lqa->table[i];
+
+		if (e->freq_hz && (argc == 0 || !memcmp(e->addr, addr, sizeof(addr))))
+			list[n++] = e;
+	}
+	qsort(list, n, sizeof(*list), lqa_entry_cmp);
+
+	vty_out(vty, "LQA %s, half-life %u s, %u of %u entries%s", lqa->file ? g_ale->lqa_file : "in memory",
+		lqa->half_life, n, lqa->slots, VTY_NEWLINE);
+	vty_out(vty, "Frequency  Station   SNR dB   SD dB  FER %%  Weight  Frames  Age s  Score%s", VTY_NEWLINE);
+	for (unsigned int i = 0; i < n; i++) {
+		const struct ale_lqa_entry *e = list[i];
+		struct ale_lqa_info info;
+
+		ale_lqa_get(lqa, e->freq_hz, e->addr[0] ? e->addr : NULL, now, &info);
+		vty_out(vty, "%9u  %-8.8s  %6.1f  %6.1f  %5.1f  %6.1f  %6u  %5u  %5.1f%s", e->freq_hz,
+			e->addr[0] ? e->addr : "(any)", info.snr_db, info.snr_sd, info.fer * 100, info.weight,
+			e->frames, info.age_s, info.score, VTY_NEWLINE);
+	}
+	talloc_free(list);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_addr, show_ale_addr_cmd,
+	"show ale address-book",
+	SHOW_STR "HF ALE Controller\n" "Index of the address entries\n")
+{
+	struct ale_addr_stats *as = &g_ale->addr->stats;
+	unsigned int entries, masks;
+
+	ale_addr_index_size(g_ale->addr, &entries, &masks);
+	vty_out(vty, "Address book: %u entries in the index, %u address shapes, built in %" PRIu64 " us%s",
+		entries, masks, as->commit_ns / 1000, VTY_NEWLINE);
+	vty_out(vty, " Lookups: %lu, hits: %lu, probes: %lu, rebuilds: %lu%s", as->lookups, as->hits,
+		as->probes, as->commits, VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_addr_lookup, show_ale_addr_lookup_cmd,
+	"show ale address ADDRESS",
+	SHOW_STR "HF ALE Controller\n" "Address book entries matching an address\n" "Address\n")
+{
+	for (int k = 0; k < _NUM_ALE_ADDR_KINDS; k++) {
+		const struct ale_addr_entry *e = ale_addr_lookup(g_ale->addr, k, argv[0]);
+
+		if (e)
+			vty_out(vty, "%-8s %-10s %s%s", ale_addr_kind_name(k), e->pattern, e->name, VTY_NEWLINE);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_spec, show_ale_spec_cmd,
+	"show ale spectrum",
+	SHOW_STR "HF ALE Controller\n" "Spectrum feed in shared memory\n")
+{
+	struct ale_spec *sp = g_ale->spec;
+	struct ale_spec_stats *ss = &sp->stats;
+	uint64_t ffts = atomic_load(&ss->ffts);
+
+	if (!ale_spec_running(sp)) {
+		vty_out(vty, "Spectrum feed off%s", VTY_NEWLINE);
+		return CMD_SUCCESS;
+	}
+	vty_out(vty, "Spectrum in shm key %u: %u bins, %u frames/s, %d viewers%s", ALE_SPEC_SHM_KEY,
+		atomic_load(&sp->bins), atomic_load(&sp->fps), ale_spec_viewers(sp), VTY_NEWLINE);
+	vty_out(vty, " Frames: %" PRIu64 ", FFTs: %" PRIu64 ", %.1f us CPU each%s", atomic_load(&ss->frames),
+		ffts, ffts ? atomic_load(&ss->cpu_ns) / 1e3 / ffts : 0.0, VTY_NEWLINE);
+	vty_out(vty, " Samples dropped: %" PRIu64 "%s", atomic_load(&ss->dropped), VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_scan, show_ale_scan_cmd,
+	"show ale scan",
+	SHOW_STR "HF ALE Controller\n" "Channel scan and rig control\n")
+{
+	struct ale_scan *scan = g_ale->scan;
+	struct ale_scan_stats *ss = &scan->stats;
+	const struct ale_rig_stats *rs = ale_rig_get_stats();
+	struct ale_scan_list *list = scan->list;
+
+	if (!list) {
+		vty_out(vty, "Not scanning, on %u Hz%s", g_ale->freq_hz, VTY_NEWLINE);
+	} else {
+		vty_out(vty, "Scanning %s, %u channels, on %u Hz%s%s", list->name, list->count,
+			ale_scan_freq(scan), scan->held ? " (held by a call)" :
+			scan->detected ? " (in sync)" : "", VTY_NEWLINE);
+		vty_out(vty, " Rate: %.2f channels/s, dwell extension %u ms, up to %u ms%s", ss->rate,
+			scan->extend_ms, scan->max_extend_ms, VTY_NEWLINE);
+	}
+	vty_out(vty, " Hops: %lu, dwells: %lu, missed: %lu, extended: %lu, detections: %lu%s", ss->hops,
+		ss->dwells, ss->missed, ss->extended, ss->detections, VTY_NEWLINE);
+	vty_out(vty, " Hook errors: %lu, latest hop: %u ms late%s", ss->hook_errors, ss->max_late_ms,
+		VTY_NEWLINE);
+	if (g_ale->rig_host)
+		vty_out(vty, "Rig: rigctld %s:%u, %s, %lu commands, %lu errors, %lu hops not ready%s",
+			g_ale->rig_host, g_ale->rig_port, rs->connected ? "connected" : "not connected",
+			rs->sent, rs->errors, rs->busy, VTY_NEWLINE);
+	if (!list)
+		return CMD_SUCCESS;
+
+	vty_out(vty, "  Freq Hz  Dwell  Dwells  Missed  Extended  Detections%s", VTY_NEWLINE);
+	for (unsigned int i = 0; i < list->count; i++) {
+		struct ale_scan_channel *ch = &list->ch[i];
+
+		vty_out(vty, "%c%8u  %5u  %6lu  %6lu  %8lu  %10lu%s", i == scan->cur ? '*' : ' ', ch->freq_hz,
+			ch->dwell_ms ? ch->dwell_ms : list->dwell_ms, ch->dwells, ch->missed, ch->extended,
+			ch->detections, VTY_NEWLINE);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_sound, show_ale_sound_cmd,
+	"show ale sounding",
+	SHOW_STR "HF ALE Controller\n" "Sounding scheduler\n")
+{
+	struct ale_sound *snd = g_ale->sound;
+	struct ale_sound_stats *ss = &snd->stats;
+	const struct ale_modem_stats *ms = g_ale->modem ? ale_modem_get_stats(g_ale->modem) : NULL;
+	time_t now = time(NULL);
+
+	vty_out(vty, "Soundings %s, budget %u ms left (%u per mille, up to %u s saved)%s",
+		snd->enabled ? "on" : "off", ale_sound_budget(snd, now), snd->duty_permille,
+		snd->window_s, VTY_NEWLINE);
+	vty_out(vty, " Sent: %lu, airtime: %.1f s, busy channels skipped: %lu, out of budget: %lu%s",
+		ss->soundings, ss->airtime_ms / 1000.0, ss->busy, ss->no_budget, VTY_NEWLINE);
+	if (ms)
+		vty_out(vty, " Waveform cache: %" PRIu64 " hits, %" PRIu64 " modulated%s",
+			atomic_load(&ms->wave_hits), atomic_load(&ms->wave_misses), VTY_NEWLINE);
+	if (!snd->count)
+		return CMD_SUCCESS;
+
+	vty_out(vty, "  Freq Hz  Priority  Soundings  Backoff  Last ago  Busy for%s", VTY_NEWLINE);
+	for (unsigned int i = 0; i < snd->count; i++) {
+		struct ale_sound_channel *ch = &snd->ch[i];
+
+		vty_out(vty, "%9u  %8.2f  %9lu  %7u  %8ld  %8ld%s", ch->freq_hz,
+			ale_sound_priority(snd, g_ale->lqa, ch->freq_hz, now), ch->soundings, ch->backoff,
+			ch->last_sound ? (long) (now - ch->last_sound) : -1L,
+			ch->busy_until > now ? (long) (ch->busy_until - now) : 0L, VTY_NEWLINE);
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(rec_keep, rec_keep_cmd,
+	"recorder keep [<1-3600>]",
+	REC_STR "Mark an event and keep the recording files around it\n"
+	"Seconds before and after (the recorder keep-seconds by default)\n")
+{
+	if (!ale_rec_running(g_ale->rec)) {
+		vty_out(vty, "%% Recorder off%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	ale_rec_keep(g_ale->rec, argc > 0 ? atoi(argv[0]) : 0);
+	return CMD_SUCCESS;
+}
+
+static void replay_freq(void *arg, uint32_t hz)
+{
+	struct ale_station *st = arg;
+
+	ale_rec_set_freq(st->rec, hz);
+	ale_spec_set_freq(st->spec, hz);
+}
+
+DEFUN(replay_start, replay_start_cmd,
+	"replay FILE [<1-1000>]",
+	"Replay a recording into the RX audio ring, the audio client should be stopped\n"
+	"Recording file (.rec)\n"
+	"Times real time, by the recording timestamps (as fast as the modem takes it by default)\n")
+{
+	const struct ale_modem_stats *ms;
+
+	if (!g_ale->modem) {
+		vty_out(vty, "%% No modem%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	ms = ale_modem_get_stats(g_ale->modem);
+	replay_frames = atomic_load(&ms->rx_frames);
+	replay_crc = atomic_load(&ms->rx_crc);
+	replay_sync_lost = atomic_load(&ms->sync_lost);
+
+	vty_replay.speed = argc > 1 ? atoi(argv[1]) : 0;
+	vty_replay.freq = replay_freq;
+	vty_replay.arg = g_ale;
+	if (ale_replay_start(&vty_replay, argv[0], ale_modem_rx_audio(g_ale->modem)) < 0) {
+		vty_out(vty, "%% Could not replay %s: %s%s", argv[0], strerror(errno), VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN(replay_stop, replay_stop_cmd,
+	"replay stop",
+	"Replay a recording into the RX audio ring\n" "Stop the running replay\n")
+{
+	ale_replay_stop(&vty_replay);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_ale_replay, show_ale_replay_cmd,
+	"show ale replay",
+	SHOW_STR "HF ALE Controller\n" "Replay of a recording, the last one if none is running\n")
+{
+	struct ale_replay_stats *rs = &vty_replay.stats;
+	const struct ale_modem_stats *ms;
+
+	if (!vty_replay.path[0] || !g_ale->modem) {
+		vty_out(vty, "No replay yet%s", VTY_NEWLINE);
+		return CMD_SUCCESS;
+	}
+	ms = ale_modem_get_stats(g_ale->modem);
+	vty_out(vty, "%s %s%s", ale_replay_busy(&vty_replay) ? "Replaying" : "Replayed", vty_replay.path,
+		VTY_NEWLINE);
+	vty_out(vty, " Audio: %.1f s in %lu chunks, %lu gaps%s", (double) rs->samples / ALE_AUDIO_RATE,
+		rs->chunks, rs->gaps, VTY_NEWLINE);
+	vty_out(vty, " Frames: %" PRIu64 ", CRC errors: %" PRIu64 ", sync losses: %" PRIu64 "%s",
+		atomic_load(&ms->rx_frames) - replay_frames, atomic_load(&ms->rx_crc) - replay_crc,
+		atomic_load(&ms->sync_lost) - replay_sync_lost, VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_latency, show_latency_cmd,
+	"show latency",
+	SHOW_STR "Time spent in each stage of the data path since start, in ms\n")
+{
+	vty_out(vty, "%-12s %10s %9s %9s %9s %9s %9s%s", "Stage", "Samples", "Avg", "p50", "p90",
+		"p99", "Max", VTY_NEWLINE);
+	for (int i = 0; i < _NUM_ALE_LAT_STAGES; i++) {
+		struct ale_lat_snap snap;
+
+		ale_lat_snapshot(i, &snap);
+		if (!snap.count) {
+			vty_out(vty, "%-12s %10d%s", ale_lat_stage_names[i], 0, VTY_NEWLINE);
+			continue;
+		}
+		vty_out(vty, "%-12s %10lu %9.3f %9.3f %9.3f %9.3f %9.3f%s", ale_lat_stage_names[i],
+			snap.count, snap.sum_us / 1000.0 / snap.count,
+			ale_lat_quantile(&snap, 0.5) / 1000.0, ale_lat_quantile(&snap, 0.9) / 1000.0,
+			ale_lat_quantile(&snap, 0.99) / 1000.0, snap.max_us / 1000.0, VTY_NEWLINE);
+	}
+	vty_out(vty, "Percentiles are log2 bucket bounds%s", VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
 static int config_write_ale(struct vty *vty)
 {
 	vty_out(vty, "ale%s", VTY_NEWLINE);
+	if (g_ale->callsign[0])
+		vty_out(vty, " callsign %s%s", g_ale->callsign, VTY_NEWLINE);
+	vty_out(vty, " data-mode %s%s", ale_mode_get(g_ale->rate.level)->name, VTY_NEWLINE);
+	vty_out(vty, " %srate-adaptation%s", g_ale->rate.enabled ? "" : "no ", VTY_NEWLINE);
+	vty_out(vty, " %scompression%s", g_ale->compression ? "" : "no ", VTY_NEWLINE);
+	if (g_ale->comp_dict)
+		vty_out(vty, " compression-dictionary %s%s", g_ale->comp_dict, VTY_NEWLINE);
+	vty_out(vty, " tx-batch-deadline %u%s", g_ale->batch->deadline_ms, VTY_NEWLINE);
+	if (g_ale->host_bind)
+		vty_out(vty, " host-bind %s%s", g_ale->host_bind, VTY_NEWLINE);
+	vty_out(vty, " host-io %s%s", g_ale->host_io_uring ? "uring" : "poll", VTY_NEWLINE);
+	vty_out(vty, " vara-port %u%s", g_ale->vara_port, VTY_NEWLINE);
+	vty_out(vty, " ardop-port %u%s", g_ale->ardop_port, VTY_NEWLINE);
+	vty_out(vty, " host-priority vara %u%s", g_ale->vara_prio, VTY_NEWLINE);
+	vty_out(vty, " host-priority ardop %u%s", g_ale->ardop_prio, VTY_NEWLINE);
+	vty_out(vty, " host-priority local %u%s", g_ale->local_prio, VTY_NEWLINE);
+	vty_out(vty, " host-class vara %s%s", ale_txq_class_names[g_ale->vara_class], VTY_NEWLINE);
+	vty_out(vty, " host-class ardop %s%s", ale_txq_class_names[g_ale->ardop_class], VTY_NEWLINE);
+	vty_out(vty, " tx-weight interactive %u%s", g_ale->txq->cls[ALE_TX_INTERACTIVE].weight, VTY_NEWLINE);
+	vty_out(vty, " tx-weight bulk %u%s", g_ale->txq->cls[ALE_TX_BULK].weight, VTY_NEWLINE);
+	vty_out(vty, " kiss-port %u%s", g_ale->kiss_port, VTY_NEWLINE);
+	if (g_ale->local_path)
+		vty_out(vty, " local-socket %s%s", g_ale->local_path, VTY_NEWLINE);
+	else
+		vty_out(vty, " no local-socket%s", VTY_NEWLINE);
+	if (strcmp(ale_flight_file(), ALE_FLIGHT_DEFAULT_FILE))
+		vty_out(vty, " flight-recorder-file %s%s", ale_flight_file(), VTY_NEWLINE);
+	if (g_ale->rec->cfg.dir[0]) {
+		struct ale_rec_cfg *cfg = &g_ale->rec->cfg;
+
+		vty_out(vty, " recorder directory %s%s", cfg->dir, VTY_NEWLINE);
+		vty_out(vty, " recorder rotate size %u%s", cfg->file_mb, VTY_NEWLINE);
+		vty_out(vty, " recorder rotate time %u%s", cfg->file_secs, VTY_NEWLINE);
+		vty_out(vty, " recorder files %u%s", cfg->files, VTY_NEWLINE);
+		vty_out(vty, " recorder keep-seconds %u%s", cfg->keep_secs, VTY_NEWLINE);
+	}
+	if (g_ale->freq_hz)
+		vty_out(vty, " frequency %u%s", g_ale->freq_hz, VTY_NEWLINE);
+	if (g_ale->lqa_file)
+		vty_out(vty, " lqa file %s%s", g_ale->lqa_file, VTY_NEWLINE);
+	vty_out(vty, " lqa half-life %u%s", g_ale->lqa->half_life, VTY_NEWLINE);
+	for (unsigned int i = 0; i < g_ale->addr->count; i++) {
+		const struct ale_addr_entry *e = &g_ale->addr->entries[i];
+
+		vty_out(vty, " address %s %s%s%s%s", e->pattern, ale_addr_kind_name(e->kind),
+			e->name[0] ? " " : "", e->name, VTY_NEWLINE);
+	}
+	if (g_ale->spec->enabled)
+		vty_out(vty, " spectrum%s", VTY_NEWLINE);
+	vty_out(vty, " spectrum bins %u%s", atomic_load(&g_ale->spec->bins), VTY_NEWLINE);
+	vty_out(vty, " spectrum frame-rate %u%s", atomic_load(&g_ale->spec->fps), VTY_NEWLINE);
+	for (unsigned int i = 0; i < g_ale->scan->num_lists; i++) {
+		struct ale_scan_list *list = &g_ale->scan->lists[i];
+
+		vty_out(vty, " scan-list %s dwell %u%s", list->name, list->dwell_ms, VTY_NEWLINE);
+		for (unsigned int j = 0; j < list->count; j++) {
+			if (list->ch[j].dwell_ms)
+				vty_out(vty, " scan-list %s channel %u %u%s", list->name, list->ch[j].freq_hz,
+					list->ch[j].dwell_ms, VTY_NEWLINE);
+			else
+				vty_out(vty, " scan-list %s channel %u%s", list->name, list->ch[j].freq_hz,
+					VTY_NEWLINE);
+		}
+	}
+	vty_out(vty, " scan dwell-extension %u %u%s", g_ale->scan->extend_ms, g_ale->scan->max_extend_ms,
+		VTY_NEWLINE);
+	if (g_ale->scan_list)
+		vty_out(vty, " scan %s%s", g_ale->scan_list, VTY_NEWLINE);
+	if (g_ale->rig_host)
+		vty_out(vty, " rig rigctld %s %u%s", g_ale->rig_host, g_ale->rig_port, VTY_NEWLINE);
+	if (g_ale->sound->enabled)
+		vty_out(vty, " sounding%s", VTY_NEWLINE);
+	vty_out(vty, " sounding stale-after %u%s", g_ale->sound->stale_s, VTY_NEWLINE);
+	vty_out(vty, " sounding interval %u%s", g_ale->sound->interval_s, VTY_NEWLINE);
+	vty_out(vty, " sounding busy-hold %u%s", g_ale->sound->busy_s, VTY_NEWLINE);
+	vty_out(vty, " sounding duty-cycle %u %u%s", g_ale->sound->duty_permille, g_ale->sound->window_s,
+		VTY_NEWLINE);
 	return CMD_SUCCESS;
 }
 
@@ -35,5 +1192,77 @@ void ale_vty_init(void)
 {
 	install_element(CONFIG_NODE, &cfg_ale_cmd);
 	install_node(&ale_node, config_write_ale);
+	install_element(ALE_NODE, &cfg_ale_callsign_cmd);
+	install_element(ALE_NODE, &cfg_ale_data_mode_cmd);
+	install_element(ALE_NODE, &cfg_ale_rate_adaptation_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_rate_adaptation_cmd);
+	install_element(ALE_NODE, &cfg_ale_compression_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_compression_cmd);
+	install_element(ALE_NODE, &cfg_ale_comp_dict_cmd);
+	install_element(ALE_NODE, &cfg_ale_tx_batch_cmd);
+	install_element(ALE_NODE, &cfg_ale_host_bind_cmd);
+	install_element(ALE_NODE, &cfg_ale_host_io_cmd);
+	install_element(ALE_NODE, &cfg_ale_vara_port_cmd);
+	install_element(ALE_NODE, &cfg_ale_ardop_port_cmd);
+	install_element(ALE_NODE, &cfg_ale_host_prio_cmd);
+	install_element(ALE_NODE, &cfg_ale_host_class_cmd);
+	install_element(ALE_NODE, &cfg_ale_tx_weight_cmd);
+	install_element(ALE_NODE, &cfg_ale_kiss_port_cmd);
+	install_element(ALE_NODE, &cfg_ale_local_socket_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_local_socket_cmd);
+	install_element(ALE_NODE, &cfg_ale_flight_file_cmd);
+	install_element(ALE_NODE, &cfg_ale_rec_dir_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_rec_cmd);
+	install_element(ALE_NODE, &cfg_ale_rec_rotate_cmd);
+	install_element(ALE_NODE, &cfg_ale_rec_files_cmd);
+	install_element(ALE_NODE, &cfg_ale_rec_keep_secs_cmd);
+	install_element(ALE_NODE, &cfg_ale_frequency_cmd);
+	install_element(ALE_NODE, &cfg_ale_lqa_file_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_lqa_file_cmd);
+	install_element(ALE_NODE, &cfg_ale_lqa_half_life_cmd);
+	install_element(ALE_NODE, &cfg_ale_address_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_address_cmd);
+	install_element(ALE_NODE, &cfg_ale_spec_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_spec_cmd);
+	install_element(ALE_NODE, &cfg_ale_spec_bins_cmd);
+	install_element(ALE_NODE, &cfg_ale_spec_fps_cmd);
+	install_element(ALE_NODE, &cfg_ale_scan_list_channel_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_scan_list_channel_cmd);
+	install_element(ALE_NODE, &cfg_ale_scan_list_dwell_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_scan_list_cmd);
+	install_element(ALE_NODE, &cfg_ale_scan_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_scan_cmd);
+	install_element(ALE_NODE, &cfg_ale_scan_extension_cmd);
+	install_element(ALE_NODE, &cfg_ale_rig_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_rig_cmd);
+	install_element(ALE_NODE, &cfg_ale_sound_cmd);
+	install_element(ALE_NODE, &cfg_ale_no_sound_cmd);
+	install_element(ALE_NODE, &cfg_ale_sound_stale_cmd);
+	install_element(ALE_NODE, &cfg_ale_sound_interval_cmd);
+	install_element(ALE_NODE, &cfg_ale_sound_busy_cmd);
+	install_element(ALE_NODE, &cfg_ale_sound_duty_cmd);
+
+	install_element_ve(&show_ale_rate_cmd);
+	install_element_ve(&show_ale_compression_cmd);
+	install_element_ve(&show_ale_batch_cmd);
+	install_element_ve(&show_ale_host_io_cmd);
+	install_element_ve(&show_ale_host_clients_cmd);
+	install_element_ve(&show_ale_tx_queues_cmd);
+	install_element_ve(&show_ale_pools_cmd);
+	install_element_ve(&show_ale_rt_log_cmd);
+	install_element_ve(&show_ale_flight_cmd);
+	install_element_ve(&show_latency_cmd);
+	install_element_ve(&show_ale_rec_cmd);
+	install_element_ve(&show_ale_spec_cmd);
+	install_element_ve(&show_ale_addr_cmd);
+	install_element_ve(&show_lqa_cmd);
+	install_element_ve(&show_ale_addr_lookup_cmd);
+	install_element_ve(&show_ale_scan_cmd);
+	install_element_ve(&show_ale_sound_cmd);
+	install_element(ENABLE_NODE, &flight_dump_cmd);
+	install_element(ENABLE_NODE, &rec_keep_cmd);
+	install_element_ve(&show_ale_replay_cmd);
+	install_element(ENABLE_NODE, &replay_start_cmd);
+	install_element(ENABLE_NODE, &replay_stop_cmd);
 
 }
@@ -1,20 +1,262 @@
 #pragma once
 
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
 #include <osmocom/core/logging.h>
 #include <osmocom/core/fsm.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
+
+#include "ale_buf.h"
+#include "ale_mode.h"
+#include "ale_arq.h"
+#include "ale_rate.h"
+#include "ale_comp.h"
+#include "ale_batch.h"
+#include "ale_txq.h"
+#include "ale_host.h"
+#include "ale_client.h"
+#include "ale_rec.h"
+#include "ale_spec.h"
+#include "ale_addr.h"
+#include "ale_lqa.h"
+#include "ale_scan.h"
+#include "ale_sound.h"
 
 #define RHIZO_VTY_PORT_ALE 6666
 
+// data ring keys and size: ale_client.h
+#define ALE_SHM_TX_AUDIO_KEY 66664
+#define ALE_SHM_RX_AUDIO_KEY 66666
+#define ALE_AUDIO_RATE 8000
+#define ALE_AUDIO_RING_SIZE (ALE_AUDIO_RATE * sizeof(int16_t) * 10)
+
+#define VARA_DEFAULT_PORT 8300  // command port, data port is the next one
+#define KISS_DEFAULT_PORT 8100
+#define ARDOP_DEFAULT_PORT 8515 // command port, data port is the next one
+#define ALE_UI_RING_SIZE (16 * 1024)
+#define HOST_DEFAULT_PRIO 3     // TX arbitration, 0..ALE_HOST_TX_PRIO_MAX
+
 #define ALE 0
 
 extern struct osmo_fsm ale_fsm;
 
+/* Rings in the statistics, the TX classes first, then the RX ones */
+enum ale_ring {
+    ALE_RING_TX_EXPRESS = ALE_TX_EXPRESS,
+    ALE_RING_TX_INTERACTIVE = ALE_TX_INTERACTIVE,
+    ALE_RING_TX_BULK = ALE_TX_BULK,
+    ALE_RING_RX_EXPRESS,
+    ALE_RING_RX_INTERACTIVE,
+    ALE_RING_RX_DATA,           // the bulk class
+    ALE_RING_UI_TX,
+    ALE_RING_TX_AUDIO,
+    ALE_RING_RX_AUDIO,
+    _NUM_ALE_RINGS
+};
+
+/* Rate counters of the station, main thread only. The ARQ and modem ones
+ * are folded in from their own counters by the stats timer */
+enum ale_ctr {
+    ALE_CTR_CALL_OUT,
+    ALE_CTR_CALL_IN,
+    ALE_CTR_CALL_CONNECTED,
+    ALE_CTR_CALL_FAILED,
+    ALE_CTR_CALL_ENDED,
+    ALE_CTR_ARQ_TX_FRAMES,
+    ALE_CTR_ARQ_TX_RETRANS,
+    ALE_CTR_ARQ_TX_BYTES,
+    ALE_CTR_ARQ_RX_FRAMES,
+    ALE_CTR_ARQ_RX_DUPLICATES,
+    ALE_CTR_ARQ_RX_BYTES,
+    ALE_CTR_ARQ_TURNS,
+    ALE_CTR_MODEM_TX_FRAMES,
+    ALE_CTR_MODEM_RX_FRAMES,
+    ALE_CTR_MODEM_RX_CRC,
+    ALE_CTR_MODEM_SYNC_LOST,
+    ALE_CTR_HOST_TX_BYTES,
+    ALE_CTR_HOST_RX_BYTES,
+    ALE_CTR_HOST_RX_LOST,
+    ALE_CTR_HOST_UI_DROPPED,
+    ALE_CTR_RING_BYTES,         // + enum ale_ring
+    _NUM_ALE_CTRS = ALE_CTR_RING_BYTES + _NUM_ALE_RINGS
+};
+
+enum ale_stat {
+    ALE_STAT_MODEM_SNR,
+    ALE_STAT_CALL_SETUP,
+    ALE_STAT_ARQ_TX_RATE,
+    ALE_STAT_ARQ_GOODPUT,
+    ALE_STAT_HOST_READERS,
+    ALE_STAT_HOST_WRITERS,
+    ALE_STAT_RING_FILL,         // + enum ale_ring
+    ALE_STAT_LATENCY = ALE_STAT_RING_FILL + _NUM_ALE_RINGS, // + 2 * enum ale_lat_stage
+};
+
+/* Counted by the modem thread alone and folded into the rate counters by
+ * the stats timer: relaxed loads and stores, no locked instructions */
+struct ale_modem_stats {
+    _Atomic uint64_t tx_frames;
+    _Atomic uint64_t rx_frames;
+    _Atomic uint64_t rx_crc;
+    _Atomic uint64_t sync_lost;
+    _Atomic uint64_t wave_hits;     // bursts sent from the waveform cache
+    _Atomic uint64_t wave_misses;   // modulated into it
+    _Atomic int snr_db10;       // last decoded frame
+    _Atomic uint64_t rx_mode[_NUM_ALE_MODES];
+    _Atomic uint64_t demod_ns[_NUM_ALE_MODES];  // thread CPU time
+};
+
 enum ale_event {
     ALE_E_INIT,
-    ALE_E_CONN_PENDING,
-    ALE_E_KEEPALIVE_PENDING,
-    ALE_E_IDLE,
+    ALE_E_REJECT_CONNECTIONS,
+    ALE_E_ACCEPT_CONNECTIONS,
+    ALE_E_MAKE_CALL,
+    ALE_E_RECEIVE_CALL,
+    ALE_E_MAKE_CALL_CONNECTED,
+    ALE_E_RECEIVE_CALL_CONNECTED,
+    ALE_E_CHG_ROLE_TO_RX,
+    ALE_E_CHG_ROLE_TO_TX,
+    ALE_E_DISCONNECTED,
+};
+
+struct ale_station {
+    struct osmo_fsm_inst *fi;
+    char callsign[ARQ_CALLSIGN_LEN + 1];
+    char remote[ARQ_CALLSIGN_LEN + 1];
+    cbuf_handle_t tx_rings[ALE_TX_NUM_CLASSES];
+    cbuf_handle_t tx_data;      // the bulk class ring
+    cbuf_handle_t rx_rings[ALE_TX_NUM_CLASSES];
+    struct ale_txq *txq;
+    struct ale_arq *arq;
+    struct ale_rate rate;
+    struct ale_comp *comp;
+    bool compression;           // offered in the call setup
+    char *comp_dict;            // dictionary file, NULL: built-in
+    uint8_t caps;               // agreed for the current session
+    char dict_from[ARQ_CALLSIGN_LEN + 1];   // last ARQ_CTRL_DICT heard, from
+    uint32_t dict_id;                       // and its dictionary id
+    struct ale_batch *batch;
+    struct osmo_timer_list batch_timer;
+    uint64_t turn_start_ms;
+    unsigned int tx_turn_ms;    // last turns of each side, wall clock
+    unsigned int rx_turn_ms;
+    unsigned int call_tries;
+    unsigned int idle_turns;
+    bool disc_pending;          // disconnect once the TX backlog is sent
+    bool ptt;
+    cbuf_handle_t ui_tx;        // KISS frames (records) to send while idle
+    unsigned long ui_tx_frames;
+    unsigned long ui_rx_frames;
+    struct ale_rec *rec;        // RX audio recorder, fed by the modem thread
+    struct ale_spec *spec;      // spectrum feed, fed by the modem thread
+    struct ale_addr_book *addr; // "address" entries of the config
+    uint32_t freq_hz;           // channel we are on, 0: unknown
+    struct ale_lqa *lqa;        // per channel and station link quality
+    char *lqa_file;             // NULL: in memory only
+    struct ale_scan *scan;      // channel scan, run by ale_rig.c
+    char *scan_list;            // scanned from the start, NULL: none
+    char *rig_host;             // rigctld, NULL: no rig control
+    uint16_t rig_port;
+    struct ale_sound *sound;    // sounding scheduler, runs while idle
+    struct osmo_timer_list sound_timer;
+    bool sound_hold;            // the scan is held for a sounding
+    struct ale_modem *modem;
+
+    // host interfaces
+    char *host_bind;
+    bool host_io_uring;         // io_uring backend for the host sockets
+    uint16_t vara_port;         // 0: disabled
+    uint16_t kiss_port;
+    uint16_t ardop_port;        // 0: disabled
+    unsigned int vara_prio;     // TX arbitration priority of the data ports
+    unsigned int ardop_prio;
+    unsigned int local_prio;    // libale-client
+    enum ale_tx_class vara_class;   // TX ring the data ports write to
+    enum ale_tx_class ardop_class;
+    char *local_path;           // libale-client socket, NULL: disabled
+
+    // ale_stats.c
+    struct rate_ctr_group *ctrs;
+    struct osmo_stat_item_group *stats;
+    uint64_t call_start_ms;
+
+    /* Modem hook: frames of a turn are handed over in order, then
+     * tx_end(), the modem calls ale_station_tx_done() once all of them are
+     * on the air. born_us is when the data was taken from the TX queue
+     * (0: control frame), for the latency accounting. */
+    int (*tx_frame)(struct ale_station *st, const struct ale_mode *mode,
+                    const uint8_t *buf, size_t len, uint64_t born_us);
+    /* Frames sent again and again (soundings): the modem keeps their
+     * waveform. With send false it is only modulated into its cache */
+    int (*tx_cached)(struct ale_station *st, const struct ale_mode *mode,
+                     const uint8_t *buf, size_t len, bool send);
+    /* End of the burst, the frames may still be in the modem queue */
+    int (*tx_end)(struct ale_station *st);
+};
+
+extern struct ale_station *g_ale;
+
+/* ale_fsm.c */
+struct ale_station *ale_station_alloc(void *ctx, cbuf_handle_t tx_data[ALE_TX_NUM_CLASSES],
+                                      cbuf_handle_t rx_data[ALE_TX_NUM_CLASSES]);
+void ale_station_rx_frame(struct ale_station *st, const uint8_t *buf, size_t len, float snr_db);
+void ale_station_rx_error(struct ale_station *st, float snr_db);
+void ale_station_tx_done(struct ale_station *st);
+void ale_station_rx_sync(struct ale_station *st, bool sync);
+bool ale_station_connected(struct ale_station *st);
+bool ale_station_idle(struct ale_station *st);
+bool ale_station_has_turn(struct ale_station *st);
+int ale_station_call(struct ale_station *st, const char *remote);
+void ale_station_listen(struct ale_station *st, bool on);
+int ale_station_disconnect(struct ale_station *st, bool abort);
+void ale_station_send_ui(struct ale_station *st);
+
+/* ale_modem.c */
+struct ale_modem;
+struct ale_modem *ale_modem_alloc(void *ctx, struct ale_station *st,
+                                  cbuf_handle_t tx_audio, cbuf_handle_t rx_audio);
+int ale_modem_start(struct ale_modem *modem);
+const struct ale_modem_stats *ale_modem_get_stats(struct ale_modem *modem);
+cbuf_handle_t ale_modem_rx_audio(struct ale_modem *modem);
+cbuf_handle_t ale_modem_tx_audio(struct ale_modem *modem);
+uint64_t ale_modem_cpu_ns(struct ale_modem *modem);
+
+/* ale_rig.c */
+struct ale_rig_stats {
+    bool connected;
+    unsigned int pending;       // commands without a reply yet
+    unsigned long sent;
+    unsigned long errors;       // RPRT with an error code
+    unsigned long busy;         // hops the rig was not ready for
 };
 
+int ale_rig_init(void *ctx, struct ale_station *st);
+int ale_rig_scan(struct ale_station *st, const char *list);
+void ale_rig_kick(struct ale_station *st);
+void ale_rig_connect(struct ale_station *st);
+const struct ale_rig_stats *ale_rig_get_stats(void);
+
+/* ale_stats.c */
+int ale_stats_init(void *ctx, struct ale_station *st);
+void ale_stats_ring(enum ale_ring ring, cbuf_handle_t cbuf);
+void ale_stats_modem(const struct ale_modem_stats *ms);
+void ale_stats_arq_flush(struct ale_station *st);
+
 /* ale_vty.c */
 void ale_vty_init(void);
+
+/* ale_vara.c */
+int ale_vara_init(void *ctx, struct ale_station *st);
+
+/* ale_ardop.c */
+int ale_ardop_init(void *ctx, struct ale_station *st);
+
+/* ale_local.c */
+int ale_local_init(void *ctx, struct ale_station *st);
+
+/* ale_kiss_srv.c */
+int ale_kiss_srv_init(void *ctx, struct ale_station *st);
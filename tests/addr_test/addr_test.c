@@ -0,0 +1,193 @@
+/* Station address book test
+ *
+ * Loads 20000 exact station addresses, 200 prefix and wildcard groups,
+ * nets and denied stations, then checks that lookups find the most
+ * specific entry of each kind, and times lookups of known, grouped and
+ * unknown addresses against the book size. A reload into a new index must
+ * leave the old one answering until the commit, and a config file with a
+ * bad address line must leave the book as it was.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "ale_addr.h"
+
+#define STATIONS 20000
+#define GROUPS 200
+#define LOOKUPS 1000000
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void station_addr(char *buf, size_t len, unsigned int i)
+{
+    snprintf(buf, len, "S%02uA%03u", i / 1000, i % 1000);
+}
+
+static void load(struct ale_addr_book *book, unsigned int stations)
+{
+    char addr[16], name[32];
+
+    book->loading = true;
+    ale_addr_clear(book);
+    for (unsigned int i = 0; i < stations; i++)
+    {
+        station_addr(addr, sizeof(addr), i);
+        snprintf(name, sizeof(name), "station-%u", i);
+        assert(ale_addr_add(book, addr, ALE_ADDR_STATION, name) == 0);
+    }
+    for (unsigned int i = 0; i < GROUPS; i++)
+    {
+        snprintf(addr, sizeof(addr), "G%03u*", i);
+        assert(ale_addr_add(book, addr, ALE_ADDR_STATION, "group") == 0);
+    }
+    assert(ale_addr_add(book, "PY?ABC", ALE_ADDR_STATION, "wildcard") == 0);
+    assert(ale_addr_add(book, "PY*", ALE_ADDR_STATION, "brazil") == 0);
+    assert(ale_addr_add(book, "PY2ABC", ALE_ADDR_STATION, "exact") == 0);
+    assert(ale_addr_add(book, "HFNET?", ALE_ADDR_NET, NULL) == 0);
+    assert(ale_addr_add(book, "ALLCALL", ALE_ADDR_NET, NULL) == 0);
+    assert(ale_addr_add(book, "BAD*", ALE_ADDR_DENY, NULL) == 0);
+    book->loading = false;
+    assert(ale_addr_commit(book) == 0);
+}
+
+static void write_file(const char *path, const char *text)
+{
+    FILE *f = fopen(path, "w");
+
+    assert(f);
+    fputs(text, f);
+    fclose(f);
+}
+
+static double time_lookups(struct ale_addr_book *book, const char *what, unsigned int stations)
+{
+    char addrs[64][16];
+    double t;
+    unsigned int found = 0;
+
+    for (int i = 0; i < 64; i++)
+    {
+        if (!strcmp(what, "exact"))
+            station_addr(addrs[i], sizeof(addrs[i]), (i * 7919) % stations);
+        else if (!strcmp(what, "prefix"))
+            snprintf(addrs[i], sizeof(addrs[i]), "G%03uX%d", (i * 13) % GROUPS, i);
+        else
+            snprintf(addrs[i], sizeof(addrs[i]), "N%06d", i);
+    }
+
+    t = now_ns();
+    for (int i = 0; i < LOOKUPS; i++)
+        found += ale_addr_lookup(book, ALE_ADDR_STATION, addrs[i & 63]) != NULL;
+    t = (now_ns() - t) / LOOKUPS;
+
+    assert(found == (strcmp(what, "unknown") ? LOOKUPS : 0));
+    return t;
+}
+
+int main(void)
+{
+    struct ale_addr_book *book = ale_addr_alloc();
+    struct ale_addr_book *scratch;
+    const struct ale_addr_entry *e;
+    char path[] = "/tmp/addr_test.XXXXXX";
+    unsigned int entries, masks, line;
+    int fd;
+
+    assert(ale_addr_add(book, "TOOLONGADDR", ALE_ADDR_STATION, NULL) < 0);
+    assert(ale_addr_add(book, "A*B", ALE_ADDR_STATION, NULL) < 0);
+    assert(!ale_addr_lookup(book, ALE_ADDR_STATION, "PY2ABC"));
+
+    for (unsigned int stations = 1000; stations <= STATIONS; stations *= 20)
+    {
+        load(book, stations);
+        ale_addr_index_size(book, &entries, &masks);
+        printf("%5u entries, %u masks, built in %.0f us: lookup exact %.0f ns, prefix %.0f ns, "
+               "unknown %.0f ns\n", entries, masks, book->stats.commit_ns / 1e3,
+               time_lookups(book, "exact", stations), time_lookups(book, "prefix", stations),
+               time_lookups(book, "unknown", stations));
+    }
+
+    // the most specific entry wins, case does not matter
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "py2abc");
+    assert(e && !strcmp(e->name, "exact"));
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "PY5ABC");
+    assert(e && !strcmp(e->name, "wildcard") && !strcmp(e->pattern, "PY?ABC"));
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "PY5ABD");
+    assert(e && !strcmp(e->name, "brazil"));
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "PY");
+    assert(e && !strcmp(e->name, "brazil"));
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "S01A002");
+    assert(e && !strcmp(e->name, "station-1002"));
+    assert(!ale_addr_lookup(book, ALE_ADDR_STATION, "S01A00"));
+
+    // '?' needs a character, kinds do not mix
+    assert(ale_addr_lookup(book, ALE_ADDR_NET, "HFNET1"));
+    assert(!ale_addr_lookup(book, ALE_ADDR_NET, "HFNET"));
+    assert(!ale_addr_lookup(book, ALE_ADDR_NET, "HFNET12"));
+    assert(ale_addr_lookup(book, ALE_ADDR_NET, "ALLCALL"));
+    assert(!ale_addr_lookup(book, ALE_ADDR_STATION, "ALLCALL"));
+    assert(ale_addr_lookup(book, ALE_ADDR_DENY, "BAD1"));
+    assert(!ale_addr_lookup(book, ALE_ADDR_DENY, "PY2ABC"));
+
+    // staged changes show up on the commit only
+    book->loading = true;
+    assert(ale_addr_del(book, "PY2ABC", ALE_ADDR_STATION) == 0);
+    assert(ale_addr_del(book, "PY2ABC", ALE_ADDR_STATION) < 0);
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "PY2ABC");
+    assert(e && !strcmp(e->name, "exact"));
+    book->loading = false;
+    assert(ale_addr_commit(book) == 0);
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "PY2ABC");
+    assert(e && !strcmp(e->name, "wildcard"));
+
+    // replacing keeps one entry
+    entries = book->count;
+    assert(ale_addr_add(book, "py?abc", ALE_ADDR_STATION, "renamed") == 0);
+    assert(book->count == entries);
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "PY5ABC");
+    assert(e && !strcmp(e->name, "renamed"));
+
+    // a reload reads the address lines of the ale node alone, all or nothing
+    fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    write_file(path, "ale\n callsign PY2RAF\n address N1ABC station\n address Q* net\n"
+               " address BAD station\n address BAD*  friend\n");
+    entries = book->count;
+    scratch = ale_addr_read(path, &line);
+    assert(!scratch && errno == EINVAL && line == 6);
+    assert(book->count == entries);
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "PY5ABC");
+    assert(e && !strcmp(e->name, "renamed"));
+
+    write_file(path, "! book\nale\n callsign PY2RAF\n address N1ABC station home\n address Q* n\n"
+               " address BAD station\n no address BAD station\nline vty\n address X1 deny\n");
+    scratch = ale_addr_read(path, &line);
+    assert(scratch && scratch->count == 2);
+    assert(!ale_addr_lookup(book, ALE_ADDR_STATION, "N1ABC"));
+    assert(ale_addr_replace(book, scratch) == 0);
+    ale_addr_free(scratch);
+    e = ale_addr_lookup(book, ALE_ADDR_STATION, "N1ABC");
+    assert(e && !strcmp(e->name, "home") && book->count == 2);
+    assert(ale_addr_lookup(book, ALE_ADDR_NET, "Q1"));
+    assert(!ale_addr_lookup(book, ALE_ADDR_STATION, "PY5ABC"));
+    assert(!ale_addr_lookup(book, ALE_ADDR_DENY, "X1"));
+    unlink(path);
+
+    ale_addr_free(book);
+    printf("OK\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,387 @@
+/* libale-client versus TCP host port benchmark
+ *
+ * A thread stands in for the daemon: it creates the shared memory data
+ * rings and the control socket (so don't run it next to rhizo-ale, the
+ * ring keys are the same) or listens on a loopback TCP port.
+ *
+ * Throughput: the client pushes -s MB, the daemon side drains the client
+ * TX ring the way the host layer would (TCP: readv into the ring first,
+ * like the VARA data port) and reports BUFFER.
+ *
+ * Latency: the daemon side writes -n timestamped messages to the client
+ * (RX ring plus an RX event, or the TCP socket), the client blocks in its
+ * read; the delivery delay is reported. The RX ring is released as the
+ * client reports RXACK, like the daemon does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "ale_buf.h"
+#include "ale_client.h"
+
+#define SOCK_PATH "/tmp/ale-client-bench.sock"
+#define TCP_PORT 18300
+#define MSG_LEN 64
+#define CHUNK 4096
+
+static struct {
+    size_t bytes;
+    int msgs;
+} cfg = { 64 << 20, 2000 };
+
+static cbuf_handle_t tx_data, rx_data;
+static cbuf_handle_t tx_class[ALE_TX_NUM_CLASSES];  // express and interactive, unused
+static cbuf_handle_t rx_class[ALE_TX_NUM_CLASSES];  // same
+static int listen_fd;
+static double lat_sum, lat_max;
+static double lat_min = 1e9;
+
+static double now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void lat_add(double us)
+{
+    lat_sum += us;
+    if (us > lat_max)
+        lat_max = us;
+    if (us < lat_min)
+        lat_min = us;
+}
+
+static void lat_reset(void)
+{
+    lat_sum = lat_max = 0;
+    lat_min = 1e9;
+}
+
+static void send_line(int fd, const char *line)
+{
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "%s\r", line);
+
+    // a full socket already holds a wake-up for the client
+    send(fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+static size_t drain(cbuf_handle_t ring)
+{
+    struct iovec iov[2];
+    int n = circular_buf_data_iov(ring, iov);
+    size_t len = 0;
+
+    for (int i = 0; i < n; i++)
+        len += iov[i].iov_len;
+    if (len)
+        circular_buf_consume(ring, len);
+
+    return len;
+}
+
+// TX reports of the client, the BUFFER after each drain answers them
+static void tx_reports(int fd)
+{
+    char buf[256];
+
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+        ;
+}
+
+// the client reports how far it read the RX ring, release up to there
+static void rx_acks(int fd)
+{
+    char buf[256];
+    ssize_t rc = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+    char *p = buf;
+
+    if (rc <= 0)
+        return;
+    buf[rc] = 0;
+    while ((p = strstr(p, "RXACK ")))
+    {
+        uint64_t pos = strtoull(p + 6, &p, 10);
+        uint64_t start = circular_buf_read_pos(rx_data);
+
+        if (pos > start)
+            circular_buf_consume(rx_data, pos - start);
+    }
+}
+
+static int listen_unix(void)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd;
+
+    unlink(SOCK_PATH);
+    strcpy(addr.sun_path, SOCK_PATH);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) || listen(fd, 1))
+    {
+        perror(SOCK_PATH);
+        exit(1);
+    }
+
+    return fd;
+}
+
+// a socket with no rings behind it is refused, not a crash
+static void run_no_rings(void)
+{
+    struct ale_client *cl;
+
+    listen_fd = listen_unix();
+    cl = ale_client_open(SOCK_PATH);
+    if (cl || errno != ENOENT)
+    {
+        fprintf(stderr, "ale_client_open without rings: %s\n", cl ? "opened" : strerror(errno));
+        exit(1);
+    }
+    close(listen_fd);
+    unlink(SOCK_PATH);
+    printf("no rings: refused\n");
+}
+
+/* Daemon side, shared memory */
+
+static void *shm_daemon(void *arg)
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    size_t total = 0;
+    char line[32];
+
+    // throughput
+    while (total < cfg.bytes)
+    {
+        size_t len = drain(tx_data);
+
+        tx_reports(fd);
+        if (!len)
+        {
+            sched_yield();
+            continue;
+        }
+        total += len;
+        snprintf(line, sizeof(line), "BUFFER %zu", circular_buf_size(tx_data));
+        send_line(fd, line);
+    }
+
+    // latency
+    for (int i = 0; i < cfg.msgs; i++)
+    {
+        uint8_t msg[MSG_LEN] = { 0 };
+        double t = now_us();
+
+        usleep(500);
+        rx_acks(fd);
+        t = now_us();
+        memcpy(msg, &t, sizeof(t));
+        circular_buf_put_range(rx_data, msg, sizeof(msg));
+        send_line(fd, "RX");
+    }
+
+    close(fd);
+    return NULL;
+}
+
+static void run_shm(void)
+{
+    uint8_t buf[CHUNK] = { 0 };
+    struct ale_client *cl;
+    pthread_t thread;
+    double t;
+
+    tx_data = circular_buf_init_shm(ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(ALE_TX_BULK));
+    rx_data = circular_buf_init_shm(ALE_DATA_RING_SIZE, ALE_SHM_RX_DATA_KEY);
+    for (int i = 0; i < ALE_TX_BULK; i++)
+    {
+        tx_class[i] = circular_buf_init_shm(ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(i));
+        rx_class[i] = circular_buf_init_shm(ALE_DATA_RING_SIZE, ALE_SHM_RX_KEY(i));
+    }
+
+    listen_fd = listen_unix();
+    pthread_create(&thread, NULL, shm_daemon, NULL);
+
+    cl = ale_client_open(SOCK_PATH);
+    if (!cl)
+    {
+        perror("ale_client_open");
+        exit(1);
+    }
+
+    t = now_us();
+    for (size_t done = 0; done < cfg.bytes; done += sizeof(buf))
+        ale_client_write(cl, buf, sizeof(buf), -1);
+    t = now_us() - t;
+    printf("shm:  %8.1f MB/s", cfg.bytes / t);
+
+    lat_reset();
+    for (int i = 0; i < cfg.msgs; i++)
+    {
+        uint8_t msg[MSG_LEN];
+        size_t got = 0;
+        double sent;
+
+        while (got < sizeof(msg))
+            got += ale_client_read(cl, msg + got, sizeof(msg) - got, -1);
+        memcpy(&sent, msg, sizeof(sent));
+        lat_add(now_us() - sent);
+    }
+    printf("  latency avg %6.1f us, min %6.1f, max %7.1f\n", lat_sum / cfg.msgs, lat_min, lat_max);
+
+    pthread_join(thread, NULL);
+    ale_client_close(cl);
+    close(listen_fd);
+    unlink(SOCK_PATH);
+    circular_buf_free_shm(tx_data, ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(ALE_TX_BULK));
+    circular_buf_free_shm(rx_data, ALE_DATA_RING_SIZE, ALE_SHM_RX_DATA_KEY);
+    for (int i = 0; i < ALE_TX_BULK; i++)
+    {
+        circular_buf_free_shm(tx_class[i], ALE_DATA_RING_SIZE, ALE_SHM_CLIENT_TX_KEY(i));
+        circular_buf_free_shm(rx_class[i], ALE_DATA_RING_SIZE, ALE_SHM_RX_KEY(i));
+    }
+}
+
+/* Daemon side, TCP */
+
+static void *tcp_daemon(void *arg)
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    int one = 1;
+    size_t total = 0;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    while (total < cfg.bytes)
+    {
+        struct iovec iov[2];
+        int n = circular_buf_free_iov(tx_data, iov);
+        ssize_t rc = readv(fd, iov, n);
+
+        if (rc <= 0)
+            break;
+        circular_buf_commit(tx_data, rc);
+        total += drain(tx_data);
+    }
+
+    for (int i = 0; i < cfg.msgs; i++)
+    {
+        uint8_t msg[MSG_LEN] = { 0 };
+        double t;
+
+        usleep(500);
+        t = now_us();
+        memcpy(msg, &t, sizeof(t));
+        send(fd, msg, sizeof(msg), MSG_NOSIGNAL);
+    }
+
+    close(fd);
+    return NULL;
+}
+
+static void run_tcp(void)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(TCP_PORT) };
+    static uint8_t mem[ALE_DATA_RING_SIZE];
+    uint8_t buf[CHUNK] = { 0 };
+    pthread_t thread;
+    int fd, one = 1;
+    double t;
+
+    tx_data = circular_buf_init(mem, sizeof(mem));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) || listen(listen_fd, 1))
+    {
+        perror("tcp");
+        exit(1);
+    }
+    pthread_create(&thread, NULL, tcp_daemon, NULL);
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)))
+    {
+        perror("connect");
+        exit(1);
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    t = now_us();
+    for (size_t done = 0; done < cfg.bytes; done += sizeof(buf))
+        send(fd, buf, sizeof(buf), MSG_NOSIGNAL);
+    t = now_us() - t;
+    printf("tcp:  %8.1f MB/s", cfg.bytes / t);
+
+    lat_reset();
+    for (int i = 0; i < cfg.msgs; i++)
+    {
+        uint8_t msg[MSG_LEN];
+        size_t got = 0;
+        double sent;
+
+        while (got < sizeof(msg))
+        {
+            ssize_t rc = recv(fd, msg + got, sizeof(msg) - got, 0);
+
+            if (rc <= 0)
+                exit(1);
+            got += rc;
+        }
+        memcpy(&sent, msg, sizeof(sent));
+        lat_add(now_us() - sent);
+    }
+    printf("  latency avg %6.1f us, min %6.1f, max %7.1f\n", lat_sum / cfg.msgs, lat_min, lat_max);
+
+    pthread_join(thread, NULL);
+    close(fd);
+    close(listen_fd);
+    circular_buf_free(tx_data);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': cfg.bytes = atol(optarg) << 20; break;
+        case 'n': cfg.msgs = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-s MB] [-n latency_msgs]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!cfg.bytes || cfg.msgs < 1)
+        return 1;
+
+    printf("%zu MB, %d x %d byte messages\n", cfg.bytes >> 20, cfg.msgs, MSG_LEN);
+    run_no_rings();
+    run_shm();
+    run_tcp();
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+/* Flight recorder test
+ *
+ * Measures the cost of an event, by itself and added to a traced ring
+ * put / get, then lets a writer and a reader thread move records through a
+ * traced ring while the main thread dumps the buffers. Every dump is read
+ * back: per thread the events must be in order, the ring events must match
+ * what the threads did and the overwritten ones must be marked as such.
+ * The last dump is left in flight_test.bin for rhizo-ale-flight.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+#include "ale_flight.h"
+
+#define RING_SIZE 4096
+#define REC 64
+#define ITER 200000
+#define BENCH 2000000
+#define DUMPS 20
+#define DUMP_FILE "flight_test.bin"
+
+static uint8_t mem[RING_SIZE];
+static cbuf_handle_t ring;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *writer(void *arg)
+{
+    uint8_t rec[REC] = { 0 };
+
+    ale_flight_thread_init("writer");
+    for (int i = 0; i < ITER; i++)
+        while (circular_buf_free_size(ring) < REC || circular_buf_put_range(ring, rec, REC) < 0);
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    uint8_t rec[REC];
+
+    ale_flight_thread_init("reader");
+    for (int i = 0; i < ITER; i++)
+        while (circular_buf_get_range(ring, rec, REC) < 0);
+    return NULL;
+}
+
+/// Reads a dump back, returns the events checked
+static unsigned long check_dump(const char *path, bool final)
+{
+    struct ale_flight_hdr hdr;
+    struct ale_flight_thread th;
+    struct ale_flight_evt evt;
+    unsigned long checked = 0;
+    FILE *f = fopen(path, "rb");
+
+    assert(f);
+    assert(fread(&hdr, sizeof(hdr), 1, f) == 1);
+    assert(!memcmp(hdr.magic, ALE_FLIGHT_MAGIC, sizeof(ALE_FLIGHT_MAGIC)));
+    assert(hdr.version == ALE_FLIGHT_VERSION);
+    assert(!strcmp(hdr.labels[FLIGHT_T_RING][0], "test-ring"));
+
+    for (uint32_t t = 0; t < hdr.threads; t++)
+    {
+        uint64_t last_ts = 0;
+        bool ring_thread;
+
+        assert(fread(&th, sizeof(th), 1, f) == 1);
+        assert(th.seq_first <= th.valid_from && th.valid_from <= th.seq_end);
+        assert(th.seq_end - th.seq_first <= ALE_FLIGHT_EVENTS);
+        ring_thread = !strcmp(th.name, "writer") || !strcmp(th.name, "reader");
+        if (final && ring_thread)
+            assert(th.seq_end == ITER);
+
+        for (uint64_t seq = th.seq_first; seq < th.seq_end; seq++)
+        {
+            assert(fread(&evt, sizeof(evt), 1, f) == 1);
+            if (seq < th.valid_from)
+                continue;
+            assert(evt.ts_ns >= last_ts);
+            last_ts = evt.ts_ns;
+            if (ring_thread)
+            {
+                assert(evt.type == (th.name[0] == 'w' ? FLIGHT_RING_PUT : FLIGHT_RING_GET));
+                assert(evt.a == 0 && evt.b == REC);
+            }
+            checked++;
+        }
+    }
+    fclose(f);
+    return checked;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t threads[2];
+    uint8_t rec[REC] = { 0 };
+    double start, plain, traced;
+    unsigned long checked = 0;
+
+    ale_flight_thread_init("main");
+    ring = circular_buf_init(mem, RING_SIZE);
+
+    start = now_ns();
+    for (int i = 0; i < BENCH; i++)
+        ale_flight_rec(FLIGHT_MODEM_RX, 3, i);
+    printf("ale_flight_rec:      %6.1f ns per event\n", (now_ns() - start) / BENCH);
+
+    start = now_ns();
+    for (int i = 0; i < BENCH; i++)
+    {
+        circular_buf_put_range(ring, rec, REC);
+        circular_buf_get_range(ring, rec, REC);
+    }
+    plain = (now_ns() - start) / BENCH / 2;
+
+    ale_flight_ring(ring, "test-ring");
+    start = now_ns();
+    for (int i = 0; i < BENCH; i++)
+    {
+        circular_buf_put_range(ring, rec, REC);
+        circular_buf_get_range(ring, rec, REC);
+    }
+    traced = (now_ns() - start) / BENCH / 2;
+    printf("ring put / get:      %6.1f ns untraced, %6.1f ns traced (+%.1f ns)\n",
+           plain, traced, traced - plain);
+
+    // the benchmark events of main are not ring events of the threads
+    pthread_create(&threads[0], NULL, writer, NULL);
+    pthread_create(&threads[1], NULL, reader, NULL);
+    for (int i = 0; i < DUMPS; i++)
+    {
+        assert(ale_flight_dump(DUMP_FILE) == 0);
+        checked += check_dump(DUMP_FILE, false);
+    }
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    assert(ale_flight_dump(DUMP_FILE) == 0);
+    checked += check_dump(DUMP_FILE, true);
+    printf("%d dumps while running and one after, %lu events checked: ok\n", DUMPS, checked);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,435 @@
+/* Goodput versus SNR benchmark
+ *
+ * Runs two station instances back to back in the same process. Each
+ * station has its TX and RX data rings and its ARQ engine, the frames of
+ * each turn go through the frame level channel simulator (tests/sim) to
+ * the other station.  Time is simulated (airtime of each modem frame plus
+ * turnovers) so a run takes seconds of CPU even for an hour of link time.
+ *
+ * Output is one CSV line (or JSON object) per profile/SNR/mode, so the
+ * results can be diffed between releases.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+#include "ale_arq.h"
+#include "ale_rate.h"
+#include "ale_mode.h"
+#include "ale_comp.h"
+#include "chan_sim.h"
+
+#define RING_SIZE 4096
+#define TURNOVER_MS 600
+#define SETUP_MAX_TRIES 10
+#define SYNC_MARGIN_DB 3.0
+#define MODE_AUTO -2
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+struct station {
+    uint8_t tx_mem[RING_SIZE];
+    uint8_t rx_mem[RING_SIZE];
+    cbuf_handle_t tx_data;
+    cbuf_handle_t rx_data;
+    struct ale_arq *arq;
+    struct ale_rate rate;
+    struct ale_comp *comp;
+};
+
+struct result {
+    bool connected;
+    unsigned long setup_ms;
+    unsigned long data_ms;
+    size_t delivered;
+    unsigned long frames;
+    unsigned long retransmissions;
+    double cpu_ms;
+    double comp_ratio;
+    bool payload_ok;
+};
+
+static struct {
+    size_t payload_size;
+    unsigned int max_minutes;
+    double snr_min, snr_max, snr_step;
+    int profile;
+    int mode;
+    uint64_t seed;
+    bool json;
+    bool compress;
+} cfg = {
+    .payload_size = 10000,
+    .max_minutes = 60,
+    .snr_min = -5, .snr_max = 20, .snr_step = 5,
+    .profile = -1,
+    .mode = -1,
+    .seed = 1,
+    .json = false,
+    .compress = false,
+};
+
+// text-like payload: words of a small vocabulary, lines of about 64 chars
+static void text_payload(uint8_t *payload, size_t size)
+{
+    static const char *words[] = {
+        "the", "of", "and", "to", "in", "is", "for", "on", "with", "as",
+        "station", "radio", "message", "network", "village", "school", "health",
+        "report", "weather", "antenna", "frequency", "signal", "power", "solar",
+        "battery", "tomorrow", "received", "please", "confirm", "thanks",
+        "schedule", "delivery",
+    };
+    uint32_t x = 2463534242u;
+    size_t i = 0, line = 0;
+
+    while (i < size)
+    {
+        const char *w;
+
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        w = words[x % ARRAY_LEN(words)];
+
+        for (; *w && i < size; w++, line++)
+            payload[i++] = *w;
+        if (i < size)
+            payload[i++] = line > 60 ? '\n' : ' ';
+        line = line > 60 ? 0 : line + 1;
+    }
+}
+
+static void station_init(struct station *st, const struct ale_mode *mode)
+{
+    st->tx_data = circular_buf_init(st->tx_mem, RING_SIZE);
+    st->rx_data = circular_buf_init(st->rx_mem, RING_SIZE);
+    st->arq = ale_arq_alloc(st->tx_data, st->rx_data, mode);
+    ale_rate_init(&st->rate, mode->id, cfg.mode == MODE_AUTO);
+    st->comp = ale_comp_alloc(&st->arq->ring_io);
+}
+
+static void station_free(struct station *st)
+{
+    ale_comp_free(st->comp);
+    ale_arq_free(st->arq);
+    circular_buf_free(st->tx_data);
+    circular_buf_free(st->rx_data);
+}
+
+static double cpu_time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// host side writer: keeps the TX data ring as full as possible
+static size_t host_write(struct station *st, const uint8_t *payload, size_t offset)
+{
+    size_t len = circular_buf_free_size(st->tx_data);
+
+    if (len > cfg.payload_size - offset)
+        len = cfg.payload_size - offset;
+    if (len && circular_buf_put_range(st->tx_data, (uint8_t *) payload + offset, len) == 0)
+        offset += len;
+
+    return offset;
+}
+
+// host side reader: drains the RX data ring and checks the contents
+static size_t host_read(struct station *st, const uint8_t *payload, size_t offset, bool *ok)
+{
+    uint8_t buf[RING_SIZE];
+    size_t len = circular_buf_size(st->rx_data);
+
+    if (len && circular_buf_get_range(st->rx_data, buf, len) == 0)
+    {
+        if (offset + len > cfg.payload_size || memcmp(buf, payload + offset, len))
+            *ok = false;
+        offset += len;
+    }
+
+    return offset;
+}
+
+// sends one call control frame, returns true if the peer decoded it
+static bool send_ctrl(struct station *to, struct chan_sim *ch, enum ale_arq_ctrl_type type,
+                      struct result *res)
+{
+    const struct ale_mode *sig = ale_mode_get(ALE_MODE_DATAC13);
+    struct ale_arq_ctrl ctrl = { .type = type, .dst = "PU2UIT", .src = "PY2RAF" }, rx_ctrl;
+    uint8_t frame[sig->payload_bytes];
+    int flags;
+
+    ale_arq_ctrl_encode(frame, sizeof(frame), &ctrl);
+    res->setup_ms += sig->frame_ms + TURNOVER_MS;
+    if (!chan_sim_frame(ch, sig))
+        return false;
+
+    flags = ale_arq_rx_frame(to->arq, frame, sizeof(frame), &rx_ctrl);
+    return flags >= 0 && (flags & ARQ_HDR_CTRL) && rx_ctrl.type == type &&
+        !strcmp(rx_ctrl.dst, ctrl.dst);
+}
+
+// call + call ack, both on the signalling mode
+static bool link_setup(struct station *a, struct station *b, struct chan_sim *fwd,
+                       struct chan_sim *rev, struct result *res)
+{
+    bool called = false;
+
+    for (int i = 0; i < SETUP_MAX_TRIES && !called; i++)
+        called = send_ctrl(b, fwd, ARQ_CTRL_CALL, res);
+    if (!called)
+        return false;
+
+    for (int i = 0; i < SETUP_MAX_TRIES; i++)
+    {
+        if (send_ctrl(a, rev, ARQ_CTRL_CALL_ACK, res))
+            return true;
+    }
+    return false;
+}
+
+// one turn of station "from", returns the airtime used
+static unsigned long link_turn(struct station *from, struct station *to, struct chan_sim *ch)
+{
+    uint8_t frame[ARQ_MAX_PAYLOAD];
+    const struct ale_mode *mode;
+    unsigned long airtime = TURNOVER_MS;
+    int len;
+
+    ale_arq_set_mode(from->arq, ale_rate_turn(&from->rate, &from->arq->stats));
+    ale_comp_pump(from->comp);
+    ale_arq_set_rx_snr(from->arq, from->rate.rx_snr_valid, from->rate.rx_snr_db);
+    ale_arq_turn_begin(from->arq);
+    while ((len = ale_arq_tx_frame(from->arq, frame, sizeof(frame), &mode)) > 0)
+    {
+        bool ok = chan_sim_frame(ch, mode);
+
+        airtime += mode->frame_ms;
+        if (ok)
+            ale_arq_rx_frame(to->arq, frame, len, NULL);
+        if (ok || ch->last_snr_db > mode->min_snr_db - SYNC_MARGIN_DB)
+            ale_rate_rx_frame(&to->rate, ch->last_snr_db, ok);
+    }
+
+    return airtime;
+}
+
+static void link_transfer(struct station *a, struct station *b,
+                          struct chan_sim *fwd, struct chan_sim *rev,
+                          const uint8_t *payload, struct result *res)
+{
+    unsigned long max_ms = cfg.max_minutes * 60000UL;
+    size_t written = 0, read = 0;
+
+    res->payload_ok = true;
+
+    while (read < cfg.payload_size && res->data_ms < max_ms)
+    {
+        written = host_write(a, payload, written);
+
+        res->data_ms += link_turn(a, b, fwd);
+        read = host_read(b, payload, read, &res->payload_ok);
+        res->data_ms += link_turn(b, a, rev);
+    }
+
+    res->delivered = read;
+    res->frames = a->arq->stats.tx_frames;
+    res->retransmissions = a->arq->stats.tx_retransmissions;
+}
+
+static void run_one(enum chan_profile profile, double snr, const struct ale_mode *mode,
+                    const uint8_t *payload, struct result *res)
+{
+    struct station a, b;
+    struct chan_sim fwd, rev;
+    double cpu_start = cpu_time_ms();
+
+    memset(res, 0, sizeof(*res));
+    station_init(&a, mode);
+    station_init(&b, mode);
+    chan_sim_init(&fwd, profile, snr, cfg.seed);
+    chan_sim_init(&rev, profile, snr, cfg.seed * 7919 + 1);
+
+    res->connected = link_setup(&a, &b, &fwd, &rev, res);
+    if (res->connected && cfg.compress)
+    {
+        uint8_t caps = ale_comp_negotiate(b.comp, ale_comp_caps(a.comp), a.comp->dict_id);
+
+        ale_arq_set_io(a.arq, ale_comp_start(a.comp, caps));
+        ale_arq_set_io(b.arq, ale_comp_start(b.comp, caps));
+    }
+    if (res->connected)
+        link_transfer(&a, &b, &fwd, &rev, payload, res);
+    res->comp_ratio = ale_comp_ratio(&a.comp->stats);
+
+    station_free(&a);
+    station_free(&b);
+    res->cpu_ms = cpu_time_ms() - cpu_start;
+}
+
+static void print_result(enum chan_profile profile, double snr, const struct ale_mode *mode,
+                         const struct result *res, bool first)
+{
+    unsigned long bpm = res->data_ms ? res->delivered * 60000UL / res->data_ms : 0;
+    const char *mode_name = mode ? mode->name : "auto";
+
+    if (cfg.json)
+    {
+        printf("%s  {\"profile\": \"%s\", \"snr_db\": %.1f, \"mode\": \"%s\", "
+               "\"connected\": %s, \"setup_s\": %.1f, \"airtime_s\": %.1f, "
+               "\"delivered\": %zu, \"bytes_per_min\": %lu, \"frames\": %lu, "
+               "\"retransmissions\": %lu, \"cpu_ms\": %.3f, \"comp_ratio\": %.3f, "
+               "\"payload_ok\": %s}",
+               first ? "" : ",\n", chan_profile_name(profile), snr, mode_name,
+               res->connected ? "true" : "false", res->setup_ms / 1000.0,
+               res->data_ms / 1000.0, res->delivered, bpm, res->frames,
+               res->retransmissions, res->cpu_ms, res->comp_ratio,
+               res->payload_ok ? "true" : "false");
+        return;
+    }
+
+    printf("%s,%.1f,%s,%d,%.1f,%.1f,%zu,%lu,%lu,%lu,%.3f,%.3f,%d\n",
+           chan_profile_name(profile), snr, mode_name, res->connected,
+           res->setup_ms / 1000.0, res->data_ms / 1000.0, res->delivered, bpm,
+           res->frames, res->retransmissions, res->cpu_ms, res->comp_ratio,
+           res->payload_ok);
+}
+
+static void print_help(void)
+{
+    printf("Usage: goodput_bench [options]\n"
+           "  -s <bytes>         payload size (default %zu)\n"
+           "  -S <min:max:step>  SNR range in dB (default %.0f:%.0f:%.0f)\n"
+           "  -p <profile>       awgn, mpg, mpm or mpp (default all)\n"
+           "  -m <mode>          data mode or \"auto\" (default all data modes)\n"
+           "  -t <minutes>       max simulated transfer time (default %u)\n"
+           "  -r <seed>          random seed (default %lu)\n"
+           "  -z                 compress the payload (ale_comp)\n"
+           "  -j                 JSON output instead of CSV\n",
+           cfg.payload_size, cfg.snr_min, cfg.snr_max, cfg.snr_step,
+           cfg.max_minutes, (unsigned long) cfg.seed);
+}
+
+static void handle_options(int argc, char **argv)
+{
+    int c;
+
+    while ((c = getopt(argc, argv, "hs:S:p:m:t:r:zj")) != -1)
+    {
+        switch (c) {
+        case 's':
+            cfg.payload_size = strtoul(optarg, NULL, 0);
+            break;
+        case 'S':
+            if (sscanf(optarg, "%lf:%lf:%lf", &cfg.snr_min, &cfg.snr_max, &cfg.snr_step) != 3 ||
+                cfg.snr_step <= 0)
+            {
+                fprintf(stderr, "Invalid SNR range %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'p':
+            cfg.profile = chan_profile_by_name(optarg);
+            if (cfg.profile < 0)
+            {
+                fprintf(stderr, "Unknown channel profile %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'm':
+            if (!strcmp(optarg, "auto"))
+            {
+                cfg.mode = MODE_AUTO;
+                break;
+            }
+            if (!ale_mode_by_name(optarg))
+            {
+                fprintf(stderr, "Unknown mode %s\n", optarg);
+                exit(1);
+            }
+            cfg.mode = ale_mode_by_name(optarg)->id;
+            break;
+        case 't':
+            cfg.max_minutes = atoi(optarg);
+            break;
+        case 'r':
+            cfg.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'z':
+            cfg.compress = true;
+            break;
+        case 'j':
+            cfg.json = true;
+            break;
+        case 'h':
+            print_help();
+            exit(0);
+        default:
+            print_help();
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *payload;
+    bool first = true;
+
+    handle_options(argc, argv);
+
+    payload = malloc(cfg.payload_size);
+    text_payload(payload, cfg.payload_size);
+
+    if (cfg.json)
+        printf("[\n");
+    else
+        printf("profile,snr_db,mode,connected,setup_s,airtime_s,delivered,"
+               "bytes_per_min,frames,retransmissions,cpu_ms,comp_ratio,payload_ok\n");
+
+    for (int p = 0; p < _NUM_CHAN_PROFILES; p++)
+    {
+        if (cfg.profile >= 0 && cfg.profile != p)
+            continue;
+
+        for (double snr = cfg.snr_min; snr <= cfg.snr_max; snr += cfg.snr_step)
+        {
+            for (int m = 0; m < _NUM_ALE_MODES; m++)
+            {
+                const struct ale_mode *mode = ale_mode_get(m);
+                struct result res;
+
+                if (cfg.mode == MODE_AUTO)
+                {
+                    // rate adaptation, starting from the middle level
+                    if (m != ALE_MODE_DATAC3)
+                        continue;
+                }
+                else if ((cfg.mode >= 0 && cfg.mode != m) || (cfg.mode < 0 && !mode->data))
+                {
+                    continue;
+                }
+
+                run_one(p, snr, mode, payload, &res);
+                print_result(p, snr, cfg.mode == MODE_AUTO ? NULL : mode, &res, first);
+                first = false;
+            }
+        }
+    }
+
+    if (cfg.json)
+        printf("\n]\n");
+
+    free(payload);
+    return 0;
+}
@@ -0,0 +1,183 @@
+/* Host TX arbitration test
+ *
+ * Three host clients write the bulk class at once, each its own stream,
+ * and keep writing as the TX queue drains the ring. The frames go to a
+ * peer queue, and its bulk RX ring must hold the three streams one after
+ * the other, each one whole: the class is owned by one writer until it
+ * detaches, then goes to the waiting one of the highest priority.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/utils.h>
+
+#include "internal.h"
+
+#define RING_SIZE 4096
+#define FRAME 126           // datac3 payload
+#define WRITERS 3
+#define STREAM 20000        // bytes each writer sends
+#define CHUNK 700           // at most per write, as a socket read would
+
+struct writer {
+    struct ale_host_tx tx;
+    unsigned int id;
+    size_t sent;
+};
+
+static const struct log_info_cat log_info_cat[] = {
+    [ALE] = {
+        .name = "ALE",
+        .description = "Rhizomatica HF ALE System",
+        .enabled = 1,
+        .loglevel = LOGL_NOTICE,
+    },
+};
+
+static const struct log_info log_info = {
+    .cat = log_info_cat,
+    .num_cat = ARRAY_SIZE(log_info_cat),
+};
+
+static struct ale_station *st;
+static struct ale_txq *peer;
+static cbuf_handle_t peer_rx[ALE_TX_NUM_CLASSES];
+static struct writer writers[WRITERS];
+
+// byte pos of the stream of a writer, each one tells itself apart
+static uint8_t pattern(unsigned int id, size_t pos)
+{
+    return (pos * (2 * id + 3) + (pos >> 8) + 85 * id) & 0xff;
+}
+
+static cbuf_handle_t ring_alloc(void)
+{
+    return circular_buf_init(talloc_size(st, RING_SIZE), RING_SIZE);
+}
+
+// what a data port read callback does with the quota
+static void writer_resume(struct ale_host_tx *tx)
+{
+    struct writer *w = tx->priv;
+    cbuf_handle_t ring = ale_host_tx_ring(st, tx);
+    uint8_t buf[CHUNK];
+
+    while (w->sent < STREAM)
+    {
+        size_t len = OSMO_MIN(ale_host_tx_quota(st, tx), circular_buf_free_size(ring));
+
+        len = OSMO_MIN(len, OSMO_MIN(STREAM - w->sent, (size_t) CHUNK));
+        if (!len)
+        {
+            ale_host_tx_wait(st, tx);
+            return;
+        }
+        for (size_t i = 0; i < len; i++)
+            buf[i] = pattern(w->id, w->sent + i);
+        circular_buf_put_range(ring, buf, len);
+        w->sent += len;
+        ale_host_tx_wrote(st, tx, len);
+    }
+}
+
+static void station_init(void *ctx)
+{
+    cbuf_handle_t peer_tx[ALE_TX_NUM_CLASSES];
+
+    st = talloc_zero(ctx, struct ale_station);
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        st->tx_rings[i] = ring_alloc();
+        st->rx_rings[i] = ring_alloc();
+        peer_tx[i] = ring_alloc();
+        peer_rx[i] = ring_alloc();
+    }
+    st->tx_data = st->tx_rings[ALE_TX_BULK];
+    st->arq = ale_arq_alloc(st->tx_data, st->rx_rings[ALE_TX_BULK], ale_mode_get(ALE_MODE_DATAC3));
+    st->txq = ale_txq_alloc(st->tx_rings, st->rx_rings);
+    peer = ale_txq_alloc(peer_tx, peer_rx);
+    assert(ale_stats_init(ctx, st) == 0);
+}
+
+int main(void)
+{
+    void *ctx = talloc_named_const(NULL, 1, "host_test");
+    static uint8_t got[WRITERS * STREAM];
+    static const unsigned int prio[WRITERS] = { 3, 1, 5 };
+    unsigned int order[WRITERS], owners = 0;
+    size_t got_len = 0;
+    uint8_t frame[FRAME];
+
+    osmo_init_logging2(ctx, &log_info);
+    station_init(ctx);
+
+    for (unsigned int i = 0; i < WRITERS; i++)
+    {
+        struct writer *w = &writers[i];
+
+        w->id = i;
+        w->tx = (struct ale_host_tx) {
+            .name = "test",
+            .prio = prio[i],
+            .cls = ALE_TX_BULK,
+            .resume = writer_resume,
+            .priv = w,
+        };
+        ale_host_tx_attach(st, &w->tx);
+        writer_resume(&w->tx);
+    }
+    assert(ale_host_tx_owner(ALE_TX_BULK) == &writers[0].tx);
+    assert(writers[1].tx.waiting && writers[2].tx.waiting && !writers[1].sent && !writers[2].sent);
+
+    while (got_len < sizeof(got))
+    {
+        struct ale_host_tx *owner = ale_host_tx_owner(ALE_TX_BULK);
+        size_t len = st->txq->io.read(st->txq->io.priv, frame, FRAME);
+
+        assert(peer->io.write(peer->io.priv, frame, len));
+        len = circular_buf_size(peer_rx[ALE_TX_BULK]);
+        assert(got_len + len <= sizeof(got));
+        circular_buf_get_range(peer_rx[ALE_TX_BULK], got + got_len, len);
+        got_len += len;
+
+        // the owner is done once all of its stream is in the ring: it goes
+        if (owner && ((struct writer *) owner->priv)->sent == STREAM)
+        {
+            struct writer *w = owner->priv;
+
+            order[owners++] = w->id;
+            ale_host_tx_detach(st, owner);
+        }
+        // as on the BUFFER event
+        ale_host_tx_schedule(st);
+        assert(len || ale_txq_size(st->txq) || ale_host_tx_owner(ALE_TX_BULK));
+    }
+
+    // first come, then by priority
+    assert(owners == WRITERS && order[0] == 0 && order[1] == 2 && order[2] == 1);
+
+    for (unsigned int i = 0; i < WRITERS; i++)
+    {
+        const uint8_t *s = got + i * STREAM;
+        unsigned int id = order[i];
+
+        for (size_t pos = 0; pos < STREAM; pos++)
+            assert(s[pos] == pattern(id, pos));
+        printf("writer %u (priority %u): %u bytes in one piece, %lu waits\n", id, prio[id],
+               STREAM, writers[id].tx.stats.waits);
+    }
+    assert(!peer->rx_errors);
+
+    talloc_free(ctx);
+    return EXIT_SUCCESS;
+}
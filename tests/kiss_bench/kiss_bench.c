@@ -0,0 +1,234 @@
+/* KISS parser throughput benchmark
+ *
+ * Parses a KISS stream (a capture given with -f, or a synthetic one) in
+ * batches, the way the TCP port does, into a record ring which is drained
+ * after each batch. The same stream goes through a byte at a time
+ * reference parser feeding the same ring; both must produce the same
+ * frames.
+ *
+ * Synthetic streams have random frame lengths and a given share of bytes
+ * needing escapes (0 for plain text, ~1% for random binary data).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+#include "ale_kiss.h"
+
+#define RING_SIZE (256 * 1024)
+
+struct digest {
+    unsigned long frames;
+    uint64_t hash;
+};
+
+static void digest_frame(struct digest *d, const uint8_t *data, size_t len)
+{
+    d->frames++;
+    d->hash = (d->hash ^ len) * 0x100000001b3ULL;
+    for (size_t i = 0; i < len; i++)
+        d->hash = (d->hash ^ data[i]) * 0x100000001b3ULL;
+}
+
+// byte at a time, same error handling as ale_kiss_parse
+struct ref_parser {
+    uint8_t frame[KISS_MAX_FRAME];
+    size_t len;
+    bool in_frame, escape, discard;
+};
+
+static void ref_parse(struct ref_parser *p, const uint8_t *buf, size_t len, cbuf_handle_t ring)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = buf[i];
+
+        if (c == KISS_FEND)
+        {
+            if (p->in_frame && !p->discard && !p->escape && p->len)
+                circular_buf_put_record(ring, p->frame, p->len);
+            p->in_frame = true;
+            p->len = 0;
+            p->escape = p->discard = false;
+            continue;
+        }
+        if (!p->in_frame)
+            continue;
+        if (p->escape)
+        {
+            p->escape = false;
+            if (c == KISS_TFEND)
+                c = KISS_FEND;
+            else if (c == KISS_TFESC)
+                c = KISS_FESC;
+            else
+            {
+                p->discard = true;
+                continue;
+            }
+        }
+        else if (c == KISS_FESC)
+        {
+            p->escape = true;
+            continue;
+        }
+        if (p->len == KISS_MAX_FRAME)
+            p->discard = true;
+        if (!p->discard)
+            p->frame[p->len++] = c;
+    }
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t *synth_stream(size_t size, double special, size_t *len)
+{
+    uint8_t *out = malloc(size + 2 * KISS_MAX_FRAME + 2);
+    uint8_t frame[KISS_MAX_FRAME];
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        size_t flen = 1 + rand() % KISS_MAX_FRAME;
+
+        frame[0] = 0;
+        for (size_t i = 1; i < flen; i++)
+        {
+            if (rand() < special * RAND_MAX)
+                frame[i] = rand() & 1 ? KISS_FEND : KISS_FESC;
+            else
+                frame[i] = ' ' + rand() % 95;
+        }
+        pos += ale_kiss_encode(out + pos, 2 * KISS_MAX_FRAME + 2, frame, flen);
+    }
+
+    *len = pos;
+    return out;
+}
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t *out;
+    long size;
+
+    if (!fp)
+    {
+        perror(path);
+        exit(1);
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    out = malloc(size);
+    *len = fread(out, 1, size, fp);
+    fclose(fp);
+
+    return out;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-f capture] [-s MB] [-e special_ratio] [-c chunk] [-r rounds]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *file = NULL;
+    double special = 0.01;
+    size_t size = 64 << 20, chunk = 16384, len;
+    int rounds = 5, opt;
+    uint8_t *stream, *ring_mem, record[KISS_MAX_FRAME];
+    cbuf_handle_t ring;
+    struct digest fast = { 0, 0xcbf29ce484222325ULL }, ref = fast;
+    double best_fast = 1e9, best_ref = 1e9;
+
+    while ((opt = getopt(argc, argv, "f:s:e:c:r:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f': file = optarg; break;
+        case 's': size = atol(optarg) << 20; break;
+        case 'e': special = atof(optarg); break;
+        case 'c': chunk = atol(optarg); break;
+        case 'r': rounds = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (!chunk || rounds < 1)
+        usage(argv[0]);
+
+    srand(1);
+    stream = file ? read_file(file, &len) : synth_stream(size, special, &len);
+    ring_mem = malloc(RING_SIZE);
+    ring = circular_buf_init(ring_mem, RING_SIZE);
+
+    for (int r = 0; r < rounds; r++)
+    {
+        struct digest d = { 0, 0xcbf29ce484222325ULL };
+        struct ref_parser rp = { 0 };
+        struct ale_kiss kiss;
+        double t;
+        int n;
+
+        ale_kiss_init(&kiss);
+        t = now_s();
+        for (size_t pos = 0; pos < len; pos += chunk)
+        {
+            size_t n_bytes = len - pos < chunk ? len - pos : chunk;
+
+            ale_kiss_parse(&kiss, stream + pos, n_bytes, ring);
+            while ((n = circular_buf_get_record(ring, record, sizeof(record))) > 0)
+                digest_frame(&d, record, n);
+        }
+        t = now_s() - t;
+        if (t < best_fast)
+            best_fast = t;
+        fast = d;
+        if (kiss.stats.dropped)
+            fprintf(stderr, "%lu frames dropped, ring too small\n", kiss.stats.dropped);
+
+        d = (struct digest) { 0, 0xcbf29ce484222325ULL };
+        t = now_s();
+        for (size_t pos = 0; pos < len; pos += chunk)
+        {
+            ref_parse(&rp, stream + pos, len - pos < chunk ? len - pos : chunk, ring);
+            while ((n = circular_buf_get_record(ring, record, sizeof(record))) > 0)
+                digest_frame(&d, record, n);
+        }
+        t = now_s() - t;
+        if (t < best_ref)
+            best_ref = t;
+        ref = d;
+    }
+
+    printf("stream: %.1f MB, %lu frames, chunk %zu\n", len / 1e6, ref.frames, chunk);
+    printf("vector:  %8.1f MB/s\n", len / 1e6 / best_fast);
+    printf("bytewise: %7.1f MB/s\n", len / 1e6 / best_ref);
+
+    if (fast.frames != ref.frames || fast.hash != ref.hash)
+    {
+        printf("FAIL: parsers disagree (%lu vs %lu frames)\n", fast.frames, ref.frames);
+        return 1;
+    }
+    printf("PASS\n");
+
+    free(ring_mem);
+    free(stream);
+    return 0;
+}
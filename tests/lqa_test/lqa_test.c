@@ -0,0 +1,148 @@
+/* Link quality analysis store test
+ *
+ * Checks the decayed SNR means and frame error rates of the channel and
+ * station entries, the decay over a half life, the best channel choice
+ * with and without station history, that the history survives reopening
+ * the file, and that a full table replaces its weakest entries. Then 100
+ * channels of history for 2000 stations are loaded and the cost of a best
+ * channel query over 32 channels is reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ale_lqa.h"
+
+#define LQA_FILE "lqa_test.lqa"
+#define T0 1700000000
+#define HALF_LIFE 3600
+#define CHANNELS 100
+#define STATIONS 2000
+#define QUERIES 100000
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool near(float a, float b, float tol)
+{
+    return fabsf(a - b) <= tol;
+}
+
+int main(void)
+{
+    struct ale_lqa *lqa = ale_lqa_alloc(ALE_LQA_DEFAULT_SLOTS);
+    const uint32_t freqs[] = { 3596000, 7102000, 14109000 };
+    struct ale_lqa_info info;
+    float score;
+    double t;
+    int best;
+
+    unlink(LQA_FILE);
+    lqa->half_life = HALF_LIFE;
+
+    // PY2ABC: 10 dB on 7 MHz, one in four frames failing the CRC
+    for (int i = 0; i < 40; i++)
+        ale_lqa_update(lqa, freqs[1], "PY2ABC", 10, i % 4, false, T0);
+    assert(ale_lqa_get(lqa, freqs[1], "PY2ABC", T0, &info));
+    assert(near(info.weight, 40, 0.01) && near(info.snr_db, 10, 0.01) && near(info.fer, 0.25, 0.01));
+    assert(ale_lqa_get(lqa, freqs[1], NULL, T0, &info) && near(info.weight, 40, 0.01));
+
+    // one half life later, half the weight, the same mean
+    assert(ale_lqa_get(lqa, freqs[1], "PY2ABC", T0 + HALF_LIFE, &info));
+    assert(near(info.weight, 20, 0.01) && near(info.snr_db, 10, 0.01) && info.age_s == HALF_LIFE);
+
+    // fresh samples count more than old ones
+    ale_lqa_update(lqa, freqs[1], "PY2ABC", 0, true, true, T0 + 4 * HALF_LIFE);
+    assert(ale_lqa_get(lqa, freqs[1], "PY2ABC", T0 + 4 * HALF_LIFE, &info));
+    assert(near(info.weight, 3.5, 0.01) && near(info.snr_db, 10 - 10 / 3.5, 0.01) && info.snr_sd > 4);
+
+    // PY2ABC better on 14 MHz; on 3.5 MHz others are heard well
+    for (int i = 0; i < 20; i++)
+    {
+        ale_lqa_update(lqa, freqs[2], "PY2ABC", 15, true, false, T0 + 4 * HALF_LIFE);
+        ale_lqa_update(lqa, freqs[0], "PY5XYZ", 20, true, false, T0 + 4 * HALF_LIFE);
+    }
+    best = ale_lqa_best(lqa, "PY2ABC", freqs, 3, T0 + 4 * HALF_LIFE, &score);
+    assert(best == 2 && score > 0);
+    best = ale_lqa_best(lqa, "PY7NEW", freqs, 3, T0 + 4 * HALF_LIFE, NULL);
+    assert(best == 0);
+    assert(ale_lqa_best(lqa, NULL, freqs, 2, T0, NULL) >= 0);
+    assert(ale_lqa_best(lqa, "PY2ABC", freqs + 2, 0, T0, NULL) == -1);
+
+    // into a file, and back after a restart
+    assert(ale_lqa_open(lqa, LQA_FILE) == 0);
+    assert(ale_lqa_get(lqa, freqs[2], "PY2ABC", T0 + 4 * HALF_LIFE, &info) && near(info.snr_db, 15, 0.01));
+    ale_lqa_update(lqa, freqs[2], "PY2DEF", 3, true, false, T0 + 4 * HALF_LIFE);
+    ale_lqa_free(lqa);
+
+    lqa = ale_lqa_alloc(ALE_LQA_DEFAULT_SLOTS);
+    lqa->half_life = HALF_LIFE;
+    assert(!ale_lqa_get(lqa, freqs[2], "PY2DEF", T0, &info));
+    assert(ale_lqa_open(lqa, LQA_FILE) == 0);
+    assert(ale_lqa_get(lqa, freqs[2], "PY2DEF", T0 + 4 * HALF_LIFE, &info) && near(info.snr_db, 3, 0.01));
+    assert(ale_lqa_get(lqa, freqs[1], "PY2ABC", T0 + 4 * HALF_LIFE, &info) && info.weight > 3);
+    ale_lqa_free(lqa);
+
+    // a file of another layout is taken over
+    lqa = ale_lqa_alloc(1024);
+    assert(ale_lqa_open(lqa, LQA_FILE) == 0);
+    assert(!ale_lqa_get(lqa, freqs[2], "PY2DEF", T0, &info));
+    ale_lqa_free(lqa);
+    unlink(LQA_FILE);
+
+    // a full table keeps the fresh entries
+    lqa = ale_lqa_alloc(64);
+    for (int i = 0; i < 1000; i++)
+    {
+        char addr[16];
+
+        snprintf(addr, sizeof(addr), "S%04d", i);
+        ale_lqa_update(lqa, freqs[i % 3], addr, i % 30, true, false, T0 + i);
+        assert(ale_lqa_get(lqa, freqs[i % 3], addr, T0 + i, &info));
+    }
+    ale_lqa_free(lqa);
+
+    // query cost with a realistic history
+    lqa = ale_lqa_alloc(256 * 1024);
+    for (int s = 0; s < STATIONS; s++)
+    {
+        char addr[16];
+
+        snprintf(addr, sizeof(addr), "S%04d", s);
+        for (int c = s % 4; c < CHANNELS; c += 4)
+            ale_lqa_update(lqa, 2000000 + c * 250000, addr, (s + c) % 25, true, false, T0);
+    }
+    {
+        uint32_t scan[32];
+        int found = 0;
+
+        for (int c = 0; c < 32; c++)
+            scan[c] = 2000000 + c * 3 * 250000;
+        t = now_ns();
+        for (int q = 0; q < QUERIES; q++)
+        {
+            char addr[16];
+
+            snprintf(addr, sizeof(addr), "S%04d", (q * 7) % STATIONS);
+            found += ale_lqa_best(lqa, addr, scan, 32, T0 + 600, NULL) >= 0;
+        }
+        t = (now_ns() - t) / QUERIES;
+        assert(found == QUERIES);
+    }
+    printf("best channel of 32 among %d channels x %d stations: %.0f ns per query\n", CHANNELS,
+           STATIONS, t);
+    ale_lqa_free(lqa);
+
+    printf("OK\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+/* Speed level controller test
+ *
+ * A station sends continuous traffic to its peer through the frame level
+ * channel simulator. The receiving side feeds the SNR of the frames it
+ * gets back into the controller of the sender (the channel is taken as
+ * reciprocal), the controller picks the level at every turnover.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+#include "ale_arq.h"
+#include "ale_rate.h"
+#include "chan_sim.h"
+
+#define RING_SIZE 8192
+#define SYNC_MARGIN_DB 3.0
+
+struct station {
+    uint8_t tx_mem[RING_SIZE];
+    uint8_t rx_mem[RING_SIZE];
+    cbuf_handle_t tx_data;
+    cbuf_handle_t rx_data;
+    struct ale_arq *arq;
+    struct ale_rate rate;
+};
+
+struct run {
+    unsigned int switches;
+    unsigned long delivered;
+    enum ale_mode_id level;
+};
+
+static void station_init(struct station *st)
+{
+    st->tx_data = circular_buf_init(st->tx_mem, RING_SIZE);
+    st->rx_data = circular_buf_init(st->rx_mem, RING_SIZE);
+    st->arq = ale_arq_alloc(st->tx_data, st->rx_data, ale_mode_get(ALE_MODE_DATAC3));
+    ale_rate_init(&st->rate, ALE_MODE_DATAC3, true);
+}
+
+static void station_free(struct station *st)
+{
+    ale_arq_free(st->arq);
+    circular_buf_free(st->tx_data);
+    circular_buf_free(st->rx_data);
+}
+
+static void turn(struct station *from, struct station *to, struct chan_sim *ch)
+{
+    uint8_t frame[ARQ_MAX_PAYLOAD];
+    const struct ale_mode *mode;
+    int len;
+
+    ale_arq_set_mode(from->arq, ale_rate_turn(&from->rate, &from->arq->stats));
+    ale_arq_set_rx_snr(from->arq, from->rate.rx_snr_valid, from->rate.rx_snr_db);
+    ale_arq_turn_begin(from->arq);
+
+    while ((len = ale_arq_tx_frame(from->arq, frame, sizeof(frame), &mode)) > 0)
+    {
+        bool ok = chan_sim_frame(ch, mode);
+
+        if (ok)
+            ale_arq_rx_frame(to->arq, frame, len, NULL);
+
+        // frames that sync but fail decoding are reported too
+        if (ok || ch->last_snr_db > mode->min_snr_db - SYNC_MARGIN_DB)
+            ale_rate_rx_frame(&to->rate, ch->last_snr_db, ok);
+    }
+}
+
+/* runs n turn pairs, the SNR going linearly from snr0 to snr1, rev_db
+ * lower on the way back */
+static void run_link(struct station *a, struct station *b, enum chan_profile profile,
+                     double snr0, double snr1, double rev_db, int n, uint64_t seed, struct run *r)
+{
+    struct chan_sim fwd, rev;
+    uint8_t junk[RING_SIZE];
+
+    memset(r, 0, sizeof(*r));
+    chan_sim_init(&fwd, profile, snr0, seed);
+    chan_sim_init(&rev, profile, snr0, seed + 1);
+    memset(junk, 'x', sizeof(junk));
+
+    for (int i = 0; i < n; i++)
+    {
+        enum ale_mode_id before = a->rate.level;
+        size_t len;
+
+        fwd.snr_db = snr0 + (snr1 - snr0) * i / n;
+        rev.snr_db = fwd.snr_db - rev_db;
+
+        // keep the sender busy
+        len = circular_buf_free_size(a->tx_data);
+        if (len)
+            circular_buf_put_range(a->tx_data, junk, len);
+
+        turn(a, b, &fwd);
+
+        len = circular_buf_size(b->rx_data);
+        r->delivered += len;
+        if (len)
+            circular_buf_get_range(b->rx_data, junk, len);
+
+        // the peer only acknowledges, with the SNR our frames arrive with
+        turn(b, a, &rev);
+
+        if (a->rate.level != before)
+            r->switches++;
+    }
+
+    r->level = a->rate.level;
+}
+
+static void check(const char *name, bool cond)
+{
+    printf("%-50s %s\n", name, cond ? "PASS" : "FAIL");
+    if (!cond)
+        exit(1);
+}
+
+int main(void)
+{
+    struct station a, b;
+    struct run r;
+
+    printf("\n=== Speed level controller ===\n");
+
+    station_init(&a);
+    station_init(&b);
+    run_link(&a, &b, CHAN_AWGN, 20, 20, 0, 40, 1, &r);
+    check("AWGN 20 dB goes up to datac1", r.level == ALE_MODE_DATAC1);
+    check("AWGN 20 dB settles (one switch)", r.switches == 1);
+    station_free(&a);
+    station_free(&b);
+
+    station_init(&a);
+    station_init(&b);
+    run_link(&a, &b, CHAN_AWGN, -3, -3, 0, 40, 2, &r);
+    check("AWGN -3 dB goes down to datac4", r.level == ALE_MODE_DATAC4);
+    check("AWGN -3 dB still delivers data", r.delivered > 0);
+    station_free(&a);
+    station_free(&b);
+
+    // the level goes on how the peer hears us, not on how we hear it
+    station_init(&a);
+    station_init(&b);
+    run_link(&a, &b, CHAN_AWGN, 20, 20, 18, 40, 7, &r);
+    check("AWGN 20 dB, 2 dB back, goes up to datac1", r.level == ALE_MODE_DATAC1);
+    station_free(&a);
+    station_free(&b);
+
+    station_init(&a);
+    station_init(&b);
+    run_link(&a, &b, CHAN_MPP, 15, 15, 0, 60, 3, &r);
+    check("CCIR poor 15 dB reaches datac1", r.level == ALE_MODE_DATAC1);
+    check("CCIR poor 15 dB does not flap (< 6 switches)", r.switches < 6);
+    printf("  %u switches, %lu bytes\n", r.switches, r.delivered);
+
+    // fade down to -2 dB and back, on the same link
+    run_link(&a, &b, CHAN_MPP, 15, -2, 0, 40, 4, &r);
+    check("CCIR poor fading to -2 dB goes down", r.level != ALE_MODE_DATAC1);
+    run_link(&a, &b, CHAN_MPP, -2, 15, 0, 40, 5, &r);
+    run_link(&a, &b, CHAN_MPP, 15, 15, 0, 20, 6, &r);
+    check("CCIR poor back to 15 dB goes up again", r.level == ALE_MODE_DATAC1);
+    check("Fragmented retransmissions delivered", a.arq->stats.tx_fragments == 0 ||
+          b.arq->stats.rx_fragments > 0);
+    printf("  decisions: up %lu, down-snr %lu, down-fer %lu, down-retry %lu, hold %lu\n",
+           a.rate.stats.decisions[RATE_UP], a.rate.stats.decisions[RATE_DOWN_SNR],
+           a.rate.stats.decisions[RATE_DOWN_FER], a.rate.stats.decisions[RATE_DOWN_RETRY],
+           a.rate.stats.decisions[RATE_HOLD]);
+    station_free(&a);
+    station_free(&b);
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+/* RX audio recorder test
+ *
+ * Feeds 400 s of 8 kHz ramp audio and a frame event every 10 s through the
+ * recorder, 80 times faster than real time, with 1 MB recording files of
+ * which 4 are kept and a "keep" of 10 s at 200 s. Reported is the cost of
+ * ale_rec_audio() for a 20 ms block, the modem thread's share. Then the
+ * files left are read back: every chunk must hold the ramp at its stream
+ * position, gaps must be announced in the index, the index must list the
+ * events at their positions and the kept files must cover the 190 s to
+ * 210 s window. One file is replayed into a ring, which must then hold its
+ * chunks back to back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "ale_rec.h"
+#include "ale_replay.h"
+
+#define RATE 8000
+#define BLOCK 160
+#define SECS 400
+#define EVENT_SECS 10
+#define KEEP_AT 200
+#define KEEP_SECS 10
+#define REC_DIR "rec_test.d"
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int16_t ramp(uint64_t pos)
+{
+    return (int16_t) (pos * 7);
+}
+
+static void clean(void)
+{
+    DIR *d = opendir(REC_DIR);
+    struct dirent *de;
+    char path[512];
+
+    if (!d)
+        return;
+    while ((de = readdir(d)))
+    {
+        if (de->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), REC_DIR "/%s", de->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
+
+/// Checks a recording and its index, returns the covered stream positions
+static void check_file(const char *name, uint64_t *first, uint64_t *end, unsigned int *events)
+{
+    char path[512];
+    struct stat sb;
+    uint8_t *map;
+    struct ale_rec_file_hdr *hdr;
+    size_t chunk_size;
+    uint64_t pos = 0;
+    int fd;
+
+    snprintf(path, sizeof(path), REC_DIR "/%s.rec", name);
+    fd = open(path, O_RDONLY);
+    assert(fd >= 0 && fstat(fd, &sb) == 0);
+    map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    assert(map != MAP_FAILED);
+    close(fd);
+
+    hdr = (struct ale_rec_file_hdr *) map;
+    assert(!memcmp(hdr->magic, ALE_REC_MAGIC, sizeof(hdr->magic)));
+    assert(hdr->rate == RATE && hdr->chunks > 0);
+    chunk_size = sizeof(struct ale_rec_chunk) + hdr->chunk_samples * sizeof(int16_t);
+    assert(sb.st_size == (off_t) (sizeof(*hdr) + hdr->chunks * chunk_size));
+
+    for (unsigned int c = 0; c < hdr->chunks; c++)
+    {
+        struct ale_rec_chunk *chunk = (struct ale_rec_chunk *) (map + sizeof(*hdr) + c * chunk_size);
+        int16_t *s = (int16_t *) (chunk + 1);
+
+        assert(!c || chunk->pos >= pos);
+        if (!c)
+            *first = chunk->pos;
+        for (unsigned int i = 0; i < chunk->samples; i++)
+            assert(s[i] == ramp(chunk->pos + i));
+        pos = chunk->pos + chunk->samples;
+    }
+    *end = pos;
+    munmap(map, sb.st_size);
+
+    // the index: chunks where the audio says, gaps announced, events in order
+    {
+        struct ale_rec_idx idx;
+        uint64_t last = 0, chunk_end = *first;
+        FILE *f;
+
+        snprintf(path, sizeof(path), REC_DIR "/%s.idx", name);
+        f = fopen(path, "r");
+        assert(f);
+        while (fread(&idx, sizeof(idx), 1, f) == 1)
+        {
+            assert(idx.pos >= last);
+            last = idx.pos;
+            if (idx.type == REC_CHUNK)
+            {
+                assert(idx.pos == chunk_end + idx.b || chunk_end == *first);
+                chunk_end = idx.pos + RATE;
+            }
+            else if (idx.type == REC_FRAME)
+            {
+                assert(idx.pos == (uint64_t) idx.a * EVENT_SECS * RATE);
+                (*events)++;
+            }
+        }
+        fclose(f);
+    }
+}
+
+/// Replays a recording into a ring big enough for all of it
+static void check_replay(const char *name, uint64_t first, uint64_t end)
+{
+    static struct ale_replay rp;
+    size_t ring_size = 4 << 20;
+    cbuf_handle_t ring = circular_buf_init(malloc(ring_size), ring_size);
+    char path[512];
+    int16_t s;
+    uint64_t samples;
+
+    snprintf(path, sizeof(path), REC_DIR "/%s.rec", name);
+    assert(ale_replay_open(&rp, path) == 0);
+    assert(ale_replay_run(&rp, ring) == 0);
+    samples = circular_buf_size(ring) / sizeof(int16_t);
+    printf("%s replayed: %.1f s in %lu chunks, %lu gaps\n", name, ale_replay_secs(&rp),
+           rp.stats.chunks, rp.stats.gaps);
+    assert(rp.stats.samples == samples);
+    assert(samples == end - first || rp.stats.gaps);
+
+    circular_buf_get_range(ring, (uint8_t *) &s, sizeof(s));
+    assert(s == ramp(first));
+    ale_replay_close(&rp);
+    free(ring->buffer);
+    circular_buf_free(ring);
+}
+
+int main(void)
+{
+    struct ale_rec *rec = ale_rec_alloc(RATE);
+    int16_t block[BLOCK];
+    uint64_t pos = 0;
+    double t, worst = 0, total = 0;
+    unsigned long blocks = 0, kept = 0, files = 0, events = 0;
+    uint64_t keep_first = UINT64_MAX, keep_end = 0, written = 0;
+    DIR *d;
+    struct dirent *de;
+
+    mkdir(REC_DIR, 0755);
+    clean();
+
+    snprintf(rec->cfg.dir, sizeof(rec->cfg.dir), REC_DIR);
+    rec->cfg.file_mb = 1;
+    rec->cfg.files = 4;
+    assert(ale_rec_start(rec) == 0);
+    ale_rec_set_freq(rec, 7074000);
+
+    while (pos < (uint64_t) SECS * RATE)
+    {
+        for (int i = 0; i < BLOCK; i++)
+            block[i] = ramp(pos + i);
+
+        if (pos % (EVENT_SECS * RATE) == 0)
+            ale_rec_event(rec, REC_FRAME, pos / (EVENT_SECS * RATE), 123);
+        if (pos == (uint64_t) KEEP_AT * RATE)
+            ale_rec_keep(rec, KEEP_SECS);
+
+        t = now_ns();
+        ale_rec_audio(rec, block, BLOCK);
+        t = now_ns() - t;
+        total += t;
+        if (t > worst)
+            worst = t;
+        blocks++;
+        pos += BLOCK;
+
+        // 80 ms of audio every 1 ms
+        if (blocks % 4 == 0)
+            usleep(1000);
+    }
+    ale_rec_stop(rec);
+
+    printf("ale_rec_audio(): %.0f ns per %d sample block on average, %.0f ns worst\n",
+           total / blocks, BLOCK, worst);
+    printf("%lu samples written, %lu dropped, %lu files, %lu kept, %lu errors\n",
+           (unsigned long) rec->stats.samples, (unsigned long) rec->stats.dropped,
+           rec->stats.files, rec->stats.kept, rec->stats.errors);
+    assert(rec->stats.samples + rec->stats.dropped == pos);
+    assert(!rec->stats.errors);
+
+    d = opendir(REC_DIR);
+    assert(d);
+    while ((de = readdir(d)))
+    {
+        char name[256];
+        uint64_t first, end;
+        size_t len = strlen(de->d_name);
+
+        if (len < 5 || strcmp(de->d_name + len - 4, ".rec"))
+            continue;
+        snprintf(name, sizeof(name), "%.*s", (int) len - 4, de->d_name);
+        check_file(name, &first, &end, (unsigned int *) &events);
+        written += end - first;
+        if (!strncmp(name, "keep-", 5))
+        {
+            kept++;
+            keep_first = first < keep_first ? first : keep_first;
+            keep_end = end > keep_end ? end : keep_end;
+        }
+        else if (!files++)
+            check_replay(name, first, end);
+    }
+    closedir(d);
+
+    printf("%lu recording files and %lu kept ones read back, %lu events indexed\n",
+           files, kept, events);
+    assert(files == 4 && kept > 0);
+    assert(keep_first <= (uint64_t) (KEEP_AT - KEEP_SECS) * RATE);
+    assert(keep_end >= (uint64_t) (KEEP_AT + KEEP_SECS) * RATE);
+
+    clean();
+    rmdir(REC_DIR);
+    ale_rec_free(rec);
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/* Channel scanning engine test, against a simulated rig
+ *
+ * 10 channels, 200 ms dwell and 400 ms on one of them, on a simulated clock
+ * in 10 ms steps. The rig hook fails every 50th tune, every 40th timer
+ * fires 100 ms late. A station calls on channel 7 for 4 s; the simulated
+ * demodulator gets sync 120 ms after the rig is there and the call is on.
+ * Checked are the scan rate, the missed dwells against the injected
+ * faults, that the call holds the dwell until its end plus the hang time
+ * and that a hold stops the hops. Reported are the figures of the run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "ale_scan.h"
+
+#define STEP_MS 10
+#define CHANNELS 10
+#define DWELL_MS 200
+#define LONG_DWELL_MS 400
+#define CALL_CH 7
+#define CALL_START_MS 20000
+#define CALL_MS 4000
+#define SYNC_MS 120
+#define LATE_EVERY 40
+#define LATE_MS 100
+#define FAIL_EVERY 50
+
+struct sim_rig {
+    uint32_t freq_hz;
+    uint64_t tuned_at;
+    unsigned long tunes;
+    uint64_t now;
+    uint64_t on_call_ms;            // time spent on the calling channel during the call
+};
+
+static int rig_tune(void *arg, uint32_t freq_hz)
+{
+    struct sim_rig *rig = arg;
+
+    rig->tunes++;
+    if (rig->tunes % FAIL_EVERY == 0)
+        return -1;
+    rig->freq_hz = freq_hz;
+    rig->tuned_at = rig->now;
+    return 0;
+}
+
+static uint32_t chan_freq(int i)
+{
+    return 3500000 + i * 1000000;
+}
+
+/// Runs the simulation from start to end, returns the late timers injected
+static unsigned long run(struct ale_scan *scan, struct sim_rig *rig, uint64_t start, uint64_t end,
+                         uint64_t *next)
+{
+    unsigned long ticks = 0, late = 0;
+
+    for (rig->now = start; rig->now < end; rig->now += STEP_MS)
+    {
+        bool call = rig->now >= CALL_START_MS && rig->now < CALL_START_MS + CALL_MS;
+        uint64_t since = rig->tuned_at > CALL_START_MS ? rig->tuned_at : CALL_START_MS;
+        bool on_call = call && rig->freq_hz == chan_freq(CALL_CH);
+
+        // the daemon reschedules its timer the same way
+        *next = ale_scan_detect(scan, on_call && rig->now - since >= SYNC_MS, rig->now);
+        if (on_call)
+            rig->on_call_ms += STEP_MS;
+
+        if (*next && rig->now >= *next)
+        {
+            // a timer firing late now and then
+            if (++ticks % LATE_EVERY == 0 && rig->now < *next + LATE_MS)
+            {
+                ticks--;
+                continue;
+            }
+            if (rig->now >= *next + LATE_MS)
+                late++;
+            *next = ale_scan_tick(scan, rig->now);
+        }
+    }
+    return late;
+}
+
+int main(void)
+{
+    static struct ale_scan scan;
+    struct sim_rig rig = { 0 };
+    struct ale_scan_list *list;
+    uint64_t next;
+    unsigned long late, hops;
+    float cycle_ms = (CHANNELS - 1) * DWELL_MS + LONG_DWELL_MS;
+
+    ale_scan_init(&scan);
+    assert(ale_scan_start(&scan, "hf", 0) < 0);
+    list = ale_scan_list_get(&scan, "hf", true);
+    assert(list && ale_scan_list_get(&scan, "hf", true) == list);
+    list->dwell_ms = DWELL_MS;
+    for (int i = 0; i < CHANNELS; i++)
+        assert(ale_scan_channel_add(list, chan_freq(i), 0) == 0);
+    assert(ale_scan_channel_add(list, chan_freq(3), LONG_DWELL_MS) == 0);
+    assert(list->count == CHANNELS);
+    assert(ale_scan_channel_add(ale_scan_list_get(&scan, "spare", true), 1800000, 0) == 0);
+    assert(ale_scan_add_hook(&scan, rig_tune, &rig) == 0);
+
+    assert(ale_scan_start(&scan, "hf", 0) == 0);
+    assert(rig.freq_hz == chan_freq(0) && ale_scan_freq(&scan) == chan_freq(0));
+    next = scan.dwell_end;
+
+    // scanning, then a call on channel 7
+    late = run(&scan, &rig, 0, 41000, &next);
+    printf("scan rate %.2f channels/s (%.2f nominal), %lu hops, %lu dwells, %lu missed "
+           "(%lu late timers, %lu rig errors), max %u ms late\n", scan.stats.rate,
+           CHANNELS * 1000 / cycle_ms, scan.stats.hops, scan.stats.dwells, scan.stats.missed, late,
+           scan.stats.hook_errors, scan.stats.max_late_ms);
+    printf("call on channel %d: %lu detections, %lu extended dwells, %.1f s of the %.1f s call heard\n",
+           CALL_CH, scan.stats.detections, scan.stats.extended, rig.on_call_ms / 1000.0, CALL_MS / 1000.0);
+
+    assert(fabsf(scan.stats.rate - CHANNELS * 1000 / cycle_ms) < 0.5);
+    assert(scan.stats.hook_errors == rig.tunes / FAIL_EVERY);
+    assert(scan.stats.missed >= late && scan.stats.missed <= late + scan.stats.hook_errors);
+    assert(scan.stats.detections >= 1 && scan.stats.extended >= 1);
+    assert(list->ch[CALL_CH].detections == scan.stats.detections);
+    // caught within one cycle and held to the end of the call
+    assert(rig.on_call_ms >= CALL_MS - cycle_ms - SYNC_MS);
+
+    // a call holds the channel
+    ale_scan_hold(&scan, true, 41000);
+    hops = scan.stats.hops;
+    assert(ale_scan_tick(&scan, 45000) == 0);
+    assert(scan.stats.hops == hops);
+    ale_scan_hold(&scan, false, 45000);
+    assert(ale_scan_tick(&scan, 45000) == 45000 + DWELL_MS ||
+           ale_scan_tick(&scan, 45000) == 45000 + LONG_DWELL_MS);
+    assert(ale_scan_goto(&scan, 5, 45010) == 0 && ale_scan_freq(&scan) == chan_freq(5));
+    assert(ale_scan_goto(&scan, CHANNELS, 45010) < 0);
+
+    // removing lists
+    assert(ale_scan_list_del(&scan, "spare") == 0);
+    assert(ale_scan_running(&scan) && scan.list == ale_scan_list_get(&scan, "hf", false));
+    assert(ale_scan_list_del(&scan, "hf") == 0 && !ale_scan_running(&scan));
+    assert(ale_scan_list_del(&scan, "hf") < 0);
+
+    printf("OK\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/* Frame level HF channel simulator used by the tests and benchmarks. */
+
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+#include "chan_sim.h"
+
+#define CHAN_STEP_MS 100
+
+static const struct {
+    const char *name;
+    double doppler_hz;
+} chan_profiles[_NUM_CHAN_PROFILES] = {
+    [CHAN_AWGN] = { "awgn", 0.0 },
+    [CHAN_MPG] = { "mpg", 0.1 },
+    [CHAN_MPM] = { "mpm", 0.5 },
+    [CHAN_MPP] = { "mpp", 1.0 },
+};
+
+const char *chan_profile_name(enum chan_profile profile)
+{
+    return chan_profiles[profile].name;
+}
+
+int chan_profile_by_name(const char *name)
+{
+    for (int i = 0; i < _NUM_CHAN_PROFILES; i++)
+    {
+        if (!strcasecmp(chan_profiles[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+// xorshift64*
+double chan_sim_rand(struct chan_sim *ch)
+{
+    ch->rng ^= ch->rng >> 12;
+    ch->rng ^= ch->rng << 25;
+    ch->rng ^= ch->rng >> 27;
+    return (double) ((ch->rng * 2685821657736338717ULL) >> 11) / (double) (1ULL << 53);
+}
+
+static double chan_sim_gauss(struct chan_sim *ch)
+{
+    double u1 = chan_sim_rand(ch);
+    double u2 = chan_sim_rand(ch);
+
+    if (u1 < 1e-300)
+        u1 = 1e-300;
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+void chan_sim_init(struct chan_sim *ch, enum chan_profile profile, double snr_db, uint64_t seed)
+{
+    memset(ch, 0, sizeof(*ch));
+    ch->profile = profile;
+    ch->snr_db = snr_db;
+    ch->rng = seed ? seed : 0x9e3779b97f4a7c15ULL;
+
+    for (int i = 0; i < 2; i++)
+    {
+        ch->path[i].re = chan_sim_gauss(ch) * M_SQRT1_2;
+        ch->path[i].im = chan_sim_gauss(ch) * M_SQRT1_2;
+    }
+    ch->last_snr_db = snr_db;
+}
+
+// Gauss-Markov update of the path gains, unit mean power
+static double chan_sim_step(struct chan_sim *ch)
+{
+    double rho = exp(-M_PI * chan_profiles[ch->profile].doppler_hz * CHAN_STEP_MS / 1000.0);
+    double sigma = sqrt((1.0 - rho * rho) / 2.0);
+    double power = 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+        ch->path[i].re = rho * ch->path[i].re + sigma * chan_sim_gauss(ch);
+        ch->path[i].im = rho * ch->path[i].im + sigma * chan_sim_gauss(ch);
+        power += ch->path[i].re * ch->path[i].re + ch->path[i].im * ch->path[i].im;
+    }
+
+    return power / 2.0;
+}
+
+bool chan_sim_frame(struct chan_sim *ch, const struct ale_mode *mode)
+{
+    double snr_lin = pow(10.0, ch->snr_db / 10.0);
+    double eff_db = ch->snr_db;
+
+    if (ch->profile != CHAN_AWGN)
+    {
+        // exponential effective SNR mapping over the frame duration
+        double beta = pow(10.0, mode->min_snr_db / 10.0);
+        int steps = mode->frame_ms / CHAN_STEP_MS + 1;
+        double acc = 0;
+
+        for (int i = 0; i < steps; i++)
+            acc += exp(-snr_lin * chan_sim_step(ch) / beta);
+
+        eff_db = 10.0 * log10(-beta * log(acc / steps) + 1e-12);
+    }
+
+    ch->last_snr_db = eff_db;
+
+    // 10% FER at min_snr_db, ~1.5 dB per decade of slope
+    double fer = 1.0 / (1.0 + exp(1.5 * (eff_db - mode->min_snr_db) + log(9.0)));
+
+    return chan_sim_rand(ch) >= fer;
+}
@@ -0,0 +1,46 @@
+/* Frame level HF channel simulator used by the tests and benchmarks.
+ *
+ * Each transmitted modem frame is given an effective SNR from a
+ * two-path Watterson-like fading process (CCIR profiles) and is then
+ * dropped with a probability taken from a logistic FER curve anchored on
+ * the mode's min_snr_db.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ale_mode.h"
+
+enum chan_profile {
+    CHAN_AWGN,
+    CHAN_MPG,   // CCIR good: 0.5 ms delay, 0.1 Hz doppler
+    CHAN_MPM,   // CCIR moderate: 1 ms delay, 0.5 Hz doppler
+    CHAN_MPP,   // CCIR poor: 2 ms delay, 1 Hz doppler
+    _NUM_CHAN_PROFILES
+};
+
+struct chan_path {
+    double re;
+    double im;
+};
+
+struct chan_sim {
+    enum chan_profile profile;
+    double snr_db;
+    uint64_t rng;
+    struct chan_path path[2];
+    double last_snr_db;     // effective SNR of the last frame
+};
+
+const char *chan_profile_name(enum chan_profile profile);
+int chan_profile_by_name(const char *name);
+
+void chan_sim_init(struct chan_sim *ch, enum chan_profile profile, double snr_db, uint64_t seed);
+
+/// Runs the channel over one frame of the given mode, returns true if decoded
+bool chan_sim_frame(struct chan_sim *ch, const struct ale_mode *mode);
+
+/// Uniform random number in [0, 1)
+double chan_sim_rand(struct chan_sim *ch);
@@ -0,0 +1,134 @@
+/* Sounding scheduler test, 48 hours of simulated time
+ *
+ * Eight channels with the LQA store behind the scheduler:
+ *  0, 1  other stations sound there every 10 minutes
+ *  2, 3  quiet, a station answers each of our soundings, steady SNR
+ *  4, 5  dead, nothing is ever heard
+ *  6     quiet, answered with an SNR all over the place
+ *  7     always busy, the demodulator syncs on traffic it can't decode
+ *
+ * Checked are that the airtime stays in the duty-cycle budget (no more
+ * than twice the duty in any hour, the duty plus the saved up window over
+ * the whole run), that the busy channel is never sounded, that dead
+ * channels back off, that an uncertain estimate is sounded more often
+ * than a steady one and a channel others keep fresh least. Reported are
+ * the soundings per channel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ale_sound.h"
+
+#define RUN_S (48 * 3600)
+#define CHANNELS 8
+#define AIRTIME_MS 1500
+#define DUTY 5
+#define STALE_S 600
+#define ANSWER_S 3
+
+static const uint32_t freqs[CHANNELS] = {
+    3596000, 5357000, 7102000, 10145000, 14109000, 18106000, 21096000, 24926000
+};
+
+static unsigned int soundings[CHANNELS];
+static time_t sound_time[RUN_S];    // per second: airtime started then
+static unsigned int sound_count;
+
+static float noise(float spread)
+{
+    return spread * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+int main(void)
+{
+    static struct ale_sound snd;
+    struct ale_lqa *lqa = ale_lqa_alloc(256);
+    time_t start = 1700000000, next = start, answer[CHANNELS] = { 0 };
+    unsigned long hour_ms = 0, max_hour_ms = 0;
+    time_t first = 0;
+
+    srand(1);
+    assert(lqa);
+    ale_sound_init(&snd, AIRTIME_MS, start);
+    snd.enabled = true;
+    snd.duty_permille = DUTY;
+    snd.stale_s = STALE_S;
+
+    assert(ale_sound_priority(&snd, lqa, freqs[0], start) >= 1.0f);
+
+    for (time_t now = start; now < start + RUN_S; now++)
+    {
+        int idx;
+
+        // the others
+        if ((now - start) % 600 == 0)
+        {
+            ale_lqa_update(lqa, freqs[0], "PY2ABC", 15 + noise(1), true, true, now);
+            ale_lqa_update(lqa, freqs[1], "PY5DEF", 12 + noise(1), true, true, now);
+        }
+        if ((now - start) % 10 == 0)
+            ale_sound_busy(&snd, freqs[7], now);
+        for (int i = 2; i < CHANNELS; i++)
+        {
+            if (answer[i] != now)
+                continue;
+            if (i == 6)
+                ale_lqa_update(lqa, freqs[i], "PU1XYZ", 10 + noise(12), true, true, now);
+            else if (i < 4)
+                ale_lqa_update(lqa, freqs[i], "PU1XYZ", 10 + noise(1), true, true, now);
+        }
+
+        if (now < next)
+            continue;
+        idx = ale_sound_pick(&snd, lqa, freqs, CHANNELS, now, &next);
+        assert(next > now);
+        if (idx < 0)
+            continue;
+
+        ale_sound_sent(&snd, freqs[idx], now);
+        soundings[idx]++;
+        sound_time[sound_count++] = now;
+        answer[idx] = now + ANSWER_S;
+        if (!first)
+            first = now;
+        // on the air until then
+        next = now + (AIRTIME_MS + 999) / 1000;
+    }
+
+    // airtime in every hour from each sounding on
+    for (unsigned int i = 0, j = 0; i < sound_count; i++)
+    {
+        while (j < sound_count && sound_time[j] < sound_time[i] + 3600)
+            j++;
+        hour_ms = (j - i) * AIRTIME_MS;
+        if (hour_ms > max_hour_ms)
+            max_hour_ms = hour_ms;
+    }
+
+    printf("%lu soundings, %.1f s of airtime (%.2f per mille), most in an hour %.1f s, "
+           "%lu picks without budget, %lu busy skips\n", snd.stats.soundings,
+           snd.stats.airtime_ms / 1000.0, snd.stats.airtime_ms / (double) RUN_S, max_hour_ms / 1000.0,
+           snd.stats.no_budget, snd.stats.busy);
+    for (int i = 0; i < CHANNELS; i++)
+        printf(" %8u Hz: %3u soundings, backoff %u\n", freqs[i], soundings[i],
+               ale_sound_channel(&snd, freqs[i])->backoff);
+
+    // the budget
+    assert(first - start >= AIRTIME_MS / DUTY);
+    assert(snd.stats.airtime_ms <= (unsigned long) RUN_S * DUTY + 3600UL * DUTY);
+    assert(max_hour_ms <= 2 * 3600UL * DUTY);
+    // busy, dead, uncertain and fresh channels
+    assert(soundings[7] == 0 && snd.stats.busy > 0);
+    assert(soundings[4] < soundings[2] / 2 && soundings[5] < soundings[3] / 2);
+    assert(ale_sound_channel(&snd, freqs[4])->backoff == ALE_SOUND_MAX_BACKOFF);
+    assert(ale_sound_channel(&snd, freqs[2])->backoff <= 1);
+    assert(soundings[6] > soundings[2]);
+    assert(soundings[0] < soundings[2] && soundings[1] < soundings[3]);
+
+    ale_lqa_free(lqa);
+    printf("OK\n");
+    return EXIT_SUCCESS;
+}
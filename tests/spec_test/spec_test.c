@@ -0,0 +1,111 @@
+/* Spectrum feed test
+ *
+ * Feeds 30 s of a half scale tone at the center of bin 100 through the
+ * spectrum feed, 40 times faster than real time, and reads the frames back
+ * through a viewer attachment of the shared memory segment: the tone must
+ * be in bin 100 at -6 dBFS, bins away from it well below, frames must come
+ * at the configured rate and the oldest ones must be overwritten. Then the
+ * bins and the rate are changed on the fly. Reported is the CPU time of
+ * the spectrum thread per FFT.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "ale_spec.h"
+
+#define RATE 8000
+#define BLOCK 160
+#define TONE_BIN 100
+
+static void feed(struct ale_spec *sp, unsigned int bins, unsigned int secs, uint64_t *pos)
+{
+    int16_t block[BLOCK];
+    double hz = (double) TONE_BIN * RATE / (2 * bins);
+
+    for (unsigned long b = 0; b < (unsigned long) secs * RATE / BLOCK; b++)
+    {
+        for (int i = 0; i < BLOCK; i++, (*pos)++)
+            block[i] = 16384 * sin(2 * M_PI * hz * *pos / RATE);
+        ale_spec_audio(sp, block, BLOCK);
+        // 20 ms of audio every 0.5 ms
+        usleep(500);
+    }
+    // let the spectrum thread catch up
+    while (circular_buf_size(sp->tee))
+        usleep(1000);
+}
+
+static void check_frame(const struct ale_spec_frame *frame, unsigned int bins)
+{
+    unsigned int peak = 0;
+
+    assert(frame->bins == bins && frame->ffts > 0);
+    for (unsigned int i = 0; i < bins; i++)
+        if (frame->db[i] > frame->db[peak])
+            peak = i;
+    assert(peak == TONE_BIN);
+    // -6 dBFS in 0.5 dB steps
+    assert(abs(frame->db[peak] - 243) <= 1);
+    for (unsigned int i = 0; i < bins; i++)
+        if (abs((int) i - TONE_BIN) > 4)
+            assert(frame->db[i] < frame->db[peak] - 120);
+}
+
+int main(void)
+{
+    struct ale_spec *sp = ale_spec_alloc(RATE);
+    const struct ale_spec_shm *shm;
+    static struct ale_spec_frame frame;
+    uint64_t pos = 0, frames;
+
+    assert(ale_spec_set(sp, 1000, 10) < 0);
+    assert(ale_spec_set(sp, 512, 0) < 0);
+    assert(ale_spec_set(sp, 512, 10) == 0);
+    assert(ale_spec_start(sp) == 0);
+    ale_spec_set_freq(sp, 7074000);
+
+    shm = ale_spec_attach();
+    assert(shm);
+    assert(shm->rate == RATE && shm->slots == ALE_SPEC_SLOTS);
+    assert(ale_spec_viewers(sp) == 1);
+
+    feed(sp, 512, 30, &pos);
+    frames = atomic_load(&shm->frames);
+    printf("512 bins at 10 frames/s: %lu frames, %lu FFTs, %lu samples dropped, "
+           "%.1f us CPU per FFT\n", (unsigned long) frames, (unsigned long) atomic_load(&sp->stats.ffts),
+           (unsigned long) atomic_load(&sp->stats.dropped),
+           atomic_load(&sp->stats.cpu_ns) / 1e3 / atomic_load(&sp->stats.ffts));
+    assert(frames >= 30 * 10 - 2 && frames <= 30 * 10);
+    assert(ale_spec_read(shm, frames, &frame) == 1);
+    assert(ale_spec_read(shm, 0, &frame) == -1);
+    assert(ale_spec_read(shm, frames - ALE_SPEC_SLOTS - 1, &frame) == -1);
+    for (uint64_t n = frames - ALE_SPEC_SLOTS; n < frames; n++)
+    {
+        assert(ale_spec_read(shm, n, &frame) == 0);
+        assert(frame.freq_hz == 7074000);
+        check_frame(&frame, 512);
+    }
+
+    // bigger FFTs than the frame period
+    assert(ale_spec_set(sp, 4096, 25) == 0);
+    feed(sp, 4096, 10, &pos);
+    assert(ale_spec_read(shm, atomic_load(&shm->frames) - 1, &frame) == 0);
+    check_frame(&frame, 4096);
+    printf("4096 bins at 25 frames/s: %lu frames in 10 s\n",
+           (unsigned long) (atomic_load(&shm->frames) - frames));
+    // a new FFT size starts over, the first second fills the FFT
+    assert(atomic_load(&shm->frames) - frames >= 9 * 25 - 2);
+
+    ale_spec_detach(shm);
+    assert(ale_spec_viewers(sp) == 0);
+    ale_spec_free(sp);
+    printf("OK\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,363 @@
+/* TX priority class test
+ *
+ * A bulk transfer keeps its ring full while an interactive client writes a
+ * short line every few frames and an express message shows up now and
+ * then. Frames are filled from the priority queue, and for comparison from
+ * a single FIFO ring holding everything. Reported is how many frames the
+ * small writes waited for, and the bulk share of the frames when the
+ * interactive class is saturated as well.
+ *
+ * Then all the classes are sent at once to a peer queue, over the ARQ with
+ * lost frames and straight in pieces of a few bytes, and each RX ring must
+ * get exactly the stream of its class.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+
+#include "ale_buf.h"
+#include "ale_mode.h"
+#include "ale_arq.h"
+#include "ale_txq.h"
+
+#define RING_SIZE 16384
+#define FRAME 126           // datac3 payload
+#define FRAMES 4000
+#define LINE 40
+#define LINE_EVERY 7
+#define EXPRESS 16
+#define EXPRESS_EVERY 53
+#define TURNS 300
+#define LOSS_EVERY 7
+
+struct write {
+    uint64_t end;           // stream position of its last byte
+    unsigned int frame;
+};
+
+struct lat {
+    struct write w[FRAMES];
+    unsigned int head, count;
+    unsigned long samples;
+    unsigned long sum;
+    unsigned int max;
+};
+
+struct station {
+    uint8_t tx_mem[ALE_TX_NUM_CLASSES][RING_SIZE];
+    uint8_t rx_mem[ALE_TX_NUM_CLASSES][RING_SIZE];
+    cbuf_handle_t tx[ALE_TX_NUM_CLASSES];
+    cbuf_handle_t rx[ALE_TX_NUM_CLASSES];
+    struct ale_txq *txq;
+    struct ale_arq *arq;
+    uint64_t sent[ALE_TX_NUM_CLASSES];      // stream positions written
+    uint64_t checked[ALE_TX_NUM_CLASSES];   // and received intact
+};
+
+static struct station sta, stb;
+static uint8_t fifo_mem[RING_SIZE];
+
+static void lat_put(struct lat *l, cbuf_handle_t ring, unsigned int frame)
+{
+    l->w[l->count++] = (struct write) {
+        .end = circular_buf_read_pos(ring) + circular_buf_size(ring),
+        .frame = frame,
+    };
+}
+
+static void lat_check(struct lat *l, cbuf_handle_t ring, unsigned int frame)
+{
+    uint64_t pos = circular_buf_read_pos(ring);
+
+    while (l->head < l->count && l->w[l->head].end <= pos)
+    {
+        unsigned int wait = frame - l->w[l->head].frame;
+
+        l->samples++;
+        l->sum += wait;
+        if (wait > l->max)
+            l->max = wait;
+        l->head++;
+    }
+}
+
+static void fill(cbuf_handle_t ring, size_t len)
+{
+    uint8_t buf[RING_SIZE];
+
+    memset(buf, 0x55, len);
+    assert(circular_buf_free_size(ring) >= len);
+    circular_buf_put_range(ring, buf, len);
+}
+
+static void top_up(cbuf_handle_t ring)
+{
+    fill(ring, circular_buf_free_size(ring));
+}
+
+static void report(const char *name, const struct lat *l)
+{
+    printf("  %-12s %5lu writes, wait avg %6.1f frames, max %4u\n", name, l->samples,
+           l->samples ? (double) l->sum / l->samples : 0.0, l->max);
+}
+
+static void run_fifo(void)
+{
+    cbuf_handle_t ring = circular_buf_init(fifo_mem, RING_SIZE);
+    static struct lat line, expr;
+    uint8_t frame[FRAME];
+
+    for (unsigned int f = 0; f < FRAMES; f++)
+    {
+        if (!(f % LINE_EVERY))
+        {
+            fill(ring, LINE);
+            lat_put(&line, ring, f);
+        }
+        if (!(f % EXPRESS_EVERY))
+        {
+            fill(ring, EXPRESS);
+            lat_put(&expr, ring, f);
+        }
+        // the bulk writer takes whatever room is left, leaving space for the next lines
+        if (circular_buf_free_size(ring) > 2 * (LINE + EXPRESS))
+            fill(ring, circular_buf_free_size(ring) - 2 * (LINE + EXPRESS));
+
+        circular_buf_get_range(ring, frame, FRAME);
+        lat_check(&line, ring, f + 1);
+        lat_check(&expr, ring, f + 1);
+    }
+
+    printf("single ring:\n");
+    report("interactive", &line);
+    report("express", &expr);
+    circular_buf_free(ring);
+}
+
+static void station_init(struct station *st)
+{
+    memset(st->sent, 0, sizeof(st->sent));
+    memset(st->checked, 0, sizeof(st->checked));
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        st->tx[i] = circular_buf_init(st->tx_mem[i], RING_SIZE);
+        st->rx[i] = circular_buf_init(st->rx_mem[i], RING_SIZE);
+    }
+    st->txq = ale_txq_alloc(st->tx, st->rx);
+    st->arq = ale_arq_alloc(st->tx[ALE_TX_BULK], st->rx[ALE_TX_BULK], ale_mode_get(ALE_MODE_DATAC3));
+    ale_arq_set_io(st->arq, &st->txq->io);
+}
+
+static void station_free(struct station *st)
+{
+    ale_arq_free(st->arq);
+    ale_txq_free(st->txq);
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+    {
+        circular_buf_free(st->tx[i]);
+        circular_buf_free(st->rx[i]);
+    }
+}
+
+// byte pos of the stream of a class, each one tells itself apart
+static uint8_t pattern(int cls, uint64_t pos)
+{
+    return (pos * (2 * cls + 3) + (pos >> 8) + 85 * cls) & 0xff;
+}
+
+// writes up to len bytes of the stream of the class
+static void stream_put(struct station *st, int cls, size_t len)
+{
+    uint8_t buf[RING_SIZE];
+
+    if (len > circular_buf_free_size(st->tx[cls]))
+        len = circular_buf_free_size(st->tx[cls]);
+    for (size_t i = 0; i < len; i++)
+        buf[i] = pattern(cls, st->sent[cls] + i);
+    circular_buf_put_range(st->tx[cls], buf, len);
+    st->sent[cls] += len;
+}
+
+// reads up to len bytes of a class from the peer's RX ring, false if they
+// are not the stream the peer wrote
+static bool stream_check(struct station *st, const struct station *from, int cls, size_t len)
+{
+    uint8_t buf[RING_SIZE];
+
+    if (len > circular_buf_size(st->rx[cls]))
+        len = circular_buf_size(st->rx[cls]);
+    if (!len || circular_buf_get_range(st->rx[cls], buf, len))
+        return true;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (buf[i] != pattern(cls, st->checked[cls] + i))
+            return false;
+    }
+    st->checked[cls] += len;
+    return st->checked[cls] <= from->sent[cls];
+}
+
+static void run_txq(void)
+{
+    cbuf_handle_t *rings = sta.tx;
+    static struct lat line, expr;
+    struct ale_txq *txq;
+    uint8_t frame[FRAME];
+
+    station_init(&sta);
+    txq = sta.txq;
+
+    for (unsigned int f = 0; f < FRAMES; f++)
+    {
+        if (!(f % LINE_EVERY))
+        {
+            fill(rings[ALE_TX_INTERACTIVE], LINE);
+            lat_put(&line, rings[ALE_TX_INTERACTIVE], f);
+        }
+        if (!(f % EXPRESS_EVERY))
+        {
+            fill(rings[ALE_TX_EXPRESS], EXPRESS);
+            lat_put(&expr, rings[ALE_TX_EXPRESS], f);
+        }
+        top_up(rings[ALE_TX_BULK]);
+
+        // whole records only, a header does not fit in the last bytes
+        assert(txq->io.read(txq->io.priv, frame, FRAME) >= FRAME - TXQ_REC_HDR);
+        lat_check(&line, rings[ALE_TX_INTERACTIVE], f + 1);
+        lat_check(&expr, rings[ALE_TX_EXPRESS], f + 1);
+    }
+
+    printf("priority classes:\n");
+    report("interactive", &line);
+    report("express", &expr);
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+        printf("  %-12s %8lu bytes sent, queueing delay avg %.1f ms\n", ale_txq_class_names[i],
+               (unsigned long) txq->cls[i].stats.bytes, ale_txq_latency(&txq->cls[i].stats));
+
+    // both weighted classes saturated: they share by weight
+    uint64_t base[ALE_TX_NUM_CLASSES];
+
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+        base[i] = txq->cls[i].stats.bytes;
+    for (unsigned int f = 0; f < FRAMES; f++)
+    {
+        top_up(rings[ALE_TX_INTERACTIVE]);
+        top_up(rings[ALE_TX_BULK]);
+        assert(txq->io.read(txq->io.priv, frame, FRAME) >= FRAME - TXQ_REC_HDR);
+    }
+
+    uint64_t inter = txq->cls[ALE_TX_INTERACTIVE].stats.bytes - base[ALE_TX_INTERACTIVE];
+    uint64_t bulk = txq->cls[ALE_TX_BULK].stats.bytes - base[ALE_TX_BULK];
+
+    printf("saturated, weights %u:%u: interactive %.1f%%, bulk %.1f%% of the bytes\n",
+           txq->cls[ALE_TX_INTERACTIVE].weight, txq->cls[ALE_TX_BULK].weight,
+           100.0 * inter / (inter + bulk), 100.0 * bulk / (inter + bulk));
+    assert(bulk > 0 && inter > 3 * bulk);
+
+    station_free(&sta);
+
+    // the express class never waits behind a full frame of the others
+    assert(expr.max <= 1);
+}
+
+// all the classes busy at once, the interactive reader slow enough to fill
+// its RX ring now and then
+static void run_streams(void)
+{
+    uint8_t frame[ARQ_MAX_PAYLOAD];
+    const struct ale_mode *mode;
+    unsigned int n = 0;
+    bool intact = true, full = false;
+    int len;
+
+    station_init(&sta);
+    station_init(&stb);
+
+    for (unsigned int t = 0; t < TURNS; t++)
+    {
+        if (!(t % 3))
+            stream_put(&sta, ALE_TX_EXPRESS, EXPRESS + t % 11);
+        stream_put(&sta, ALE_TX_INTERACTIVE, 3 * LINE + t % 17);
+        stream_put(&sta, ALE_TX_BULK, RING_SIZE);
+
+        ale_arq_turn_begin(sta.arq);
+        while ((len = ale_arq_tx_frame(sta.arq, frame, sizeof(frame), &mode)) > 0)
+        {
+            if (++n % LOSS_EVERY)
+                ale_arq_rx_frame(stb.arq, frame, len, NULL);
+        }
+
+        intact &= stream_check(&stb, &sta, ALE_TX_EXPRESS, RING_SIZE);
+        intact &= stream_check(&stb, &sta, ALE_TX_BULK, 700 + t % 300);
+        if (!(t % 10))
+            intact &= stream_check(&stb, &sta, ALE_TX_INTERACTIVE, 400);
+        full |= circular_buf_free_size(stb.rx[ALE_TX_INTERACTIVE]) < FRAME;
+
+        // acks back, nothing lost
+        ale_arq_turn_begin(stb.arq);
+        while ((len = ale_arq_tx_frame(stb.arq, frame, sizeof(frame), &mode)) > 0)
+            ale_arq_rx_frame(sta.arq, frame, len, NULL);
+    }
+
+    printf("class streams over the ARQ, 1 frame in %d lost:\n", LOSS_EVERY);
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+        printf("  %-12s %8lu of %8lu bytes received intact\n", ale_txq_class_names[i],
+               (unsigned long) stb.checked[i], (unsigned long) sta.sent[i]);
+    printf("  interactive RX ring %s\n", full ? "filled up, frames held back" : "never full");
+    assert(intact && full && !stb.txq->rx_errors);
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+        assert(stb.checked[i] > 0);
+    assert(stb.checked[ALE_TX_INTERACTIVE] > 10 * LINE);
+
+    station_free(&sta);
+    station_free(&stb);
+
+    // no ARQ: the records come in pieces that split their headers
+    station_init(&sta);
+    station_init(&stb);
+    for (unsigned int f = 0; f < FRAMES; f++)
+    {
+        stream_put(&sta, f % ALE_TX_NUM_CLASSES, LINE + f % 23);
+
+        size_t got = sta.txq->io.read(sta.txq->io.priv, frame, FRAME);
+
+        for (size_t pos = 0, piece; pos < got; pos += piece)
+        {
+            piece = 1 + (pos + f) % 5;
+            if (piece > got - pos)
+                piece = got - pos;
+            assert(stb.txq->io.write(stb.txq->io.priv, frame + pos, piece));
+        }
+        for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+            intact &= stream_check(&stb, &sta, i, RING_SIZE);
+    }
+    for (int i = 0; i < ALE_TX_NUM_CLASSES; i++)
+        assert(stb.checked[i] + circular_buf_size(sta.tx[i]) == sta.sent[i]);
+    assert(intact);
+
+    // a header no sender writes ends the stream
+    frame[0] = 0xc0;
+    frame[1] = 0x01;
+    assert(!stb.txq->io.write(stb.txq->io.priv, frame, 3));
+    assert(stb.txq->rx_error && !stb.txq->io.write(stb.txq->io.priv, frame, 0));
+    ale_txq_reset(stb.txq);
+    assert(!stb.txq->rx_error);
+    printf("class streams in pieces of 1 to 5 bytes: intact, bad header refused\n");
+
+    station_free(&sta);
+    station_free(&stb);
+}
+
+int main(void)
+{
+    run_fifo();
+    run_txq();
+    run_streams();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,391 @@
+/* Host socket backend benchmark: poll loop versus io_uring
+ *
+ * -c client threads stream -s MB each over loopback TCP to a server loop
+ * that lands the bytes in one data ring per client, the way the host ports
+ * fill the TX data ring, and drains the ring again like the ARQ would.
+ *
+ *  poll:      poll() over all sockets, readv() into the free ring region
+ *  multishot: one multishot recv per socket with provided buffers, copied
+ *             into the ring (the KISS / command port path)
+ *  fixed:     the rings are registered buffers, read_fixed lands straight
+ *             in the free ring region (the VARA data port path)
+ *
+ * Both io_uring modes re-arm all sockets and submit once per loop turn.
+ * Reported are MB/s and the syscalls the server loop made per MB.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <liburing.h>
+
+#include "ale_buf.h"
+
+#define TCP_PORT 18310
+#define MAX_CLIENTS 64
+#define RING_SIZE (64 * 1024)
+#define CHUNK (16 * 1024)
+#define PBUFS 64
+#define PBUF_SIZE 4096
+
+static struct {
+    int clients;
+    size_t bytes;
+} cfg = { 4, 64 << 20 };
+
+struct conn
+{
+    int fd;
+    bool open;
+    cbuf_handle_t ring;
+    int index;
+};
+
+static struct conn conns[MAX_CLIENTS];
+static size_t total_rx;
+static unsigned long syscalls;
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *client_thread(void *arg)
+{
+    struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(TCP_PORT) };
+    uint8_t buf[CHUNK];
+    size_t left = cfg.bytes;
+    int fd;
+
+    memset(buf, 0x55, sizeof(buf));
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0)
+    {
+        perror("connect");
+        exit(EXIT_FAILURE);
+    }
+
+    while (left)
+    {
+        ssize_t n = send(fd, buf, left < CHUNK ? left : CHUNK, 0);
+
+        if (n <= 0)
+            break;
+        left -= n;
+    }
+    close(fd);
+    return NULL;
+}
+
+/// What the ARQ does with the TX ring: take everything out
+static void drain(struct conn *c)
+{
+    size_t len = circular_buf_size(c->ring);
+
+    circular_buf_consume(c->ring, len);
+    total_rx += len;
+}
+
+static int open_conns(pthread_t *threads)
+{
+    struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(TCP_PORT) };
+    int lfd, one = 1;
+
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    lfd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(lfd, (struct sockaddr *) &sa, sizeof(sa)) < 0 || listen(lfd, MAX_CLIENTS) < 0)
+    {
+        perror("listen");
+        return -1;
+    }
+
+    for (int i = 0; i < cfg.clients; i++)
+        pthread_create(&threads[i], NULL, client_thread, NULL);
+
+    for (int i = 0; i < cfg.clients; i++)
+    {
+        conns[i].fd = accept(lfd, NULL, NULL);
+        conns[i].open = true;
+        conns[i].index = i;
+        conns[i].ring = circular_buf_init(malloc(RING_SIZE), RING_SIZE);
+    }
+    close(lfd);
+    return 0;
+}
+
+static void close_conns(pthread_t *threads)
+{
+    for (int i = 0; i < cfg.clients; i++)
+    {
+        pthread_join(threads[i], NULL);
+        free(conns[i].ring->buffer);
+        circular_buf_free(conns[i].ring);
+    }
+}
+
+static void run_poll(void)
+{
+    struct pollfd pfd[MAX_CLIENTS];
+    int open = cfg.clients;
+
+    for (int i = 0; i < cfg.clients; i++)
+    {
+        pfd[i].fd = conns[i].fd;
+        pfd[i].events = POLLIN;
+    }
+
+    while (open)
+    {
+        poll(pfd, cfg.clients, -1);
+        syscalls++;
+
+        for (int i = 0; i < cfg.clients; i++)
+        {
+            struct iovec iov[2];
+            int iovcnt;
+            ssize_t n;
+
+            if (!(pfd[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+
+            iovcnt = circular_buf_free_iov(conns[i].ring, iov);
+            n = readv(conns[i].fd, iov, iovcnt);
+            syscalls++;
+            if (n <= 0)
+            {
+                close(conns[i].fd);
+                pfd[i].fd = -1;
+                open--;
+                continue;
+            }
+            circular_buf_commit(conns[i].ring, n);
+            drain(&conns[i]);
+        }
+    }
+}
+
+static void arm_multishot(struct io_uring *ring, struct conn *c)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+
+    io_uring_prep_recv_multishot(sqe, c->fd, NULL, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    io_uring_sqe_set_data(sqe, c);
+}
+
+static void arm_fixed(struct io_uring *ring, struct conn *c)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+    struct iovec iov[2];
+
+    circular_buf_free_iov(c->ring, iov);
+    io_uring_prep_read_fixed(sqe, c->fd, iov[0].iov_base, iov[0].iov_len, 0, c->index);
+    io_uring_sqe_set_data(sqe, c);
+}
+
+static int run_uring(bool fixed)
+{
+    struct io_uring ring;
+    struct io_uring_buf_ring *br = NULL;
+    struct iovec iov[MAX_CLIENTS];
+    uint8_t *bufs = NULL;
+    int open = cfg.clients;
+    int rc;
+
+    rc = io_uring_queue_init(256, &ring, 0);
+    if (rc < 0)
+    {
+        fprintf(stderr, "io_uring: %s\n", strerror(-rc));
+        return rc;
+    }
+
+    if (fixed)
+    {
+        for (int i = 0; i < cfg.clients; i++)
+        {
+            iov[i].iov_base = conns[i].ring->buffer;
+            iov[i].iov_len = RING_SIZE;
+        }
+        rc = io_uring_register_buffers(&ring, iov, cfg.clients);
+        if (rc < 0)
+        {
+            fprintf(stderr, "register buffers: %s\n", strerror(-rc));
+            return rc;
+        }
+        for (int i = 0; i < cfg.clients; i++)
+            arm_fixed(&ring, &conns[i]);
+    }
+    else
+    {
+        br = io_uring_setup_buf_ring(&ring, PBUFS, 0, 0, &rc);
+        if (!br)
+        {
+            fprintf(stderr, "buffer ring: %s\n", strerror(-rc));
+            return rc;
+        }
+        bufs = malloc(PBUFS * PBUF_SIZE);
+        for (int i = 0; i < PBUFS; i++)
+            io_uring_buf_ring_add(br, bufs + i * PBUF_SIZE, PBUF_SIZE, i,
+                                  io_uring_buf_ring_mask(PBUFS), i);
+        io_uring_buf_ring_advance(br, PBUFS);
+        for (int i = 0; i < cfg.clients; i++)
+            arm_multishot(&ring, &conns[i]);
+    }
+
+    while (open)
+    {
+        struct io_uring_cqe *cqe;
+        unsigned int head, count = 0;
+
+        // submits the re-arms of the last turn and waits in one call
+        io_uring_submit_and_wait(&ring, 1);
+        syscalls++;
+
+        io_uring_for_each_cqe(&ring, head, cqe)
+        {
+            struct conn *c = io_uring_cqe_get_data(cqe);
+            int res = cqe->res;
+
+            count++;
+            if (fixed)
+            {
+                if (res <= 0)
+                {
+                    close(c->fd);
+                    open--;
+                    continue;
+                }
+                circular_buf_commit(c->ring, res);
+                drain(c);
+                arm_fixed(&ring, c);
+                continue;
+            }
+
+            if (cqe->flags & IORING_CQE_F_BUFFER)
+            {
+                unsigned int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                uint8_t *buf = bufs + bid * PBUF_SIZE;
+
+                if (res > 0)
+                {
+                    struct iovec fiov[2];
+                    size_t first;
+
+                    circular_buf_free_iov(c->ring, fiov);
+                    first = (size_t) res < fiov[0].iov_len ? (size_t) res : fiov[0].iov_len;
+                    memcpy(fiov[0].iov_base, buf, first);
+                    memcpy(fiov[1].iov_base, buf + first, res - first);
+                    circular_buf_commit(c->ring, res);
+                    drain(c);
+                }
+                io_uring_buf_ring_add(br, buf, PBUF_SIZE, bid, io_uring_buf_ring_mask(PBUFS), 0);
+                io_uring_buf_ring_advance(br, 1);
+            }
+
+            if (res == 0 || (res < 0 && res != -ENOBUFS))
+            {
+                close(c->fd);
+                open--;
+            }
+            else if (!(cqe->flags & IORING_CQE_F_MORE))
+                arm_multishot(&ring, c);
+        }
+        io_uring_cq_advance(&ring, count);
+    }
+
+    io_uring_queue_exit(&ring);
+    free(bufs);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-c clients] [-s MB per client] [-m poll|multishot|fixed|all]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *modes[] = { "poll", "multishot", "fixed" };
+    const char *mode = "all";
+    pthread_t threads[MAX_CLIENTS];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:s:m:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            cfg.clients = atoi(optarg);
+            break;
+        case 's':
+            cfg.bytes = (size_t) atoi(optarg) << 20;
+            break;
+        case 'm':
+            mode = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (cfg.clients < 1 || cfg.clients > MAX_CLIENTS)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%d clients x %zu MB over loopback\n", cfg.clients, cfg.bytes >> 20);
+    for (int m = 0; m < 3; m++)
+    {
+        double start, elapsed, mb;
+        int rc = 0;
+
+        if (strcmp(mode, "all") && strcmp(mode, modes[m]))
+            continue;
+
+        total_rx = 0;
+        syscalls = 0;
+        if (open_conns(threads) < 0)
+            return EXIT_FAILURE;
+
+        start = now_s();
+        if (m == 0)
+            run_poll();
+        else
+            rc = run_uring(m == 2);
+        elapsed = now_s() - start;
+        if (rc < 0)
+        {
+            // let the clients run into the closed socket
+            for (int i = 0; i < cfg.clients; i++)
+                close(conns[i].fd);
+            close_conns(threads);
+            continue;
+        }
+        close_conns(threads);
+
+        mb = total_rx / 1e6;
+        printf("%-10s %8.1f MB/s  %8.1f syscalls/MB  %s\n", modes[m], mb / elapsed,
+               syscalls / mb, total_rx == cfg.bytes * cfg.clients ? "ok" : "SHORT");
+    }
+
+    return EXIT_SUCCESS;
+}